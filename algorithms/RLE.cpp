@@ -1,5 +1,6 @@
 #include "RLE.h"
 #include "logger.h"
+#include <limits>
 
 bool RLE::compress(const std::vector<uint8_t>& input, std::vector<uint8_t>& output) {
     if (input.empty()) {
@@ -7,59 +8,90 @@ bool RLE::compress(const std::vector<uint8_t>& input, std::vector<uint8_t>& outp
         output.clear();
         return true;
     }
-    
+
     output.clear();
     output.reserve(input.size() * 2); // Reserve space to avoid reallocations
-    
+
+    compressBlock(input.data(), input.size(), output);
+
+    Logger::info("RLE Compression: " + std::to_string(input.size()) +
+                 " bytes -> " + std::to_string(output.size()) + " bytes");
+    return true;
+}
+
+bool RLE::decompress(const std::vector<uint8_t>& input, std::vector<uint8_t>& output) {
+    if (input.empty()) {
+        Logger::warning("RLE: Input data is empty");
+        output.clear();
+        return true;
+    }
+
+    output.clear();
+
+    if (!decompressBlock(input.data(), input.size(), output,
+                         std::numeric_limits<size_t>::max())) {
+        return false;
+    }
+
+    Logger::info("RLE Decompression: " + std::to_string(input.size()) +
+                 " bytes -> " + std::to_string(output.size()) + " bytes");
+    return true;
+}
+
+bool RLE::compressBlock(const uint8_t* input, size_t size, std::vector<uint8_t>& output) {
     size_t i = 0;
-    while (i < input.size()) {
+    while (i < size) {
         uint8_t currentByte = input[i];
         uint8_t count = 1;
-        
+
         // Count consecutive identical bytes
-        while (i + count < input.size() && 
-               input[i + count] == currentByte && 
+        while (i + count < size &&
+               input[i + count] == currentByte &&
                count < MAX_RUN_LENGTH) {
             count++;
         }
-        
+
         // Write count and byte value
         output.push_back(count);
         output.push_back(currentByte);
-        
+
         i += count;
     }
-    
-    Logger::info("RLE Compression: " + std::to_string(input.size()) + 
-                 " bytes -> " + std::to_string(output.size()) + " bytes");
+
     return true;
 }
 
-bool RLE::decompress(const std::vector<uint8_t>& input, std::vector<uint8_t>& output) {
-    if (input.empty()) {
-        Logger::warning("RLE: Input data is empty");
-        output.clear();
-        return true;
-    }
-    
-    if (input.size() % 2 != 0) {
+bool RLE::decompressBlock(const uint8_t* input, size_t size,
+                          std::vector<uint8_t>& output, size_t maxOutput) {
+    if (size % 2 != 0) {
         Logger::error("RLE: Invalid compressed data (odd number of bytes)");
         return false;
     }
-    
-    output.clear();
-    
-    for (size_t i = 0; i < input.size(); i += 2) {
+
+    // Walk the pairs once to size the output, so corrupt counts are rejected
+    // before anything is allocated
+    size_t decodedSize = 0;
+    for (size_t i = 0; i < size; i += 2) {
+        decodedSize += input[i];
+    }
+    if (decodedSize > maxOutput) {
+        Logger::error("RLE: Decoded size exceeds expected block size");
+        return false;
+    }
+
+    size_t offset = output.size();
+    output.resize(offset + decodedSize);
+    uint8_t* out = output.data() + offset;
+
+    for (size_t i = 0; i < size; i += 2) {
         uint8_t count = input[i];
         uint8_t value = input[i + 1];
-        
+
         // Append 'count' copies of 'value'
         for (uint8_t j = 0; j < count; j++) {
-            output.push_back(value);
+            *out++ = value;
         }
     }
-    
-    Logger::info("RLE Decompression: " + std::to_string(input.size()) + 
-                 " bytes -> " + std::to_string(output.size()) + " bytes");
+
     return true;
-}
\ No newline at end of file
+}
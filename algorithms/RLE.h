@@ -14,6 +14,13 @@ public:
     bool decompress(const std::vector<uint8_t>& input, 
                    std::vector<uint8_t>& output) override;
 
+    bool compressBlock(const uint8_t* input, size_t size,
+                       std::vector<uint8_t>& output) override;
+
+    bool decompressBlock(const uint8_t* input, size_t size,
+                         std::vector<uint8_t>& output,
+                         size_t maxOutput) override;
+
 private:
     // Maximum run length for RLE
     static constexpr uint8_t MAX_RUN_LENGTH = 255;
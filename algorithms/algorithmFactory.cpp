@@ -4,20 +4,29 @@
 #include "logger.h"
 #include <algorithm>
 
-std::unique_ptr<CompressionAlgorithm> AlgorithmFactory::createAlgorithm(AlgorithmType type) {
+std::unique_ptr<CompressionAlgorithm> AlgorithmFactory::createAlgorithm(
+    AlgorithmType type, std::pmr::memory_resource* resource) {
+    std::unique_ptr<CompressionAlgorithm> algorithm;
     switch (type) {
         case AlgorithmType::HUFFMAN:
             Logger::info("Creating Huffman algorithm instance");
-            return std::make_unique<Huffman>();
+            algorithm = std::make_unique<Huffman>();
+            break;
             
         case AlgorithmType::RLE:
             Logger::info("Creating RLE algorithm instance");
-            return std::make_unique<RLE>();
+            algorithm = std::make_unique<RLE>();
+            break;
             
         default:
             Logger::error("Unsupported algorithm type");
             return nullptr;
     }
+    
+    if (resource) {
+        algorithm->setMemoryResource(resource);
+    }
+    return algorithm;
 }
 
 AlgorithmType AlgorithmFactory::getAlgorithmType(const std::string& name) {
@@ -8,8 +8,10 @@
 // Factory pattern for creating compression algorithms
 class AlgorithmFactory {
 public:
-    // Create algorithm based on type
-    static std::unique_ptr<CompressionAlgorithm> createAlgorithm(AlgorithmType type);
+    // Create algorithm based on type; temporaries come from resource when
+    // one is given (see CompressionAlgorithm::setMemoryResource)
+    static std::unique_ptr<CompressionAlgorithm> createAlgorithm(
+        AlgorithmType type, std::pmr::memory_resource* resource = nullptr);
     
     // Get algorithm type from string
     static AlgorithmType getAlgorithmType(const std::string& name);
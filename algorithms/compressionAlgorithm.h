@@ -4,26 +4,50 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <cstddef>
+#include <memory_resource>
 
 // Abstract base class for compression algorithms (OOP - Polymorphism)
 class CompressionAlgorithm {
 protected:
     std::string algorithmName;
-    
+
+    // Where codec temporaries (trees, tables) are allocated
+    std::pmr::memory_resource* memoryResource;
+
 public:
-    CompressionAlgorithm(const std::string& name) : algorithmName(name) {}
+    CompressionAlgorithm(const std::string& name)
+        : algorithmName(name), memoryResource(std::pmr::get_default_resource()) {}
     virtual ~CompressionAlgorithm() = default;
-    
+
     // Pure virtual functions - must be implemented by derived classes
-    virtual bool compress(const std::vector<uint8_t>& input, 
+    virtual bool compress(const std::vector<uint8_t>& input,
                          std::vector<uint8_t>& output) = 0;
-    
-    virtual bool decompress(const std::vector<uint8_t>& input, 
+
+    virtual bool decompress(const std::vector<uint8_t>& input,
                            std::vector<uint8_t>& output) = 0;
-    
+
+    // Block-level entry points used by the frame layer (see frameFormat.h).
+    // Both append to output instead of replacing it, so a whole frame can be
+    // built in one buffer. decompressBlock fails rather than produce more
+    // than maxOutput bytes, which stops corrupt input from allocating.
+    virtual bool compressBlock(const uint8_t* input, size_t size,
+                               std::vector<uint8_t>& output) = 0;
+
+    virtual bool decompressBlock(const uint8_t* input, size_t size,
+                                 std::vector<uint8_t>& output,
+                                 size_t maxOutput) = 0;
+
+    // Route codec temporaries to a caller-owned resource, typically a
+    // per-request arena that is released in one step
+    virtual void setMemoryResource(std::pmr::memory_resource* resource) {
+        memoryResource = resource ? resource : std::pmr::get_default_resource();
+    }
+    std::pmr::memory_resource* getMemoryResource() const { return memoryResource; }
+
     // Getter for algorithm name
     std::string getName() const { return algorithmName; }
-    
+
     // Calculate compression ratio
     double calculateCompressionRatio(size_t originalSize, size_t compressedSize) const {
         if (originalSize == 0) return 0.0;
@@ -31,4 +55,4 @@ public:
     }
 };
 
-#endif // COMPRESSION_ALGORITHM_H
\ No newline at end of file
+#endif // COMPRESSION_ALGORITHM_H
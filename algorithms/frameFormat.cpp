@@ -0,0 +1,576 @@
+#include "frameFormat.h"
+#include "algorithmFactory.h"
+#include "checksum.h"
+#include "bufferPool.h"
+#include "threadPool.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+void putU32(uint8_t* dst, uint32_t value) {
+    for (int i = 0; i < 4; i++) dst[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+void putU64(uint8_t* dst, uint64_t value) {
+    for (int i = 0; i < 8; i++) dst[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+uint32_t getU32(const uint8_t* src) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= static_cast<uint32_t>(src[i]) << (8 * i);
+    return value;
+}
+
+uint64_t getU64(const uint8_t* src) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) value |= static_cast<uint64_t>(src[i]) << (8 * i);
+    return value;
+}
+
+} // namespace
+
+bool FrameFormat::isFramed(const uint8_t* data, size_t size) {
+    return size >= HEADER_SIZE && getU32(data) == MAGIC;
+}
+
+bool FrameFormat::readHeader(const uint8_t* data, size_t size, FrameHeader& header) {
+    if (!isFramed(data, size)) {
+        Logger::error("Frame: Missing frame magic");
+        return false;
+    }
+
+    header.version = data[4];
+    header.codec = static_cast<AlgorithmType>(data[5]);
+    header.flags = data[6];
+    uint8_t headerSize = data[7];
+    header.contentSize = getU64(data + 8);
+    header.payloadSize = getU64(data + 16);
+    header.blockSize = getU32(data + 24);
+    header.blockCount = getU32(data + 28);
+
+    if (header.version != VERSION || headerSize != HEADER_SIZE) {
+        Logger::error("Frame: Unsupported frame version " + std::to_string(header.version));
+        return false;
+    }
+    if ((header.flags & ~KNOWN_FLAGS) != 0) {
+        Logger::error("Frame: Unknown frame flags " + std::to_string(header.flags));
+        return false;
+    }
+    if (!AlgorithmFactory::isSupported(header.codec)) {
+        Logger::error("Frame: Unknown codec id " +
+                      std::to_string(static_cast<int>(header.codec)));
+        return false;
+    }
+    if (header.blockSize == 0 || header.blockSize > MAX_FRAME_BLOCK_SIZE) {
+        Logger::error("Frame: Invalid block size " + std::to_string(header.blockSize));
+        return false;
+    }
+    if (header.payloadSize > size - HEADER_SIZE) {
+        Logger::error("Frame: Truncated frame (" + std::to_string(header.payloadSize) +
+                      " payload bytes declared, " + std::to_string(size - HEADER_SIZE) +
+                      " available)");
+        return false;
+    }
+    const uint64_t trailer = trailerSize(header.flags);
+    if (header.payloadSize < trailer ||
+        header.blockCount > (header.payloadSize - trailer) / blockHeaderSize(header.flags) ||
+        header.contentSize > static_cast<uint64_t>(header.blockCount) * header.blockSize ||
+        header.contentSize > header.payloadSize * MAX_EXPANSION_RATIO) {
+        Logger::error("Frame: Inconsistent content size " + std::to_string(header.contentSize));
+        return false;
+    }
+
+    return true;
+}
+
+bool FrameFormat::validateOptions(uint32_t blockSize, uint8_t flags) {
+    if (blockSize == 0 || blockSize > MAX_FRAME_BLOCK_SIZE) {
+        Logger::error("Frame: Invalid block size " + std::to_string(blockSize));
+        return false;
+    }
+    if ((flags & ~KNOWN_FLAGS) != 0) {
+        Logger::error("Frame: Unknown frame flags " + std::to_string(flags));
+        return false;
+    }
+    return true;
+}
+
+bool FrameFormat::encodeBlocks(CompressionAlgorithm& codec, const uint8_t* input, size_t size,
+                               std::vector<uint8_t>& output, uint32_t blockSize,
+                               uint8_t flags, uint32_t& contentCrc) {
+    const bool blockChecksums = (flags & FLAG_BLOCK_CHECKSUM) != 0;
+    const size_t blockHeaderLength = blockHeaderSize(flags);
+
+    for (size_t offset = 0; offset < size; offset += blockSize) {
+        const size_t blockLength = std::min<size_t>(blockSize, size - offset);
+        const size_t blockStart = output.size();
+        output.resize(blockStart + blockHeaderLength);
+
+        if (!codec.compressBlock(input + offset, blockLength, output)) {
+            Logger::error("Frame: " + codec.getName() + " failed on block at offset " +
+                          std::to_string(offset));
+            return false;
+        }
+
+        size_t compressedLength = output.size() - blockStart - blockHeaderLength;
+        uint32_t sizeField = static_cast<uint32_t>(compressedLength);
+        if (compressedLength >= blockLength) {
+            // Codec expanded this block; keep the raw bytes instead
+            output.resize(blockStart + blockHeaderLength);
+            output.insert(output.end(), input + offset, input + offset + blockLength);
+            compressedLength = blockLength;
+            sizeField = static_cast<uint32_t>(blockLength) | BLOCK_STORED;
+        }
+
+        // The input block was just read by the codec, so it is still in cache
+        if (flags & FLAG_CONTENT_CHECKSUM) {
+            contentCrc = Checksum::crc32c(input + offset, blockLength, contentCrc);
+        }
+
+        uint8_t* blockHeader = output.data() + blockStart;
+        putU32(blockHeader, sizeField);
+        putU32(blockHeader + 4, static_cast<uint32_t>(blockLength));
+        if (blockChecksums) {
+            putU32(blockHeader + 8, Checksum::crc32c(blockHeader + blockHeaderLength,
+                                                     compressedLength));
+        }
+    }
+    return true;
+}
+
+void FrameFormat::writeHeader(uint8_t* header, AlgorithmType type, uint64_t contentSize,
+                              uint64_t payloadSize, uint32_t blockSize, uint8_t flags) {
+    const uint32_t blockCount = static_cast<uint32_t>((contentSize + blockSize - 1) / blockSize);
+    putU32(header, MAGIC);
+    header[4] = VERSION;
+    header[5] = static_cast<uint8_t>(type);
+    header[6] = flags;
+    header[7] = static_cast<uint8_t>(HEADER_SIZE);
+    putU64(header + 8, contentSize);
+    putU64(header + 16, payloadSize);
+    putU32(header + 24, blockSize);
+    putU32(header + 28, blockCount);
+}
+
+void FrameFormat::finishFrame(AlgorithmType type, size_t contentSize,
+                              std::vector<uint8_t>& output, size_t frameStart,
+                              uint32_t blockSize, uint8_t flags, uint32_t contentCrc) {
+    if (flags & FLAG_CONTENT_CHECKSUM) {
+        const size_t trailerStart = output.size();
+        output.resize(trailerStart + 4);
+        putU32(output.data() + trailerStart, contentCrc);
+    }
+
+    writeHeader(output.data() + frameStart, type, contentSize,
+                output.size() - frameStart - HEADER_SIZE, blockSize, flags);
+}
+
+bool FrameFormat::encodeBlock(CompressionAlgorithm& codec, const uint8_t* input, size_t size,
+                              std::vector<uint8_t>& output, uint8_t flags,
+                              uint32_t& contentCrc) {
+    if (size == 0 || size > MAX_FRAME_BLOCK_SIZE || !validateOptions(MAX_FRAME_BLOCK_SIZE, flags)) {
+        Logger::error("Frame: Invalid streamed block of " + std::to_string(size) + " bytes");
+        return false;
+    }
+    contentCrc = 0;
+    return encodeBlocks(codec, input, size, output, static_cast<uint32_t>(size), flags,
+                        contentCrc);
+}
+
+void FrameFormat::encodeEnvelope(AlgorithmType type, uint64_t contentSize, uint64_t blocksSize,
+                                 uint32_t blockSize, uint8_t flags, uint32_t contentCrc,
+                                 std::vector<uint8_t>& output) {
+    const size_t start = output.size();
+    const size_t trailer = trailerSize(flags);
+    output.resize(start + HEADER_SIZE + trailer);
+    writeHeader(output.data() + start, type, contentSize, blocksSize + trailer, blockSize, flags);
+    if (trailer > 0) {
+        putU32(output.data() + start + HEADER_SIZE, contentCrc);
+    }
+}
+
+bool FrameFormat::compress(CompressionAlgorithm& codec, AlgorithmType type,
+                           const uint8_t* input, size_t size,
+                           std::vector<uint8_t>& output, uint32_t blockSize,
+                           uint8_t flags) {
+    if (!validateOptions(blockSize, flags)) {
+        return false;
+    }
+
+    const size_t frameStart = output.size();
+    output.resize(frameStart + HEADER_SIZE);
+
+    uint32_t contentCrc = 0;
+    if (!encodeBlocks(codec, input, size, output, blockSize, flags, contentCrc)) {
+        output.resize(frameStart);
+        return false;
+    }
+
+    finishFrame(type, size, output, frameStart, blockSize, flags, contentCrc);
+    Logger::info("Frame: " + codec.getName() + " " + std::to_string(size) + " bytes -> " +
+                 std::to_string(output.size() - frameStart) + " bytes");
+    return true;
+}
+
+bool FrameFormat::compressParallel(AlgorithmType type, const uint8_t* input, size_t size,
+                                   std::vector<uint8_t>& output, ThreadPool& pool,
+                                   uint32_t blockSize, uint8_t flags,
+                                   std::atomic<uint64_t>* progress,
+                                   const std::atomic<bool>* cancelled) {
+    if (!validateOptions(blockSize, flags)) {
+        return false;
+    }
+
+    // Pieces are whole runs of blocks, so the frame is byte-for-byte the one
+    // compress() would build
+    const size_t pieceLength = std::max<size_t>(1, PARALLEL_CHUNK_SIZE / blockSize) * blockSize;
+    const size_t pieceCount = (size + pieceLength - 1) / pieceLength;
+
+    struct Piece {
+        std::vector<uint8_t> data;
+        uint32_t contentCrc = 0;
+        bool ok = false;
+    };
+    std::vector<Piece> pieces(pieceCount);
+
+    pool.parallelFor(pieceCount, [&](size_t index) {
+        if (cancelled && cancelled->load(std::memory_order_relaxed)) return;
+        const size_t offset = index * pieceLength;
+        const size_t length = std::min(pieceLength, size - offset);
+
+        // Codecs and their arenas are per piece; neither is thread-safe
+        std::pmr::monotonic_buffer_resource arena(REQUEST_ARENA_INITIAL_SIZE);
+        auto codec = AlgorithmFactory::createAlgorithm(type, &arena);
+        if (!codec) return;
+
+        Piece& piece = pieces[index];
+        piece.data = BufferPool::instance().acquireCapacity(
+            maxCompressedSize(length, blockSize, flags) - HEADER_SIZE - trailerSize(flags));
+        piece.ok = encodeBlocks(*codec, input + offset, length, piece.data, blockSize, flags,
+                                piece.contentCrc);
+        if (progress) progress->fetch_add(length, std::memory_order_relaxed);
+    });
+
+    const size_t frameStart = output.size();
+    bool ok = true;
+    uint32_t contentCrc = 0;
+    output.resize(frameStart + HEADER_SIZE);
+    for (size_t i = 0; i < pieceCount; i++) {
+        Piece& piece = pieces[i];
+        ok = ok && piece.ok;
+        if (ok) {
+            output.insert(output.end(), piece.data.begin(), piece.data.end());
+            const size_t length = std::min(pieceLength, size - i * pieceLength);
+            contentCrc = Checksum::crc32cCombine(contentCrc, piece.contentCrc, length);
+        }
+        BufferPool::instance().release(std::move(piece.data));
+    }
+
+    if (!ok) {
+        output.resize(frameStart);
+        return false;
+    }
+
+    finishFrame(type, size, output, frameStart, blockSize, flags, contentCrc);
+    Logger::info("Frame: " + std::to_string(size) + " bytes -> " +
+                 std::to_string(output.size() - frameStart) + " bytes in " +
+                 std::to_string(pieceCount) + " parallel pieces");
+    return true;
+}
+
+bool FrameFormat::compress(AlgorithmType type, const std::vector<uint8_t>& input,
+                           std::vector<uint8_t>& output, uint32_t blockSize,
+                           uint8_t flags) {
+    auto codec = AlgorithmFactory::createAlgorithm(type);
+    if (!codec) {
+        return false;
+    }
+
+    output.clear();
+    return compress(*codec, type, input.data(), input.size(), output, blockSize, flags);
+}
+
+bool FrameFormat::scanFrames(const uint8_t* input, size_t size, AlgorithmType* codecOut,
+                             uint64_t maxContentSize, uint64_t& totalContent) {
+    totalContent = 0;
+    size_t offset = 0;
+    while (offset < size) {
+        FrameHeader header;
+        if (!readHeader(input + offset, size - offset, header)) {
+            return false;
+        }
+        if (offset == 0 && codecOut) {
+            *codecOut = header.codec;
+        }
+        totalContent += header.contentSize;
+        if (totalContent > maxContentSize) {
+            Logger::error("Frame: Content size exceeds limit of " +
+                          std::to_string(maxContentSize) + " bytes");
+            return false;
+        }
+        offset += static_cast<size_t>(frameLength(header));
+    }
+
+    if (size == 0) {
+        Logger::error("Frame: Empty input");
+        return false;
+    }
+    return true;
+}
+
+bool FrameFormat::decompress(const uint8_t* input, size_t size,
+                             std::vector<uint8_t>& output,
+                             AlgorithmType* codecOut, uint64_t maxContentSize,
+                             std::pmr::memory_resource* resource) {
+    // Validate every header first so the output is reserved exactly once and
+    // only for a total the input can actually describe
+    uint64_t totalContent = 0;
+    if (!scanFrames(input, size, codecOut, maxContentSize, totalContent)) {
+        return false;
+    }
+
+    size_t offset = 0;
+    output.reserve(output.size() + static_cast<size_t>(totalContent));
+
+    while (offset < size) {
+        FrameHeader header;
+        readHeader(input + offset, size - offset, header);
+
+        auto codec = AlgorithmFactory::createAlgorithm(header.codec, resource);
+        if (!codec) {
+            return false;
+        }
+
+        const bool blockChecksums = (header.flags & FLAG_BLOCK_CHECKSUM) != 0;
+        const bool contentChecksum = (header.flags & FLAG_CONTENT_CHECKSUM) != 0;
+        const size_t blockHeaderLength = blockHeaderSize(header.flags);
+        const uint8_t* cursor = input + offset + HEADER_SIZE;
+        const uint8_t* frameEnd = cursor + header.payloadSize - trailerSize(header.flags);
+        const size_t contentStart = output.size();
+        uint32_t contentCrc = 0;
+
+        for (uint32_t block = 0; block < header.blockCount; block++) {
+            if (static_cast<size_t>(frameEnd - cursor) < blockHeaderLength) {
+                Logger::error("Frame: Truncated block header");
+                return false;
+            }
+            uint32_t sizeField = getU32(cursor);
+            uint32_t originalSize = getU32(cursor + 4);
+            uint32_t blockCrc = blockChecksums ? getU32(cursor + 8) : 0;
+            cursor += blockHeaderLength;
+
+            bool stored = (sizeField & BLOCK_STORED) != 0;
+            uint32_t compressedSize = sizeField & ~BLOCK_STORED;
+            if (compressedSize > static_cast<size_t>(frameEnd - cursor) ||
+                originalSize > header.blockSize ||
+                (stored && compressedSize != originalSize)) {
+                Logger::error("Frame: Corrupt block " + std::to_string(block));
+                return false;
+            }
+
+            // Reject damaged blocks before the codec walks them
+            if (blockChecksums && Checksum::crc32c(cursor, compressedSize) != blockCrc) {
+                Logger::error("Frame: Checksum mismatch in block " + std::to_string(block));
+                return false;
+            }
+
+            const size_t blockStart = output.size();
+            if (stored) {
+                output.insert(output.end(), cursor, cursor + compressedSize);
+            } else if (!codec->decompressBlock(cursor, compressedSize, output, originalSize) ||
+                       output.size() - blockStart != originalSize) {
+                Logger::error("Frame: " + codec->getName() + " failed on block " +
+                              std::to_string(block));
+                return false;
+            }
+
+            // Checksum the block while it is still hot from decoding
+            if (contentChecksum) {
+                contentCrc = Checksum::crc32c(output.data() + blockStart, originalSize, contentCrc);
+            }
+            cursor += compressedSize;
+        }
+
+        if (cursor != frameEnd || output.size() - contentStart != header.contentSize) {
+            Logger::error("Frame: Content size mismatch");
+            return false;
+        }
+
+        if (contentChecksum && getU32(frameEnd) != contentCrc) {
+            Logger::error("Frame: Content checksum mismatch");
+            return false;
+        }
+
+        offset += static_cast<size_t>(frameLength(header));
+    }
+
+    Logger::info("Frame: Decoded " + std::to_string(size) + " bytes -> " +
+                 std::to_string(totalContent) + " bytes");
+    return true;
+}
+
+bool FrameFormat::decompressParallel(const uint8_t* input, size_t size,
+                                     std::vector<uint8_t>& output, ThreadPool& pool,
+                                     AlgorithmType* codecOut, uint64_t maxContentSize,
+                                     std::atomic<uint64_t>* progress,
+                                     const std::atomic<bool>* cancelled) {
+    uint64_t totalContent = 0;
+    if (!scanFrames(input, size, codecOut, maxContentSize, totalContent)) {
+        return false;
+    }
+
+    // Where each block starts in the input and lands in the output
+    struct BlockRef {
+        const uint8_t* data;
+        uint32_t compressedSize;
+        uint32_t originalSize;
+        uint32_t crc;
+        bool stored;
+        size_t outputOffset;
+    };
+
+    output.reserve(output.size() + static_cast<size_t>(totalContent));
+
+    size_t offset = 0;
+    while (offset < size) {
+        FrameHeader header;
+        readHeader(input + offset, size - offset, header);
+
+        const bool blockChecksums = (header.flags & FLAG_BLOCK_CHECKSUM) != 0;
+        const bool contentChecksum = (header.flags & FLAG_CONTENT_CHECKSUM) != 0;
+        const size_t blockHeaderLength = blockHeaderSize(header.flags);
+        const uint8_t* cursor = input + offset + HEADER_SIZE;
+        const uint8_t* frameEnd = cursor + header.payloadSize - trailerSize(header.flags);
+
+        // Walk the block headers first; only sizes are read here, so the
+        // layout is checked before any output is committed
+        std::vector<BlockRef> blocks;
+        blocks.reserve(header.blockCount);
+        size_t contentLength = 0;
+        for (uint32_t block = 0; block < header.blockCount; block++) {
+            if (static_cast<size_t>(frameEnd - cursor) < blockHeaderLength) {
+                Logger::error("Frame: Truncated block header");
+                return false;
+            }
+            BlockRef ref;
+            uint32_t sizeField = getU32(cursor);
+            ref.originalSize = getU32(cursor + 4);
+            ref.crc = blockChecksums ? getU32(cursor + 8) : 0;
+            ref.stored = (sizeField & BLOCK_STORED) != 0;
+            ref.compressedSize = sizeField & ~BLOCK_STORED;
+            cursor += blockHeaderLength;
+
+            if (ref.compressedSize > static_cast<size_t>(frameEnd - cursor) ||
+                ref.originalSize > header.blockSize ||
+                (ref.stored && ref.compressedSize != ref.originalSize)) {
+                Logger::error("Frame: Corrupt block " + std::to_string(block));
+                return false;
+            }
+            ref.data = cursor;
+            ref.outputOffset = contentLength;
+            contentLength += ref.originalSize;
+            cursor += ref.compressedSize;
+            blocks.push_back(ref);
+        }
+
+        if (cursor != frameEnd || contentLength != header.contentSize) {
+            Logger::error("Frame: Content size mismatch");
+            return false;
+        }
+
+        const size_t contentStart = output.size();
+        output.resize(contentStart + contentLength);
+        uint8_t* content = output.data() + contentStart;
+
+        const size_t blocksPerPiece = std::max<size_t>(1, PARALLEL_CHUNK_SIZE / header.blockSize);
+        const size_t pieceCount = (blocks.size() + blocksPerPiece - 1) / blocksPerPiece;
+        std::vector<uint32_t> pieceCrcs(pieceCount, 0);
+        std::vector<uint8_t> pieceOk(pieceCount, 0);
+
+        pool.parallelFor(pieceCount, [&](size_t index) {
+            std::pmr::monotonic_buffer_resource arena(REQUEST_ARENA_INITIAL_SIZE);
+            auto codec = AlgorithmFactory::createAlgorithm(header.codec, &arena);
+            if (!codec) return;
+
+            // Codecs append, so decode into scratch and copy into place
+            std::vector<uint8_t> scratch = BufferPool::instance().acquireCapacity(header.blockSize);
+            const size_t first = index * blocksPerPiece;
+            const size_t last = std::min(first + blocksPerPiece, blocks.size());
+            uint32_t crc = 0;
+            bool ok = true;
+            for (size_t i = first; i < last && ok; i++) {
+                if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+                    ok = false;
+                    break;
+                }
+                const BlockRef& ref = blocks[i];
+                if (blockChecksums && Checksum::crc32c(ref.data, ref.compressedSize) != ref.crc) {
+                    Logger::error("Frame: Checksum mismatch in block " + std::to_string(i));
+                    ok = false;
+                    break;
+                }
+
+                uint8_t* destination = content + ref.outputOffset;
+                if (ref.stored) {
+                    std::memcpy(destination, ref.data, ref.compressedSize);
+                } else {
+                    scratch.clear();
+                    if (!codec->decompressBlock(ref.data, ref.compressedSize, scratch,
+                                                ref.originalSize) ||
+                        scratch.size() != ref.originalSize) {
+                        Logger::error("Frame: " + codec->getName() + " failed on block " +
+                                      std::to_string(i));
+                        ok = false;
+                        break;
+                    }
+                    std::memcpy(destination, scratch.data(), ref.originalSize);
+                }
+
+                if (contentChecksum) {
+                    crc = Checksum::crc32c(destination, ref.originalSize, crc);
+                }
+            }
+            BufferPool::instance().release(std::move(scratch));
+            pieceCrcs[index] = crc;
+            pieceOk[index] = ok ? 1 : 0;
+            if (progress) {
+                const BlockRef& end = blocks[last - 1];
+                progress->fetch_add(static_cast<uint64_t>(end.data + end.compressedSize -
+                                                          blocks[first].data),
+                                    std::memory_order_relaxed);
+            }
+        });
+
+        uint32_t contentCrc = 0;
+        for (size_t i = 0; i < pieceCount; i++) {
+            if (!pieceOk[i]) {
+                return false;
+            }
+            const size_t first = i * blocksPerPiece;
+            const size_t last = std::min(first + blocksPerPiece, blocks.size());
+            const size_t pieceLength = blocks[last - 1].outputOffset +
+                                       blocks[last - 1].originalSize - blocks[first].outputOffset;
+            contentCrc = Checksum::crc32cCombine(contentCrc, pieceCrcs[i], pieceLength);
+        }
+
+        if (contentChecksum && getU32(frameEnd) != contentCrc) {
+            Logger::error("Frame: Content checksum mismatch");
+            return false;
+        }
+
+        offset += static_cast<size_t>(frameLength(header));
+    }
+
+    Logger::info("Frame: Decoded " + std::to_string(size) + " bytes -> " +
+                 std::to_string(totalContent) + " bytes in parallel");
+    return true;
+}
+
+bool FrameFormat::decompress(const std::vector<uint8_t>& input,
+                             std::vector<uint8_t>& output,
+                             AlgorithmType* codecOut) {
+    output.clear();
+    return decompress(input.data(), input.size(), output, codecOut);
+}
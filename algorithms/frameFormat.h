@@ -0,0 +1,188 @@
+#ifndef FRAME_FORMAT_H
+#define FRAME_FORMAT_H
+
+#include "compressionAlgorithm.h"
+#include "messageTypes.h"
+#include "config.h"
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+class ThreadPool;
+
+// Self-describing container for codec output. Every frame is
+//
+//   [header: 32 bytes][block]...[block]
+//
+// header (little-endian):
+//   magic u32 | version u8 | codec u8 | flags u8 | headerSize u8 |
+//   contentSize u64 | payloadSize u64 | blockSize u32 | blockCount u32
+//
+// block: compressedSize u32 | originalSize u32 | [blockCrc u32] | data
+// trailer (FLAG_CONTENT_CHECKSUM only): contentCrc u32
+//
+// payloadSize counts every byte after the header, so frames can be skipped
+// or concatenated without decoding them. A block whose compressedSize has
+// BLOCK_STORED set holds its bytes verbatim (used when the codec expands).
+//
+// Checksums are CRC32C. blockCrc covers the block's coded bytes and is
+// checked before the codec sees them; contentCrc covers the original content
+// and is accumulated block by block as each one is decoded.
+struct FrameHeader {
+    uint8_t version;
+    AlgorithmType codec;
+    uint8_t flags;
+    uint64_t contentSize;
+    uint64_t payloadSize;
+    uint32_t blockSize;
+    uint32_t blockCount;
+
+    FrameHeader()
+        : version(0),
+          codec(AlgorithmType::HUFFMAN),
+          flags(0),
+          contentSize(0),
+          payloadSize(0),
+          blockSize(0),
+          blockCount(0) {}
+};
+
+class FrameFormat {
+public:
+    static constexpr uint32_t MAGIC = 0x5A434644; // "DFCZ"
+    static constexpr uint8_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 32;
+    static constexpr size_t BLOCK_HEADER_SIZE = 8;
+    static constexpr uint32_t BLOCK_STORED = 0x80000000u;
+
+    // Header flags
+    static constexpr uint8_t FLAG_BLOCK_CHECKSUM = 0x01;
+    static constexpr uint8_t FLAG_CONTENT_CHECKSUM = 0x02;
+    static constexpr uint8_t KNOWN_FLAGS = FLAG_BLOCK_CHECKSUM | FLAG_CONTENT_CHECKSUM;
+    static constexpr uint8_t DEFAULT_FLAGS = FLAG_BLOCK_CHECKSUM | FLAG_CONTENT_CHECKSUM;
+
+    // Best case of any supported codec (RLE: 255 bytes from a 2-byte pair),
+    // used to reject content sizes the payload could never expand to
+    static constexpr uint64_t MAX_EXPANSION_RATIO = 128;
+
+    // Append one frame holding the compressed form of input
+    static bool compress(CompressionAlgorithm& codec, AlgorithmType type,
+                         const uint8_t* input, size_t size,
+                         std::vector<uint8_t>& output,
+                         uint32_t blockSize = DEFAULT_FRAME_BLOCK_SIZE,
+                         uint8_t flags = DEFAULT_FLAGS);
+
+    static bool compress(AlgorithmType type, const std::vector<uint8_t>& input,
+                         std::vector<uint8_t>& output,
+                         uint32_t blockSize = DEFAULT_FRAME_BLOCK_SIZE,
+                         uint8_t flags = DEFAULT_FLAGS);
+
+    // Decode every frame in input (frames may be concatenated) and append the
+    // content to output. The codec of the first frame is reported through
+    // codecOut; maxContentSize bounds the total before anything is reserved.
+    // Codec temporaries are allocated from resource when one is given.
+    static bool decompress(const uint8_t* input, size_t size,
+                           std::vector<uint8_t>& output,
+                           AlgorithmType* codecOut = nullptr,
+                           uint64_t maxContentSize = std::numeric_limits<uint64_t>::max(),
+                           std::pmr::memory_resource* resource = nullptr);
+
+    // Same frames as compress()/decompress(), with runs of blocks handled
+    // as separate tasks on pool (see ThreadPool::parallelFor). Each run gets
+    // its own codec and arena, and the content checksum is stitched back
+    // together from the per-run checksums. With progress, the input bytes
+    // of every finished run are added to it. Once cancelled is raised, runs
+    // not yet started (and, decoding, blocks) are skipped and the call fails.
+    static bool compressParallel(AlgorithmType type, const uint8_t* input, size_t size,
+                                 std::vector<uint8_t>& output, ThreadPool& pool,
+                                 uint32_t blockSize = DEFAULT_FRAME_BLOCK_SIZE,
+                                 uint8_t flags = DEFAULT_FLAGS,
+                                 std::atomic<uint64_t>* progress = nullptr,
+                                 const std::atomic<bool>* cancelled = nullptr);
+
+    static bool decompressParallel(const uint8_t* input, size_t size,
+                                   std::vector<uint8_t>& output, ThreadPool& pool,
+                                   AlgorithmType* codecOut = nullptr,
+                                   uint64_t maxContentSize = std::numeric_limits<uint64_t>::max(),
+                                   std::atomic<uint64_t>* progress = nullptr,
+                                   const std::atomic<bool>* cancelled = nullptr);
+
+    static bool decompress(const std::vector<uint8_t>& input,
+                           std::vector<uint8_t>& output,
+                           AlgorithmType* codecOut = nullptr);
+
+    // Streaming: one frame built a block at a time, for output that leaves
+    // before the rest of the input has arrived. encodeBlock() appends one
+    // block (size at most the frame's block size) and returns the CRC of
+    // its content; encodeEnvelope() appends the header, then the trailer,
+    // for blocks totalling blocksSize bytes. Header + blocks in order +
+    // trailer is byte-for-byte the frame compress() builds.
+    static bool encodeBlock(CompressionAlgorithm& codec, const uint8_t* input, size_t size,
+                            std::vector<uint8_t>& output, uint8_t flags,
+                            uint32_t& contentCrc);
+
+    static void encodeEnvelope(AlgorithmType type, uint64_t contentSize, uint64_t blocksSize,
+                               uint32_t blockSize, uint8_t flags, uint32_t contentCrc,
+                               std::vector<uint8_t>& output);
+
+    // Check for the frame magic (cheap test for legacy unframed input)
+    static bool isFramed(const uint8_t* data, size_t size);
+
+    // Parse and validate a frame header; false if it is malformed or the
+    // frame claims more payload than size holds
+    static bool readHeader(const uint8_t* data, size_t size, FrameHeader& header);
+
+    // What decompressing input would produce, summed over every frame, read
+    // from the headers alone; false if any header is malformed
+    static bool contentSize(const uint8_t* input, size_t size, uint64_t& total) {
+        return scanFrames(input, size, nullptr, std::numeric_limits<uint64_t>::max(), total);
+    }
+
+    // Total encoded length of a frame, header included
+    static uint64_t frameLength(const FrameHeader& header) {
+        return HEADER_SIZE + header.payloadSize;
+    }
+
+    // Upper bound on the frame produced for size input bytes (blocks that
+    // do not shrink are stored, so no block grows past its header)
+    static size_t maxCompressedSize(size_t size, uint32_t blockSize = DEFAULT_FRAME_BLOCK_SIZE,
+                                    uint8_t flags = DEFAULT_FLAGS) {
+        size_t blocks = (size + blockSize - 1) / blockSize;
+        return HEADER_SIZE + size + blocks * blockHeaderSize(flags) + trailerSize(flags);
+    }
+
+    // Per-block header length for a frame with the given flags
+    static size_t blockHeaderSize(uint8_t flags) {
+        return BLOCK_HEADER_SIZE + ((flags & FLAG_BLOCK_CHECKSUM) ? 4 : 0);
+    }
+
+    // Bytes after the last block
+    static size_t trailerSize(uint8_t flags) {
+        return (flags & FLAG_CONTENT_CHECKSUM) ? 4 : 0;
+    }
+
+private:
+    static bool validateOptions(uint32_t blockSize, uint8_t flags);
+
+    // Append the blocks for input to output, extending contentCrc
+    static bool encodeBlocks(CompressionAlgorithm& codec, const uint8_t* input, size_t size,
+                             std::vector<uint8_t>& output, uint32_t blockSize, uint8_t flags,
+                             uint32_t& contentCrc);
+
+    // Fill in a header for payloadSize bytes of blocks and trailer
+    static void writeHeader(uint8_t* header, AlgorithmType type, uint64_t contentSize,
+                            uint64_t payloadSize, uint32_t blockSize, uint8_t flags);
+
+    // Append the trailer and fill in the header reserved at frameStart
+    static void finishFrame(AlgorithmType type, size_t contentSize,
+                            std::vector<uint8_t>& output, size_t frameStart,
+                            uint32_t blockSize, uint8_t flags, uint32_t contentCrc);
+
+    // Validate every frame header and total their content sizes
+    static bool scanFrames(const uint8_t* input, size_t size, AlgorithmType* codecOut,
+                           uint64_t maxContentSize, uint64_t& totalContent);
+};
+
+#endif // FRAME_FORMAT_H
@@ -1,184 +1,239 @@
 #include "huffman.h"
 #include "logger.h"
-#include <bitset>
+#include <algorithm>
 #include <cstring>
+#include <limits>
 
-std::map<uint8_t, uint32_t> Huffman::buildFrequencyTable(const std::vector<uint8_t>& data) {
-    std::map<uint8_t, uint32_t> frequencies;
-    for (uint8_t byte : data) {
-        frequencies[byte]++;
+void Huffman::setMemoryResource(std::pmr::memory_resource* resource) {
+    CompressionAlgorithm::setMemoryResource(resource);
+    workspace.reset(); // rebuilt on the new resource at next use
+}
+
+Huffman::Workspace& Huffman::getWorkspace() {
+    if (!workspace) {
+        workspace.emplace(memoryResource);
+    }
+    return *workspace;
+}
+
+void Huffman::buildFrequencyTable(const uint8_t* data, size_t size,
+                                  std::array<uint64_t, 256>& frequencies) {
+    frequencies.fill(0);
+    for (size_t i = 0; i < size; i++) {
+        frequencies[data[i]]++;
     }
-    return frequencies;
 }
 
-std::shared_ptr<HuffmanNode> Huffman::buildHuffmanTree(const std::map<uint8_t, uint32_t>& frequencies) {
-    std::priority_queue<std::shared_ptr<HuffmanNode>, 
-                       std::vector<std::shared_ptr<HuffmanNode>>,
-                       CompareNodes> pq;
+int16_t Huffman::buildHuffmanTree(const std::array<uint64_t, 256>& frequencies) {
+    Workspace& ws = getWorkspace();
+    ws.nodes.clear();
+    ws.heap.clear();
+    
+    CompareNodes compare{&ws.nodes};
     
     // Create leaf nodes
-    for (const auto& pair : frequencies) {
-        pq.push(std::make_shared<HuffmanNode>(pair.first, pair.second));
+    for (int symbol = 0; symbol < 256; symbol++) {
+        if (frequencies[symbol] == 0) continue;
+        ws.nodes.emplace_back(static_cast<uint8_t>(symbol), frequencies[symbol]);
+        ws.heap.push_back(static_cast<int16_t>(ws.nodes.size() - 1));
+        std::push_heap(ws.heap.begin(), ws.heap.end(), compare);
     }
     
     // Build tree
-    while (pq.size() > 1) {
-        auto left = pq.top(); pq.pop();
-        auto right = pq.top(); pq.pop();
+    while (ws.heap.size() > 1) {
+        std::pop_heap(ws.heap.begin(), ws.heap.end(), compare);
+        int16_t left = ws.heap.back(); ws.heap.pop_back();
+        std::pop_heap(ws.heap.begin(), ws.heap.end(), compare);
+        int16_t right = ws.heap.back(); ws.heap.pop_back();
         
-        auto parent = std::make_shared<HuffmanNode>(0, left->frequency + right->frequency);
-        parent->left = left;
-        parent->right = right;
+        HuffmanNode parent(0, ws.nodes[left].frequency + ws.nodes[right].frequency);
+        parent.left = left;
+        parent.right = right;
+        ws.nodes.push_back(parent);
         
-        pq.push(parent);
+        ws.heap.push_back(static_cast<int16_t>(ws.nodes.size() - 1));
+        std::push_heap(ws.heap.begin(), ws.heap.end(), compare);
     }
     
-    return pq.top();
+    return ws.heap.front();
 }
 
-void Huffman::generateCodes(const std::shared_ptr<HuffmanNode>& node, 
-                           const std::string& code,
-                           std::map<uint8_t, std::string>& codes) {
-    if (!node) return;
+bool Huffman::generateCodes(int16_t node, uint64_t code, uint8_t length) {
+    Workspace& ws = getWorkspace();
+    const HuffmanNode& current = ws.nodes[node];
     
-    if (node->isLeaf()) {
-        codes[node->data] = code.empty() ? "0" : code;
-        return;
+    if (current.isLeaf()) {
+        // A lone symbol still needs one bit per occurrence
+        ws.codes[current.data] = length == 0 ? HuffmanCode{0, 1} : HuffmanCode{code, length};
+        return true;
     }
     
-    generateCodes(node->left, code + "0", codes);
-    generateCodes(node->right, code + "1", codes);
+    if (length >= MAX_CODE_LENGTH) return false;
+    
+    return generateCodes(current.left, code << 1, length + 1) &&
+           generateCodes(current.right, (code << 1) | 1, length + 1);
 }
 
-void Huffman::serializeTree(const std::shared_ptr<HuffmanNode>& node, std::vector<uint8_t>& output) {
-    if (!node) return;
+void Huffman::serializeTree(int16_t node, std::vector<uint8_t>& output) {
+    const HuffmanNode& current = getWorkspace().nodes[node];
     
-    if (node->isLeaf()) {
+    if (current.isLeaf()) {
         output.push_back(1); // Leaf marker
-        output.push_back(node->data);
+        output.push_back(current.data);
     } else {
         output.push_back(0); // Internal node marker
-        serializeTree(node->left, output);
-        serializeTree(node->right, output);
+        serializeTree(current.left, output);
+        serializeTree(current.right, output);
     }
 }
 
-std::shared_ptr<HuffmanNode> Huffman::deserializeTree(const std::vector<uint8_t>& input, size_t& index) {
-    if (index >= input.size()) return nullptr;
+int16_t Huffman::deserializeTree(const uint8_t* input, size_t size,
+                                 size_t& index, int depth) {
+    Workspace& ws = getWorkspace();
+    if (index >= size || depth > MAX_TREE_DEPTH || ws.nodes.size() >= MAX_TREE_NODES) return -1;
     
     uint8_t marker = input[index++];
     
     if (marker == 1) { // Leaf node
-        if (index >= input.size()) return nullptr;
-        uint8_t data = input[index++];
-        return std::make_shared<HuffmanNode>(data, 0);
+        if (index >= size) return -1;
+        ws.nodes.emplace_back(input[index++], 0);
+        return static_cast<int16_t>(ws.nodes.size() - 1);
     } else { // Internal node
-        auto node = std::make_shared<HuffmanNode>(0, 0);
-        node->left = deserializeTree(input, index);
-        node->right = deserializeTree(input, index);
+        int16_t node = static_cast<int16_t>(ws.nodes.size());
+        ws.nodes.emplace_back(0, 0);
+        int16_t left = deserializeTree(input, size, index, depth + 1);
+        if (left < 0) return -1;
+        int16_t right = deserializeTree(input, size, index, depth + 1);
+        if (right < 0) return -1;
+        ws.nodes[node].left = left;
+        ws.nodes[node].right = right;
         return node;
     }
 }
 
-std::vector<uint8_t> Huffman::bitStringToBytes(const std::string& bits) {
-    std::vector<uint8_t> bytes;
+bool Huffman::compress(const std::vector<uint8_t>& input, std::vector<uint8_t>& output) {
+    if (input.empty()) {
+        Logger::warning("Huffman: Input data is empty");
+        output.clear();
+        return true;
+    }
     
-    for (size_t i = 0; i < bits.length(); i += 8) {
-        std::string byteStr = bits.substr(i, 8);
-        while (byteStr.length() < 8) {
-            byteStr += '0'; // Pad with zeros
-        }
-        bytes.push_back(static_cast<uint8_t>(std::bitset<8>(byteStr).to_ulong()));
+    output.clear();
+    if (!compressBlock(input.data(), input.size(), output)) {
+        return false;
     }
     
-    return bytes;
+    Logger::info("Huffman Compression: " + std::to_string(input.size()) + 
+                 " bytes -> " + std::to_string(output.size()) + " bytes");
+    return true;
 }
 
-bool Huffman::compress(const std::vector<uint8_t>& input, std::vector<uint8_t>& output) {
-    if (input.empty()) {
-        Logger::warning("Huffman: Input data is empty");
-        output.clear();
+bool Huffman::compressBlock(const uint8_t* input, size_t size, std::vector<uint8_t>& output) {
+    if (size > std::numeric_limits<uint32_t>::max()) {
+        Logger::error("Huffman: Block too large for 32-bit size field");
+        return false;
+    }
+    if (size == 0) {
         return true;
     }
     
     // Build frequency table
-    auto frequencies = buildFrequencyTable(input);
+    std::array<uint64_t, 256> frequencies;
+    buildFrequencyTable(input, size, frequencies);
     
     // Build Huffman tree
-    auto root = buildHuffmanTree(frequencies);
+    int16_t root = buildHuffmanTree(frequencies);
     
     // Generate codes
-    std::map<uint8_t, std::string> codes;
-    generateCodes(root, "", codes);
-    
-    // Encode data
-    std::string encodedBits;
-    for (uint8_t byte : input) {
-        encodedBits += codes[byte];
+    if (!generateCodes(root, 0, 0)) {
+        Logger::error("Huffman: Code length limit exceeded");
+        return false;
     }
-    
-    // Serialize tree
-    std::vector<uint8_t> serializedTree;
-    serializeTree(root, serializedTree);
+    const auto& codes = getWorkspace().codes;
     
     // Build output: [tree_size][tree][original_size][padding_bits][encoded_data]
-    output.clear();
     
-    // Write tree size (4 bytes)
-    uint32_t treeSize = serializedTree.size();
-    output.insert(output.end(), 
-                  reinterpret_cast<uint8_t*>(&treeSize), 
-                  reinterpret_cast<uint8_t*>(&treeSize) + sizeof(treeSize));
-    
-    // Write tree
-    output.insert(output.end(), serializedTree.begin(), serializedTree.end());
+    // Write tree size (4 bytes) and tree; the size is patched once known
+    const size_t treeSizeOffset = output.size();
+    output.resize(treeSizeOffset + sizeof(uint32_t));
+    serializeTree(root, output);
+    uint32_t treeSize = static_cast<uint32_t>(output.size() - treeSizeOffset - sizeof(uint32_t));
+    std::memcpy(output.data() + treeSizeOffset, &treeSize, sizeof(treeSize));
     
     // Write original data size (4 bytes)
-    uint32_t originalSize = input.size();
+    uint32_t originalSize = static_cast<uint32_t>(size);
     output.insert(output.end(),
                   reinterpret_cast<uint8_t*>(&originalSize),
                   reinterpret_cast<uint8_t*>(&originalSize) + sizeof(originalSize));
     
-    // Write padding bits count (1 byte)
-    uint8_t paddingBits = (8 - (encodedBits.length() % 8)) % 8;
+    // Write padding bits count (1 byte); the bit count is known from the table
+    uint64_t totalBits = 0;
+    for (int symbol = 0; symbol < 256; symbol++) {
+        if (frequencies[symbol]) totalBits += frequencies[symbol] * codes[symbol].length;
+    }
+    uint8_t paddingBits = static_cast<uint8_t>((8 - (totalBits % 8)) % 8);
     output.push_back(paddingBits);
     
-    // Write encoded data
-    auto encodedBytes = bitStringToBytes(encodedBits);
-    output.insert(output.end(), encodedBytes.begin(), encodedBytes.end());
+    // Write encoded data straight into the output, most significant bit first
+    const size_t encodedStart = output.size();
+    output.resize(encodedStart + static_cast<size_t>((totalBits + 7) / 8));
+    uint8_t* out = output.data() + encodedStart;
+    
+    uint64_t pending = 0;
+    int pendingBits = 0;
+    for (size_t i = 0; i < size; i++) {
+        const HuffmanCode& code = codes[input[i]];
+        pending = (pending << code.length) | code.bits;
+        pendingBits += code.length;
+        while (pendingBits >= 8) {
+            pendingBits -= 8;
+            *out++ = static_cast<uint8_t>(pending >> pendingBits);
+        }
+    }
+    if (pendingBits > 0) {
+        *out++ = static_cast<uint8_t>(pending << (8 - pendingBits));
+    }
     
-    Logger::info("Huffman Compression: " + std::to_string(input.size()) + 
-                 " bytes -> " + std::to_string(output.size()) + " bytes");
     return true;
 }
 
-bool Huffman::decodeData(const std::shared_ptr<HuffmanNode>& root, 
-                        const std::vector<uint8_t>& encodedData,
+bool Huffman::decodeData(int16_t root, 
+                        const uint8_t* encodedData, size_t encodedSize,
                         uint32_t originalSize,
                         std::vector<uint8_t>& output) {
-    output.clear();
-    output.reserve(originalSize);
+    const std::pmr::vector<HuffmanNode>& nodes = getWorkspace().nodes;
+    const size_t start = output.size();
+    output.resize(start + originalSize);
+    uint8_t* out = output.data() + start;
+    uint8_t* const end = out + originalSize;
+    
+    // A single-symbol tree has no edges; compress() emits one '0' bit per byte
+    if (nodes[root].isLeaf()) {
+        std::memset(out, nodes[root].data, originalSize);
+        return true;
+    }
     
-    auto currentNode = root;
+    int16_t currentNode = root;
     
-    for (size_t i = 0; i < encodedData.size() && output.size() < originalSize; i++) {
-        std::bitset<8> bits(encodedData[i]);
+    for (size_t i = 0; i < encodedSize && out < end; i++) {
+        uint8_t bits = encodedData[i];
         
-        for (int j = 7; j >= 0 && output.size() < originalSize; j--) {
-            if (bits[j]) {
-                currentNode = currentNode->right;
-            } else {
-                currentNode = currentNode->left;
-            }
+        for (int j = 7; j >= 0 && out < end; j--) {
+            const HuffmanNode& node = nodes[currentNode];
+            currentNode = ((bits >> j) & 1) ? node.right : node.left;
             
-            if (currentNode->isLeaf()) {
-                output.push_back(currentNode->data);
+            if (nodes[currentNode].isLeaf()) {
+                *out++ = nodes[currentNode].data;
                 currentNode = root;
             }
         }
     }
     
-    return output.size() == originalSize;
+    if (out != end) {
+        output.resize(static_cast<size_t>(out - output.data()));
+        return false;
+    }
+    return true;
 }
 
 bool Huffman::decompress(const std::vector<uint8_t>& input, std::vector<uint8_t>& output) {
@@ -188,52 +243,70 @@ bool Huffman::decompress(const std::vector<uint8_t>& input, std::vector<uint8_t>
         return true;
     }
     
+    output.clear();
+    bool success = decompressBlock(input.data(), input.size(), output,
+                                   std::numeric_limits<size_t>::max());
+    
+    if (success) {
+        Logger::info("Huffman Decompression: " + std::to_string(input.size()) + 
+                     " bytes -> " + std::to_string(output.size()) + " bytes");
+    } else {
+        Logger::error("Huffman: Decompression failed");
+    }
+    
+    return success;
+}
+
+bool Huffman::decompressBlock(const uint8_t* input, size_t size,
+                              std::vector<uint8_t>& output, size_t maxOutput) {
     size_t index = 0;
     
     // Read tree size
-    if (index + sizeof(uint32_t) > input.size()) {
+    if (index + sizeof(uint32_t) > size) {
         Logger::error("Huffman: Invalid compressed data (tree size)");
         return false;
     }
     uint32_t treeSize;
-    std::memcpy(&treeSize, input.data() + index, sizeof(treeSize));
+    std::memcpy(&treeSize, input + index, sizeof(treeSize));
     index += sizeof(treeSize);
     
     // Read tree
-    if (index + treeSize > input.size()) {
+    if (treeSize > size - index) {
+        Logger::error("Huffman: Invalid compressed data (tree)");
+        return false;
+    }
+    const size_t treeEnd = index + treeSize;
+    getWorkspace().nodes.clear();
+    int16_t root = deserializeTree(input, treeEnd, index);
+    if (root < 0 || index != treeEnd) {
         Logger::error("Huffman: Invalid compressed data (tree)");
         return false;
     }
-    auto root = deserializeTree(input, index);
     
     // Read original size
-    if (index + sizeof(uint32_t) > input.size()) {
+    if (index + sizeof(uint32_t) > size) {
         Logger::error("Huffman: Invalid compressed data (original size)");
         return false;
     }
     uint32_t originalSize;
-    std::memcpy(&originalSize, input.data() + index, sizeof(originalSize));
+    std::memcpy(&originalSize, input + index, sizeof(originalSize));
     index += sizeof(originalSize);
     
     // Read padding bits
-    if (index >= input.size()) {
+    if (index >= size) {
         Logger::error("Huffman: Invalid compressed data (padding)");
         return false;
     }
-    uint8_t paddingBits = input[index++];
+    index++; // padding count is implied by originalSize
     
-    // Read encoded data
-    std::vector<uint8_t> encodedData(input.begin() + index, input.end());
-    
-    // Decode
-    bool success = decodeData(root, encodedData, originalSize, output);
-    
-    if (success) {
-        Logger::info("Huffman Decompression: " + std::to_string(input.size()) + 
-                     " bytes -> " + std::to_string(output.size()) + " bytes");
-    } else {
-        Logger::error("Huffman: Decompression failed");
+    // Every symbol costs at least one bit, so a size the payload cannot
+    // hold is corrupt; check before reserving anything
+    const size_t encodedSize = size - index;
+    if (originalSize > maxOutput || originalSize > encodedSize * 8) {
+        Logger::error("Huffman: Invalid compressed data (original size out of range)");
+        return false;
     }
     
-    return success;
-}
\ No newline at end of file
+    // Decode
+    return decodeData(root, input + index, encodedSize, originalSize, output);
+}
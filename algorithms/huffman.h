@@ -2,31 +2,38 @@
 #define HUFFMAN_H
 
 #include "compressionAlgorithm.h"
-#include <map>
-#include <queue>
-#include <memory>
+#include <array>
+#include <optional>
+#include <memory_resource>
 
-// Huffman tree node
+// Huffman tree node; children are indices into the codec's node table
 struct HuffmanNode {
     uint8_t data;
-    uint32_t frequency;
-    std::shared_ptr<HuffmanNode> left;
-    std::shared_ptr<HuffmanNode> right;
+    uint64_t frequency;
+    int16_t left;
+    int16_t right;
     
-    HuffmanNode(uint8_t d, uint32_t f) 
-        : data(d), frequency(f), left(nullptr), right(nullptr) {}
+    HuffmanNode(uint8_t d, uint64_t f) 
+        : data(d), frequency(f), left(-1), right(-1) {}
     
-    bool isLeaf() const { return !left && !right; }
+    bool isLeaf() const { return left < 0 && right < 0; }
 };
 
-// Comparator for priority queue
+// Comparator for priority queue (min-heap on frequency)
 struct CompareNodes {
-    bool operator()(const std::shared_ptr<HuffmanNode>& a, 
-                   const std::shared_ptr<HuffmanNode>& b) const {
-        return a->frequency > b->frequency;
+    const std::pmr::vector<HuffmanNode>* nodes;
+    
+    bool operator()(int16_t a, int16_t b) const {
+        return (*nodes)[a].frequency > (*nodes)[b].frequency;
     }
 };
 
+// Bit pattern for one symbol, most significant bit first
+struct HuffmanCode {
+    uint64_t bits;
+    uint8_t length;
+};
+
 // Huffman Coding implementation
 class Huffman : public CompressionAlgorithm {
 public:
@@ -38,30 +45,63 @@ public:
     bool decompress(const std::vector<uint8_t>& input, 
                    std::vector<uint8_t>& output) override;
 
+    bool compressBlock(const uint8_t* input, size_t size,
+                       std::vector<uint8_t>& output) override;
+
+    bool decompressBlock(const uint8_t* input, size_t size,
+                         std::vector<uint8_t>& output,
+                         size_t maxOutput) override;
+
+    void setMemoryResource(std::pmr::memory_resource* resource) override;
+
 private:
+    // Deepest tree a 256-symbol alphabet can produce
+    static constexpr int MAX_TREE_DEPTH = 256;
+    
+    // A full tree over 256 symbols
+    static constexpr size_t MAX_TREE_NODES = 511;
+    
+    // Longest code the 64-bit bit writer accepts; 32-bit block sizes keep
+    // real trees far shallower than this
+    static constexpr uint8_t MAX_CODE_LENGTH = 56;
+    
+    // Per-block temporaries, allocated from the codec's memory resource and
+    // reused from block to block
+    struct Workspace {
+        std::pmr::vector<HuffmanNode> nodes;
+        std::pmr::vector<int16_t> heap;
+        std::pmr::vector<HuffmanCode> codes;
+        
+        explicit Workspace(std::pmr::memory_resource* resource)
+            : nodes(resource), heap(resource), codes(256, HuffmanCode{0, 0}, resource) {
+            nodes.reserve(MAX_TREE_NODES);
+            heap.reserve(256);
+        }
+    };
+    std::optional<Workspace> workspace;
+    
+    Workspace& getWorkspace();
+    
     // Build frequency table
-    std::map<uint8_t, uint32_t> buildFrequencyTable(const std::vector<uint8_t>& data);
+    void buildFrequencyTable(const uint8_t* data, size_t size,
+                             std::array<uint64_t, 256>& frequencies);
     
-    // Build Huffman tree
-    std::shared_ptr<HuffmanNode> buildHuffmanTree(const std::map<uint8_t, uint32_t>& frequencies);
+    // Build Huffman tree, returning the root index
+    int16_t buildHuffmanTree(const std::array<uint64_t, 256>& frequencies);
     
-    // Generate codes from tree
-    void generateCodes(const std::shared_ptr<HuffmanNode>& node, 
-                      const std::string& code,
-                      std::map<uint8_t, std::string>& codes);
+    // Generate codes from tree; false if a code would be too long
+    bool generateCodes(int16_t node, uint64_t code, uint8_t length);
     
     // Serialize tree for storage
-    void serializeTree(const std::shared_ptr<HuffmanNode>& node, std::vector<uint8_t>& output);
-    
-    // Deserialize tree from storage
-    std::shared_ptr<HuffmanNode> deserializeTree(const std::vector<uint8_t>& input, size_t& index);
+    void serializeTree(int16_t node, std::vector<uint8_t>& output);
     
-    // Convert bit string to bytes
-    std::vector<uint8_t> bitStringToBytes(const std::string& bits);
+    // Deserialize tree from storage (-1 if truncated or malformed)
+    int16_t deserializeTree(const uint8_t* input, size_t size,
+                            size_t& index, int depth = 0);
     
     // Decode using Huffman tree
-    bool decodeData(const std::shared_ptr<HuffmanNode>& root, 
-                   const std::vector<uint8_t>& encodedData,
+    bool decodeData(int16_t root, 
+                   const uint8_t* encodedData, size_t encodedSize,
                    uint32_t originalSize,
                    std::vector<uint8_t>& output);
 };
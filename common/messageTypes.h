@@ -10,7 +10,13 @@ enum class MessageType : uint8_t {
     DECOMPRESS_REQUEST = 2,
     RESPONSE = 3,
     MSG_ERROR  = 4,  // Changed from ERROR to avoid Windows conflict
-    ACK = 5
+    ACK = 5,
+    FETCH_REQUEST = 6, // download an output the server already stored, by name
+    STATS_REQUEST = 7, // server metrics as text (see utils/metrics.h)
+    BATCH_REQUEST = 8, // many small files in one request (see src/batchFormat.h)
+    POLL_REQUEST = 9,  // state of a background job, or its result (see src/jobFormat.h)
+    WAIT_REQUEST = 10, // the same, once the job is done or JOB_WAIT_MS has passed
+    CANCEL_REQUEST = 11
 };
 
 // Algorithm types
@@ -23,19 +29,31 @@ enum class AlgorithmType : uint8_t {
 enum class OperationStatus : uint8_t {
     SUCCESS = 0,
     FAILURE = 1,
-    IN_PROGRESS = 2
+    IN_PROGRESS = 2,
+    BUSY = 3          // not admitted (server over its memory budget); retry later
 };
 
+// Payload flags carried in request and response headers
+constexpr uint8_t PAYLOAD_FLAG_CHECKSUM = 0x01; // CRC32C trailer follows the data
+constexpr uint8_t PAYLOAD_FLAG_STREAM = 0x02;   // answer block by block (compress only)
+constexpr uint8_t PAYLOAD_FLAG_NO_SAVE = 0x04;  // server keeps no output file for it
+constexpr uint8_t PAYLOAD_FLAG_TIMING = 0x08;   // request: report stage timing;
+                                                // response: StageTiming follows the message
+constexpr uint8_t PAYLOAD_FLAG_SUBMIT = 0x10;   // run as a background job; the answer is
+                                                // IN_PROGRESS with the job's ID
+
 // Message header structure
 struct MessageHeader {
     MessageType type;
     AlgorithmType algorithm;
+    uint8_t flags;
     uint32_t dataSize;
     uint32_t fileNameLength;
 
     MessageHeader() 
         : type(MessageType::COMPRESS_REQUEST),
           algorithm(AlgorithmType::HUFFMAN),
+          flags(0),
           dataSize(0),
           fileNameLength(0) {}
 };
@@ -43,17 +61,36 @@ struct MessageHeader {
 // Response header structure
 struct ResponseHeader {
     OperationStatus status;
+    uint8_t flags;
     uint32_t dataSize;
     uint32_t fileNameLength;
     uint32_t messageLength;
 
     ResponseHeader()
         : status(OperationStatus::SUCCESS),
+          flags(0),
           dataSize(0),
           fileNameLength(0),
           messageLength(0) {}
 };
 
+// Where the server spent a request's time, in microseconds of a monotonic
+// clock. Sent after the response message when PAYLOAD_FLAG_TIMING is set.
+// Sending the response itself is not included: it has not happened yet.
+struct StageTiming {
+    uint32_t receiveMicros;  // request header to the end of the payload
+    uint32_t queueMicros;    // waiting for a worker
+    uint32_t lookupMicros;   // result cache, object store, identical requests in flight
+    uint32_t codecMicros;    // compressing, decompressing or opening the file
+    uint32_t saveMicros;     // keeping the output: write-behind queue, object store, cache
+    uint32_t cpuMicros;      // CPU time of the thread that handled it
+    uint32_t totalMicros;    // request header to response ready
+
+    StageTiming()
+        : receiveMicros(0), queueMicros(0), lookupMicros(0), codecMicros(0),
+          saveMicros(0), cpuMicros(0), totalMicros(0) {}
+};
+
 // Helper functions to convert enums to strings
 inline std::string messageTypeToString(MessageType type) {
     switch (type) {
@@ -62,6 +99,12 @@ inline std::string messageTypeToString(MessageType type) {
         case MessageType::RESPONSE: return "RESPONSE";
         case MessageType::MSG_ERROR: return "MSG_ERROR";  // Updated to match the enum change
         case MessageType::ACK: return "ACK";
+        case MessageType::FETCH_REQUEST: return "FETCH_REQUEST";
+        case MessageType::STATS_REQUEST: return "STATS_REQUEST";
+        case MessageType::BATCH_REQUEST: return "BATCH_REQUEST";
+        case MessageType::POLL_REQUEST: return "POLL_REQUEST";
+        case MessageType::WAIT_REQUEST: return "WAIT_REQUEST";
+        case MessageType::CANCEL_REQUEST: return "CANCEL_REQUEST";
         default: return "UNKNOWN"; // fallback - added default case
     }
 }
@@ -79,6 +122,7 @@ inline std::string operationStatusToString(OperationStatus status) {
         case OperationStatus::SUCCESS: return "SUCCESS";
         case OperationStatus::FAILURE: return "FAILURE";
         case OperationStatus::IN_PROGRESS: return "IN_PROGRESS";
+        case OperationStatus::BUSY: return "BUSY";
         default: return "UNKNOWN"; // fallback - added default case
     }
 }
@@ -1,24 +1,58 @@
 #include "networkUtils.h"
 #include "logger.h"
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#include "checksum.h"
 #include <vector>
 #include <string>
+#include <algorithm>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <csignal>
+#include <poll.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
-#pragma comment(lib, "ws2_32.lib")
+bool NetworkUtils::initialize() {
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        Logger::error("WSAStartup failed");
+        return false;
+    }
+#else
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    return true;
+}
+
+void NetworkUtils::cleanup() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+namespace {
+// Largest single send/recv; keeps the length within an int on every platform
+constexpr uint64_t MAX_IO_CHUNK = 1u << 30;
+}
 
 bool NetworkUtils::sendData(SOCKET socket, const void* data, uint64_t size) {
     uint64_t totalSent = 0;
     const uint8_t* ptr = static_cast<const uint8_t*>(data);
 
     while (totalSent < size) {
-        int sent = send(socket,
+        int sent = static_cast<int>(send(socket,
                         reinterpret_cast<const char*>(ptr + totalSent),
-                        static_cast<int>(size - totalSent),
-                        0);
+                        static_cast<int>(std::min(size - totalSent, MAX_IO_CHUNK)),
+                        0));
 
         if (sent == SOCKET_ERROR) {
-            int err = WSAGetLastError();
+            int err = socketLastError();
+            if (socketInterrupted(err)) continue;
             Logger::error("Failed to send data: " + std::to_string(err));
             return false;
         }
@@ -34,10 +68,10 @@ bool NetworkUtils::receiveData(SOCKET socket, void* buffer, uint64_t size) {
     uint8_t* ptr = static_cast<uint8_t*>(buffer);
 
     while (totalReceived < size) {
-        int received = recv(socket,
+        int received = static_cast<int>(recv(socket,
                             reinterpret_cast<char*>(ptr + totalReceived),
-                            static_cast<int>(size - totalReceived),
-                            0);
+                            static_cast<int>(std::min(size - totalReceived, MAX_IO_CHUNK)),
+                            0));
 
         if (received == 0) {
             Logger::warning("Connection closed by peer");
@@ -45,8 +79,9 @@ bool NetworkUtils::receiveData(SOCKET socket, void* buffer, uint64_t size) {
         }
 
         if (received == SOCKET_ERROR) {
-            int err = WSAGetLastError();
-            if (err == WSAETIMEDOUT) {
+            int err = socketLastError();
+            if (socketInterrupted(err)) continue;
+            if (socketTimedOut(err)) {
                 Logger::warning("Receive timeout reached");
             } else {
                 Logger::error("Failed to receive data: " + std::to_string(err));
@@ -60,6 +95,79 @@ bool NetworkUtils::receiveData(SOCKET socket, void* buffer, uint64_t size) {
     return true;
 }
 
+namespace {
+// Small enough to still be in cache when it is checksummed
+constexpr uint64_t CHECKSUM_CHUNK_SIZE = 256 * 1024;
+}
+
+bool NetworkUtils::sendDataWithChecksum(SOCKET socket, const void* data, uint64_t size,
+                                        uint32_t& crc) {
+    const uint8_t* ptr = static_cast<const uint8_t*>(data);
+
+    for (uint64_t offset = 0; offset < size; offset += CHECKSUM_CHUNK_SIZE) {
+        uint64_t chunk = std::min(CHECKSUM_CHUNK_SIZE, size - offset);
+        crc = Checksum::crc32c(ptr + offset, static_cast<size_t>(chunk), crc);
+        if (!sendData(socket, ptr + offset, chunk))
+            return false;
+    }
+
+    return true;
+}
+
+bool NetworkUtils::receiveDataWithChecksum(SOCKET socket, void* buffer, uint64_t size,
+                                           uint32_t& crc) {
+    uint8_t* ptr = static_cast<uint8_t*>(buffer);
+
+    for (uint64_t offset = 0; offset < size; offset += CHECKSUM_CHUNK_SIZE) {
+        uint64_t chunk = std::min(CHECKSUM_CHUNK_SIZE, size - offset);
+        if (!receiveData(socket, ptr + offset, chunk))
+            return false;
+        crc = Checksum::crc32c(ptr + offset, static_cast<size_t>(chunk), crc);
+    }
+
+    return true;
+}
+
+bool NetworkUtils::sendFile(SOCKET socket, int fileDescriptor, uint64_t size) {
+#ifdef __linux__
+    off_t offset = 0;
+    while (static_cast<uint64_t>(offset) < size) {
+        ssize_t sent = ::sendfile(socket, fileDescriptor, &offset,
+                                  std::min(size - offset, MAX_IO_CHUNK));
+        if (sent < 0) {
+            int err = socketLastError();
+            if (socketInterrupted(err)) continue;
+            Logger::error("Failed to send file: " + std::to_string(err));
+            return false;
+        }
+        if (sent == 0) {
+            Logger::error("File ended before " + std::to_string(size) + " bytes were sent");
+            return false;
+        }
+    }
+    return true;
+#else
+    // No sendfile here: read through a buffer the size of a checksum chunk
+    std::vector<uint8_t> buffer(static_cast<size_t>(std::min(size, CHECKSUM_CHUNK_SIZE)));
+    for (uint64_t offset = 0; offset < size; ) {
+        const unsigned int chunk =
+            static_cast<unsigned int>(std::min<uint64_t>(buffer.size(), size - offset));
+#ifdef _WIN32
+        int count = _read(fileDescriptor, buffer.data(), chunk);
+#else
+        ssize_t count = ::read(fileDescriptor, buffer.data(), chunk);
+#endif
+        if (count <= 0) {
+            Logger::error("File ended before " + std::to_string(size) + " bytes were sent");
+            return false;
+        }
+        if (!sendData(socket, buffer.data(), static_cast<uint64_t>(count))) return false;
+        offset += static_cast<uint64_t>(count);
+    }
+    return true;
+#endif
+}
+
 bool NetworkUtils::sendString(SOCKET socket, const std::string& str) {
     uint32_t length = htonl(static_cast<uint32_t>(str.size()));
 
@@ -110,20 +218,88 @@ void NetworkUtils::closeSocket(SOCKET socket) {
     }
 }
 
+void NetworkUtils::abortSocket(SOCKET socket) {
+    if (socket == INVALID_SOCKET) return;
+    linger reset{};
+    reset.l_onoff = 1;
+    reset.l_linger = 0;
+    setsockopt(socket, SOL_SOCKET, SO_LINGER, reinterpret_cast<const char*>(&reset),
+               sizeof(reset));
+    closesocket(socket);
+}
+
+bool NetworkUtils::isPeerGone(SOCKET socket) {
+#ifdef _WIN32
+    WSAPOLLFD entry{};
+    entry.fd = socket;
+    entry.events = POLLRDNORM;
+    if (WSAPoll(&entry, 1, 0) <= 0) return false;
+#else
+    pollfd entry{};
+    entry.fd = socket;
+    entry.events = POLLIN;
+    if (poll(&entry, 1, 0) <= 0) return false;
+#endif
+    return (entry.revents & (POLLERR | POLLHUP)) != 0;
+}
+
+bool NetworkUtils::waitReadable(SOCKET socket, int milliseconds) {
+#ifdef _WIN32
+    WSAPOLLFD entry{};
+    entry.fd = socket;
+    entry.events = POLLRDNORM;
+    return WSAPoll(&entry, 1, milliseconds) > 0;
+#else
+    pollfd entry{};
+    entry.fd = socket;
+    entry.events = POLLIN;
+    return poll(&entry, 1, milliseconds) > 0;
+#endif
+}
+
 bool NetworkUtils::setSocketTimeout(SOCKET socket, int seconds) {
+#ifdef _WIN32
     DWORD timeout = seconds * 1000;
+#else
+    timeval timeout{};
+    timeout.tv_sec = seconds;
+#endif
 
     if (setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO,
                    reinterpret_cast<const char*>(&timeout), sizeof(timeout)) < 0) {
-        Logger::error("Failed to set receive timeout: " + std::to_string(WSAGetLastError()));
+        Logger::error("Failed to set receive timeout: " + std::to_string(socketLastError()));
         return false;
     }
 
     if (setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO,
                    reinterpret_cast<const char*>(&timeout), sizeof(timeout)) < 0) {
-        Logger::error("Failed to set send timeout: " + std::to_string(WSAGetLastError()));
+        Logger::error("Failed to set send timeout: " + std::to_string(socketLastError()));
         return false;
     }
 
     return true;
 }
+
+bool NetworkUtils::setNonBlocking(SOCKET socket) {
+#ifdef _WIN32
+    u_long mode = 1;
+    if (ioctlsocket(socket, FIONBIO, &mode) != 0) {
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    if (flags < 0 || fcntl(socket, F_SETFL, flags | O_NONBLOCK) < 0) {
+#endif
+        Logger::error("Failed to make socket non-blocking: " + std::to_string(socketLastError()));
+        return false;
+    }
+    return true;
+}
+
+bool NetworkUtils::setNoDelay(SOCKET socket) {
+    int enabled = 1;
+    if (setsockopt(socket, IPPROTO_TCP, TCP_NODELAY,
+                   reinterpret_cast<const char*>(&enabled), sizeof(enabled)) < 0) {
+        Logger::error("Failed to set TCP_NODELAY: " + std::to_string(socketLastError()));
+        return false;
+    }
+    return true;
+}
@@ -1,17 +1,34 @@
 #ifndef NETWORK_UTILS_H
 #define NETWORK_UTILS_H
 
-#include <winsock2.h>
+#include "socketCompat.h"
 #include <string>
 #include <vector>
 #include <cstdint>
 
 class NetworkUtils {
 public:
+    // Process-wide socket setup and teardown (Winsock on Windows; on POSIX,
+    // SIGPIPE is ignored so a vanished peer surfaces as EPIPE instead)
+    static bool initialize();
+    static void cleanup();
+
     // Send and receive raw data
     static bool sendData(SOCKET socket, const void* data, uint64_t size);
     static bool receiveData(SOCKET socket, void* buffer, uint64_t size);
 
+    // Same as above, extending crc (CRC32C) over the bytes chunk by chunk as
+    // they are sent or land, so checksumming needs no separate pass
+    static bool sendDataWithChecksum(SOCKET socket, const void* data, uint64_t size,
+                                     uint32_t& crc);
+    static bool receiveDataWithChecksum(SOCKET socket, void* buffer, uint64_t size,
+                                        uint32_t& crc);
+
+    // Send size bytes of an open file from its start. On Linux the kernel
+    // copies them from the page cache (sendfile); elsewhere they are read
+    // through a small buffer.
+    static bool sendFile(SOCKET socket, int fileDescriptor, uint64_t size);
+
     // Send and receive strings
     static bool sendString(SOCKET socket, const std::string& str);
     static bool receiveString(SOCKET socket, std::string& str, uint32_t length);
@@ -22,7 +39,22 @@ public:
 
     // Utility functions
     static void closeSocket(SOCKET socket);
+
+    // Close with a reset instead of an orderly shutdown, telling the peer
+    // at once that nothing more will be read
+    static void abortSocket(SOCKET socket);
+
+    // Whether the peer has reset or hung up the connection, checked without
+    // blocking. A peer that only finished sending (half-close) is not gone.
+    static bool isPeerGone(SOCKET socket);
+
+    // Wait up to milliseconds for socket to have something to read (or a
+    // pending connection, on a listening socket); true once it does
+    static bool waitReadable(SOCKET socket, int milliseconds);
+
     static bool setSocketTimeout(SOCKET socket, int seconds);
+    static bool setNonBlocking(SOCKET socket);
+    static bool setNoDelay(SOCKET socket); // disable Nagle for request/response traffic
 };
 
 #endif // NETWORK_UTILS_H
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef SOCKET_COMPAT_H
+#define SOCKET_COMPAT_H
+
+// Platform socket layer. The tree is written against the Winsock names
+// (SOCKET, INVALID_SOCKET, closesocket); on POSIX they map onto plain file
+// descriptors so the same code builds on Linux.
+#ifdef _WIN32
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+
+#ifndef SHUT_RDWR
+#define SHUT_RDWR SD_BOTH
+#endif
+
+inline int socketLastError() { return WSAGetLastError(); }
+inline bool socketInterrupted(int err) { return err == WSAEINTR; }
+inline bool socketWouldBlock(int err) { return err == WSAEWOULDBLOCK; }
+inline bool socketTimedOut(int err) { return err == WSAETIMEDOUT; }
+
+#else
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+
+typedef int SOCKET;
+typedef sockaddr SOCKADDR;
+
+constexpr SOCKET INVALID_SOCKET = -1;
+constexpr int SOCKET_ERROR = -1;
+
+inline int closesocket(SOCKET socket) { return ::close(socket); }
+
+inline int socketLastError() { return errno; }
+inline bool socketInterrupted(int err) { return err == EINTR; }
+inline bool socketWouldBlock(int err) { return err == EAGAIN || err == EWOULDBLOCK; }
+
+// SO_RCVTIMEO expiry surfaces as EAGAIN on POSIX
+inline bool socketTimedOut(int err) { return socketWouldBlock(err) || err == ETIMEDOUT; }
+
+#endif
+
+#endif // SOCKET_COMPAT_H
@@ -0,0 +1,120 @@
+#include "compressionStream.h"
+#include "algorithmFactory.h"
+#include "frameFormat.h"
+#include "fileHandler.h"
+#include "bufferPool.h"
+#include "checksum.h"
+#include "metrics.h"
+#include "logger.h"
+#include <algorithm>
+#include <memory_resource>
+
+CompressionStream::CompressionStream(AlgorithmType algorithm, std::string name,
+                                     uint64_t size, bool checksum, uint32_t block)
+    : type(algorithm),
+      filename(std::move(name)),
+      contentSize(size),
+      checksumEnabled(checksum),
+      blockSize(block),
+      blockCount(static_cast<uint32_t>((size + block - 1) / block)),
+      finalSequence(0),
+      blockCrcs(blockCount, 0),
+      encodedBytes(0),
+      outstanding(blockCount),
+      failed(false),
+      cancelled(false),
+      started(std::chrono::steady_clock::now()) {
+    auto codec = AlgorithmFactory::createAlgorithm(type);
+    codecName = codec ? codec->getName() : algorithmTypeToString(type);
+}
+
+size_t CompressionStream::blockLength(uint32_t index) const {
+    const uint64_t offset = static_cast<uint64_t>(index) * blockSize;
+    return static_cast<size_t>(std::min<uint64_t>(blockSize, contentSize - offset));
+}
+
+Response CompressionStream::compressBlock(uint32_t index, std::vector<uint8_t>&& data,
+                                          bool& last) {
+    if (cancelFlag && cancelFlag->load(std::memory_order_relaxed)) {
+        BufferPool::instance().release(std::move(data));
+        cancelled = true;
+        failed = true;
+        last = (outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1);
+        return Response(OperationStatus::FAILURE, "", "Cancelled: the client went away", {});
+    }
+
+    std::vector<uint8_t> chunk = BufferPool::instance().acquireCapacity(
+        data.size() + FrameFormat::blockHeaderSize(FrameFormat::DEFAULT_FLAGS));
+
+    // Blocks of one stream may be compressed side by side, so each gets its
+    // own codec and arena
+    std::pmr::monotonic_buffer_resource arena(REQUEST_ARENA_INITIAL_SIZE);
+    auto codec = AlgorithmFactory::createAlgorithm(type, &arena);
+    if (!codec || !FrameFormat::encodeBlock(*codec, data.data(), data.size(), chunk,
+                                            FrameFormat::DEFAULT_FLAGS, blockCrcs[index])) {
+        Logger::error("Stream " + filename + ": block " + std::to_string(index) + " failed");
+        failed = true;
+        chunk.clear();
+    }
+    BufferPool::instance().release(std::move(data));
+    encodedBytes += chunk.size();
+
+    Response response(OperationStatus::IN_PROGRESS, "", "", std::move(chunk));
+    response.setChecksumEnabled(checksumEnabled);
+    last = (outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1);
+    return response;
+}
+
+void CompressionStream::record(bool succeeded, uint64_t bytesOut) const {
+    // One request from the first block received to the closing response
+    Metrics::instance().recordRequest(
+        MessageType::COMPRESS_REQUEST, type, contentSize, bytesOut, succeeded,
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - started));
+}
+
+Response CompressionStream::finish() {
+    Response response;
+    response.setChecksumEnabled(checksumEnabled);
+    if (cancelled) {
+        Logger::warning("Stream " + filename + " cancelled: the client went away");
+        response.setStatus(OperationStatus::FAILURE);
+        response.setMessage("Cancelled: the client went away");
+        Metrics::instance().requestCancelled(contentSize);
+        return response;
+    }
+    if (failed) {
+        response.setStatus(OperationStatus::FAILURE);
+        response.setMessage("Compression failed");
+        record(false, 0);
+        return response;
+    }
+
+    // Block checksums are stitched together in order, as compressParallel does
+    uint32_t contentCrc = 0;
+    for (uint32_t i = 0; i < blockCount; i++) {
+        contentCrc = Checksum::crc32cCombine(contentCrc, blockCrcs[i], blockLength(i));
+    }
+
+    std::vector<uint8_t> envelope;
+    FrameFormat::encodeEnvelope(type, contentSize, encodedBytes, blockSize,
+                                FrameFormat::DEFAULT_FLAGS, contentCrc, envelope);
+
+    const size_t frameSize = encodedBytes + envelope.size();
+    const double ratio = contentSize == 0 ? 0.0
+        : (1.0 - static_cast<double>(frameSize) / contentSize) * 100.0;
+    std::string outputFilename = FileHandler::generateOutputFilename(
+        filename, "compress", codecName);
+
+    Logger::info("Streamed compression completed: " + outputFilename + " (" +
+                 std::to_string(blockCount) + " blocks, " + std::to_string(frameSize) +
+                 " bytes)");
+    record(true, frameSize);
+
+    response.setStatus(OperationStatus::SUCCESS);
+    response.setFilename(std::move(outputFilename));
+    response.setData(std::move(envelope));
+    response.setMessage("Compression successful (streamed). Ratio: " +
+                        std::to_string(ratio) + "%");
+    return response;
+}
@@ -0,0 +1,82 @@
+#ifndef COMPRESSION_STREAM_H
+#define COMPRESSION_STREAM_H
+
+#include "response.h"
+#include "messageTypes.h"
+#include "config.h"
+#include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+
+// One streamed compress request (PAYLOAD_FLAG_STREAM). The upload is cut
+// into frame blocks as it arrives; each block is compressed as soon as it is
+// complete and goes back as its own IN_PROGRESS response carrying just that
+// block. After the last block a final response carries the frame header
+// followed by the trailer, so the client rebuilds the frame as
+//
+//   final.data[0, HEADER_SIZE) + block chunks in order + the rest of final.data
+//
+// which is byte-for-byte what FrameFormat::compress() produces. Blocks may
+// be compressed on different threads and in any order; the connection keeps
+// the responses in sequence.
+//
+// Streamed results go straight back to the client: they are not saved to
+// disk, cached or stored, since nothing holds the whole frame at once.
+// Once the cancel flag is raised, blocks still to come are dropped
+// uncompressed and the stream is counted as cancelled.
+class CompressionStream {
+public:
+    CompressionStream(AlgorithmType type, std::string filename, uint64_t contentSize,
+                      bool checksumEnabled, uint32_t blockSize = DEFAULT_FRAME_BLOCK_SIZE);
+
+    CompressionStream(const CompressionStream&) = delete;
+    CompressionStream& operator=(const CompressionStream&) = delete;
+
+    uint32_t getBlockCount() const { return blockCount; }
+    uint32_t getBlockSize() const { return blockSize; }
+
+    // Length of block index; every block but the last is a full block
+    size_t blockLength(uint32_t index) const;
+
+    // Compress block index (data is returned to the buffer pool) and return
+    // its chunk response. last is set for exactly one caller: the one whose
+    // block was the final one outstanding, which must then send finish().
+    Response compressBlock(uint32_t index, std::vector<uint8_t>&& data, bool& last);
+
+    // Header and trailer once every block is done; FAILURE if any block failed
+    Response finish();
+
+    // Raised when the client has gone (see Connection)
+    void setCancelFlag(std::shared_ptr<const std::atomic<bool>> flag) {
+        cancelFlag = std::move(flag);
+    }
+
+    // Sequence number reserved for the final response (event loop path)
+    void setFinalSequence(uint64_t sequence) { finalSequence = sequence; }
+    uint64_t getFinalSequence() const { return finalSequence; }
+
+private:
+    void record(bool succeeded, uint64_t bytesOut) const; // into Metrics
+
+    AlgorithmType type;
+    std::string codecName;                // names the output file
+    std::string filename;
+    uint64_t contentSize;
+    bool checksumEnabled;
+    uint32_t blockSize;
+    uint32_t blockCount;
+    uint64_t finalSequence;
+
+    std::vector<uint32_t> blockCrcs;      // one slot per block, written once each
+    std::atomic<uint64_t> encodedBytes;   // total length of the chunks sent
+    std::atomic<uint32_t> outstanding;    // blocks not yet compressed
+    std::atomic<bool> failed;
+    std::atomic<bool> cancelled;          // a block was dropped for cancelFlag
+    std::shared_ptr<const std::atomic<bool>> cancelFlag;
+    std::chrono::steady_clock::time_point started;
+};
+
+#endif // COMPRESSION_STREAM_H
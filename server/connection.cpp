@@ -0,0 +1,453 @@
+#include "connection.h"
+
+#ifdef __linux__
+
+#include "networkUtils.h"
+#include "bufferPool.h"
+#include "checksum.h"
+#include "memoryBudget.h"
+#include "metrics.h"
+#include "algorithmFactory.h"
+#include "logger.h"
+#include "config.h"
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+Connection::Connection(SOCKET sock, uint64_t connectionId, bool streamingEnabled)
+    : socket(sock),
+      id(connectionId),
+      cancelFlag(std::make_shared<std::atomic<bool>>(false)),
+      streaming(streamingEnabled),
+      peerClosed(false),
+      interest(0),
+      lastActivity(std::chrono::steady_clock::now()),
+      nextSequence(0),
+      nextToQueue(0),
+      stage(ReadStage::HEADER),
+      rejected(false),
+      header(),
+      trailer(0),
+      crc(0),
+      target(nullptr),
+      targetRemaining(0),
+      charge(0),
+      blocksTaken(0),
+      readStart(0),
+      readEnd(0) {
+    parser = parseRequests();
+    parser.resume();
+    Metrics::instance().connectionOpened();
+}
+
+Connection::~Connection() {
+    // Work still queued or running for this connection stops at its next check
+    cancelFlag->store(true, std::memory_order_relaxed);
+
+    MemoryBudget& budget = MemoryBudget::instance();
+    for (auto& entry : finishedEarly) {
+        BufferPool::instance().release(entry.second.takeData());
+    }
+    for (size_t held : charges) {
+        budget.release(held);
+    }
+    for (auto& out : writeQueue) {
+        BufferPool::instance().release(std::move(out.payload));
+        budget.release(out.charge);
+    }
+    BufferPool::instance().release(std::move(payload));
+    BufferPool::instance().release(std::move(readBuffer));
+    budget.release(charge);
+    NetworkUtils::closeSocket(socket);
+    Metrics::instance().connectionClosed();
+}
+
+void Connection::setTarget(void* destination, size_t size) {
+    target = static_cast<uint8_t*>(destination);
+    targetRemaining = size;
+}
+
+Connection::Parser& Connection::Parser::operator=(Parser&& other) noexcept {
+    if (this != &other) {
+        if (handle) handle.destroy();
+        handle = other.handle;
+        other.handle = nullptr;
+    }
+    return *this;
+}
+
+void Connection::Parser::resume() {
+    // A parser that threw has finished and must not be resumed again
+    if (!handle || handle.done()) return;
+    handle.resume();
+    if (handle.promise().error) {
+        std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+    }
+}
+
+Connection::Parser Connection::parseRequests() {
+    while (true) {
+        header = MessageHeader();
+        filename.clear();
+        payload.clear();
+        co_await receive(ReadStage::HEADER, &header, sizeof(header));
+
+        if (header.fileNameLength > MAX_FILENAME_LENGTH) {
+            Logger::error("Connection " + std::to_string(id) + ": filename length " +
+                          std::to_string(header.fileNameLength) + " out of range");
+            stage = ReadStage::FAILED;
+            co_return;
+        }
+        filename.resize(header.fileNameLength);
+        co_await receive(ReadStage::FILENAME, filename.data(), filename.size());
+
+        const bool checksummed = (header.flags & PAYLOAD_FLAG_CHECKSUM) != 0;
+        if (streaming && (header.flags & PAYLOAD_FLAG_STREAM) &&
+            !(header.flags & PAYLOAD_FLAG_SUBMIT) &&
+            header.type == MessageType::COMPRESS_REQUEST && header.dataSize > 0 &&
+            AlgorithmFactory::isSupported(header.algorithm)) {
+            stream = std::make_shared<CompressionStream>(header.algorithm, filename,
+                                                         header.dataSize, checksummed);
+            stream->setCancelFlag(cancelFlag);
+        }
+
+        if (header.dataSize > MAX_REQUEST_SIZE ||
+            MemoryBudget::instance().exceedsLimit(admissionCharge())) {
+            // Refused from the header alone; nothing is allocated for it
+            Logger::warning("Connection " + std::to_string(id) + ": refusing " +
+                            std::to_string(header.dataSize) + " byte request");
+            const bool tooLarge = header.dataSize > MAX_REQUEST_SIZE;
+            reject(OperationStatus::FAILURE,
+                   "Request of " + std::to_string(header.dataSize) + " bytes exceeds the " +
+                   (tooLarge ? "server limit of " + std::to_string(MAX_REQUEST_SIZE)
+                             : "memory budget of " +
+                               std::to_string(MemoryBudget::instance().getLimit())) +
+                   " bytes");
+        } else {
+            // The loop resumes us as budget frees up, or rejects the request
+            // once it has waited ADMISSION_WAIT_MS
+            waitingSince = std::chrono::steady_clock::now();
+            while (!rejected && !admit()) {
+                co_await pause(ReadStage::ADMISSION);
+            }
+        }
+
+        if (rejected) {
+            // Skip the payload (and its checksum) as it arrives
+            rejected = false;
+            co_await receive(ReadStage::DISCARD, nullptr,
+                             static_cast<size_t>(header.dataSize) +
+                             (checksummed ? sizeof(trailer) : 0));
+            continue;
+        }
+
+        // A streamed request is handed over a block at a time as each one
+        // fills; only the last block waits for the trailer
+        crc = 0;
+        const uint32_t blocks = stream ? stream->getBlockCount() : 1;
+        for (uint32_t block = 0; block < blocks; block++) {
+            // Pooled buffer: recv overwrites it, so recycled bytes need no zeroing
+            payload = BufferPool::instance().acquire(stream ? stream->blockLength(block)
+                                                            : header.dataSize);
+            co_await receive(ReadStage::PAYLOAD, payload.data(), payload.size());
+
+            if (checksummed && block + 1 == blocks) {
+                co_await receive(ReadStage::TRAILER, &trailer, sizeof(trailer));
+                if (crc != trailer) {
+                    Logger::error("Request payload checksum mismatch");
+                    stage = ReadStage::FAILED;
+                    co_return;
+                }
+            }
+            co_await pause(stream ? ReadStage::BLOCK : ReadStage::COMPLETE);
+        }
+    }
+}
+
+bool Connection::advance(size_t count) {
+    // Stage timing starts with the first byte of a request's header
+    if (stage == ReadStage::HEADER && targetRemaining == sizeof(header) && count > 0) {
+        receiveStarted = std::chrono::steady_clock::now();
+    }
+    // Checksum payload bytes while they are still in cache
+    if (stage == ReadStage::PAYLOAD && (header.flags & PAYLOAD_FLAG_CHECKSUM)) {
+        crc = Checksum::crc32c(target, count, crc);
+    }
+    if (target) target += count;
+    targetRemaining -= count;
+
+    if (targetRemaining == 0) parser.resume();
+    return stage != ReadStage::FAILED;
+}
+
+size_t Connection::admissionCharge() const {
+    // A stream holds at most a pipeline's worth of blocks, plus the one
+    // being received
+    if (stream) {
+        const uint64_t window = static_cast<uint64_t>(MAX_PIPELINED_REQUESTS + 1) *
+                                stream->getBlockSize();
+        return MemoryBudget::chargeFor(std::min<uint64_t>(header.dataSize, window));
+    }
+    return MemoryBudget::chargeFor(header.dataSize);
+}
+
+bool Connection::admit() {
+    const size_t bytes = admissionCharge();
+    if (!MemoryBudget::instance().tryReserve(bytes)) {
+        return false;
+    }
+    charge = bytes;
+    blocksTaken = 0;
+    return true;
+}
+
+void Connection::reject(OperationStatus status, const std::string& message) {
+    stream.reset();
+    Response response(status, filename, message, {});
+    response.setChecksumEnabled((header.flags & PAYLOAD_FLAG_CHECKSUM) != 0);
+    charges.push_back(0);
+    completeRequest(nextSequence++, std::move(response));
+    rejected = true;
+}
+
+Connection::Status Connection::readAvailable() {
+    Status status = receiveAvailable();
+
+    // Nothing left over: give the buffer back rather than keep 64 KiB per
+    // idle connection
+    if (readStart == readEnd && !readBuffer.empty()) {
+        BufferPool::instance().release(std::move(readBuffer));
+        readBuffer.clear();
+        readStart = readEnd = 0;
+    }
+    return status;
+}
+
+Connection::Status Connection::receiveAvailable() {
+    size_t budget = CONNECTION_READ_BUDGET;
+    while (stage != ReadStage::COMPLETE && stage != ReadStage::BLOCK) {
+        if (stage == ReadStage::FAILED) return Status::FAILED;
+
+        // Rejected requests hold pipeline slots too; the event loop resumes
+        // reading once responses drain
+        if (stage == ReadStage::HEADER && targetRemaining == sizeof(header) &&
+            getInFlight() >= MAX_PIPELINED_REQUESTS) {
+            return Status::PENDING;
+        }
+
+        // The parser retries the reservation, or skips a rejected payload
+        if (stage == ReadStage::ADMISSION) {
+            parser.resume();
+            if (stage == ReadStage::ADMISSION) return Status::OVER_BUDGET;
+            continue;
+        }
+
+        // Bytes already buffered are parsed before touching the socket
+        if (readStart < readEnd) {
+            size_t count = std::min(readEnd - readStart, targetRemaining);
+            if (target) std::memcpy(target, readBuffer.data() + readStart, count);
+            readStart += count;
+            if (!advance(count)) return Status::FAILED;
+            continue;
+        }
+
+        // Level-triggered epoll wakes us again for whatever is left
+        if (budget == 0) return Status::PENDING;
+
+        // Large remainders go straight to their destination, skipping a copy
+        const bool direct = target && targetRemaining >= CONNECTION_READ_BUFFER_SIZE;
+        if (!direct && readBuffer.empty()) {
+            readBuffer = BufferPool::instance().acquire(CONNECTION_READ_BUFFER_SIZE);
+        }
+        uint8_t* destination = direct ? target : readBuffer.data();
+        size_t length = direct ? std::min(targetRemaining, budget) : readBuffer.size();
+
+        ssize_t received = recv(socket, destination, length, 0);
+        if (received == 0) {
+            return Status::CLOSED;
+        }
+        if (received < 0) {
+            int err = socketLastError();
+            if (socketInterrupted(err)) continue;
+            if (socketWouldBlock(err)) return Status::PENDING;
+            Logger::error("Connection " + std::to_string(id) + ": receive failed: " +
+                          std::to_string(err));
+            return Status::FAILED;
+        }
+
+        lastActivity = std::chrono::steady_clock::now();
+        budget -= std::min(budget, static_cast<size_t>(received));
+
+        if (direct) {
+            if (!advance(static_cast<size_t>(received))) return Status::FAILED;
+        } else {
+            readStart = 0;
+            readEnd = static_cast<size_t>(received);
+        }
+    }
+
+    return stage == ReadStage::BLOCK ? Status::BLOCK_READY : Status::REQUEST_READY;
+}
+
+bool Connection::isPipelineFull() const {
+    return getInFlight() >= MAX_PIPELINED_REQUESTS ||
+           (stream && writeQueue.size() >= MAX_PIPELINED_REQUESTS);
+}
+
+Request Connection::takeRequest(uint64_t& sequence) {
+    Request request(header.type, header.algorithm, std::move(filename), std::move(payload));
+    request.setChecksumEnabled((header.flags & PAYLOAD_FLAG_CHECKSUM) != 0);
+    request.setSaveOutput((header.flags & PAYLOAD_FLAG_NO_SAVE) == 0);
+    request.setTimingRequested((header.flags & PAYLOAD_FLAG_TIMING) != 0);
+    request.setSubmitted((header.flags & PAYLOAD_FLAG_SUBMIT) != 0);
+    request.setCancelFlag(cancelFlag);
+    request.setReceiveTimes(receiveStarted, std::chrono::steady_clock::now());
+
+    Logger::info("Request received: " + messageTypeToString(request.getMessageType()) +
+                 ", Algorithm: " + algorithmTypeToString(request.getAlgorithmType()) +
+                 ", File: " + request.getFilename() +
+                 ", Size: " + std::to_string(request.getData().size()));
+
+    // A submitted job outlives its acknowledgement, so it takes the charge
+    // with it rather than being charged again
+    if (request.isSubmitted()) {
+        request.setAdmission(MemoryBudget::Hold(charge));
+        charges.push_back(0);
+    } else {
+        charges.push_back(charge);
+    }
+    charge = 0;
+    sequence = nextSequence++;
+    parser.resume();
+    return request;
+}
+
+Connection::StreamBlock Connection::takeBlock(uint64_t& sequence) {
+    StreamBlock block{stream, blocksTaken++, std::move(payload)};
+    charges.push_back(0);
+    sequence = nextSequence++;
+
+    if (blocksTaken == stream->getBlockCount()) {
+        // The final response comes after every chunk and returns the charge
+        Logger::info("Streamed request received: File: " + filename + ", Size: " +
+                     std::to_string(header.dataSize) + " in " +
+                     std::to_string(blocksTaken) + " blocks");
+        stream->setFinalSequence(nextSequence++);
+        charges.push_back(charge);
+        charge = 0;
+        stream.reset();
+    }
+    parser.resume();
+    return block;
+}
+
+void Connection::completeRequest(uint64_t sequence, Response&& response) {
+    if (sequence != nextToQueue) {
+        finishedEarly.emplace(sequence, std::move(response));
+        return;
+    }
+
+    queueResponse(std::move(response));
+    nextToQueue++;
+
+    // Release any later responses that were waiting on this one
+    auto it = finishedEarly.begin();
+    while (it != finishedEarly.end() && it->first == nextToQueue) {
+        queueResponse(std::move(it->second));
+        nextToQueue++;
+        it = finishedEarly.erase(it);
+    }
+}
+
+void Connection::queueResponse(Response&& response) {
+    Outgoing out;
+    response.encodeHead(out.head);
+    out.payload = response.takeData();
+    out.file = response.takeFile();
+    out.trailer = 0;
+    out.trailerSize = 0;
+    out.sent = 0;
+    out.charge = charges.front();
+    out.hold = response.takeHold();
+    charges.pop_front();
+    if (response.isChecksumEnabled() && !out.file.isOpen()) {
+        out.trailer = Checksum::crc32c(out.payload.data(), out.payload.size());
+        out.trailerSize = sizeof(out.trailer);
+    }
+    writeQueue.push_back(std::move(out));
+}
+
+ssize_t Connection::sendPieces(const Outgoing& out) {
+    // Gather whatever is left of head, payload and trailer
+    iovec parts[3];
+    int partCount = 0;
+    size_t offset = out.sent;
+    const std::pair<const void*, size_t> pieces[3] = {
+        {out.head.data(), out.head.size()},
+        {out.payload.data(), out.payload.size()},
+        {&out.trailer, out.trailerSize},
+    };
+    for (const auto& piece : pieces) {
+        if (offset >= piece.second) {
+            offset -= piece.second;
+            continue;
+        }
+        parts[partCount].iov_base =
+            const_cast<uint8_t*>(static_cast<const uint8_t*>(piece.first) + offset);
+        parts[partCount].iov_len = piece.second - offset;
+        partCount++;
+        offset = 0;
+    }
+
+    msghdr message{};
+    message.msg_iov = parts;
+    message.msg_iovlen = partCount;
+    return sendmsg(socket, &message, MSG_NOSIGNAL);
+}
+
+Connection::Status Connection::writePending() {
+    while (!writeQueue.empty()) {
+        Outgoing& out = writeQueue.front();
+
+        // A file payload follows the head straight from the page cache
+        const size_t inMemory = out.head.size() + out.payload.size();
+        ssize_t sent;
+        if (out.file.isOpen() && out.sent >= inMemory) {
+            off_t offset = static_cast<off_t>(out.sent - inMemory);
+            sent = ::sendfile(socket, out.file.getDescriptor(), &offset,
+                              out.file.getSize() - (out.sent - inMemory));
+            if (sent == 0) {
+                Logger::error("Connection " + std::to_string(id) + ": file ended early");
+                return Status::FAILED;
+            }
+        } else {
+            sent = sendPieces(out);
+        }
+
+        if (sent < 0) {
+            int err = socketLastError();
+            if (socketInterrupted(err)) continue;
+            if (socketWouldBlock(err)) return Status::PENDING;
+            Logger::error("Connection " + std::to_string(id) + ": send failed: " +
+                          std::to_string(err));
+            return Status::FAILED;
+        }
+
+        lastActivity = std::chrono::steady_clock::now();
+        out.sent += static_cast<size_t>(sent);
+
+        if (out.sent == out.total()) {
+            Logger::info("Response sent: " + std::to_string(out.total()) + " bytes on connection " +
+                         std::to_string(id));
+            BufferPool::instance().release(std::move(out.payload));
+            MemoryBudget::instance().release(out.charge);
+            writeQueue.pop_front();
+        }
+    }
+
+    return Status::DONE;
+}
+
+#endif // __linux__
@@ -0,0 +1,267 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#ifdef __linux__
+
+#include "request.h"
+#include "response.h"
+#include "compressionStream.h"
+#include "socketCompat.h"
+#include <vector>
+#include <string>
+#include <deque>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <cstdint>
+
+// One client socket driven by the event loop. Incoming bytes are parsed into
+// a Request as they arrive and queued responses are written out as the
+// socket drains; neither side ever blocks.
+//
+// The parser is a coroutine that reads a request front to back, suspending
+// whenever it needs more bytes, budget, or the loop to take what it has.
+// Between requests a connection holds no read buffer, so an idle keep-alive
+// connection costs this object and a small coroutine frame, not a thread.
+//
+// Connections are persistent and may carry pipelined requests. Each request
+// is numbered as it is taken, and responses are written strictly in that
+// order however the workers finish them.
+//
+// A request's payload is only allocated once its charge fits the server's
+// MemoryBudget; until then the connection stops reading. The charge is
+// returned when the response has been written.
+//
+// Streamed compress requests (PAYLOAD_FLAG_STREAM, see compressionStream.h)
+// are handed over a frame block at a time with takeBlock() while the rest of
+// the upload is still arriving. Every block takes its own sequence number and
+// the final response one more, so chunks and the closing response are
+// written in order like any other pipelined responses. The budget charge
+// covers a window of blocks rather than the whole upload.
+//
+// Every request and stream taken from a connection shares its cancel flag,
+// raised when the connection is destroyed. The loop only drops a connection
+// with requests in flight once the client is gone (reset, hangup, or a
+// failed write), so workers use the flag to abandon what nobody will read.
+// A half-close is not abandonment: those requests are still answered.
+class Connection {
+public:
+    enum class Status {
+        PENDING,       // socket drained, nothing complete yet
+        REQUEST_READY, // takeRequest() has a full request
+        BLOCK_READY,   // takeBlock() has the next block of a streamed request
+        OVER_BUDGET,   // next payload does not fit the memory budget yet
+        DONE,          // every queued response has been written
+        CLOSED,        // peer closed the connection
+        FAILED         // socket error or malformed request
+    };
+
+    // Without streaming, PAYLOAD_FLAG_STREAM is ignored and such requests
+    // are taken whole
+    Connection(SOCKET socket, uint64_t id, bool streaming = false);
+    ~Connection();
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    SOCKET getSocket() const { return socket; }
+    uint64_t getId() const { return id; }
+
+    // Raised by the destructor; handed to every request and stream taken
+    const std::shared_ptr<std::atomic<bool>>& getCancelFlag() const { return cancelFlag; }
+
+    // Read what the socket has, stopping at the end of one request
+    Status readAvailable();
+
+    // Hand over the parsed request and its sequence number, then start
+    // parsing the next one
+    Request takeRequest(uint64_t& sequence);
+
+    // Hand over the next block of a streamed request and its sequence
+    // number. The last block also reserves the final response's sequence
+    // (CompressionStream::getFinalSequence()) and ends the request.
+    struct StreamBlock {
+        std::shared_ptr<CompressionStream> stream;
+        uint32_t index;
+        std::vector<uint8_t> data;
+    };
+    StreamBlock takeBlock(uint64_t& sequence);
+
+    // Accept the response for a sequence number; it is queued for writing
+    // once every earlier response has been. writePending() sends as much as
+    // the socket takes.
+    void completeRequest(uint64_t sequence, Response&& response);
+    Status writePending();
+    bool hasPendingWrite() const { return !writeQueue.empty(); }
+
+    // Parsing is parked before a payload that did not fit the budget
+    bool isWaitingForBudget() const { return stage == ReadStage::ADMISSION; }
+    std::chrono::steady_clock::time_point getWaitingSince() const { return waitingSince; }
+
+    // Answer the request being parsed without receiving it: the response
+    // takes its place in the pipeline and the payload bytes are skipped
+    void reject(OperationStatus status, const std::string& message);
+
+    // Requests taken but not yet queued for writing
+    size_t getInFlight() const { return static_cast<size_t>(nextSequence - nextToQueue); }
+
+    // Reading pauses at MAX_PIPELINED_REQUESTS in flight, or while a stream
+    // has that many chunks waiting to be written (chunks hold no charge)
+    bool isPipelineFull() const;
+
+    // The peer has finished sending; remaining responses are still written
+    bool isPeerClosed() const { return peerClosed; }
+    void setPeerClosed() { peerClosed = true; }
+
+    // epoll events currently registered for this socket
+    uint32_t getInterest() const { return interest; }
+    void setInterest(uint32_t events) { interest = events; }
+
+    std::chrono::steady_clock::time_point getLastActivity() const { return lastActivity; }
+
+    // Read bytes are only buffered while a request is partly received
+    bool hasReadBuffer() const { return !readBuffer.empty(); }
+
+private:
+    enum class ReadStage {
+        HEADER, FILENAME, ADMISSION, PAYLOAD, TRAILER, DISCARD, BLOCK, COMPLETE, FAILED
+    };
+
+    // Handle to the parser coroutine; it starts suspended and is resumed
+    // once to reach its first read
+    class Parser {
+    public:
+        struct promise_type {
+            std::exception_ptr error;
+            Parser get_return_object() {
+                return Parser(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { error = std::current_exception(); }
+        };
+
+        Parser() = default;
+        explicit Parser(std::coroutine_handle<promise_type> coroutine) : handle(coroutine) {}
+        Parser(Parser&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+        Parser& operator=(Parser&& other) noexcept;
+        ~Parser() { if (handle) handle.destroy(); }
+
+        // Run to the next suspension; exceptions from the parser surface here,
+        // once, and leave it finished
+        void resume();
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    // co_await receive(...): park until size bytes have landed in destination
+    // (skipped when destination is null). A no-op for zero bytes.
+    struct Receive {
+        Connection& connection;
+        ReadStage stage;
+        void* destination;
+        size_t size;
+        bool await_ready() const noexcept { return size == 0; }
+        void await_suspend(std::coroutine_handle<>) noexcept {
+            connection.stage = stage;
+            connection.setTarget(destination, size);
+        }
+        void await_resume() const noexcept {}
+    };
+    Receive receive(ReadStage stage, void* destination, size_t size) {
+        return Receive{*this, stage, destination, size};
+    }
+
+    // co_await pause(...): park in a stage the loop acts on (admission, or a
+    // request or block ready to be taken)
+    struct Pause {
+        Connection& connection;
+        ReadStage stage;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<>) noexcept {
+            connection.stage = stage;
+            connection.setTarget(nullptr, 0);
+        }
+        void await_resume() const noexcept {}
+    };
+    Pause pause(ReadStage stage) { return Pause{*this, stage}; }
+
+    Parser parseRequests();
+
+    // Encoded response: head and trailer around the payload, sent with one
+    // gathered write so the payload is never copied. A file payload goes
+    // from the page cache to the socket without entering user space.
+    struct Outgoing {
+        std::vector<uint8_t> head;
+        std::vector<uint8_t> payload;
+        FileBody file;      // sent with sendfile() after head, instead of payload
+        uint32_t trailer;
+        size_t trailerSize;
+        size_t sent;
+        size_t charge;      // budget returned once written
+        MemoryBudget::Hold hold;    // the response's own, likewise
+
+        size_t total() const {
+            return head.size() + payload.size() + file.getSize() + trailerSize;
+        }
+    };
+
+    void queueResponse(Response&& response);
+    ssize_t sendPieces(const Outgoing& out); // head, payload and trailer from out.sent
+
+    Status receiveAvailable();
+
+    // Move the parse target forward, resuming the parser once it fills
+    bool advance(size_t count);
+    void setTarget(void* destination, size_t size);
+    bool admit();
+    size_t admissionCharge() const;
+
+    SOCKET socket;
+    uint64_t id;
+    std::shared_ptr<std::atomic<bool>> cancelFlag;
+    bool streaming;
+    bool peerClosed;
+    uint32_t interest;
+    std::chrono::steady_clock::time_point lastActivity;
+
+    // Ordering for pipelined requests
+    uint64_t nextSequence;
+    uint64_t nextToQueue;
+    std::map<uint64_t, Response> finishedEarly; // done ahead of an earlier request
+    std::deque<size_t> charges;                 // budget held per sequence not yet queued
+
+    // Parse state for the request being received
+    Parser parser;
+    ReadStage stage;
+    bool rejected;              // answered already; the payload is skipped
+    MessageHeader header;
+    std::string filename;
+    std::vector<uint8_t> payload;
+    uint32_t trailer;
+    uint32_t crc;
+    uint8_t* target;            // null while skipping a rejected payload
+    size_t targetRemaining;
+    size_t charge;              // budget reserved for the request being parsed
+    std::shared_ptr<CompressionStream> stream; // set while a streamed request is parsed
+    uint32_t blocksTaken;
+    std::chrono::steady_clock::time_point waitingSince;
+    std::chrono::steady_clock::time_point receiveStarted;
+
+    // Small reads land here first; large payload reads bypass it. Pooled,
+    // and handed back whenever it is drained.
+    std::vector<uint8_t> readBuffer;
+    size_t readStart;
+    size_t readEnd;
+
+    std::deque<Outgoing> writeQueue;
+};
+
+#endif // __linux__
+
+#endif // CONNECTION_H
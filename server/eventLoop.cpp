@@ -0,0 +1,421 @@
+#include "eventLoop.h"
+
+#ifdef __linux__
+
+#include "networkUtils.h"
+#include "bufferPool.h"
+#include "memoryBudget.h"
+#include "logger.h"
+#include "config.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <algorithm>
+
+EventLoop::EventLoop(SOCKET listenSock, Dispatch dispatchFunction,
+                     DispatchBlock dispatchBlockFunction)
+    : listenSocket(listenSock),
+      dispatch(std::move(dispatchFunction)),
+      dispatchBlock(std::move(dispatchBlockFunction)),
+      epollFd(-1),
+      wakeFd(-1),
+      running(false),
+      nextConnectionId(WAKE_ID + 1),
+      connectionCount(0),
+      connectionLimit(descriptorConnectionLimit()),
+      accepting(true) {}
+
+EventLoop::~EventLoop() {
+    connections.clear();
+    for (auto& completion : completions) {
+        BufferPool::instance().release(completion.second.takeData());
+    }
+    if (wakeFd >= 0) close(wakeFd);
+    if (epollFd >= 0) close(epollFd);
+}
+
+size_t EventLoop::descriptorConnectionLimit() {
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return MAX_CONNECTIONS;
+
+    // Idle keep-alive connections cost a descriptor each, so take all the
+    // hard limit allows; an unlimited hard limit is refused and left as is
+    if (limit.rlim_cur < limit.rlim_max) {
+        rlimit raised = limit;
+        raised.rlim_cur = limit.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &raised) == 0) limit = raised;
+    }
+
+    const rlim_t ceiling = 1u << 24; // RLIM_INFINITY has to mean something
+    const size_t descriptors = static_cast<size_t>(std::min(limit.rlim_cur, ceiling));
+    if (descriptors <= EVENT_LOOP_RESERVED_DESCRIPTORS * 2) return descriptors / 2;
+    return descriptors - EVENT_LOOP_RESERVED_DESCRIPTORS;
+}
+
+bool EventLoop::initialize() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0) {
+        Logger::error("Failed to create event loop: " + std::to_string(errno));
+        return false;
+    }
+
+    if (!NetworkUtils::setNonBlocking(listenSocket)) {
+        return false;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = LISTEN_ID;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, listenSocket, &event) < 0) {
+        Logger::error("Failed to watch listening socket: " + std::to_string(errno));
+        return false;
+    }
+
+    event.data.u64 = WAKE_ID;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event) < 0) {
+        Logger::error("Failed to watch wake-up eventfd: " + std::to_string(errno));
+        return false;
+    }
+
+    running = true;
+    return true;
+}
+
+void EventLoop::run() {
+    Logger::info("Event loop started");
+
+    epoll_event events[MAX_EVENTS];
+    auto lastSweep = std::chrono::steady_clock::now();
+
+    while (running) {
+        // Wake at least once a second to time out idle connections
+        int count = epoll_wait(epollFd, events, MAX_EVENTS, 1000);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            Logger::error("epoll_wait failed: " + std::to_string(errno));
+            break;
+        }
+
+        for (int i = 0; i < count && running; i++) {
+            const uint64_t id = events[i].data.u64;
+            if (id == LISTEN_ID) {
+                acceptConnections();
+            } else if (id == WAKE_ID) {
+                uint64_t value;
+                while (read(wakeFd, &value, sizeof(value)) > 0) {}
+                processCompletions();
+            } else {
+                handleEvent(id, events[i].events);
+            }
+        }
+
+        // Responses written above may have returned budget
+        if (!waitingForBudget.empty()) {
+            admitWaiting();
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastSweep >= std::chrono::seconds(1)) {
+            closeIdleConnections();
+            // Retry after running out of descriptors
+            if (!accepting && connections.size() < connectionLimit) {
+                setAccepting(true);
+            }
+            lastSweep = now;
+        }
+    }
+
+    Logger::info("Event loop stopped with " + std::to_string(connections.size()) +
+                 " open connections");
+    connections.clear();
+    connectionCount = 0;
+}
+
+void EventLoop::stop() {
+    running = false;
+    wake();
+}
+
+void EventLoop::wake() {
+    if (wakeFd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd, &one, sizeof(one));
+        (void)written; // a full counter already guarantees a wake-up
+    }
+}
+
+void EventLoop::complete(RequestTag tag, Response&& response) {
+    {
+        std::lock_guard<std::mutex> lock(completionMutex);
+        completions.emplace_back(tag, std::move(response));
+    }
+    wake();
+}
+
+void EventLoop::acceptConnections() {
+    while (true) {
+        SOCKET clientSocket = accept4(listenSocket, nullptr, nullptr,
+                                      SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientSocket == INVALID_SOCKET) {
+            int err = socketLastError();
+            if (socketInterrupted(err)) continue;
+            if (err == EMFILE || err == ENFILE) {
+                // Level-triggered: the pending client would wake us forever
+                Logger::warning("Out of file descriptors, pausing accept");
+                setAccepting(false);
+            } else if (!socketWouldBlock(err)) {
+                Logger::error("Failed to accept client: " + std::to_string(err));
+            }
+            return;
+        }
+
+        NetworkUtils::setNoDelay(clientSocket);
+
+        const uint64_t id = nextConnectionId++;
+        std::unique_ptr<Connection> connection;
+        try {
+            connection = std::make_unique<Connection>(clientSocket, id,
+                                                      static_cast<bool>(dispatchBlock));
+        } catch (const std::exception& e) {
+            Logger::error("Connection " + std::to_string(id) + " not opened: " + e.what());
+            NetworkUtils::closeSocket(clientSocket);
+            continue;
+        }
+        if (!watch(*connection, EPOLLIN, true)) {
+            continue; // the connection closes its socket
+        }
+
+        connections.emplace(id, std::move(connection));
+        connectionCount = connections.size();
+        Logger::info("Client connected (connection " + std::to_string(id) + ")");
+
+        // Further clients wait in the listen backlog until one leaves
+        if (connections.size() >= connectionLimit) {
+            Logger::warning("Connection limit of " + std::to_string(connectionLimit) +
+                            " reached, pausing accept");
+            setAccepting(false);
+            return;
+        }
+    }
+}
+
+void EventLoop::setAccepting(bool enabled) {
+    epoll_event event{};
+    event.events = enabled ? static_cast<uint32_t>(EPOLLIN) : 0u;
+    event.data.u64 = LISTEN_ID;
+    if (epoll_ctl(epollFd, EPOLL_CTL_MOD, listenSocket, &event) < 0) {
+        Logger::error("Failed to update listening socket: " + std::to_string(errno));
+        return;
+    }
+    accepting = enabled;
+}
+
+void EventLoop::handleEvent(uint64_t id, uint32_t events) {
+    auto it = connections.find(id);
+    if (it == connections.end()) return;
+    Connection& connection = *it->second;
+
+    if (events & EPOLLERR) {
+        Logger::warning("Connection " + std::to_string(id) + " reset by peer");
+        closeConnection(id);
+        return;
+    }
+
+    // A hangup while we are not reading means responses can no longer be
+    // delivered either
+    if ((events & EPOLLHUP) && !(connection.getInterest() & EPOLLIN)) {
+        Logger::warning("Connection " + std::to_string(id) + " closed by peer mid-request");
+        closeConnection(id);
+        return;
+    }
+
+    const bool readingPaused = !(connection.getInterest() & EPOLLIN);
+    if ((events & (EPOLLIN | EPOLLHUP)) && !readRequests(connection)) return;
+    if (events & EPOLLOUT) {
+        if (!flushResponses(connection)) return;
+        // A stream paused on unsent chunks may have its next block buffered
+        if (readingPaused && !readRequests(connection)) return;
+    }
+    updateConnection(connection);
+}
+
+bool EventLoop::readRequests(Connection& connection) {
+    // The parser and the dispatchers may throw (std::bad_alloc, say); that
+    // costs this connection, not the loop and every other connection on it
+    const uint64_t id = connection.getId();
+    try {
+        return drainRequests(connection);
+    } catch (const std::exception& e) {
+        Logger::error("Connection " + std::to_string(id) + ": " + e.what() + ", closing");
+        closeConnection(id);
+        return false;
+    }
+}
+
+bool EventLoop::drainRequests(Connection& connection) {
+    while (!connection.isPeerClosed() && !connection.isPipelineFull()) {
+        Connection::Status status = connection.readAvailable();
+
+        if (status == Connection::Status::FAILED) {
+            closeConnection(connection.getId());
+            return false;
+        }
+        if (status == Connection::Status::CLOSED) {
+            // Half-close: answer what was already sent, then close
+            connection.setPeerClosed();
+            break;
+        }
+        if (status == Connection::Status::PENDING) {
+            break;
+        }
+        if (status == Connection::Status::OVER_BUDGET) {
+            if (std::find(waitingForBudget.begin(), waitingForBudget.end(),
+                          connection.getId()) == waitingForBudget.end()) {
+                waitingForBudget.push_back(connection.getId());
+            }
+            break;
+        }
+
+        RequestTag tag{connection.getId(), 0};
+        if (status == Connection::Status::BLOCK_READY) {
+            Connection::StreamBlock block = connection.takeBlock(tag.sequence);
+            dispatchBlock(tag, std::move(block));
+            continue;
+        }
+
+        Request request = connection.takeRequest(tag.sequence);
+        dispatch(tag, std::move(request));
+    }
+    return true;
+}
+
+bool EventLoop::flushResponses(Connection& connection) {
+    if (connection.writePending() == Connection::Status::FAILED) {
+        closeConnection(connection.getId());
+        return false;
+    }
+    return true;
+}
+
+void EventLoop::updateConnection(Connection& connection) {
+    // Keep-alive ends when the client has stopped sending and every
+    // response it is owed has been written
+    if (connection.isPeerClosed() && connection.getInFlight() == 0 &&
+        !connection.hasPendingWrite()) {
+        closeConnection(connection.getId());
+        return;
+    }
+
+    uint32_t events = 0;
+    if (!connection.isPeerClosed() && !connection.isWaitingForBudget() &&
+        !connection.isPipelineFull()) {
+        events |= EPOLLIN;
+    }
+    if (connection.hasPendingWrite()) {
+        events |= EPOLLOUT;
+    }
+    if (events != connection.getInterest()) {
+        watch(connection, events);
+    }
+}
+
+void EventLoop::processCompletions() {
+    std::vector<std::pair<RequestTag, Response>> ready;
+    {
+        std::lock_guard<std::mutex> lock(completionMutex);
+        ready.swap(completions);
+    }
+
+    for (auto& completion : ready) {
+        auto it = connections.find(completion.first.connectionId);
+        if (it == connections.end()) {
+            // Client went away while the request was being processed
+            BufferPool::instance().release(completion.second.takeData());
+            continue;
+        }
+
+        Connection& connection = *it->second;
+        const bool readingPaused = !(connection.getInterest() & EPOLLIN);
+        connection.completeRequest(completion.first.sequence, std::move(completion.second));
+
+        // Most responses fit the socket buffer and go out right here
+        if (!flushResponses(connection)) continue;
+
+        // Requests already buffered while the pipeline was full get no new
+        // epoll event, so parse them now
+        if (readingPaused && !readRequests(connection)) continue;
+        updateConnection(connection);
+    }
+}
+
+void EventLoop::admitWaiting() {
+    const auto deadline = std::chrono::steady_clock::now() -
+                          std::chrono::milliseconds(ADMISSION_WAIT_MS);
+
+    // Oldest first; anything still over budget is put back by readRequests
+    std::vector<uint64_t> waiting;
+    waiting.swap(waitingForBudget);
+    for (uint64_t id : waiting) {
+        auto it = connections.find(id);
+        if (it == connections.end() || !it->second->isWaitingForBudget()) continue;
+        Connection& connection = *it->second;
+
+        if (connection.getWaitingSince() < deadline) {
+            Logger::warning("Connection " + std::to_string(id) +
+                            ": no memory budget for request, answering BUSY");
+            connection.reject(OperationStatus::BUSY,
+                              "Server busy: over its memory budget, retry later");
+        }
+
+        if (!readRequests(connection)) continue;
+        if (!flushResponses(connection)) continue;
+        updateConnection(connection);
+    }
+}
+
+void EventLoop::closeIdleConnections() {
+    const auto deadline = std::chrono::steady_clock::now() -
+                          std::chrono::seconds(CONNECTION_IDLE_TIMEOUT_SECONDS);
+
+    std::vector<uint64_t> idle;
+    for (const auto& entry : connections) {
+        const Connection& connection = *entry.second;
+        if (connection.getInFlight() == 0 && connection.getLastActivity() < deadline) {
+            idle.push_back(entry.first);
+        }
+    }
+
+    for (uint64_t id : idle) {
+        Logger::warning("Closing idle connection " + std::to_string(id));
+        closeConnection(id);
+    }
+}
+
+void EventLoop::closeConnection(uint64_t id) {
+    auto it = connections.find(id);
+    if (it == connections.end()) return;
+
+    // Closing the socket also drops it from the epoll set
+    connections.erase(it);
+    connectionCount = connections.size();
+
+    if (!accepting && connections.size() < connectionLimit) {
+        setAccepting(true);
+    }
+}
+
+bool EventLoop::watch(Connection& connection, uint32_t events, bool add) {
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = connection.getId();
+    if (epoll_ctl(epollFd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD,
+                  connection.getSocket(), &event) < 0) {
+        Logger::error("Failed to update epoll interest: " + std::to_string(errno));
+        return false;
+    }
+    connection.setInterest(events);
+    return true;
+}
+
+#endif // __linux__
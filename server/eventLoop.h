@@ -0,0 +1,116 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#ifdef __linux__
+
+#include "connection.h"
+#include "request.h"
+#include "response.h"
+#include "socketCompat.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+// Identifies a dispatched request so its response finds the right
+// connection and slot in that connection's pipeline
+struct RequestTag {
+    uint64_t connectionId;
+    uint64_t sequence;
+};
+
+// epoll reactor for the server's listening socket. One thread runs the loop:
+// it accepts connections, reads requests without blocking and writes
+// responses as sockets become writable. Only complete requests leave the
+// loop, through dispatch; workers hand results back with complete().
+//
+// Connections stay open for as many requests as the client sends. Up to
+// MAX_PIPELINED_REQUESTS per connection are processed at once; past that
+// the loop stops reading the socket until responses drain.
+//
+// Backpressure: at its connection limit (descriptorConnectionLimit() unless
+// set) the loop stops accepting, leaving new clients in the listen backlog. A
+// connection whose next payload does not fit the MemoryBudget stops being
+// read; if no room opens up within ADMISSION_WAIT_MS the request is
+// answered BUSY and its payload skipped.
+//
+// With a block dispatcher, streamed compress requests leave the loop a frame
+// block at a time through dispatchBlock as the upload arrives; each block's
+// chunk and the stream's final response come back through complete().
+class EventLoop {
+public:
+    using Dispatch = std::function<void(RequestTag tag, Request&& request)>;
+    using DispatchBlock = std::function<void(RequestTag tag, Connection::StreamBlock&& block)>;
+
+    EventLoop(SOCKET listenSocket, Dispatch dispatch, DispatchBlock dispatchBlock = nullptr);
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // Create the epoll set and wake-up eventfd
+    bool initialize();
+
+    // Run until stop() is called
+    void run();
+
+    // Both may be called from any thread
+    void stop();
+    void complete(RequestTag tag, Response&& response);
+
+    // Call before run(); a sharded server splits descriptorConnectionLimit() between loops
+    void setConnectionLimit(size_t limit) { connectionLimit = limit > 0 ? limit : 1; }
+
+    size_t getConnectionCount() const { return connectionCount.load(std::memory_order_relaxed); }
+
+    // Connections the process can hold open: RLIMIT_NOFILE, with the soft limit
+    // raised to the hard one, less EVENT_LOOP_RESERVED_DESCRIPTORS
+    static size_t descriptorConnectionLimit();
+
+private:
+    // epoll user data: these two ids are reserved, connections start above
+    static constexpr uint64_t LISTEN_ID = 0;
+    static constexpr uint64_t WAKE_ID = 1;
+    static constexpr int MAX_EVENTS = 256;
+
+    void acceptConnections();
+    void handleEvent(uint64_t id, uint32_t events);
+    bool readRequests(Connection& connection);
+    bool drainRequests(Connection& connection);
+    bool flushResponses(Connection& connection);
+    void updateConnection(Connection& connection);
+    void processCompletions();
+    void closeIdleConnections();
+    void closeConnection(uint64_t id);
+    void admitWaiting();
+    void setAccepting(bool enabled);
+    bool watch(Connection& connection, uint32_t events, bool add = false);
+    void wake();
+
+    SOCKET listenSocket;
+    Dispatch dispatch;
+    DispatchBlock dispatchBlock;
+    int epollFd;
+    int wakeFd;
+    std::atomic<bool> running;
+
+    // Owned by the loop thread
+    std::unordered_map<uint64_t, std::unique_ptr<Connection>> connections;
+    uint64_t nextConnectionId;
+    std::atomic<size_t> connectionCount;
+    size_t connectionLimit;
+    bool accepting;
+    std::vector<uint64_t> waitingForBudget;   // connections parked on admission, oldest first
+
+    // Results posted by workers, drained by the loop thread
+    std::mutex completionMutex;
+    std::vector<std::pair<RequestTag, Response>> completions;
+};
+
+#endif // __linux__
+
+#endif // EVENT_LOOP_H
@@ -0,0 +1,372 @@
+#include "jobManager.h"
+#include "workerthread.h"
+#include "jobFormat.h"
+#include "threadPool.h"
+#include "bufferPool.h"
+#include "memoryBudget.h"
+#include "logger.h"
+#include "config.h"
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+JobManager& JobManager::instance() {
+    static JobManager manager;
+    return manager;
+}
+
+JobManager::JobManager()
+    : idRandom(std::random_device{}()),
+      waitTimeout(JOB_WAIT_MS),
+      resultTtl(std::chrono::seconds(JOB_RESULT_TTL_SECONDS)),
+      stopping(false),
+      submitted(0),
+      completed(0),
+      cancelled(0),
+      expired(0) {
+    thread = std::thread(&JobManager::housekeep, this);
+}
+
+JobManager::~JobManager() {
+    shutdown();
+}
+
+bool JobManager::isJobMessage(const Request& request) {
+    switch (request.getMessageType()) {
+        case MessageType::POLL_REQUEST:
+        case MessageType::WAIT_REQUEST:
+        case MessageType::CANCEL_REQUEST:
+            return true;
+        case MessageType::COMPRESS_REQUEST:
+        case MessageType::DECOMPRESS_REQUEST:
+        case MessageType::BATCH_REQUEST:
+            return request.isSubmitted();
+        default:
+            return false;
+    }
+}
+
+Response JobManager::statusOf(const Job& job, bool checksum) {
+    JobFormat::Status status;
+    status.id = job.id;
+    status.done = job.progress.load(std::memory_order_relaxed);
+    status.total = job.total;
+    Response response(OperationStatus::IN_PROGRESS, job.request.getFilename(),
+                      "Job " + std::to_string(job.id) +
+                      (job.state == State::QUEUED ? " queued: " : " running: ") +
+                      std::to_string(status.done) + " of " + std::to_string(status.total) +
+                      " bytes", JobFormat::encodeStatus(status));
+    response.setChecksumEnabled(checksum);
+    return response;
+}
+
+Response JobManager::refusal(const std::string& message, bool checksum) {
+    Response response(OperationStatus::FAILURE, "", message, {});
+    response.setChecksumEnabled(checksum);
+    return response;
+}
+
+void JobManager::handle(Request&& request, ThreadPool* pool, uint64_t owner, Reply reply) {
+    const MessageType type = request.getMessageType();
+    const bool checksum = request.isChecksumEnabled();
+    if (type != MessageType::POLL_REQUEST && type != MessageType::WAIT_REQUEST &&
+        type != MessageType::CANCEL_REQUEST) {
+        reply(submit(std::move(request), pool, owner));
+        return;
+    }
+
+    uint64_t id = 0;
+    const bool valid = JobFormat::decodeId(request.getData(), id);
+    BufferPool::instance().release(request.takeData());
+    if (!valid) {
+        reply(refusal("A job message carries an 8-byte job ID", checksum));
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    auto found = jobs.find(id);
+    if (stopping || found == jobs.end()) {
+        lock.unlock();
+        // Collected, cancelled and expired jobs are forgotten too
+        reply(refusal(stopping ? "Server is shutting down" : "No job " + std::to_string(id),
+                      checksum));
+        return;
+    }
+    std::shared_ptr<Job> job = found->second;
+
+    if (type == MessageType::CANCEL_REQUEST) {
+        // A queued job never starts; a running one stops at its next block
+        const bool queued = job->state == State::QUEUED;
+        job->cancelFlag->store(true, std::memory_order_relaxed);
+        std::vector<Waiter> waiters = std::move(job->waiters);
+        Response dropped = std::move(job->result);
+        job->state = State::CANCELLED;
+        jobs.erase(found);
+        cancelled++;
+        lock.unlock();
+
+        if (queued) {
+            BufferPool::instance().release(job->request.takeData());
+            MemoryBudget::instance().release(job->charge);
+        }
+        BufferPool::instance().release(dropped.takeData());
+        for (Waiter& waiter : waiters) {
+            waiter.reply(refusal("Job " + std::to_string(id) + " was cancelled", waiter.checksum));
+        }
+        Response response(OperationStatus::SUCCESS, "", "Job " + std::to_string(id) + " cancelled",
+                          {});
+        response.setChecksumEnabled(checksum);
+        reply(std::move(response));
+        return;
+    }
+
+    if (job->state == State::DONE) {
+        Response result = std::move(job->result);
+        jobs.erase(found);
+        lock.unlock();
+        result.setChecksumEnabled(checksum);
+        reply(std::move(result));
+        return;
+    }
+
+    if (type == MessageType::POLL_REQUEST) {
+        Response status = statusOf(*job, checksum);
+        lock.unlock();
+        reply(std::move(status));
+        return;
+    }
+
+    // Answered by run() when the job finishes, or by housekeep() at the deadline
+    job->waiters.push_back({std::chrono::steady_clock::now() + waitTimeout, checksum,
+                            std::move(reply)});
+    lock.unlock();
+    wake.notify_one();
+}
+
+Response JobManager::submit(Request&& request, ThreadPool* pool, uint64_t owner) {
+    const bool checksum = request.isChecksumEnabled();
+    const uint64_t size = request.getData().size();
+    const size_t charge = MemoryBudget::chargeFor(size);
+
+    // What admitting the upload already reserved carries over to the job;
+    // only a shortfall is reserved here, and a refusal gives it all back
+    MemoryBudget::Hold paid = request.takeAdmission();
+    const size_t topUp = charge - std::min(charge, paid.getBytes());
+
+    auto job = std::make_shared<Job>();
+    Response ack;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::string refused;
+        OperationStatus status = OperationStatus::BUSY;
+        if (stopping) {
+            refused = "Server is shutting down";
+            status = OperationStatus::FAILURE;
+        } else if (jobs.size() >= MAX_JOBS) {
+            refused = "Server busy: " + std::to_string(MAX_JOBS) + " jobs pending, retry later";
+        } else if (topUp > 0 && !MemoryBudget::instance().tryReserve(topUp)) {
+            refused = "Server busy: over its memory budget, retry later";
+        }
+        if (!refused.empty()) {
+            BufferPool::instance().release(request.takeData());
+            ack = Response(status, request.getFilename(), refused, {});
+            ack.setChecksumEnabled(checksum);
+            return ack;
+        }
+
+        do {
+            job->id = idRandom();
+        } while (job->id == 0 || jobs.count(job->id) != 0);
+        job->total = size;
+        job->charge = paid.detach() + topUp;
+        job->request = std::move(request);
+        job->request.setSubmitted(false);
+        job->request.setCancelFlag(job->cancelFlag);
+        jobs.emplace(job->id, job);
+        submitted++;
+        ack = statusOf(*job, checksum);
+    }
+    ack.setMessage("Job " + std::to_string(job->id) + " accepted");
+    Logger::info("Job " + std::to_string(job->id) + " submitted (" + std::to_string(size) +
+                 " bytes)");
+
+    if (!pool) {
+        run(job, nullptr);
+    } else if (size > SMALL_REQUEST_MAX_SIZE) {
+        pool->submitLarge(owner, [this, job, pool] { run(job, pool); });
+    } else {
+        pool->submit([this, job, pool] { run(job, pool); });
+    }
+    return ack;
+}
+
+void JobManager::run(const std::shared_ptr<Job>& job, ThreadPool* pool) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (job->state != State::QUEUED) return;   // cancelled; nothing left to release
+        job->state = State::RUNNING;
+    }
+
+    // From here on only this task touches the request and the charge. A job
+    // identical to one in flight gives its worker back and completes later.
+    WorkerThread worker(INVALID_SOCKET, pool);
+    worker.setProgress(&job->progress);
+    worker.handleRequest(std::shared_ptr<Request>(job, &job->request),
+                         [this, job](Response&& result) { complete(job, std::move(result)); });
+}
+
+void JobManager::complete(const std::shared_ptr<Job>& job, Response&& result) {
+    job->progress = job->total;
+    
+    // The payload is gone; as much of its charge as the result needs stays
+    // with the result until it is collected, cancelled or expires
+    const size_t resultCharge = std::min(job->charge, result.getData().size());
+    result.addHold(MemoryBudget::Hold(resultCharge));
+    MemoryBudget::instance().release(job->charge - resultCharge);
+
+    std::vector<Waiter> waiters;
+    bool kept = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        completed++;
+        if (job->state == State::RUNNING) {
+            job->state = State::DONE;
+            job->finishedAt = std::chrono::steady_clock::now();
+            waiters = std::move(job->waiters);
+            if (waiters.empty()) {
+                job->result = std::move(result);
+                kept = true;
+            } else {
+                jobs.erase(job->id);
+            }
+        }
+    }
+
+    // The first WAIT collects the result; it is only handed out once
+    if (!waiters.empty()) {
+        result.setChecksumEnabled(waiters.front().checksum);
+        waiters.front().reply(std::move(result));
+        for (size_t i = 1; i < waiters.size(); i++) {
+            waiters[i].reply(refusal("Job " + std::to_string(job->id) +
+                                     " was collected by another request", waiters[i].checksum));
+        }
+    } else if (!kept) {
+        BufferPool::instance().release(result.takeData());
+    }
+}
+
+void JobManager::housekeep() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        const auto now = std::chrono::steady_clock::now();
+        auto next = now + std::chrono::seconds(1);
+        std::vector<std::pair<Reply, Response>> due;
+
+        for (auto entry = jobs.begin(); entry != jobs.end();) {
+            Job& job = *entry->second;
+            if (job.state == State::DONE) {
+                if (now - job.finishedAt >= resultTtl) {
+                    Logger::warning("Job " + std::to_string(job.id) + " expired uncollected");
+                    BufferPool::instance().release(job.result.takeData());
+                    job.result.takeHold().reset();
+                    expired++;
+                    entry = jobs.erase(entry);
+                    continue;
+                }
+                next = std::min(next, job.finishedAt + resultTtl);
+            }
+            for (auto waiter = job.waiters.begin(); waiter != job.waiters.end();) {
+                if (waiter->deadline <= now) {
+                    due.emplace_back(std::move(waiter->reply), statusOf(job, waiter->checksum));
+                    waiter = job.waiters.erase(waiter);
+                } else {
+                    next = std::min(next, waiter->deadline);
+                    ++waiter;
+                }
+            }
+            ++entry;
+        }
+
+        if (!due.empty()) {
+            lock.unlock();
+            for (auto& [reply, response] : due) reply(std::move(response));
+            lock.lock();
+            continue;
+        }
+        wake.wait_until(lock, next);
+    }
+}
+
+void JobManager::shutdown() {
+    std::vector<Waiter> waiters;
+    std::vector<std::shared_ptr<Job>> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        for (auto& entry : jobs) {
+            Job& job = *entry.second;
+            for (Waiter& waiter : job.waiters) waiters.push_back(std::move(waiter));
+            job.waiters.clear();
+            job.cancelFlag->store(true, std::memory_order_relaxed);
+            if (job.state == State::QUEUED) {
+                job.state = State::CANCELLED;
+                cancelled++;
+                dropped.push_back(entry.second);
+            }
+        }
+    }
+    wake.notify_all();
+    if (thread.joinable()) thread.join();
+
+    for (auto& job : dropped) {
+        BufferPool::instance().release(job->request.takeData());
+        MemoryBudget::instance().release(job->charge);
+    }
+    for (Waiter& waiter : waiters) {
+        waiter.reply(refusal("Server is shutting down", waiter.checksum));
+    }
+}
+
+void JobManager::setWaitTimeout(std::chrono::milliseconds timeout) {
+    std::lock_guard<std::mutex> lock(mutex);
+    waitTimeout = timeout;
+}
+
+void JobManager::setResultTtl(std::chrono::milliseconds ttl) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        resultTtl = ttl;
+    }
+    wake.notify_one();
+}
+
+JobManager::Stats JobManager::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats{};
+    stats.submitted = submitted;
+    stats.completed = completed;
+    stats.cancelled = cancelled;
+    stats.expired = expired;
+    for (const auto& entry : jobs) {
+        switch (entry.second->state) {
+            case State::QUEUED: stats.queued++; break;
+            case State::RUNNING: stats.running++; break;
+            case State::DONE: stats.finished++; break;
+            case State::CANCELLED: break;
+        }
+    }
+    return stats;
+}
+
+std::string JobManager::report() const {
+    const Stats stats = getStats();
+    std::ostringstream out;
+    out << "jobs_submitted_total " << stats.submitted << "\n";
+    out << "jobs_completed_total " << stats.completed << "\n";
+    out << "jobs_cancelled_total " << stats.cancelled << "\n";
+    out << "jobs_expired_total " << stats.expired << "\n";
+    out << "jobs_queued " << stats.queued << "\n";
+    out << "jobs_running " << stats.running << "\n";
+    out << "jobs_finished " << stats.finished << "\n";
+    return out.str();
+}
@@ -0,0 +1,128 @@
+#ifndef JOB_MANAGER_H
+#define JOB_MANAGER_H
+
+#include "request.h"
+#include "response.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class ThreadPool;
+
+// Background jobs, so a client can hand over long compressions without
+// keeping a connection open for each (wire format in src/jobFormat.h).
+//
+// A submitted request is acknowledged straight away and queued on a pool
+// lane by size, like any other request. The MemoryBudget charge its upload
+// was admitted with (Request::takeAdmission) carries over to the job, so
+// the payload is charged once, until it has run. The result waits here until a POLL or
+// WAIT collects it, from any connection, or JOB_RESULT_TTL_SECONDS pass.
+// Job IDs are random, so one client cannot guess another's. A job does not
+// belong to the connection that submitted it, so it runs on after that
+// connection closes; CANCEL stops it at its next block boundary.
+//
+// WAIT does not hold a worker: its reply is kept with the job and sent when
+// the job finishes. A housekeeping thread answers waits that reach
+// JOB_WAIT_MS with the job's progress and drops expired results.
+class JobManager {
+public:
+    // Called once with the answer, maybe later and from another thread
+    using Reply = std::function<void(Response&&)>;
+
+    struct Stats {
+        uint64_t submitted;
+        uint64_t completed;     // ran to the end, whether or not it succeeded
+        uint64_t cancelled;
+        uint64_t expired;       // results nobody collected in time
+        size_t queued;
+        size_t running;
+        size_t finished;        // waiting to be collected
+    };
+
+    static JobManager& instance();
+
+    // A submit (compress, decompress or batch with PAYLOAD_FLAG_SUBMIT),
+    // POLL, WAIT or CANCEL
+    static bool isJobMessage(const Request& request);
+
+    // Answer a job message through reply. Submitted jobs run on pool, in
+    // owner's turn of the large lane when they are large; without a pool
+    // they run here before the acknowledgement goes out.
+    void handle(Request&& request, ThreadPool* pool, uint64_t owner, Reply reply);
+
+    // Cancel every job and answer every WAIT; later job messages are
+    // refused. Jobs already running stop at their next block boundary.
+    void shutdown();
+
+    // For tests; JOB_WAIT_MS and JOB_RESULT_TTL_SECONDS otherwise
+    void setWaitTimeout(std::chrono::milliseconds timeout);
+    void setResultTtl(std::chrono::milliseconds ttl);
+
+    Stats getStats() const;
+
+    // "name value" lines for the STATS report
+    std::string report() const;
+
+    ~JobManager();
+
+private:
+    enum class State { QUEUED, RUNNING, DONE, CANCELLED };
+
+    struct Waiter {
+        std::chrono::steady_clock::time_point deadline;
+        bool checksum;          // the WAIT's own checksum flag, for its answer
+        Reply reply;
+    };
+
+    struct Job {
+        uint64_t id = 0;
+        State state = State::QUEUED;
+        uint64_t total = 0;
+        size_t charge = 0;
+        std::atomic<uint64_t> progress{0};
+        std::shared_ptr<std::atomic<bool>> cancelFlag =
+            std::make_shared<std::atomic<bool>>(false);
+        Request request;
+        Response result;
+        std::chrono::steady_clock::time_point finishedAt;
+        std::vector<Waiter> waiters;
+    };
+
+    JobManager();
+    JobManager(const JobManager&) = delete;
+    JobManager& operator=(const JobManager&) = delete;
+
+    Response submit(Request&& request, ThreadPool* pool, uint64_t owner);
+    void run(const std::shared_ptr<Job>& job, ThreadPool* pool);
+    void complete(const std::shared_ptr<Job>& job, Response&& result); // the rest of run()
+    void housekeep();
+
+    // IN_PROGRESS with the job's Status
+    static Response statusOf(const Job& job, bool checksum);
+    static Response refusal(const std::string& message, bool checksum);
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::unordered_map<uint64_t, std::shared_ptr<Job>> jobs;
+    std::mt19937_64 idRandom;
+    std::chrono::milliseconds waitTimeout;
+    std::chrono::milliseconds resultTtl;
+    bool stopping;
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t cancelled;
+    uint64_t expired;
+    std::thread thread;
+};
+
+#endif // JOB_MANAGER_H
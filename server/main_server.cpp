@@ -1,9 +1,12 @@
 #include "server.h"
 #include "logger.h"
 #include "config.h"
+#include "cpuTopology.h"
 #include <iostream>
 #include <csignal>
 #include <atomic>
+#include <string>
+#include <vector>
 
 std::atomic<bool> shutdownRequested(false);
 Server* globalServer = nullptr;
@@ -27,11 +30,36 @@ int main(int argc, char* argv[]) {
     std::cout << "========================================" << std::endl;
     std::cout << std::endl;
     
-    // Parse command line arguments
+    // Parse command line arguments: [port] [--shards N] [--cpus LIST]
     int port = DEFAULT_PORT;
-    if (argc > 1) {
+    size_t shards = DEFAULT_SERVER_SHARDS;
+    std::vector<size_t> cpus;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--cpus" && i + 1 < argc) {
+            const std::string list = argv[++i];
+            if (!CpuTopology::parseCpuList(list, cpus)) {
+                std::cerr << "Invalid CPU list '" << list << "' (e.g. 0-3,8). Using every CPU."
+                          << std::endl;
+                cpus.clear();
+            }
+            continue;
+        }
+        if (arg == "--shards" && i + 1 < argc) {
+            int value = 0;
+            try {
+                value = std::stoi(argv[++i]);
+            } catch (...) {}
+            if (value >= 1 && static_cast<size_t>(value) <= MAX_SERVER_SHARDS) {
+                shards = static_cast<size_t>(value);
+            } else {
+                std::cerr << "Shards must be 1-" << MAX_SERVER_SHARDS << ". Using default: "
+                          << DEFAULT_SERVER_SHARDS << std::endl;
+            }
+            continue;
+        }
         try {
-            port = std::stoi(argv[1]);
+            port = std::stoi(arg);
             if (port < 1024 || port > 65535) {
                 std::cerr << "Invalid port number. Using default: " << DEFAULT_PORT << std::endl;
                 port = DEFAULT_PORT;
@@ -47,10 +75,13 @@ int main(int argc, char* argv[]) {
     signal(SIGTERM, signalHandler);
     
     // Create and start server
-    Server server(port);
+    Server server(port, shards, cpus);
     globalServer = &server;
     
-    std::cout << "Starting server on port " << port << "..." << std::endl;
+    std::cout << "Starting server on port " << port;
+    if (shards > 1) std::cout << " with " << shards << " shards";
+    if (!cpus.empty()) std::cout << " on " << cpus.size() << " configured CPUs";
+    std::cout << "..." << std::endl;
     std::cout << "Press Ctrl+C to stop the server." << std::endl;
     std::cout << std::endl;
     
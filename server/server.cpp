@@ -2,33 +2,66 @@
 #include "workerthread.h"
 #include "networkUtils.h"
 #include "logger.h"
+#include "bufferPool.h"
+#include "memoryBudget.h"
+#include "resultCache.h"
+#include "objectStore.h"
+#include "singleFlight.h"
+#include "writeBehind.h"
+#include "jobManager.h"
+#include "metrics.h"
+#include "cpuTopology.h"
+#include "config.h"
 
-#include <winsock2.h>
-#include <ws2tcpip.h>
 #include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
 #include <cstring>
+#include <thread>
+#include <chrono>
 
-#pragma comment(lib, "ws2_32.lib")
+namespace {
 
-Server::Server(int portNum)
-    : port(portNum), serverSocket(INVALID_SOCKET), running(false)
+// One worker per CPU of cpuShare, growing to POOL_THREADS_PER_CPU times
+// that while workers block; budget is the whole process's
+std::unique_ptr<ThreadPool> makePool(double cpuShare, double budget) {
+    const size_t minThreads = std::clamp<size_t>(static_cast<size_t>(std::ceil(cpuShare)), 1,
+                                                 MAX_WORKER_THREADS);
+    const size_t maxThreads = std::min(minThreads * POOL_THREADS_PER_CPU, MAX_WORKER_THREADS);
+    auto pool = std::make_unique<ThreadPool>(maxThreads, minThreads / SMALL_LANE_WORKER_SHARE);
+    pool->startAutoSizing({minThreads, budget, std::chrono::microseconds(POOL_GROW_WAIT_US),
+                           std::chrono::milliseconds(POOL_RESIZE_INTERVAL_MS)});
+    return pool;
+}
+
+} // namespace
+
+Server::Server(int portNum, size_t shards, std::vector<size_t> cpus)
+    : serverSocket(INVALID_SOCKET), port(portNum),
+      shardCount(std::min(std::max<size_t>(shards, 1), MAX_SERVER_SHARDS)),
+      configuredCpus(std::move(cpus)),
+      running(false), activeConnections(0), clientsWaiting(false)
 {
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-        Logger::error("WSAStartup failed");
-    }
+    NetworkUtils::initialize();
 }
 
 Server::~Server() {
     stop();
-    WSACleanup();
+    if (pool) Metrics::instance().removeThreadPool(pool.get());
+#ifdef __linux__
+    for (auto& shard : shards) {
+        if (shard->pool) Metrics::instance().removeThreadPool(shard->pool.get());
+    }
+#endif
+    NetworkUtils::cleanup();
 }
 
-bool Server::initializeSocket() {
-    serverSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (serverSocket == INVALID_SOCKET) {
-        Logger::error("Failed to create server socket: " + std::to_string(WSAGetLastError()));
-        return false;
+SOCKET Server::openListenSocket(bool reusePort) {
+    SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenSocket == INVALID_SOCKET) {
+        Logger::error("Failed to create server socket: " + std::to_string(socketLastError()));
+        return INVALID_SOCKET;
     }
 
     sockaddr_in serverAddr;
@@ -37,94 +70,308 @@ bool Server::initializeSocket() {
     serverAddr.sin_addr.s_addr = INADDR_ANY;
     serverAddr.sin_port = htons(port);
 
-    if (bind(serverSocket, reinterpret_cast<SOCKADDR*>(&serverAddr), sizeof(serverAddr)) == SOCKET_ERROR) {
-        Logger::error("Failed to bind socket: " + std::to_string(WSAGetLastError()));
-        closesocket(serverSocket);
-        serverSocket = INVALID_SOCKET;
-        return false;
+#ifndef _WIN32
+    // Let a restarted server rebind while old connections sit in TIME_WAIT
+    int reuse = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+#ifdef SO_REUSEPORT
+    if (reusePort &&
+        setsockopt(listenSocket, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0) {
+        Logger::error("Failed to set SO_REUSEPORT: " + std::to_string(socketLastError()));
+        closesocket(listenSocket);
+        return INVALID_SOCKET;
     }
+#else
+    (void)reusePort;
+#endif
 
-    if (listen(serverSocket, SOMAXCONN) == SOCKET_ERROR) {
-        Logger::error("Failed to listen on socket: " + std::to_string(WSAGetLastError()));
-        closesocket(serverSocket);
-        serverSocket = INVALID_SOCKET;
-        return false;
+    if (bind(listenSocket, reinterpret_cast<SOCKADDR*>(&serverAddr), sizeof(serverAddr)) == SOCKET_ERROR) {
+        Logger::error("Failed to bind socket: " + std::to_string(socketLastError()));
+        closesocket(listenSocket);
+        return INVALID_SOCKET;
     }
 
-    Logger::info("Server listening on port " + std::to_string(port));
-    return true;
+    if (listen(listenSocket, SOMAXCONN) == SOCKET_ERROR) {
+        Logger::error("Failed to listen on socket: " + std::to_string(socketLastError()));
+        closesocket(listenSocket);
+        return INVALID_SOCKET;
+    }
+
+    return listenSocket;
 }
 
 bool Server::start() {
-    if (!initializeSocket()) return false;
-
     running = true;
 
-    // Start worker threads
-    const size_t threadCount = std::thread::hardware_concurrency();
-    for (size_t i = 0; i < threadCount; ++i) {
-        workerThreads.emplace_back(&Server::workerThreadFunction, this);
+    // Results stored by an earlier run are served again straight away
+    if (!ObjectStore::instance().open(STORE_DIR)) {
+        Logger::warning("Running without the object store");
     }
 
+    // The configured cores we may actually run on, or all of those
+    std::vector<size_t> cpus = ThreadPool::availableCpus();
+    if (!configuredCpus.empty()) {
+        std::vector<size_t> usable;
+        std::set_intersection(configuredCpus.begin(), configuredCpus.end(),
+                              cpus.begin(), cpus.end(), std::back_inserter(usable));
+        if (usable.empty()) {
+            Logger::warning("None of the configured CPUs is available; using all of them");
+        } else {
+            cpus = std::move(usable);
+        }
+    }
+    const bool pinned = cpus.size() < ThreadPool::availableCpus().size() || shardCount > 1;
+    const double budget = CpuTopology::cpuBudget(cpus);
+    Logger::info("CPU budget " + std::to_string(budget) + " on " + std::to_string(cpus.size()) +
+                 " CPUs over " + std::to_string(CpuTopology::nodeCount()) + " NUMA node(s)");
+
+#ifdef __linux__
+    // Shards split the CPUs, grouped by node so that a shard's workers and
+    // the buffers they recycle stay on one node where the counts allow; more
+    // shards than CPUs share them. A single shard is only pinned to
+    // configured cores.
+    cpus = CpuTopology::groupByNode(std::move(cpus));
+    for (size_t i = 0; i < shardCount; i++) {
+        shards.push_back(std::make_unique<Shard>());
+        Shard& shard = *shards.back();
+        const size_t first = i * cpus.size() / shardCount;
+        const size_t last = std::max((i + 1) * cpus.size() / shardCount, first + 1);
+        if (pinned) shard.cpus.assign(cpus.begin() + first, cpus.begin() + last);
+        shard.cpuShare = budget * static_cast<double>(last - first) /
+                         static_cast<double>(cpus.size());
+        if (!startShard(shard, budget)) {
+            stop();
+            return false;
+        }
+    }
+    Logger::info("Server listening on port " + std::to_string(port) + " with " +
+                 std::to_string(shardCount) + (shardCount == 1 ? " event loop" : " event loops"));
+
+    for (size_t i = 1; i < shards.size(); i++) {
+        Shard* shard = shards[i].get();
+        shard->thread = std::thread([shard] {
+            ThreadPool::pinCurrentThread(shard->cpus);
+            shard->eventLoop->run();
+        });
+    }
+
+    // The calling thread becomes shard 0's reactor
+    if (!shards[0]->cpus.empty()) ThreadPool::pinCurrentThread(shards[0]->cpus);
+    shards[0]->eventLoop->run();
+#else
+    if (shardCount > 1) Logger::warning("Shards need epoll; running a single acceptor");
+    serverSocket = openListenSocket(false);
+    if (serverSocket == INVALID_SOCKET) return false;
+    Logger::info("Server listening on port " + std::to_string(port));
+
+    // Connections hold their worker while they last, so waiting ones grow the pool
+    if (pinned) ThreadPool::pinCurrentThread(cpus);
+    pool = makePool(budget, budget);
+    if (pinned && !pool->pinWorkers(cpus)) {
+        Logger::warning("Could not pin workers to the configured CPUs");
+    }
+    Metrics::instance().addThreadPool(pool.get());
+
     // Accept connections in main thread
     acceptConnections();
+#endif
 
     return true;
 }
 
+#ifdef __linux__
+bool Server::startShard(Shard& shard, double budget) {
+    shard.listenSocket = openListenSocket(shardCount > 1);
+    if (shard.listenSocket == INVALID_SOCKET) return false;
+
+    shard.pool = makePool(shard.cpuShare, budget);
+    if (!shard.cpus.empty() && !shard.pool->pinWorkers(shard.cpus)) {
+        Logger::warning("Could not pin shard workers to their CPUs");
+    }
+    Metrics::instance().addThreadPool(shard.pool.get());
+
+    // Workers only see whole requests. Large payloads take turns per
+    // connection in the large lane, so small requests never queue behind them.
+    Shard* self = &shard;
+    shard.eventLoop = std::make_unique<EventLoop>(shard.listenSocket,
+        [self](RequestTag tag, Request&& request) {
+            // Job messages are answered from the loop; a submitted job
+            // queues like any other request and a WAIT answers later
+            if (JobManager::isJobMessage(request)) {
+                JobManager::instance().handle(std::move(request), self->pool.get(),
+                                              tag.connectionId,
+                    [self, tag](Response&& response) {
+                        self->eventLoop->complete(tag, std::move(response));
+                    });
+                return;
+            }
+            const bool large = request.getData().size() > SMALL_REQUEST_MAX_SIZE;
+            auto pending = std::make_shared<Request>(std::move(request));
+            auto task = [self, tag, pending] {
+                WorkerThread worker(INVALID_SOCKET, self->pool.get());
+                worker.handleRequest(pending, [self, tag](Response&& response) {
+                    self->eventLoop->complete(tag, std::move(response));
+                });
+            };
+            if (large) {
+                self->pool->submitLarge(tag.connectionId, std::move(task));
+            } else {
+                self->pool->submit(std::move(task));
+            }
+        },
+        // Streamed blocks are compressed as they arrive; whichever finishes
+        // the stream's last block also sends its closing response. A stream
+        // is a large upload, so its blocks are its time slices.
+        [self](RequestTag tag, Connection::StreamBlock&& block) {
+            auto pending = std::make_shared<Connection::StreamBlock>(std::move(block));
+            self->pool->submitLarge(tag.connectionId, [self, tag, pending] {
+                CompressionStream& stream = *pending->stream;
+                bool last = false;
+                self->eventLoop->complete(tag, stream.compressBlock(pending->index,
+                                                                    std::move(pending->data), last));
+                if (last) {
+                    self->eventLoop->complete({tag.connectionId, stream.getFinalSequence()},
+                                              stream.finish());
+                }
+            });
+        });
+    const size_t connectionLimit = EventLoop::descriptorConnectionLimit() / shardCount;
+    shard.eventLoop->setConnectionLimit(connectionLimit);
+    Logger::info("Event loop accepts up to " + std::to_string(connectionLimit) + " connections");
+    return shard.eventLoop->initialize();
+}
+#endif
+
 void Server::stop() {
     running = false;
+    bool listening = false;
 
-    queueCondition.notify_all();
+    // Queued jobs are cancelled rather than run by the pools on their way out
+    JobManager::instance().shutdown();
 
-    for (auto& t : workerThreads) {
-        if (t.joinable()) t.join();
+#ifdef __linux__
+    // The loop objects stay alive: stop() may run on a loop's own thread
+    for (auto& shard : shards) {
+        if (shard->eventLoop) shard->eventLoop->stop();
+    }
+    for (auto& shard : shards) {
+        if (shard->thread.joinable() && shard->thread.get_id() != std::this_thread::get_id()) {
+            shard->thread.join();
+        }
     }
-    workerThreads.clear();
+    for (auto& shard : shards) {
+        if (shard->pool) shard->pool->shutdown();
+        if (shard->listenSocket != INVALID_SOCKET) {
+            closesocket(shard->listenSocket);
+            shard->listenSocket = INVALID_SOCKET;
+            listening = true;
+        }
+    }
+#endif
+
+    // Pool objects outlive stop() as well; later submits run inline
+    if (pool) pool->shutdown();
+
+    // Output files still queued are written before the server exits
+    WriteBehind::instance().shutdown();
 
     if (serverSocket != INVALID_SOCKET) {
         closesocket(serverSocket);
         serverSocket = INVALID_SOCKET;
-        Logger::info("Server stopped");
+        listening = true;
     }
+    if (listening) logStats();
+}
+
+void Server::logStats() {
+    BufferPool::Stats buffers = BufferPool::instance().getStats();
+    Logger::info("Buffer pool: " + std::to_string(buffers.acquires) + " acquires, " +
+                 std::to_string(static_cast<int>(buffers.hitRate() * 100)) + "% hit rate (" +
+                 std::to_string(buffers.threadCacheHits) + " thread-local, " +
+                 std::to_string(buffers.sharedHits) + " shared), " +
+                 std::to_string(buffers.discarded) + " discarded");
+
+    MemoryBudget::Stats budget = MemoryBudget::instance().getStats();
+    Logger::info("Memory budget: peak " + std::to_string(budget.peak) + " of " +
+                 std::to_string(budget.limit) + " bytes, " +
+                 std::to_string(budget.admitted) + " admitted, " +
+                 std::to_string(budget.deferred) + " deferred, " +
+                 std::to_string(budget.refused) + " refused");
+
+    ResultCache::Stats cache = ResultCache::instance().getStats();
+    Logger::info("Result cache: " + std::to_string(cache.hits) + " hits, " +
+                 std::to_string(cache.misses) + " misses (" +
+                 std::to_string(static_cast<int>(cache.hitRate() * 100)) + "% hit rate), " +
+                 std::to_string(cache.evictions) + " evictions, " +
+                 std::to_string(cache.entries) + " entries in " +
+                 std::to_string(cache.bytes) + " bytes");
+
+    ObjectStore::Stats store = ObjectStore::instance().getStats();
+    Logger::info("Object store: " + std::to_string(store.hits) + " hits, " +
+                 std::to_string(store.misses) + " misses, " +
+                 std::to_string(store.stores) + " stored, " +
+                 std::to_string(store.evictions) + " evictions, " +
+                 std::to_string(store.objects) + " objects in " +
+                 std::to_string(store.bytes) + " bytes");
+
+    SingleFlight::Stats flights = SingleFlight::instance().getStats();
+    Logger::info("Single-flight: " + std::to_string(flights.coalesced) +
+                 " requests coalesced with identical ones in flight, " +
+                 std::to_string(flights.bytesSaved) + " payload bytes not reprocessed");
+
+    WriteBehind::Stats writes = WriteBehind::instance().getStats();
+    Logger::info("Write-behind: " + std::to_string(writes.written) + " files (" +
+                 std::to_string(writes.bytesWritten) + " bytes) written in " +
+                 std::to_string(writes.batches) + " batches, " +
+                 std::to_string(writes.failed) + " failed, " +
+                 std::to_string(writes.skipped) + " already present");
+
+    JobManager::Stats jobs = JobManager::instance().getStats();
+    Logger::info("Jobs: " + std::to_string(jobs.submitted) + " submitted, " +
+                 std::to_string(jobs.completed) + " completed, " +
+                 std::to_string(jobs.cancelled) + " cancelled, " +
+                 std::to_string(jobs.expired) + " expired, " +
+                 std::to_string(jobs.finished) + " left uncollected");
+    Logger::info("Server stopped");
 }
 
 void Server::acceptConnections() {
+    // A connection keeps its worker while it is open, so one accepted
+    // beyond the pool's workers would only wait for another to close
+    const size_t limit = std::min(MAX_CONNECTIONS, pool->getThreadCount());
+    Logger::info("Serving up to " + std::to_string(limit) + " connections at once");
+    
     while (running) {
+        // At the limit, leave further clients queued in the listen backlog
+        // and have idle connections make way for them
+        if (activeConnections.load() >= limit) {
+            clientsWaiting = NetworkUtils::waitReadable(serverSocket, 10);
+            if (clientsWaiting) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        clientsWaiting = false;
+
         SOCKET clientSocket = accept(serverSocket, nullptr, nullptr);
         if (clientSocket == INVALID_SOCKET) {
-            int err = WSAGetLastError();
+            int err = socketLastError();
             if (running) Logger::error("Failed to accept client: " + std::to_string(err));
             continue;
         }
 
         Logger::info("Client connected");
+        NetworkUtils::setNoDelay(clientSocket);
 
-        {
-            std::unique_lock<std::mutex> lock(queueMutex);
-            clientQueue.push(clientSocket);
-        }
-        queueCondition.notify_one();
+        activeConnections++;
+        Metrics::instance().connectionOpened();
+        pool->submit([this, clientSocket] {
+            {
+                WorkerThread worker(clientSocket, pool.get());
+                worker.setYieldSignal(&clientsWaiting);
+                worker.processRequest(); // Handle the client completely inside WorkerThread
+            }
+            activeConnections--;
+            Metrics::instance().connectionClosed();
+        });
     }
 }
-
-void Server::workerThreadFunction() {
-    while (running) {
-        SOCKET clientSocket = INVALID_SOCKET;
-
-        {
-            std::unique_lock<std::mutex> lock(queueMutex);
-            queueCondition.wait(lock, [this] { return !clientQueue.empty() || !running; });
-
-            if (!running && clientQueue.empty()) return;
-
-            clientSocket = clientQueue.front();
-            clientQueue.pop();
-        }
-
-        if (clientSocket != INVALID_SOCKET) {
-            WorkerThread worker(clientSocket);
-            worker.processRequest(); // Handle the client completely inside WorkerThread
-        }
-    }
-}
\ No newline at end of file
@@ -3,36 +3,64 @@
 
 #include <string>
 #include <atomic>
+#include <memory>
 #include <thread>
 #include <vector>
-#include <queue>
-#include <mutex>
-#include <condition_variable>
-#include <winsock2.h>
+#include "socketCompat.h"
+#include "threadPool.h"
+
+#ifdef __linux__
+#include "eventLoop.h"
+#endif
 
 class Server {
 private:
-    SOCKET serverSocket;
+    SOCKET serverSocket;                   // blocking path only
     int port;
+    size_t shardCount;
+    std::vector<size_t> configuredCpus;    // --cpus; empty: every CPU we may use
     std::atomic<bool> running;
-    std::vector<std::thread> workerThreads;
+    std::atomic<size_t> activeConnections; // blocking path only
+    std::atomic<bool> clientsWaiting;      // blocking path: accepted none for want of a worker
+
+    // Work-stealing pool handling whole connections on the blocking path
+    std::unique_ptr<ThreadPool> pool;
+
+#ifdef __linux__
+    // A listening socket, event loop and worker pool of its own. With more
+    // than one shard the sockets share the port through SO_REUSEPORT and
+    // the kernel spreads new connections over them, so accepting does not
+    // funnel through a single loop. Shard 0 runs on the thread that called
+    // start(); the others get a thread each.
+    struct Shard {
+        SOCKET listenSocket = INVALID_SOCKET;
+        std::vector<size_t> cpus;          // loop and workers run here; empty: anywhere
+        double cpuShare = 1;               // of the process's CPU budget
+        std::unique_ptr<ThreadPool> pool;
+        std::unique_ptr<EventLoop> eventLoop;
+        std::thread thread;
+    };
+    std::vector<std::unique_ptr<Shard>> shards;
 
-    // Thread pool for handling client requests
-    std::queue<SOCKET> clientQueue; // Use SOCKET
-    std::mutex queueMutex;
-    std::condition_variable queueCondition;
+    // budget: CPUs' worth of time for the whole process
+    bool startShard(Shard& shard, double budget);
+#endif
 
-    // Initialize server socket
-    bool initializeSocket();
+    // Create a socket bound to the port and listening; reusePort lets the
+    // other shards bind the same port
+    SOCKET openListenSocket(bool reusePort);
 
-    // Accept client connections
+    // Accept client connections (blocking path, used where epoll is
+    // unavailable). Each holds a pool worker while it lasts, so no more are
+    // accepted than the pool has workers.
     void acceptConnections();
 
-    // Worker thread function
-    void workerThreadFunction();
+    void logStats();
 
 public:
-    Server(int portNum = 8080);
+    // shards is clamped to 1..MAX_SERVER_SHARDS; only the event loop shards.
+    // cpus, when given, are the cores the shards are pinned to.
+    Server(int portNum = 8080, size_t shards = 1, std::vector<size_t> cpus = {});
     ~Server();
 
     // Start the server
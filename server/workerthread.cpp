@@ -1,15 +1,80 @@
 #include "workerthread.h"
 #include "algorithmFactory.h"
+#include "frameFormat.h"
 #include "fileHandler.h"
 #include "networkUtils.h"
+#include "bufferPool.h"
+#include "threadPool.h"
+#include "memoryBudget.h"
+#include "objectStore.h"
+#include "singleFlight.h"
+#include "compressionStream.h"
+#include "batchFormat.h"
+#include "writeBehind.h"
+#include "jobManager.h"
+#include "metrics.h"
 #include "logger.h"
 #include "config.h"
-#include <winsock2.h>
-#include <ws2tcpip.h>
 #include <iostream>
-#pragma comment(lib, "ws2_32.lib")
+#include <limits>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
 
-WorkerThread::WorkerThread(SOCKET socket) : clientSocket(socket) {}
+namespace {
+
+uint32_t toMicros(std::chrono::steady_clock::duration duration) {
+    const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    const int64_t limit = std::numeric_limits<uint32_t>::max();
+    return static_cast<uint32_t>(std::clamp<int64_t>(micros, 0, limit));
+}
+
+// CPU time the calling thread has used so far
+uint64_t threadCpuMicros() {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user)) return 0;
+    auto ticks = [](const FILETIME& time) {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return (ticks(kernel) + ticks(user)) / 10;
+#else
+    timespec now{};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) return 0;
+    return static_cast<uint64_t>(now.tv_sec) * 1000000 + static_cast<uint64_t>(now.tv_nsec) / 1000;
+#endif
+}
+
+// Compress and decompress results are coalesced and cached by payload
+bool resultKey(const Request& request, ResultCache::Key& key) {
+    const MessageType type = request.getMessageType();
+    if (type != MessageType::COMPRESS_REQUEST && type != MessageType::DECOMPRESS_REQUEST) {
+        return false;
+    }
+    key = ResultCache::keyFor(type, request.getAlgorithmType(), request.getData());
+    return true;
+}
+
+} // namespace
+
+WorkerThread::WorkerThread(SOCKET socket, ThreadPool* pool)
+    : clientSocket(socket), pool(pool), progress(nullptr), saveTime(0), cpuStarted(0),
+      cancelled(false), yieldSignal(nullptr) {}
+
+bool WorkerThread::shouldSplit(uint64_t size) const {
+    // Only idle workers are borrowed, so small requests never queue behind
+    // pieces of a large one. A large-lane job is cut up even without helpers:
+    // each piece ends at a point where it can yield to small requests.
+    if (!pool) return false;
+    if (pool->inLargeTask() && size > PARALLEL_CHUNK_SIZE) return true;
+    return size >= PARALLEL_MIN_REQUEST_SIZE && pool->spareWorkers() > 0;
+}
 
 WorkerThread::~WorkerThread() {
     if (clientSocket != INVALID_SOCKET) {
@@ -19,57 +84,486 @@ WorkerThread::~WorkerThread() {
 }
 
 void WorkerThread::processRequest() {
-    Logger::info("Processing request from client socket: " + std::to_string(clientSocket));
-    
-    Request request;
-    if (!request.deserialize(clientSocket)) {
-        Logger::error("Failed to receive request");
-        Response errorResponse(OperationStatus::FAILURE, "", 
-                               "Failed to receive request", {});
-        errorResponse.serialize(clientSocket);
-        return;
+    Logger::info("Processing requests from client socket: " + std::to_string(clientSocket));
+    
+    // Keep-alive: serve requests in order until the client closes or goes
+    // quiet; pipelined requests simply wait in the socket buffer
+    NetworkUtils::setSocketTimeout(clientSocket, CONNECTION_IDLE_TIMEOUT_SECONDS);
+    size_t served = 0;
+    
+    while (awaitRequest(served)) {
+        Request request;
+        if (!request.receiveHead(clientSocket)) {
+            if (served == 0) {
+                Logger::error("Failed to receive request");
+                Response errorResponse(OperationStatus::FAILURE, "", 
+                                       "Failed to receive request", {});
+                errorResponse.serialize(clientSocket);
+            }
+            break;
+        }
+        
+        // Streamed uploads are taken a block at a time, so only one block
+        // (and its output) is held at once
+        const bool streamed = request.isStreamed() && !request.isSubmitted() &&
+                              request.getMessageType() == MessageType::COMPRESS_REQUEST &&
+                              request.getIncomingSize() > 0 &&
+                              AlgorithmFactory::isSupported(request.getAlgorithmType());
+        
+        // Take the payload only once its memory is granted; otherwise skip
+        // it and answer straight away so the connection stays in step
+        const size_t charge = MemoryBudget::chargeFor(streamed
+            ? std::min<uint32_t>(request.getIncomingSize(), DEFAULT_FRAME_BLOCK_SIZE)
+            : request.getIncomingSize());
+        Response response;
+        bool admitted = false;
+        bool handedOver = false;   // the charge went on with a submitted job
+        if (request.getIncomingSize() > MAX_REQUEST_SIZE ||
+            MemoryBudget::instance().exceedsLimit(charge)) {
+            const bool tooLarge = request.getIncomingSize() > MAX_REQUEST_SIZE;
+            response = Response(OperationStatus::FAILURE, request.getFilename(),
+                                "Request of " + std::to_string(request.getIncomingSize()) +
+                                " bytes exceeds the " +
+                                (tooLarge ? "server limit of " + std::to_string(MAX_REQUEST_SIZE)
+                                          : "memory budget of " +
+                                            std::to_string(MemoryBudget::instance().getLimit())) +
+                                " bytes", {});
+        } else if (!MemoryBudget::instance().reserve(
+                       charge, std::chrono::milliseconds(ADMISSION_WAIT_MS))) {
+            response = Response(OperationStatus::BUSY, request.getFilename(),
+                                "Server busy: over its memory budget, retry later", {});
+        } else {
+            admitted = true;
+            if (streamed) {
+                const bool streamedOk = streamCompression(request);
+                MemoryBudget::instance().release(charge);
+                served++;
+                if (!streamedOk) break;
+                continue;
+            }
+            if (!request.receivePayload(clientSocket)) {
+                MemoryBudget::instance().release(charge);
+                break;
+            }
+            if (JobManager::isJobMessage(request)) {
+                // A submit hands its charge on to the job, which outlives
+                // the acknowledgement
+                if (request.isSubmitted()) {
+                    request.setAdmission(MemoryBudget::Hold(charge));
+                    handedOver = true;
+                }
+                // A WAIT may be answered later, from another thread
+                std::promise<Response> answer;
+                std::future<Response> answered = answer.get_future();
+                JobManager::instance().handle(std::move(request), pool,
+                                              static_cast<uint64_t>(clientSocket),
+                    [&answer](Response&& reply) { answer.set_value(std::move(reply)); });
+                response = answered.get();
+            } else {
+                response = handleRequest(request);
+            }
+        }
+        
+        if (!admitted) {
+            if (!request.skipPayload(clientSocket)) break;
+            response.setChecksumEnabled(request.isChecksumEnabled());
+        }
+        
+        bool sent = response.serialize(clientSocket);
+        if (!sent) {
+            Logger::error("Failed to send response");
+        }
+        
+        response.print();
+        
+        // The payload goes back to the pool for the next request
+        BufferPool::instance().release(response.takeData());
+        if (admitted && !handedOver) MemoryBudget::instance().release(charge);
+        served++;
+        if (!sent) break;
     }
     
+    Logger::info("Connection closed after " + std::to_string(served) + " requests");
+}
+
+bool WorkerThread::awaitRequest(size_t served) {
+    // A new client gets its first request in; receiveHead()'s timeout
+    // covers idling when nobody can be waiting
+    if (!yieldSignal || served == 0) return true;
+    
+    const auto idleSince = std::chrono::steady_clock::now();
+    while (!NetworkUtils::waitReadable(clientSocket, CONNECTION_YIELD_IDLE_MS)) {
+        if (yieldSignal->load()) {
+            Logger::info("Idle connection closed to make way for a waiting client");
+            return false;
+        }
+        if (std::chrono::steady_clock::now() - idleSince >=
+            std::chrono::seconds(CONNECTION_IDLE_TIMEOUT_SECONDS)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WorkerThread::streamCompression(const Request& request) {
+    CompressionStream stream(request.getAlgorithmType(), request.getFilename(),
+                             request.getIncomingSize(), request.isChecksumEnabled());
+    
+    // Each block is compressed and on its way back before the next is read;
+    // the socket buffers keep the client sending meanwhile
+    uint32_t crc = 0;
+    for (uint32_t i = 0; i < stream.getBlockCount(); i++) {
+        std::vector<uint8_t> block = BufferPool::instance().acquire(stream.blockLength(i));
+        const bool received = request.isChecksumEnabled()
+            ? NetworkUtils::receiveDataWithChecksum(clientSocket, block.data(), block.size(), crc)
+            : NetworkUtils::receiveData(clientSocket, block.data(), block.size());
+        if (!received) {
+            Logger::error("Failed to receive streamed block " + std::to_string(i));
+            BufferPool::instance().release(std::move(block));
+            return false;
+        }
+        
+        bool last = false;
+        Response chunk = stream.compressBlock(i, std::move(block), last);
+        const bool sent = chunk.serialize(clientSocket);
+        BufferPool::instance().release(chunk.takeData());
+        if (!sent) return false;
+    }
+    
+    if (request.isChecksumEnabled()) {
+        uint32_t expected = 0;
+        if (!NetworkUtils::receiveData(clientSocket, &expected, sizeof(expected))) {
+            return false;
+        }
+        if (expected != crc) {
+            Logger::error("Request payload checksum mismatch");
+            return false;
+        }
+    }
+    
+    Response response = stream.finish();
+    response.print();
+    return response.serialize(clientSocket);
+}
+
+bool WorkerThread::beginRequest(Request& request, Response& response) {
     request.print();
+    started = std::chrono::steady_clock::now();
+    cpuStarted = threadCpuMicros();
+    lookupDone = started;
+    saveTime = std::chrono::steady_clock::duration::zero();
+    cancelled = false;
+    response.setChecksumEnabled(request.isChecksumEnabled());
     
+    // Queued work whose client has gone is dropped before it costs anything
+    if (checkCancelled(request, response)) {
+        Metrics::instance().requestCancelled(request.getData().size());
+        BufferPool::instance().release(request.takeData());
+        return false;
+    }
+    return true;
+}
+
+Response WorkerThread::handleRequest(Request& request) {
     Response response;
-    bool success = false;
+    if (!beginRequest(request, response)) return response;
     
-    switch (request.getMessageType()) {
-        case MessageType::COMPRESS_REQUEST:
-            success = processCompression(request, response);
-            break;
-            
-        case MessageType::DECOMPRESS_REQUEST:
-            success = processDecompression(request, response);
-            break;
-            
-        default:
-            Logger::error("Unknown message type");
-            response.setStatus(OperationStatus::FAILURE);
-            response.setMessage("Unknown message type");
-            break;
+    // A payload being processed right now is waited for; one seen before is
+    // answered from the cache or the object store without the codec. A
+    // leader whose client went away hands the work on to whoever joins next.
+    ResultCache::Key key{};
+    const bool keyed = resultKey(request, key);
+    SingleFlight::Outcome outcome;
+    auto follows = [&key, &outcome] {
+        while (!SingleFlight::instance().join(key, outcome)) {
+            if (!outcome.abandoned) return true;
+        }
+        return false;
+    };
+    if (keyed && follows()) {
+        followRequest(request, outcome, response);
+    } else {
+        leadRequest(request, keyed ? &key : nullptr, response);
+    }
+    finishRequest(request, response);
+    return response;
+}
+
+void WorkerThread::handleRequest(std::shared_ptr<Request> request, Reply reply) {
+    ResultCache::Key key{};
+    if (!pool || !resultKey(*request, key)) {
+        reply(handleRequest(*request));
+        return;
     }
     
-    if (!response.serialize(clientSocket)) {
-        Logger::error("Failed to send response");
+    Response response;
+    if (!beginRequest(*request, response)) {
+        reply(std::move(response));
+        return;
     }
     
-    response.print();
+    // A follower leaves a callback with the flight and its worker goes back
+    // to the pool; the leader's outcome is turned into a response by a new
+    // task. After an abandoned flight the request starts over.
+    ThreadPool* workers = pool;
+    const auto arrived = started;
+    auto onFinish = [workers, request, reply, arrived](const SingleFlight::Outcome& outcome) {
+        workers->submit([workers, request, reply, arrived, outcome] {
+            WorkerThread worker(INVALID_SOCKET, workers);
+            if (outcome.abandoned) {
+                worker.handleRequest(request, reply);
+                return;
+            }
+            Response response;
+            worker.started = arrived;
+            worker.cpuStarted = threadCpuMicros();
+            response.setChecksumEnabled(request->isChecksumEnabled());
+            if (!worker.checkCancelled(*request, response)) {
+                worker.followRequest(*request, outcome, response);
+            }
+            worker.finishRequest(*request, response);
+            reply(std::move(response));
+        });
+    };
+    if (!SingleFlight::instance().join(key, std::move(onFinish))) return;
+    
+    leadRequest(*request, &key, response);
+    finishRequest(*request, response);
+    reply(std::move(response));
+}
+
+void WorkerThread::followRequest(const Request& request, const SingleFlight::Outcome& outcome,
+                                 Response& response) {
+    Logger::info("Request coalesced with an identical one in flight");
+    lookupDone = std::chrono::steady_clock::now();
+    if (outcome.status == OperationStatus::SUCCESS) {
+        respondWith(request, outcome.result, "coalesced", response);
+    } else {
+        response.setStatus(outcome.status);
+        response.setMessage(outcome.result.message);
+    }
+}
+
+void WorkerThread::leadRequest(Request& request, const ResultCache::Key* key, Response& response) {
+    // Codec temporaries for this request are bump-allocated here and released
+    // together when the request finishes, instead of freed node by node
+    std::pmr::monotonic_buffer_resource arena(REQUEST_ARENA_INITIAL_SIZE);
+    
+    // Followers are released on every way out, failed unless published
+    struct FlightLead {
+        const ResultCache::Key* key;
+        const Response& response;
+        SingleFlight::Outcome outcome;
+        ~FlightLead() {
+            if (key) SingleFlight::instance().finish(*key, outcome, response.getData());
+        }
+    } lead{key, response, {}};
+    lead.outcome.result.message = "Identical request failed";
+    
+    ResultCache::Result result;
+    const bool found = key && findResult(*key, result);
+    lookupDone = std::chrono::steady_clock::now();
+    if (found) {
+        respondWith(request, result, "cached", response);
+        if (response.getStatus() == OperationStatus::SUCCESS) {
+            lead.outcome.result = result;
+        } else {
+            lead.outcome.result.message = response.getMessage();
+        }
+    } else {
+        std::string algorithmName;
+        switch (request.getMessageType()) {
+            case MessageType::COMPRESS_REQUEST:
+                processCompression(request, response, &arena, algorithmName);
+                break;
+                
+            case MessageType::DECOMPRESS_REQUEST:
+                processDecompression(request, response, &arena, algorithmName);
+                break;
+                
+            case MessageType::FETCH_REQUEST:
+                processFetch(request, response);
+                break;
+                
+            case MessageType::BATCH_REQUEST:
+                processBatch(request, response);
+                break;
+                
+            case MessageType::STATS_REQUEST: {
+                const std::string report =
+                    Metrics::instance().report() + JobManager::instance().report();
+                response.setStatus(OperationStatus::SUCCESS);
+                response.setMessage("Server statistics");
+                response.setData(std::vector<uint8_t>(report.begin(), report.end()));
+                break;
+            }
+                
+            default:
+                Logger::error("Unknown message type");
+                response.setStatus(OperationStatus::FAILURE);
+                response.setMessage("Unknown message type");
+                break;
+        }
+        
+        // Stored before the flight ends, so later requests find it
+        lead.outcome.abandoned = cancelled;
+        lead.outcome.result.message = response.getMessage();
+        lead.outcome.result.algorithmName = algorithmName;
+        if (key && response.getStatus() == OperationStatus::SUCCESS) {
+            const auto storing = std::chrono::steady_clock::now();
+            lead.outcome.result.data = remember(*key, response.getData(), algorithmName,
+                                                response.getMessage());
+            saveTime += std::chrono::steady_clock::now() - storing;
+        }
+    }
+    lead.outcome.status = response.getStatus();
 }
 
-bool WorkerThread::processCompression(const Request& request, Response& response) {
+void WorkerThread::finishRequest(Request& request, Response& response) {
+    if (response.getStatus() != OperationStatus::SUCCESS) {
+        Logger::warning("Request failed: " + response.getMessage());
+    }
+    
+    const auto finished = std::chrono::steady_clock::now();
+    if (cancelled) {
+        Metrics::instance().requestCancelled(request.getData().size());
+    } else {
+        Metrics::instance().recordRequest(
+            request.getMessageType(), request.getAlgorithmType(), request.getData().size(),
+            response.getPayloadSize(), response.getStatus() == OperationStatus::SUCCESS,
+            std::chrono::duration_cast<std::chrono::microseconds>(finished - started));
+    }
+    
+    if (request.isTimingRequested()) {
+        // Requests built in-process were never received; they start here
+        const bool received = request.getReceiveFinished().time_since_epoch().count() != 0;
+        const auto arrived = received ? request.getReceiveStarted() : started;
+        StageTiming timing;
+        timing.receiveMicros = received ? toMicros(request.getReceiveFinished() - arrived) : 0;
+        timing.queueMicros = received ? toMicros(started - request.getReceiveFinished()) : 0;
+        timing.lookupMicros = toMicros(lookupDone - started);
+        timing.codecMicros = toMicros(finished - lookupDone - saveTime);
+        timing.saveMicros = toMicros(saveTime);
+        timing.cpuMicros = static_cast<uint32_t>(std::min<uint64_t>(
+            threadCpuMicros() - cpuStarted, std::numeric_limits<uint32_t>::max()));
+        timing.totalMicros = toMicros(finished - arrived);
+        response.setTiming(timing);
+    }
+    
+    BufferPool::instance().release(request.takeData());
+}
+
+bool WorkerThread::findResult(const ResultCache::Key& key, ResultCache::Result& result) {
+    if (ResultCache::instance().lookup(key, result)) {
+        return true;
+    }
+    
+    std::vector<uint8_t> data;
+    if (ObjectStore::instance().fetch(key, data, result.algorithmName, result.message)) {
+        Logger::info("Result found in the object store");
+        result.data = std::make_shared<const std::vector<uint8_t>>(std::move(data));
+        ResultCache::instance().insert(key, result);
+        return true;
+    }
+    return false;
+}
+
+bool WorkerThread::holdOutput(const Request& request, uint64_t outputSize, Response& response) {
+    const uint64_t payloadSize = request.getData().size();
+    if (outputSize <= payloadSize) return true;
+    
+    MemoryBudget& budget = MemoryBudget::instance();
+    const uint64_t extra = outputSize - payloadSize;
+    if (extra > std::numeric_limits<size_t>::max() || budget.exceedsLimit(extra)) {
+        response.setStatus(OperationStatus::FAILURE);
+        response.setMessage("Output of " + std::to_string(outputSize) +
+                            " bytes exceeds the memory budget of " +
+                            std::to_string(budget.getLimit()) + " bytes");
+        return false;
+    }
+    if (!budget.tryReserve(static_cast<size_t>(extra))) {
+        response.setStatus(OperationStatus::BUSY);
+        response.setMessage("Server busy: output over its memory budget, retry later");
+        return false;
+    }
+    response.addHold(MemoryBudget::Hold(static_cast<size_t>(extra)));
+    return true;
+}
+
+void WorkerThread::respondWith(const Request& request, const ResultCache::Result& result,
+                               const std::string& note, Response& response) {
+    const std::string operation =
+        (request.getMessageType() == MessageType::COMPRESS_REQUEST) ? "compress" : "decompress";
+    std::string outputFilename = FileHandler::generateOutputFilename(
+        request.getFilename(), operation, result.algorithmName);
+    Logger::info("Serving " + outputFilename + " (" + note + ")");
+    if (!holdOutput(request, result.data->size(), response)) return;
+    
+    // The shared bytes stay as they are; the response gets its own pooled copy
+    std::vector<uint8_t> data = BufferPool::instance().acquire(result.data->size());
+    if (!data.empty()) {
+        std::memcpy(data.data(), result.data->data(), data.size());
+    }
+    
+    // The same upload under the same name has already been written
+    if (request.isSaveOutput() &&
+        !saveProcessedFile(outputFilename, data, operation, response, true)) {
+        BufferPool::instance().release(std::move(data));
+        return;
+    }
+    
+    response.setStatus(OperationStatus::SUCCESS);
+    response.setFilename(std::move(outputFilename));
+    response.setData(std::move(data));
+    response.setMessage(result.message + " (" + note + ")");
+}
+
+std::shared_ptr<const std::vector<uint8_t>> WorkerThread::remember(
+    const ResultCache::Key& key, const std::vector<uint8_t>& data,
+    const std::string& algorithmName, const std::string& message) {
+    ObjectStore::instance().store(key, data, algorithmName, message);
+    if (data.size() > RESULT_CACHE_MAX_ENTRY_SIZE) {
+        return nullptr;
+    }
+    
+    // One shared copy serves the cache and any coalesced followers
+    ResultCache::Result result;
+    result.data = std::make_shared<const std::vector<uint8_t>>(data);
+    result.algorithmName = algorithmName;
+    result.message = message;
+    ResultCache::instance().insert(key, result);
+    return result.data;
+}
+
+bool WorkerThread::processCompression(const Request& request, Response& response,
+                                      std::pmr::memory_resource* arena,
+                                      std::string& algorithmName) {
     Logger::info("Processing compression request");
     
-    auto algorithm = AlgorithmFactory::createAlgorithm(request.getAlgorithmType());
+    auto algorithm = AlgorithmFactory::createAlgorithm(request.getAlgorithmType(), arena);
     if (!algorithm) {
         response.setStatus(OperationStatus::FAILURE);
         response.setMessage("Failed to create compression algorithm");
         return false;
     }
     
-    std::vector<uint8_t> compressedData;
-    if (!algorithm->compress(request.getData(), compressedData)) {
+    const std::vector<uint8_t>& input = request.getData();
+    std::vector<uint8_t> compressedData =
+        BufferPool::instance().acquireCapacity(FrameFormat::maxCompressedSize(input.size()));
+    bool compressed = shouldSplit(input.size())
+        ? FrameFormat::compressParallel(request.getAlgorithmType(), input.data(), input.size(),
+                                        compressedData, *pool, DEFAULT_FRAME_BLOCK_SIZE,
+                                        FrameFormat::DEFAULT_FLAGS, progress,
+                                        request.getCancelFlag().get())
+        : FrameFormat::compress(*algorithm, request.getAlgorithmType(),
+                                input.data(), input.size(), compressedData);
+    
+    // Nothing is saved or sent for a client that has gone
+    if (checkCancelled(request, response)) {
+        BufferPool::instance().release(std::move(compressedData));
+        return false;
+    }
+    if (!compressed) {
         response.setStatus(OperationStatus::FAILURE);
         response.setMessage("Compression failed");
         return false;
@@ -78,67 +572,259 @@ bool WorkerThread::processCompression(const Request& request, Response& response
     std::string outputFilename = FileHandler::generateOutputFilename(
         request.getFilename(), "compress", algorithm->getName());
     
-    if (!saveProcessedFile(outputFilename, compressedData, "compress")) {
-        response.setStatus(OperationStatus::FAILURE);
-        response.setMessage("Failed to save compressed file");
+    if (request.isSaveOutput() &&
+        !saveProcessedFile(outputFilename, compressedData, "compress", response)) {
         return false;
     }
     
     double ratio = algorithm->calculateCompressionRatio(
         request.getData().size(), compressedData.size());
     
+    Logger::info("Compression completed: " + outputFilename);
+    
+    algorithmName = algorithm->getName();
     response.setStatus(OperationStatus::SUCCESS);
-    response.setFilename(outputFilename);
-    response.setData(compressedData);
+    response.setFilename(std::move(outputFilename));
+    response.setData(std::move(compressedData));
     response.setMessage("Compression successful. Ratio: " + 
                         std::to_string(ratio) + "%");
-    
-    Logger::info("Compression completed: " + outputFilename);
     return true;
 }
 
-bool WorkerThread::processDecompression(const Request& request, Response& response) {
+bool WorkerThread::processDecompression(const Request& request, Response& response,
+                                        std::pmr::memory_resource* arena,
+                                        std::string& algorithmName) {
     Logger::info("Processing decompression request");
     
-    auto algorithm = AlgorithmFactory::createAlgorithm(request.getAlgorithmType());
-    if (!algorithm) {
-        response.setStatus(OperationStatus::FAILURE);
-        response.setMessage("Failed to create decompression algorithm");
-        return false;
+    // Framed input names its own codec, so the request's algorithm is only
+    // needed for legacy unframed streams
+    const std::vector<uint8_t>& input = request.getData();
+    AlgorithmType algorithmType = request.getAlgorithmType();
+    std::vector<uint8_t> decompressedData;
+    bool decoded = false;
+    
+    if (FrameFormat::isFramed(input.data(), input.size())) {
+        // Frames can expand MAX_EXPANSION_RATIO times, far beyond the
+        // request's charge, so their content is charged before it exists
+        uint64_t contentSize = 0;
+        if (FrameFormat::contentSize(input.data(), input.size(), contentSize) &&
+            contentSize <= std::numeric_limits<uint32_t>::max()) {
+            if (!holdOutput(request, contentSize, response)) return false;
+            decompressedData = BufferPool::instance().acquireCapacity(
+                static_cast<size_t>(contentSize));
+            decoded = shouldSplit(contentSize)
+                ? FrameFormat::decompressParallel(input.data(), input.size(), decompressedData,
+                                                  *pool, &algorithmType, contentSize, progress,
+                                                  request.getCancelFlag().get())
+                : FrameFormat::decompress(input.data(), input.size(), decompressedData,
+                                          &algorithmType, contentSize, arena);
+        }
+    } else {
+        auto algorithm = AlgorithmFactory::createAlgorithm(algorithmType, arena);
+        if (!algorithm) {
+            response.setStatus(OperationStatus::FAILURE);
+            response.setMessage("Failed to create decompression algorithm");
+            return false;
+        }
+        decoded = algorithm->decompress(input, decompressedData);
     }
     
-    std::vector<uint8_t> decompressedData;
-    if (!algorithm->decompress(request.getData(), decompressedData)) {
+    if (checkCancelled(request, response)) {
+        BufferPool::instance().release(std::move(decompressedData));
+        return false;
+    }
+    if (!decoded) {
         response.setStatus(OperationStatus::FAILURE);
         response.setMessage("Decompression failed");
         return false;
     }
     
     std::string outputFilename = FileHandler::generateOutputFilename(
-        request.getFilename(), "decompress", algorithm->getName());
+        request.getFilename(), "decompress", algorithmTypeToString(algorithmType));
     
-    if (!saveProcessedFile(outputFilename, decompressedData, "decompress")) {
+    if (request.isSaveOutput() &&
+        !saveProcessedFile(outputFilename, decompressedData, "decompress", response)) {
+        return false;
+    }
+    
+    Logger::info("Decompression completed: " + outputFilename);
+    
+    algorithmName = algorithmTypeToString(algorithmType);
+    response.setStatus(OperationStatus::SUCCESS);
+    response.setFilename(std::move(outputFilename));
+    response.setMessage("Decompression successful (" + algorithmTypeToString(algorithmType) +
+                        "). Size: " + std::to_string(decompressedData.size()) + " bytes");
+    response.setData(std::move(decompressedData));
+    return true;
+}
+
+bool WorkerThread::processFetch(const Request& request, Response& response) {
+    Logger::info("Processing fetch request");
+    
+    // Only plain names inside the output directories can be fetched
+    const std::string& name = request.getFilename();
+    if (name.empty() || name == "." || name == ".." ||
+        name.find_first_of("/\\") != std::string::npos) {
         response.setStatus(OperationStatus::FAILURE);
-        response.setMessage("Failed to save decompressed file");
+        response.setMessage("Invalid output name: " + name);
         return false;
     }
     
+    auto openOutput = [&name] {
+        FileBody file = FileBody::open(COMPRESSED_DIR + name);
+        return file.isOpen() ? std::move(file) : FileBody::open(DECOMPRESSED_DIR + name);
+    };
+    FileBody file = openOutput();
+    if (!file.isOpen()) {
+        // Still queued for the write-behind thread: answer from its copy
+        // rather than wait for the disk
+        WriteBehind& writer = WriteBehind::instance();
+        std::string path = COMPRESSED_DIR + name;
+        size_t size = 0;
+        bool pending = writer.pendingSize(path, size);
+        if (!pending) {
+            path = DECOMPRESSED_DIR + name;
+            pending = writer.pendingSize(path, size);
+        }
+        if (pending && size <= std::numeric_limits<uint32_t>::max()) {
+            if (!holdOutput(request, size, response)) return false;
+            std::vector<uint8_t> data;
+            if (writer.readPending(path, data)) {
+                Logger::info("Fetching " + name + " from the write-behind queue (" +
+                             std::to_string(data.size()) + " bytes)");
+                response.setStatus(OperationStatus::SUCCESS);
+                response.setFilename(name);
+                response.setMessage("Fetched stored output. Size: " +
+                                    std::to_string(data.size()) + " bytes");
+                response.setData(std::move(data));
+                return true;
+            }
+            response.takeHold().reset();
+        }
+        // It may have been renamed into place since the first look
+        file = openOutput();
+    }
+    if (!file.isOpen()) {
+        response.setStatus(OperationStatus::FAILURE);
+        response.setMessage("No stored output named " + name);
+        return false;
+    }
+    if (file.getSize() > std::numeric_limits<uint32_t>::max()) {
+        response.setStatus(OperationStatus::FAILURE);
+        response.setMessage("Stored output " + name + " is too large to fetch");
+        return false;
+    }
+    
+    Logger::info("Fetching " + name + " (" + std::to_string(file.getSize()) + " bytes)");
     response.setStatus(OperationStatus::SUCCESS);
-    response.setFilename(outputFilename);
-    response.setData(decompressedData);
-    response.setMessage("Decompression successful. Size: " + 
-                        std::to_string(decompressedData.size()) + " bytes");
+    response.setFilename(name);
+    response.setMessage("Fetched stored output. Size: " + std::to_string(file.getSize()) +
+                        " bytes");
+    response.setFile(std::move(file));
+    return true;
+}
+
+bool WorkerThread::processBatch(const Request& request, Response& response) {
+    std::vector<Request> members;
+    if (!BatchFormat::decode(request.getData().data(), request.getData().size(),
+                             request.getAlgorithmType(), members)) {
+        response.setStatus(OperationStatus::FAILURE);
+        response.setMessage("Malformed batch manifest");
+        return false;
+    }
+    Logger::info("Processing batch of " + std::to_string(members.size()) + " members");
     
-    Logger::info("Decompression completed: " + outputFilename);
+    // Each member is an ordinary request: cached, coalesced, saved and
+    // counted on its own. Spare workers take members while this one works
+    // through the rest.
+    std::vector<Response> results(members.size());
+    auto handleMember = [this, &request, &members, &results](size_t i) {
+        members[i].setSaveOutput(request.isSaveOutput());
+        members[i].setCancelFlag(request.getCancelFlag());
+        const uint64_t size = members[i].getData().size();
+        WorkerThread worker(INVALID_SOCKET, pool);
+        results[i] = worker.handleRequest(members[i]);
+        if (progress) progress->fetch_add(size, std::memory_order_relaxed);
+    };
+    if (pool) {
+        pool->parallelFor(members.size(), handleMember);
+    } else {
+        for (size_t i = 0; i < members.size(); i++) handleMember(i);
+    }
+    
+    if (checkCancelled(request, response)) {
+        for (Response& result : results) {
+            BufferPool::instance().release(result.takeData());
+        }
+        return false;
+    }
+    
+    size_t succeeded = 0;
+    for (const Response& result : results) {
+        if (result.getStatus() == OperationStatus::SUCCESS) succeeded++;
+    }
+    std::vector<uint8_t> data =
+        BufferPool::instance().acquireCapacity(BatchFormat::encodedSize(results));
+    BatchFormat::encode(results, data);
+    for (Response& result : results) {
+        BufferPool::instance().release(result.takeData());
+        // The members' outputs now live in the batch payload
+        response.addHold(result.takeHold());
+    }
+    
+    response.setStatus(OperationStatus::SUCCESS);
+    response.setFilename(request.getFilename());
+    response.setMessage(std::to_string(succeeded) + " of " + std::to_string(results.size()) +
+                        " members succeeded");
+    response.setData(std::move(data));
+    return succeeded == results.size();
+}
+
+bool WorkerThread::checkCancelled(const Request& request, Response& response) {
+    if (!request.isCancelled() &&
+        (clientSocket == INVALID_SOCKET || !NetworkUtils::isPeerGone(clientSocket))) {
+        return false;
+    }
+    Logger::warning("Request for " + request.getFilename() + " cancelled: the client went away");
+    cancelled = true;
+    response.setStatus(OperationStatus::FAILURE);
+    response.setMessage("Cancelled: the client went away");
     return true;
 }
 
 bool WorkerThread::saveProcessedFile(const std::string& filename,
                                      const std::vector<uint8_t>& data,
-                                     const std::string& operation) {
+                                     const std::string& operation,
+                                     Response& response,
+                                     bool keepExisting) {
     std::string outputDir = (operation == "compress") ? COMPRESSED_DIR : DECOMPRESSED_DIR;
-    FileHandler::createDirectory(outputDir);
     
-    std::string filepath = outputDir + filename;
-    return FileHandler::writeFile(filepath, data);
+    // The response keeps data; the I/O thread writes its own pooled copy
+    // after the response has gone out. The copy is charged until it is on
+    // disk, and reserved before it is made.
+    MemoryBudget& budget = MemoryBudget::instance();
+    if (!budget.tryReserve(data.size())) {
+        const bool tooLarge = budget.exceedsLimit(data.size());
+        response.setStatus(tooLarge ? OperationStatus::FAILURE : OperationStatus::BUSY);
+        response.setMessage(tooLarge
+            ? "Output of " + std::to_string(data.size()) +
+              " bytes is too large to save within the memory budget"
+            : "Server busy: no memory budget to save the " + operation + "ed file, retry later");
+        return false;
+    }
+    MemoryBudget::Hold charge(data.size());
+    
+    const auto started = std::chrono::steady_clock::now();
+    std::vector<uint8_t> copy = BufferPool::instance().acquire(data.size());
+    if (!copy.empty()) {
+        std::memcpy(copy.data(), data.data(), copy.size());
+    }
+    const bool queued = WriteBehind::instance().write(outputDir + filename, std::move(copy),
+                                                      keepExisting, std::move(charge));
+    saveTime += std::chrono::steady_clock::now() - started;
+    if (!queued) {
+        response.setStatus(OperationStatus::FAILURE);
+        response.setMessage("Failed to save " + operation + "ed file");
+    }
+    return queued;
 }
@@ -3,31 +3,138 @@
 
 #include "request.h"
 #include "response.h"
+#include "resultCache.h"
+#include "singleFlight.h"
 #include <string>
 #include <vector>
-#include <winsock2.h> // SOCKET
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <chrono>
+#include "socketCompat.h" // SOCKET
+
+class ThreadPool;
 
 class WorkerThread {
 private:
     SOCKET clientSocket; // Use SOCKET type on Windows
+    ThreadPool* pool;    // spare workers take pieces of large payloads
+    std::atomic<uint64_t>* progress; // payload bytes done, for background jobs
+    std::chrono::steady_clock::time_point started;    // the current request's timing
+    std::chrono::steady_clock::time_point lookupDone;
+    std::chrono::steady_clock::duration saveTime; // spent keeping the current output
+    uint64_t cpuStarted;
+    bool cancelled;      // the current request was given up on
+    const std::atomic<bool>* yieldSignal; // raised while clients wait for a worker
+    
+    // The parts of handleRequest(). beginRequest() drops a cancelled request
+    // and returns false; leadRequest() computes the response, as the flight's
+    // leader unless key is null; followRequest() answers from a leader's
+    // outcome; finishRequest() counts and times the response.
+    bool beginRequest(Request& request, Response& response);
+    void leadRequest(Request& request, const ResultCache::Key* key, Response& response);
+    void followRequest(const Request& request, const SingleFlight::Outcome& outcome,
+                       Response& response);
+    void finishRequest(Request& request, Response& response);
+    
+    // Process compression request; codec temporaries come from arena.
+    // algorithmName is set to the codec that named the output.
+    bool processCompression(const Request& request, Response& response,
+                            std::pmr::memory_resource* arena, std::string& algorithmName);
+    
+    // Process decompression request; codec temporaries come from arena
+    bool processDecompression(const Request& request, Response& response,
+                              std::pmr::memory_resource* arena, std::string& algorithmName);
+    
+    // Answer with a stored output file, sent from disk without a copy (or
+    // copied from the write-behind queue when it is not on disk yet)
+    bool processFetch(const Request& request, Response& response);
+    
+    // Process every member of a batch, in parallel where workers are spare,
+    // and answer with their results in one payload (see batchFormat.h)
+    bool processBatch(const Request& request, Response& response);
+    
+    // Look a result up in the cache, then the object store
+    bool findResult(const ResultCache::Key& key, ResultCache::Result& result);
+    
+    // Charge an output of outputSize bytes to the memory budget before it is
+    // allocated. The request's own charge covers output as large as its
+    // payload; the rest goes on a Hold carried by response. Answers BUSY
+    // (or FAILURE when it could never fit) and returns false otherwise.
+    bool holdOutput(const Request& request, uint64_t outputSize, Response& response);
+    
+    // Answer request with a result computed for the same payload
+    void respondWith(const Request& request, const ResultCache::Result& result,
+                     const std::string& note, Response& response);
     
-    // Process compression request
-    bool processCompression(const Request& request, Response& response);
+    // Keep a computed result in the object store and, unless too large, the
+    // cache; returns the cached bytes
+    std::shared_ptr<const std::vector<uint8_t>> remember(const ResultCache::Key& key,
+                                                         const std::vector<uint8_t>& data,
+                                                         const std::string& algorithmName,
+                                                         const std::string& message);
     
-    // Process decompression request
-    bool processDecompression(const Request& request, Response& response);
+    // Blocking path for a streamed compress request: read, compress and
+    // send back one block at a time, then the closing response. False if
+    // the connection can no longer be used.
+    bool streamCompression(const Request& request);
     
-    // Save processed file
+    // Give up on request if its client has gone: the request's cancel flag
+    // is raised, or on the blocking path its socket was reset. Answers
+    // response with the cancellation and returns true.
+    bool checkCancelled(const Request& request, Response& response);
+    
+    // Blocking path: wait for the next request's first bytes; false when
+    // the connection idled out or should give its worker up
+    bool awaitRequest(size_t served);
+    
+    // Whether a payload of this size is worth spreading over the pool, or
+    // cutting into slices that give way to small requests
+    bool shouldSplit(uint64_t size) const;
+    
+    // Queue the processed file for the write-behind thread; with
+    // keepExisting a file already saved under this name is left alone. On
+    // failure response says why: BUSY when the budget has no room for the
+    // queued copy.
     bool saveProcessedFile(const std::string& filename, 
                           const std::vector<uint8_t>& data,
-                          const std::string& operation);
+                          const std::string& operation,
+                          Response& response,
+                          bool keepExisting = false);
 
 public:
-    WorkerThread(SOCKET socket);
+    // Called once with the response, maybe later and from another worker
+    using Reply = std::function<void(Response&&)>;
+    
+    // Without a socket the worker only computes responses (event loop path).
+    // Without a pool every request is processed on the calling thread.
+    WorkerThread(SOCKET socket = INVALID_SOCKET, ThreadPool* pool = nullptr);
     ~WorkerThread();
     
-    // Main processing function
+    // Blocking path: handle requests on the socket until the client closes
     void processRequest();
+    
+    // Blocking path: once signal is raised, a connection idle between
+    // requests for CONNECTION_YIELD_IDLE_MS is closed to free its worker;
+    // the client reconnects for its next request
+    void setYieldSignal(const std::atomic<bool>* signal) { yieldSignal = signal; }
+    
+    // Compress or decompress a fully received request; no socket I/O. The
+    // request payload is returned to the buffer pool afterwards. A request
+    // whose client goes away is checked before it starts, between blocks
+    // of a split payload and before its output is saved, and dropped.
+    Response handleRequest(Request& request);
+    
+    // Pool path: the same, but a request identical to one in flight gives
+    // its worker back instead of waiting; a new pool task answers it once
+    // the leader finishes. Without a pool it is answered before returning.
+    void handleRequest(std::shared_ptr<Request> request, Reply reply);
+    
+    // Count the payload bytes processed into counter as the work goes on.
+    // Split payloads and batches report piece by piece; other requests
+    // report nothing until handleRequest() returns.
+    void setProgress(std::atomic<uint64_t>* counter) { progress = counter; }
 };
 
 #endif // WORKERTHREAD_H
\ No newline at end of file
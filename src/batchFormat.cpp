@@ -0,0 +1,150 @@
+#include "batchFormat.h"
+#include "bufferPool.h"
+#include "config.h"
+#include <cstring>
+#include <string>
+
+namespace {
+// Fixed part of a result entry: status u8, then data, name and message sizes
+constexpr size_t RESULT_ENTRY_SIZE = 1 + 3 * 4;
+
+void putU32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+// Bounds-checked reader over a payload
+struct Reader {
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+
+    bool u8(uint8_t& value) {
+        if (size - offset < 1) return false;
+        value = data[offset++];
+        return true;
+    }
+    bool u32(uint32_t& value) {
+        if (size - offset < 4) return false;
+        value = 0;
+        for (int i = 0; i < 4; i++) value |= static_cast<uint32_t>(data[offset + i]) << (8 * i);
+        offset += 4;
+        return true;
+    }
+    bool text(uint32_t length, std::string& value) {
+        if (length > MAX_FILENAME_LENGTH || size - offset < length) return false;
+        value.assign(reinterpret_cast<const char*>(data + offset), length);
+        offset += length;
+        return true;
+    }
+    // Pooled copy of the next length bytes
+    bool bytes(uint32_t length, std::vector<uint8_t>& value) {
+        if (size - offset < length) return false;
+        value = BufferPool::instance().acquire(length);
+        if (length > 0) std::memcpy(value.data(), data + offset, length);
+        offset += length;
+        return true;
+    }
+};
+}
+
+void BatchFormat::encode(const std::vector<Request>& members, std::vector<uint8_t>& out) {
+    putU32(out, static_cast<uint32_t>(members.size()));
+    for (const Request& member : members) {
+        out.push_back(static_cast<uint8_t>(member.getMessageType()));
+        putU32(out, static_cast<uint32_t>(member.getData().size()));
+        putU32(out, static_cast<uint32_t>(member.getFilename().size()));
+        out.insert(out.end(), member.getFilename().begin(), member.getFilename().end());
+    }
+    for (const Request& member : members) {
+        out.insert(out.end(), member.getData().begin(), member.getData().end());
+    }
+}
+
+void BatchFormat::encode(const std::vector<Response>& results, std::vector<uint8_t>& out) {
+    putU32(out, static_cast<uint32_t>(results.size()));
+    for (const Response& result : results) {
+        out.push_back(static_cast<uint8_t>(result.getStatus()));
+        putU32(out, static_cast<uint32_t>(result.getData().size()));
+        putU32(out, static_cast<uint32_t>(result.getFilename().size()));
+        putU32(out, static_cast<uint32_t>(result.getMessage().size()));
+        out.insert(out.end(), result.getFilename().begin(), result.getFilename().end());
+        out.insert(out.end(), result.getMessage().begin(), result.getMessage().end());
+    }
+    for (const Response& result : results) {
+        out.insert(out.end(), result.getData().begin(), result.getData().end());
+    }
+}
+
+size_t BatchFormat::encodedSize(const std::vector<Response>& results) {
+    size_t size = 4;
+    for (const Response& result : results) {
+        size += RESULT_ENTRY_SIZE + result.getFilename().size() + result.getMessage().size() +
+                result.getData().size();
+    }
+    return size;
+}
+
+bool BatchFormat::decode(const uint8_t* data, size_t size, AlgorithmType algorithm,
+                         std::vector<Request>& members) {
+    Reader reader{data, size, 0};
+    uint32_t count = 0;
+    if (!reader.u32(count) || count > MAX_BATCH_MEMBERS) return false;
+
+    std::vector<uint32_t> sizes(count);
+    members.clear();
+    members.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t type = 0;
+        uint32_t nameLength = 0;
+        std::string name;
+        if (!reader.u8(type) || !reader.u32(sizes[i]) || !reader.u32(nameLength) ||
+            !reader.text(nameLength, name)) {
+            return false;
+        }
+        const MessageType memberType = static_cast<MessageType>(type);
+        if (memberType != MessageType::COMPRESS_REQUEST &&
+            memberType != MessageType::DECOMPRESS_REQUEST) {
+            return false;
+        }
+        members.emplace_back(memberType, algorithm, std::move(name), std::vector<uint8_t>());
+        members.back().setChecksumEnabled(false);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        std::vector<uint8_t> memberData;
+        if (!reader.bytes(sizes[i], memberData)) return false;
+        members[i].setData(std::move(memberData));
+    }
+    return reader.offset == size;
+}
+
+bool BatchFormat::decode(const uint8_t* data, size_t size, std::vector<Response>& results) {
+    Reader reader{data, size, 0};
+    uint32_t count = 0;
+    if (!reader.u32(count) || count > MAX_BATCH_MEMBERS) return false;
+
+    std::vector<uint32_t> sizes(count);
+    results.clear();
+    results.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t status = 0;
+        uint32_t nameLength = 0, messageLength = 0;
+        std::string name, message;
+        if (!reader.u8(status) || !reader.u32(sizes[i]) || !reader.u32(nameLength) ||
+            !reader.u32(messageLength) || !reader.text(nameLength, name) ||
+            !reader.text(messageLength, message)) {
+            return false;
+        }
+        results.emplace_back(static_cast<OperationStatus>(status), std::move(name),
+                             std::move(message), std::vector<uint8_t>());
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        std::vector<uint8_t> resultData;
+        if (!reader.bytes(sizes[i], resultData)) return false;
+        results[i].setData(std::move(resultData));
+    }
+    return reader.offset == size;
+}
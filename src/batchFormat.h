@@ -0,0 +1,36 @@
+#ifndef BATCH_FORMAT_H
+#define BATCH_FORMAT_H
+
+#include "request.h"
+#include "response.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Payload of a BATCH_REQUEST and of its response: many small files in one
+// round trip. Both are a manifest followed by the members' bytes back to
+// back, in manifest order (integers little-endian):
+//
+//   request:  count u32 | count x (type u8 | dataSize u32 | nameLength u32 | name) | data...
+//   response: count u32 | count x (status u8 | dataSize u32 | nameLength u32 |
+//                                  messageLength u32 | name | message) | data...
+//
+// Members of a request are compress or decompress requests; the batch's
+// algorithm applies to all of them. The response has one entry per member,
+// each with the status, output name and message a single request would get.
+class BatchFormat {
+public:
+    // Append the encoded members to out
+    static void encode(const std::vector<Request>& members, std::vector<uint8_t>& out);
+    static void encode(const std::vector<Response>& results, std::vector<uint8_t>& out);
+    static size_t encodedSize(const std::vector<Response>& results);
+
+    // Split a payload back into members (data in pooled buffers); false if
+    // it is malformed, holds more than MAX_BATCH_MEMBERS, or a request
+    // member is neither a compress nor a decompress request
+    static bool decode(const uint8_t* data, size_t size, AlgorithmType algorithm,
+                       std::vector<Request>& members);
+    static bool decode(const uint8_t* data, size_t size, std::vector<Response>& results);
+};
+
+#endif // BATCH_FORMAT_H
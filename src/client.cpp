@@ -1,33 +1,36 @@
 #include "client.h"
 #include "fileHandler.h"
+#include "frameFormat.h"
+#include "batchFormat.h"
+#include "jobFormat.h"
 #include "networkUtils.h"
 #include "logger.h"
 #include "config.h"
 
-#include <winsock2.h>
-#include <ws2tcpip.h>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <cstring>
-
-#pragma comment(lib, "ws2_32.lib")
+#include <utility>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <random>
 
 Client::Client(const std::string& ip, int port) 
-    : serverIP(ip), serverPort(port), clientSocket(INVALID_SOCKET) 
+    : serverIP(ip), serverPort(port), clientSocket(INVALID_SOCKET), checksumEnabled(true),
+      streamingEnabled(false), serverSaveEnabled(true), timingEnabled(false),
+      batchEnabled(false), jobsEnabled(false), retryRandom(std::random_device{}())
 {
-    // Initialize Winsock
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2,2), &wsaData) != 0) {
-        Logger::error("WSAStartup failed");
-    }
+    NetworkUtils::initialize();
 
     Logger::info("Client initialized for server " + ip + ":" + std::to_string(port));
 }
 
 Client::~Client() {
     disconnect();
-    WSACleanup(); // Cleanup Winsock
+    NetworkUtils::cleanup();
 }
 
 bool Client::connectToServer() {
@@ -53,13 +56,16 @@ bool Client::connectToServer() {
     
     // Connect to server
     if (connect(clientSocket, reinterpret_cast<SOCKADDR*>(&serverAddr), sizeof(serverAddr)) == SOCKET_ERROR) {
-        int err = WSAGetLastError();
+        int err = socketLastError();
         Logger::error("Failed to connect to server: " + std::to_string(err));
         NetworkUtils::closeSocket(clientSocket);
         clientSocket = INVALID_SOCKET;
         return false;
     }
     
+    // Request heads and payloads go out as separate writes
+    NetworkUtils::setNoDelay(clientSocket);
+    
     Logger::info("Connected to server " + serverIP + ":" + std::to_string(serverPort));
     return true;
 }
@@ -73,47 +79,273 @@ void Client::disconnect() {
 }
 
 bool Client::compressFile(const std::string& filepath, AlgorithmType algorithm) {
-    std::cout << "Reading file: " << filepath << std::endl;
+    return processFiles({filepath}, MessageType::COMPRESS_REQUEST, algorithm);
+}
 
-    std::vector<uint8_t> fileData;
-    if (!FileHandler::readFile(filepath, fileData)) {
-        std::cerr << "Failed to read file: " << filepath << std::endl;
-        return false;
-    }
+bool Client::decompressFile(const std::string& filepath, AlgorithmType algorithm) {
+    return processFiles({filepath}, MessageType::DECOMPRESS_REQUEST, algorithm);
+}
 
-    std::cout << "File size: " << fileData.size() << " bytes" << std::endl;
-    std::cout << "Algorithm: " << algorithmTypeToString(algorithm) << std::endl;
-    std::cout << "Connecting to server..." << std::endl;
+bool Client::compressFiles(const std::vector<std::string>& filepaths, AlgorithmType algorithm) {
+    return processFiles(filepaths, MessageType::COMPRESS_REQUEST, algorithm);
+}
+
+bool Client::decompressFiles(const std::vector<std::string>& filepaths, AlgorithmType algorithm) {
+    return processFiles(filepaths, MessageType::DECOMPRESS_REQUEST, algorithm);
+}
 
-    std::string filename = FileHandler::getFileName(filepath);
-    Request request(MessageType::COMPRESS_REQUEST, algorithm, filename, fileData);
+bool Client::fetchFiles(const std::vector<std::string>& names) {
+    return processFiles(names, MessageType::FETCH_REQUEST, AlgorithmType::HUFFMAN);
+}
 
+bool Client::fetchStats(std::string& report) {
+    Request request(MessageType::STATS_REQUEST, AlgorithmType::HUFFMAN, "", {});
+    request.setChecksumEnabled(checksumEnabled);
     Response response;
-    if (!sendRequest(request, response)) {
-        std::cerr << "Failed to send compression request" << std::endl;
+    if (!sendRequest(request, response) || response.getStatus() != OperationStatus::SUCCESS) {
         return false;
     }
+    report.assign(response.getData().begin(), response.getData().end());
+    return true;
+}
 
-    if (response.getStatus() == OperationStatus::SUCCESS) {
-        std::cout << "\nCompression successful!" << std::endl;
-        std::cout << "Message: " << response.getMessage() << std::endl;
-        std::cout << "Output file: " << response.getFilename() << std::endl;
-        std::cout << "Compressed size: " << response.getData().size() << " bytes" << std::endl;
+namespace {
+const char* operationName(MessageType type) {
+    switch (type) {
+        case MessageType::COMPRESS_REQUEST: return "compression";
+        case MessageType::DECOMPRESS_REQUEST: return "decompression";
+        default: return "fetch";
+    }
+}
 
-        std::string outputPath = "./client_output/" + response.getFilename();
-        FileHandler::createDirectory("./client_output");
-        if (FileHandler::writeFile(outputPath, response.getData())) {
-            std::cout << "Compressed file saved to: " << outputPath << std::endl;
+// Stage timing summed over the responses of a run
+struct TimingTotals {
+    size_t count = 0;
+    uint64_t receive = 0, queue = 0, lookup = 0, codec = 0, save = 0, cpu = 0, total = 0;
+
+    void add(const StageTiming& timing) {
+        count++;
+        receive += timing.receiveMicros;
+        queue += timing.queueMicros;
+        lookup += timing.lookupMicros;
+        codec += timing.codecMicros;
+        save += timing.saveMicros;
+        cpu += timing.cpuMicros;
+        total += timing.totalMicros;
+    }
+
+    // The stage that took longest says what the requests were waiting on
+    const char* bottleneck() const {
+        const std::pair<uint64_t, const char*> stages[] = {
+            {receive, "network-bound (receive)"}, {queue, "queued for a worker"},
+            {lookup, "lookup"}, {codec, "CPU-bound (codec)"}, {save, "disk-bound (save)"}};
+        return std::max_element(std::begin(stages), std::end(stages))->second;
+    }
+
+    void print(const std::string& title) const {
+        std::cout << title << " (us): receive " << receive << ", queue " << queue
+                  << ", lookup " << lookup << ", codec " << codec << ", save " << save
+                  << ", total " << total << ", cpu " << cpu << std::endl;
+        std::cout << "Mostly " << bottleneck() << std::endl;
+    }
+};
+}
+
+bool Client::processFiles(const std::vector<std::string>& filepaths,
+                          MessageType type, AlgorithmType algorithm) {
+    if (batchEnabled && type != MessageType::FETCH_REQUEST) {
+        return processBatches(filepaths, type, algorithm);
+    }
+    if (jobsEnabled && type != MessageType::FETCH_REQUEST) {
+        return processJobs(filepaths, type, algorithm);
+    }
+
+    bool allSucceeded = true;
+    TimingTotals timing;
+    std::chrono::steady_clock::duration elapsed{};
+
+    // Files are read a pipeline's worth at a time to bound client memory
+    for (size_t start = 0; start < filepaths.size(); start += MAX_PIPELINED_REQUESTS) {
+        size_t end = std::min(filepaths.size(), start + MAX_PIPELINED_REQUESTS);
+
+        std::vector<Request> requests;
+        for (size_t i = start; i < end; i++) {
+            Request request;
+            if (!prepareRequest(filepaths[i], type, algorithm, request)) {
+                allSucceeded = false;
+                continue;
+            }
+            requests.push_back(std::move(request));
+        }
+        if (requests.empty()) continue;
+
+        std::vector<Response> responses;
+        const auto started = std::chrono::steady_clock::now();
+        const bool sent = sendRequests(requests, responses);
+        elapsed += std::chrono::steady_clock::now() - started;
+        if (!sent) {
+            std::cerr << "Failed to send " << operationName(type) << " request" << std::endl;
+            return false;
+        }
+
+        for (const Response& response : responses) {
+            if (!reportResponse(response, type)) allSucceeded = false;
+            if (response.hasTiming()) timing.add(response.getTiming());
         }
-        return true;
-    } else {
-        std::cerr << "\nCompression failed!" << std::endl;
-        std::cerr << "Error: " << response.getMessage() << std::endl;
-        return false;
     }
+
+    // Time outside the server is the network, sending responses and the client
+    if (timingEnabled && timing.count > 0) {
+        const auto wall = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        std::cout << "\nClient wall time: " << wall << " us for " << timing.count
+                  << (timing.count == 1 ? " request" : " requests") << std::endl;
+        if (timing.count > 1) timing.print("Server timing, all requests");
+    }
+
+    return allSucceeded;
 }
 
-bool Client::decompressFile(const std::string& filepath, AlgorithmType algorithm) {
+bool Client::processBatches(const std::vector<std::string>& filepaths,
+                            MessageType type, AlgorithmType algorithm) {
+    bool allSucceeded = true;
+    size_t next = 0;
+
+    while (next < filepaths.size()) {
+        // A batch grows until it holds CLIENT_BATCH_BYTES of member data;
+        // a single larger file still goes, as a batch of one
+        std::vector<Request> members;
+        size_t bytes = 0;
+        while (next < filepaths.size() && members.size() < MAX_BATCH_MEMBERS &&
+               bytes < CLIENT_BATCH_BYTES) {
+            Request member;
+            if (!prepareRequest(filepaths[next++], type, algorithm, member)) {
+                allSucceeded = false;
+                continue;
+            }
+            bytes += member.getData().size();
+            members.push_back(std::move(member));
+        }
+        if (members.empty()) continue;
+
+        std::vector<uint8_t> payload;
+        BatchFormat::encode(members, payload);
+        Request batch(MessageType::BATCH_REQUEST, algorithm,
+                      "batch of " + std::to_string(members.size()), std::move(payload));
+        batch.setChecksumEnabled(checksumEnabled);
+        batch.setSaveOutput(serverSaveEnabled);
+        batch.setTimingRequested(timingEnabled);
+        members.clear();
+
+        Response response;
+        if (!sendRequest(batch, response)) {
+            std::cerr << "Failed to send batch " << operationName(type) << " request" << std::endl;
+            return false;
+        }
+        std::vector<Response> results;
+        if (response.getStatus() != OperationStatus::SUCCESS ||
+            !BatchFormat::decode(response.getData().data(), response.getData().size(), results)) {
+            std::cerr << "Batch failed: " << response.getMessage() << std::endl;
+            allSucceeded = false;
+            continue;
+        }
+
+        for (const Response& result : results) {
+            if (!reportResponse(result, type)) allSucceeded = false;
+        }
+        std::cout << "\nBatch: " << response.getMessage() << std::endl;
+        if (response.hasTiming()) {
+            TimingTotals timing;
+            timing.add(response.getTiming());
+            timing.print("Server timing, whole batch");
+        }
+    }
+
+    return allSucceeded;
+}
+
+bool Client::processJobs(const std::vector<std::string>& filepaths,
+                         MessageType type, AlgorithmType algorithm) {
+    bool allSucceeded = true;
+
+    for (size_t start = 0; start < filepaths.size(); start += MAX_PIPELINED_REQUESTS) {
+        size_t end = std::min(filepaths.size(), start + MAX_PIPELINED_REQUESTS);
+
+        std::vector<Request> requests;
+        for (size_t i = start; i < end; i++) {
+            Request request;
+            if (!prepareRequest(filepaths[i], type, algorithm, request)) {
+                allSucceeded = false;
+                continue;
+            }
+            request.setStreamed(false);
+            request.setSubmitted(true);
+            requests.push_back(std::move(request));
+        }
+        if (requests.empty()) continue;
+
+        std::vector<Response> acks;
+        if (!sendRequests(requests, acks)) {
+            std::cerr << "Failed to submit " << operationName(type) << " jobs" << std::endl;
+            return false;
+        }
+        requests.clear();
+
+        std::vector<uint64_t> jobs;
+        for (const Response& ack : acks) {
+            JobFormat::Status status;
+            if (ack.getStatus() != OperationStatus::IN_PROGRESS ||
+                !JobFormat::decodeStatus(ack.getData(), status)) {
+                std::cerr << "\nSubmit failed: " << ack.getMessage() << std::endl;
+                allSucceeded = false;
+                continue;
+            }
+            std::cout << ack.getMessage() << std::endl;
+            jobs.push_back(status.id);
+        }
+
+        // A WAIT is answered when its job finishes, or with the job's
+        // progress after JOB_WAIT_MS; unfinished jobs are simply waited on again
+        while (!jobs.empty()) {
+            std::vector<Request> waits;
+            for (uint64_t id : jobs) {
+                Request wait(MessageType::WAIT_REQUEST, algorithm, "", JobFormat::encodeId(id));
+                wait.setChecksumEnabled(checksumEnabled);
+                waits.push_back(std::move(wait));
+            }
+
+            std::vector<Response> responses;
+            if (!sendRequests(waits, responses)) {
+                std::cerr << "Failed to wait for " << operationName(type) << " jobs" << std::endl;
+                return false;
+            }
+
+            std::vector<uint64_t> running;
+            for (size_t i = 0; i < responses.size(); i++) {
+                if (responses[i].getStatus() == OperationStatus::IN_PROGRESS) {
+                    std::cout << responses[i].getMessage() << std::endl;
+                    running.push_back(jobs[i]);
+                } else if (!reportResponse(responses[i], type)) {
+                    allSucceeded = false;
+                }
+            }
+            jobs.swap(running);
+        }
+    }
+
+    return allSucceeded;
+}
+
+bool Client::prepareRequest(const std::string& filepath, MessageType type,
+                            AlgorithmType algorithm, Request& request) {
+    // A fetch names a stored output and uploads nothing
+    if (type == MessageType::FETCH_REQUEST) {
+        std::cout << "Fetching: " << filepath << std::endl;
+        request = Request(type, algorithm, filepath, {});
+        request.setChecksumEnabled(checksumEnabled);
+        request.setTimingRequested(timingEnabled);
+        return true;
+    }
+
     std::cout << "Reading file: " << filepath << std::endl;
 
     std::vector<uint8_t> fileData;
@@ -123,56 +355,200 @@ bool Client::decompressFile(const std::string& filepath, AlgorithmType algorithm
     }
 
     std::cout << "File size: " << fileData.size() << " bytes" << std::endl;
-    std::cout << "Algorithm: " << algorithmTypeToString(algorithm) << std::endl;
-    std::cout << "Connecting to server..." << std::endl;
-
-    std::string filename = FileHandler::getFileName(filepath);
-    Request request(MessageType::DECOMPRESS_REQUEST, algorithm, filename, fileData);
 
-    Response response;
-    if (!sendRequest(request, response)) {
-        std::cerr << "Failed to send decompression request" << std::endl;
-        return false;
+    // Framed files carry their codec id; the server routes on it
+    FrameHeader frameHeader;
+    if (type == MessageType::DECOMPRESS_REQUEST &&
+        FrameFormat::isFramed(fileData.data(), fileData.size()) &&
+        FrameFormat::readHeader(fileData.data(), fileData.size(), frameHeader)) {
+        algorithm = frameHeader.codec;
+        std::cout << "Algorithm: " << algorithmTypeToString(algorithm)
+                  << " (from frame header)" << std::endl;
+    } else {
+        std::cout << "Algorithm: " << algorithmTypeToString(algorithm) << std::endl;
     }
 
+    // The request takes ownership of the file bytes; no second copy stays alive
+    request = Request(type, algorithm, FileHandler::getFileName(filepath), std::move(fileData));
+    request.setChecksumEnabled(checksumEnabled);
+    request.setStreamed(streamingEnabled && type == MessageType::COMPRESS_REQUEST);
+    request.setSaveOutput(serverSaveEnabled);
+    request.setTimingRequested(timingEnabled && !request.isStreamed());
+    return true;
+}
+
+bool Client::reportResponse(const Response& response, MessageType type) {
+    const std::string operation = (type == MessageType::COMPRESS_REQUEST) ? "Compression"
+                                : (type == MessageType::DECOMPRESS_REQUEST) ? "Decompression"
+                                : "Fetch";
+    const std::string label = (type == MessageType::COMPRESS_REQUEST) ? "Compressed"
+                            : (type == MessageType::DECOMPRESS_REQUEST) ? "Decompressed"
+                            : "Fetched";
+
     if (response.getStatus() == OperationStatus::SUCCESS) {
-        std::cout << "\nDecompression successful!" << std::endl;
+        std::cout << "\n" << operation << " successful!" << std::endl;
         std::cout << "Message: " << response.getMessage() << std::endl;
         std::cout << "Output file: " << response.getFilename() << std::endl;
-        std::cout << "Decompressed size: " << response.getData().size() << " bytes" << std::endl;
+        std::cout << label << " size: " << response.getData().size() << " bytes" << std::endl;
 
         std::string outputPath = "./client_output/" + response.getFilename();
         FileHandler::createDirectory("./client_output");
         if (FileHandler::writeFile(outputPath, response.getData())) {
-            std::cout << "Decompressed file saved to: " << outputPath << std::endl;
+            std::cout << label << " file saved to: " << outputPath << std::endl;
+        }
+        if (response.hasTiming()) {
+            TimingTotals timing;
+            timing.add(response.getTiming());
+            timing.print("Server timing");
         }
         return true;
     } else {
-        std::cerr << "\nDecompression failed!" << std::endl;
+        std::cerr << "\n" << operation << " failed!" << std::endl;
         std::cerr << "Error: " << response.getMessage() << std::endl;
         return false;
     }
 }
 
 bool Client::sendRequest(const Request& request, Response& response) {
-    if (!connectToServer()) {
-        return false;
+    return exchange(&request, 1, &response);
+}
+
+bool Client::sendRequests(const std::vector<Request>& requests, std::vector<Response>& responses) {
+    responses.clear();
+    responses.resize(requests.size());
+    return exchange(requests.data(), requests.size(), responses.data());
+}
+
+bool Client::exchange(const Request* requests, size_t count, Response* responses) {
+    std::vector<const Request*> pending;
+    std::vector<Response*> results;
+    for (size_t i = 0; i < count; i++) {
+        pending.push_back(&requests[i]);
+        results.push_back(&responses[i]);
     }
 
-    std::cout << "Sending request to server..." << std::endl;
+    for (int attempt = 0; ; attempt++) {
+        if (!exchangeWithReconnect(pending, results)) {
+            return false;
+        }
 
-    if (!request.serialize(clientSocket)) {
-        disconnect();
-        return false;
+        // BUSY means the server had no memory for the request right now;
+        // resend just those after an exponential, jittered back-off
+        std::vector<const Request*> busyRequests;
+        std::vector<Response*> busyResults;
+        for (size_t i = 0; i < pending.size(); i++) {
+            if (results[i]->getStatus() == OperationStatus::BUSY) {
+                busyRequests.push_back(pending[i]);
+                busyResults.push_back(results[i]);
+            }
+        }
+        if (busyRequests.empty() || attempt == CLIENT_MAX_RETRIES) {
+            return true; // anything still BUSY is reported as a failure
+        }
+
+        const int delay = CLIENT_RETRY_BASE_MS << attempt;
+        std::uniform_int_distribution<int> jitter(0, delay / 2);
+        const int wait = delay + jitter(retryRandom);
+        std::cout << "Server busy, retrying " << busyRequests.size() << " request(s) in "
+                  << wait << " ms" << std::endl;
+        Logger::warning("Server busy, retry " + std::to_string(attempt + 1) + " in " +
+                        std::to_string(wait) + " ms");
+        std::this_thread::sleep_for(std::chrono::milliseconds(wait));
+
+        pending.swap(busyRequests);
+        results.swap(busyResults);
+    }
+}
+
+bool Client::exchangeWithReconnect(const std::vector<const Request*>& requests,
+                                   const std::vector<Response*>& responses) {
+    const bool reused = (clientSocket != INVALID_SOCKET);
+    size_t received = 0;
+    if (exchangeOnce(requests, responses, 0, received)) {
+        return true;
+    }
+
+    // The server may have closed a kept-alive connection while it sat idle.
+    // Requests are idempotent, so the unanswered ones are retried once on a
+    // fresh connection. Submits are not: one whose acknowledgement was lost
+    // may already have started a job, and a resend would start a second that
+    // nobody collects.
+    const bool submits = std::any_of(requests.begin() + received, requests.end(),
+                                     [](const Request* request) {
+                                         return request->isSubmitted();
+                                     });
+    if (reused && received < requests.size() && !submits) {
+        Logger::info("Connection was closed, reconnecting");
+        size_t retried = 0;
+        return exchangeOnce(requests, responses, received, retried);
+    }
+    return false;
+}
+
+bool Client::exchangeOnce(const std::vector<const Request*>& requests,
+                          const std::vector<Response*>& responses, size_t first,
+                          size_t& received) {
+    const size_t count = requests.size() - first;
+    received = 0;
+    if (clientSocket == INVALID_SOCKET) {
+        std::cout << "Connecting to server..." << std::endl;
+        if (!connectToServer()) {
+            return false;
+        }
+    }
+
+    std::cout << "Sending " << count << (count == 1 ? " request" : " requests")
+              << " to server..." << std::endl;
+
+    // With several requests, or a streamed one whose blocks come back while
+    // it is still being sent, a sender thread keeps writing while responses
+    // are read here; writing everything first could deadlock once both
+    // sides' socket buffers fill
+    const bool sendInline = (count == 1 && !requests[first]->isStreamed());
+    std::atomic<bool> sendFailed(false);
+    auto sendAll = [&] {
+        for (size_t i = first; i < requests.size(); i++) {
+            if (!requests[i]->serialize(clientSocket)) {
+                sendFailed = true;
+                return;
+            }
+        }
+    };
+
+    std::thread sender;
+    if (sendInline) {
+        sendAll();
+    } else {
+        sender = std::thread(sendAll);
+    }
+
+    if (!(sendInline && sendFailed)) {
+        std::cout << "Waiting for response..." << std::endl;
+        while (received < count) {
+            const size_t i = first + received;
+            const bool ok = requests[i]->isStreamed()
+                ? responses[i]->deserializeStreamed(clientSocket)
+                : responses[i]->deserialize(clientSocket);
+            if (!ok) break;
+            received++;
+        }
     }
 
-    std::cout << "Waiting for response..." << std::endl;
+    if (sender.joinable()) {
+        // Unblock a sender stuck on a connection that has already failed
+        if (received < count) shutdown(clientSocket, SHUT_RDWR);
+        sender.join();
+    }
 
-    if (!response.deserialize(clientSocket)) {
+    if (received < count || sendFailed) {
+        // A reset rather than a close tells the server to drop the work
+        // it still owes us answers for
+        if (received < count) {
+            NetworkUtils::abortSocket(clientSocket);
+            clientSocket = INVALID_SOCKET;
+        }
         disconnect();
         return false;
     }
-
-    disconnect();
     return true;
 }
@@ -4,18 +4,55 @@
 #include "request.h"
 #include "response.h"
 #include <string>
+#include <vector>
+#include <random>
 
+// The connection to the server is kept open between requests and reused;
+// several requests can be pipelined on it with sendRequests().
 class Client {
 private:
     std::string serverIP;
     int serverPort;
-    int clientSocket;
+    SOCKET clientSocket;
+    bool checksumEnabled;
+    bool streamingEnabled; // compress requests are answered block by block
+    bool serverSaveEnabled; // server keeps its own copy of each output
+    bool timingEnabled;     // ask for and print the server's stage timing
+    bool batchEnabled;      // pack files into BATCH requests instead of one request each
+    bool jobsEnabled;       // submit files as background jobs, then wait for them
+    std::minstd_rand retryRandom; // jitter for BUSY back-off
     
     // Connect to server
     bool connectToServer();
     
     // Disconnect from server
     void disconnect();
+    
+    // Send count requests back to back and read their responses in order.
+    // Requests the server answers BUSY are resent after a back-off.
+    bool exchange(const Request* requests, size_t count, Response* responses);
+    bool exchangeWithReconnect(const std::vector<const Request*>& requests,
+                               const std::vector<Response*>& responses);
+    bool exchangeOnce(const std::vector<const Request*>& requests,
+                      const std::vector<Response*>& responses, size_t first,
+                      size_t& received);
+    
+    // Read files into requests, pipeline them, then report each result
+    bool processFiles(const std::vector<std::string>& filepaths,
+                      MessageType type, AlgorithmType algorithm);
+    bool prepareRequest(const std::string& filepath, MessageType type,
+                        AlgorithmType algorithm, Request& request);
+    
+    // Same, with the files packed CLIENT_BATCH_BYTES at a time into BATCH
+    // requests; each member's result is reported like a request of its own
+    bool processBatches(const std::vector<std::string>& filepaths,
+                        MessageType type, AlgorithmType algorithm);
+    bool reportResponse(const Response& response, MessageType type);
+
+    // Same, submitted as background jobs a pipeline's worth at a time; the
+    // results are collected with WAIT requests once all are accepted
+    bool processJobs(const std::vector<std::string>& filepaths,
+                     MessageType type, AlgorithmType algorithm);
 
 public:
     Client(const std::string& ip, int port);
@@ -27,8 +64,44 @@ public:
     // Send decompression request
     bool decompressFile(const std::string& filepath, AlgorithmType algorithm);
     
+    // Several files over one connection, pipelined
+    bool compressFiles(const std::vector<std::string>& filepaths, AlgorithmType algorithm);
+    bool decompressFiles(const std::vector<std::string>& filepaths, AlgorithmType algorithm);
+    
+    // Download outputs the server has already stored, by output name
+    bool fetchFiles(const std::vector<std::string>& names);
+    
+    // The server's metrics report, as text
+    bool fetchStats(std::string& report);
+    
+    // Toggle CRC32C payload checksums on outgoing requests
+    void setChecksumEnabled(bool enabled) { checksumEnabled = enabled; }
+
+    // Ask for compressed blocks to come back while the upload is still
+    // being sent, instead of one response after the whole file
+    void setStreamingEnabled(bool enabled) { streamingEnabled = enabled; }
+
+    // Whether the server also writes each output file to its own disk
+    void setServerSaveEnabled(bool enabled) { serverSaveEnabled = enabled; }
+
+    // Print where the server spent each request's time, and the totals of
+    // a batch (streamed requests are not timed)
+    void setTimingEnabled(bool enabled) { timingEnabled = enabled; }
+
+    // Send many small files as a few BATCH requests (compress and
+    // decompress); the server works on a batch's members in parallel
+    void setBatchEnabled(bool enabled) { batchEnabled = enabled; }
+
+    // Submit compress and decompress requests as background jobs and wait
+    // for their results, printing progress while they run
+    void setJobsEnabled(bool enabled) { jobsEnabled = enabled; }
+
     // Generic request sending
     bool sendRequest(const Request& request, Response& response);
+    
+    // Pipelined: every request is written before its response is awaited,
+    // and responses come back in request order
+    bool sendRequests(const std::vector<Request>& requests, std::vector<Response>& responses);
 };
 
 #endif // CLIENT_H
\ No newline at end of file
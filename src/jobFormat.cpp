@@ -0,0 +1,45 @@
+#include "jobFormat.h"
+
+namespace {
+void putU64(std::vector<uint8_t>& out, uint64_t value) {
+    for (int shift = 0; shift < 64; shift += 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+uint64_t getU64(const uint8_t* data) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) value |= static_cast<uint64_t>(data[i]) << (8 * i);
+    return value;
+}
+}
+
+std::vector<uint8_t> JobFormat::encodeId(uint64_t id) {
+    std::vector<uint8_t> out;
+    out.reserve(ID_SIZE);
+    putU64(out, id);
+    return out;
+}
+
+std::vector<uint8_t> JobFormat::encodeStatus(const Status& status) {
+    std::vector<uint8_t> out;
+    out.reserve(STATUS_SIZE);
+    putU64(out, status.id);
+    putU64(out, status.done);
+    putU64(out, status.total);
+    return out;
+}
+
+bool JobFormat::decodeId(const std::vector<uint8_t>& data, uint64_t& id) {
+    if (data.size() != ID_SIZE) return false;
+    id = getU64(data.data());
+    return true;
+}
+
+bool JobFormat::decodeStatus(const std::vector<uint8_t>& data, Status& status) {
+    if (data.size() != STATUS_SIZE) return false;
+    status.id = getU64(data.data());
+    status.done = getU64(data.data() + 8);
+    status.total = getU64(data.data() + 16);
+    return true;
+}
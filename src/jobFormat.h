@@ -0,0 +1,39 @@
+#ifndef JOB_FORMAT_H
+#define JOB_FORMAT_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Payloads of the background job messages (integers little-endian).
+//
+// A compress, decompress or batch request with PAYLOAD_FLAG_SUBMIT is run
+// as a job: it is answered at once, IN_PROGRESS with a Status. POLL, WAIT
+// and CANCEL requests carry the job's ID as their payload:
+//
+//   id:     id u64
+//   status: id u64 | done u64 | total u64
+//
+// POLL and WAIT are answered IN_PROGRESS with a Status while the job runs,
+// and with the job's own response once it has finished; that response is
+// handed out once. CANCEL is answered SUCCESS or FAILURE, without a payload.
+class JobFormat {
+public:
+    struct Status {
+        uint64_t id = 0;
+        uint64_t done = 0;      // payload bytes processed so far
+        uint64_t total = 0;     // payload bytes submitted
+    };
+
+    static constexpr size_t ID_SIZE = 8;
+    static constexpr size_t STATUS_SIZE = 3 * 8;
+
+    static std::vector<uint8_t> encodeId(uint64_t id);
+    static std::vector<uint8_t> encodeStatus(const Status& status);
+
+    // False unless the payload is exactly one of the above
+    static bool decodeId(const std::vector<uint8_t>& data, uint64_t& id);
+    static bool decodeStatus(const std::vector<uint8_t>& data, Status& status);
+};
+
+#endif // JOB_FORMAT_H
@@ -4,6 +4,7 @@
 #include "algorithmFactory.h"
 #include <iostream>
 #include <string>
+#include <vector>
 
 void printUsage(const char* programName) {
     std::cout << "Usage: " << programName << " [options]" << std::endl;
@@ -11,12 +12,26 @@ void printUsage(const char* programName) {
     std::cout << "  -h, --help              Show this help message" << std::endl;
     std::cout << "  -s, --server <IP>       Server IP address (default: " << DEFAULT_SERVER_IP << ")" << std::endl;
     std::cout << "  -p, --port <PORT>       Server port (default: " << DEFAULT_PORT << ")" << std::endl;
-    std::cout << "  -c, --compress <FILE>   Compress the specified file" << std::endl;
-    std::cout << "  -d, --decompress <FILE> Decompress the specified file" << std::endl;
+    std::cout << "  -c, --compress <FILE>...   Compress one or more files" << std::endl;
+    std::cout << "  -d, --decompress <FILE>... Decompress one or more files" << std::endl;
+    std::cout << "  -f, --fetch <NAME>...   Download outputs the server already stored" << std::endl;
+    std::cout << "                          Several files share one connection and are pipelined" << std::endl;
     std::cout << "  -a, --algorithm <ALG>   Algorithm to use (huffman|rle, default: huffman)" << std::endl;
+    std::cout << "                          Framed files are decompressed with the codec in their header" << std::endl;
+    std::cout << "  --stats                 Print the server's metrics" << std::endl;
+    std::cout << "  --no-checksum           Skip CRC32C payload checksums" << std::endl;
+    std::cout << "  --stream                Receive compressed blocks while the upload is still sent" << std::endl;
+    std::cout << "  --no-save               Ask the server not to keep its own copy of the output" << std::endl;
+    std::cout << "  --timing                Show where the server spent each request's time" << std::endl;
+    std::cout << "  --batch                 Send many small files in a few BATCH requests" << std::endl;
+    std::cout << "  --submit                Run as background jobs on the server and wait for them" << std::endl;
     std::cout << "\nExamples:" << std::endl;
     std::cout << "  " << programName << " -c myfile.txt" << std::endl;
-    std::cout << "  " << programName << " -d myfile.compressed -a huffman" << std::endl;
+    std::cout << "  " << programName << " -d myfile.compressed" << std::endl;
+    std::cout << "  " << programName << " -a rle -c a.txt b.txt c.txt" << std::endl;
+    std::cout << "  " << programName << " --batch -c configs/*.conf" << std::endl;
+    std::cout << "  " << programName << " --submit -c backup.tar" << std::endl;
+    std::cout << "  " << programName << " -f myfile_Huffman.compressed" << std::endl;
     std::cout << "  " << programName << " -s 192.168.1.100 -p 8080 -c document.pdf" << std::endl;
 }
 
@@ -82,9 +97,15 @@ int main(int argc, char* argv[]) {
     // Default values
     std::string serverIP = DEFAULT_SERVER_IP;
     int port = DEFAULT_PORT;
-    std::string filepath;
-    std::string operation; // "compress" or "decompress"
+    std::vector<std::string> filepaths;
+    std::string operation; // "compress", "decompress" or "fetch"
     AlgorithmType algorithm = AlgorithmType::HUFFMAN;
+    bool checksumEnabled = true;
+    bool streamingEnabled = false;
+    bool serverSaveEnabled = true;
+    bool timingEnabled = false;
+    bool batchEnabled = false;
+    bool jobsEnabled = false;
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -101,40 +122,72 @@ int main(int argc, char* argv[]) {
             if (i + 1 < argc) {
                 port = std::stoi(argv[++i]);
             }
-        } else if (arg == "-c" || arg == "--compress") {
-            if (i + 1 < argc) {
-                operation = "compress";
-                filepath = argv[++i];
-            }
-        } else if (arg == "-d" || arg == "--decompress") {
-            if (i + 1 < argc) {
-                operation = "decompress";
-                filepath = argv[++i];
+        } else if (arg == "-c" || arg == "--compress" || arg == "-d" || arg == "--decompress" ||
+                   arg == "-f" || arg == "--fetch") {
+            operation = (arg == "-c" || arg == "--compress") ? "compress"
+                      : (arg == "-d" || arg == "--decompress") ? "decompress" : "fetch";
+            // Every following argument up to the next option is a file
+            while (i + 1 < argc && argv[i + 1][0] != '-') {
+                filepaths.push_back(argv[++i]);
             }
         } else if (arg == "-a" || arg == "--algorithm") {
             if (i + 1 < argc) {
                 algorithm = AlgorithmFactory::getAlgorithmType(argv[++i]);
             }
+        } else if (arg == "--stats") {
+            operation = "stats";
+        } else if (arg == "--no-checksum") {
+            checksumEnabled = false;
+        } else if (arg == "--stream") {
+            streamingEnabled = true;
+        } else if (arg == "--no-save") {
+            serverSaveEnabled = false;
+        } else if (arg == "--timing") {
+            timingEnabled = true;
+        } else if (arg == "--batch") {
+            batchEnabled = true;
+        } else if (arg == "--submit") {
+            jobsEnabled = true;
         }
     }
     
     // Create client
     Client client(serverIP, port);
+    client.setChecksumEnabled(checksumEnabled);
+    client.setStreamingEnabled(streamingEnabled);
+    client.setServerSaveEnabled(serverSaveEnabled);
+    client.setTimingEnabled(timingEnabled);
+    client.setBatchEnabled(batchEnabled);
+    client.setJobsEnabled(jobsEnabled);
     
     std::cout << "Server: " << serverIP << ":" << port << std::endl;
     std::cout << std::endl;
     
+    if (operation == "stats") {
+        std::string report;
+        const bool success = client.fetchStats(report);
+        if (success) {
+            std::cout << report;
+        } else {
+            std::cerr << "Failed to read server statistics" << std::endl;
+        }
+        Logger::close();
+        return success ? 0 : 1;
+    }
+    
     // If no operation specified, enter interactive mode
-    if (operation.empty()) {
+    if (operation.empty() || filepaths.empty()) {
         interactiveMode(client);
     } else {
         // Execute command line operation
         bool success = false;
         
         if (operation == "compress") {
-            success = client.compressFile(filepath, algorithm);
+            success = client.compressFiles(filepaths, algorithm);
         } else if (operation == "decompress") {
-            success = client.decompressFile(filepath, algorithm);
+            success = client.decompressFiles(filepaths, algorithm);
+        } else if (operation == "fetch") {
+            success = client.fetchFiles(filepaths);
         }
         
         Logger::close();
@@ -1,41 +1,70 @@
 #include "request.h"
 #include "networkUtils.h"
 #include "logger.h"
+#include "bufferPool.h"
+#include "config.h"
 #include <iostream>
+#include <algorithm>
 
 Request::Request() 
     : messageType(MessageType::COMPRESS_REQUEST),
       algorithmType(AlgorithmType::HUFFMAN),
       filename(""),
-      data() {}
+      data(),
+      checksumEnabled(true),
+      streamed(false),
+      saveOutput(true),
+      timingRequested(false),
+      submitted(false),
+      incomingSize(0) {}
 
 Request::Request(MessageType msgType, AlgorithmType algoType, 
-                const std::string& fname, const std::vector<uint8_t>& fileData)
+                std::string fname, std::vector<uint8_t>&& fileData)
     : messageType(msgType),
       algorithmType(algoType),
-      filename(fname),
-      data(fileData) {}
+      filename(std::move(fname)),
+      data(std::move(fileData)),
+      checksumEnabled(true),
+      streamed(false),
+      saveOutput(true),
+      timingRequested(false),
+      submitted(false),
+      incomingSize(0) {}
 
-bool Request::serialize(SOCKET sock) const {
+void Request::encodeHead(std::vector<uint8_t>& out) const {
     MessageHeader header{};
     header.type = messageType;
     header.algorithm = algorithmType;
+    header.flags = (checksumEnabled ? PAYLOAD_FLAG_CHECKSUM : 0) |
+                   (streamed ? PAYLOAD_FLAG_STREAM : 0) |
+                   (saveOutput ? 0 : PAYLOAD_FLAG_NO_SAVE) |
+                   (timingRequested ? PAYLOAD_FLAG_TIMING : 0) |
+                   (submitted ? PAYLOAD_FLAG_SUBMIT : 0);
     header.dataSize = static_cast<uint32_t>(data.size());
     header.fileNameLength = static_cast<uint32_t>(filename.size());
 
-    if (!NetworkUtils::sendData(sock, &header, sizeof(header))) {
+    const uint8_t* headerBytes = reinterpret_cast<const uint8_t*>(&header);
+    out.insert(out.end(), headerBytes, headerBytes + sizeof(header));
+    out.insert(out.end(), filename.begin(), filename.end());
+}
+
+bool Request::serialize(SOCKET sock) const {
+    // Header and filename go out in one send
+    std::vector<uint8_t> head;
+    encodeHead(head);
+    if (!NetworkUtils::sendData(sock, head.data(), head.size())) {
         Logger::error("Failed to send request header");
         return false;
     }
 
-    if (!filename.empty()) {
-        if (!NetworkUtils::sendData(sock, filename.data(), filename.size())) {
-            Logger::error("Failed to send filename");
+    if (checksumEnabled) {
+        uint32_t crc = 0;
+        if (!NetworkUtils::sendDataWithChecksum(sock, data.data(), data.size(), crc) ||
+            !NetworkUtils::sendData(sock, &crc, sizeof(crc))) {
+            Logger::error("Failed to send file data");
             return false;
         }
-    }
-
-    if (!data.empty()) {
+    } else if (!data.empty()) {
         if (!NetworkUtils::sendData(sock, data.data(), data.size())) {
             Logger::error("Failed to send file data");
             return false;
@@ -49,38 +78,96 @@ bool Request::serialize(SOCKET sock) const {
 }
 
 bool Request::deserialize(SOCKET sock) {
+    if (!receiveHead(sock)) {
+        return false;
+    }
+    if (incomingSize > MAX_REQUEST_SIZE) {
+        Logger::error("Request payload of " + std::to_string(incomingSize) +
+                      " bytes exceeds the limit");
+        return false;
+    }
+    return receivePayload(sock);
+}
+
+bool Request::receiveHead(SOCKET sock) {
     MessageHeader header{};
     if (!NetworkUtils::receiveData(sock, &header, sizeof(header))) {
         Logger::error("Failed to receive request header");
         return false;
     }
 
+    // Lengths come from the peer; check them before sizing anything
+    if (header.fileNameLength > MAX_FILENAME_LENGTH) {
+        Logger::error("Request filename length " + std::to_string(header.fileNameLength) +
+                      " out of range");
+        return false;
+    }
+
     messageType = header.type;
     algorithmType = header.algorithm;
+    checksumEnabled = (header.flags & PAYLOAD_FLAG_CHECKSUM) != 0;
+    streamed = (header.flags & PAYLOAD_FLAG_STREAM) != 0;
+    saveOutput = (header.flags & PAYLOAD_FLAG_NO_SAVE) == 0;
+    timingRequested = (header.flags & PAYLOAD_FLAG_TIMING) != 0;
+    submitted = (header.flags & PAYLOAD_FLAG_SUBMIT) != 0;
+    incomingSize = header.dataSize;
+    receiveStarted = std::chrono::steady_clock::now();
 
-    if (header.fileNameLength > 0) {
-        std::vector<char> buf(header.fileNameLength);
-        if (!NetworkUtils::receiveData(sock, buf.data(), header.fileNameLength)) {
-            Logger::error("Failed to receive filename");
-            return false;
-        }
-        filename.assign(buf.begin(), buf.end());
+    filename.resize(header.fileNameLength);
+    if (header.fileNameLength > 0 &&
+        !NetworkUtils::receiveData(sock, filename.data(), header.fileNameLength)) {
+        Logger::error("Failed to receive filename");
+        return false;
     }
+    return true;
+}
 
-    if (header.dataSize > 0) {
-        data.resize(header.dataSize);
-        if (!NetworkUtils::receiveData(sock, data.data(), header.dataSize)) {
+bool Request::receivePayload(SOCKET sock) {
+    // Pooled buffer: recycled memory is handed back without zero-filling
+    BufferPool::instance().release(std::move(data));
+    data = BufferPool::instance().acquire(incomingSize);
+
+    if (checksumEnabled) {
+        uint32_t crc = 0;
+        uint32_t expected = 0;
+        if (!NetworkUtils::receiveDataWithChecksum(sock, data.data(), incomingSize, crc) ||
+            !NetworkUtils::receiveData(sock, &expected, sizeof(expected))) {
+            Logger::error("Failed to receive file data");
+            return false;
+        }
+        if (crc != expected) {
+            Logger::error("Request payload checksum mismatch");
+            return false;
+        }
+    } else if (incomingSize > 0) {
+        if (!NetworkUtils::receiveData(sock, data.data(), incomingSize)) {
             Logger::error("Failed to receive file data");
             return false;
         }
     }
 
+    receiveFinished = std::chrono::steady_clock::now();
     Logger::info("Request received: " + messageTypeToString(messageType) +
                  ", Algorithm: " + algorithmTypeToString(algorithmType) +
                  ", File: " + filename + ", Size: " + std::to_string(data.size()));
     return true;
 }
 
+bool Request::skipPayload(SOCKET sock) {
+    // Read through a small buffer so a refused request costs no memory
+    uint64_t remaining = incomingSize + (checksumEnabled ? sizeof(uint32_t) : 0);
+    uint8_t scratch[MAX_BUFFER_SIZE];
+    while (remaining > 0) {
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(remaining, sizeof(scratch)));
+        if (!NetworkUtils::receiveData(sock, scratch, chunk)) {
+            Logger::error("Failed to skip refused payload");
+            return false;
+        }
+        remaining -= chunk;
+    }
+    return true;
+}
+
 void Request::print() const {
     std::cout << "=== Request Details ===\n"
               << "Message Type: " << messageTypeToString(messageType) << "\n"
@@ -2,9 +2,14 @@
 #define REQUEST_H
 
 #include "messageTypes.h"
+#include "memoryBudget.h"
 #include <vector>
 #include <string>
-#include <winsock2.h> // SOCKET
+#include <utility>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include "socketCompat.h" // SOCKET
 
 // Encapsulates a client request
 class Request {
@@ -13,27 +18,91 @@ private:
     AlgorithmType algorithmType;
     std::string filename;
     std::vector<uint8_t> data;
+    bool checksumEnabled; // send a CRC32C trailer after the data
+    bool streamed;        // ask for the result block by block (compress only)
+    bool saveOutput;      // server writes the result under its output directory
+    bool timingRequested; // ask for the server's stage timing in the response
+    bool submitted;       // run as a background job (see src/jobFormat.h)
+    uint32_t incomingSize; // payload announced by a received head
+
+    // Server side only: when the head arrived and the payload was complete
+    std::chrono::steady_clock::time_point receiveStarted;
+    std::chrono::steady_clock::time_point receiveFinished;
+
+    // Server side only: raised once nobody is waiting for the answer any more
+    std::shared_ptr<const std::atomic<bool>> cancelFlag;
+
+    // Server side only: the budget paid to admit the payload, for a submit
+    // to hand on to its job
+    MemoryBudget::Hold admission;
 
 public:
     Request();
     Request(MessageType msgType, AlgorithmType algoType, 
-            const std::string& fname, const std::vector<uint8_t>& fileData);
+            std::string fname, std::vector<uint8_t>&& fileData);
+
+    // Requests own their payload, so they move but never copy
+    Request(const Request&) = delete;
+    Request& operator=(const Request&) = delete;
+    Request(Request&&) noexcept = default;
+    Request& operator=(Request&&) noexcept = default;
     
     // Getters
     MessageType getMessageType() const { return messageType; }
     AlgorithmType getAlgorithmType() const { return algorithmType; }
-    std::string getFilename() const { return filename; }
+    const std::string& getFilename() const { return filename; }
     const std::vector<uint8_t>& getData() const { return data; }
+    bool isChecksumEnabled() const { return checksumEnabled; }
+    bool isStreamed() const { return streamed; }
+    bool isSaveOutput() const { return saveOutput; }
+    bool isTimingRequested() const { return timingRequested; }
+    bool isSubmitted() const { return submitted; }
+    std::chrono::steady_clock::time_point getReceiveStarted() const { return receiveStarted; }
+    std::chrono::steady_clock::time_point getReceiveFinished() const { return receiveFinished; }
+    const std::shared_ptr<const std::atomic<bool>>& getCancelFlag() const { return cancelFlag; }
+    bool isCancelled() const {
+        return cancelFlag && cancelFlag->load(std::memory_order_relaxed);
+    }
+
+    // Hand the payload to the caller, leaving the request empty
+    std::vector<uint8_t> takeData() { return std::move(data); }
     
     // Setters
     void setMessageType(MessageType type) { messageType = type; }
     void setAlgorithmType(AlgorithmType type) { algorithmType = type; }
-    void setFilename(const std::string& fname) { filename = fname; }
-    void setData(const std::vector<uint8_t>& fileData) { data = fileData; }
+    void setFilename(std::string fname) { filename = std::move(fname); }
+    void setData(std::vector<uint8_t>&& fileData) { data = std::move(fileData); }
+    void setChecksumEnabled(bool enabled) { checksumEnabled = enabled; }
+    void setStreamed(bool enabled) { streamed = enabled; }
+    void setSaveOutput(bool enabled) { saveOutput = enabled; }
+    void setTimingRequested(bool enabled) { timingRequested = enabled; }
+    void setSubmitted(bool enabled) { submitted = enabled; }
+    void setReceiveTimes(std::chrono::steady_clock::time_point started,
+                         std::chrono::steady_clock::time_point finished) {
+        receiveStarted = started;
+        receiveFinished = finished;
+    }
+    void setCancelFlag(std::shared_ptr<const std::atomic<bool>> flag) {
+        cancelFlag = std::move(flag);
+    }
+    void setAdmission(MemoryBudget::Hold&& hold) { admission = std::move(hold); }
+    MemoryBudget::Hold takeAdmission() { return std::move(admission); }
     
     // Serialization
     bool serialize(SOCKET sock) const;
     bool deserialize(SOCKET sock);
+
+    // deserialize() in two steps, so a server can decide whether to take
+    // the payload before allocating it. receiveHead() reads the header and
+    // filename; then either receivePayload() or skipPayload() must follow.
+    bool receiveHead(SOCKET sock);
+    bool receivePayload(SOCKET sock);
+    bool skipPayload(SOCKET sock);
+    uint32_t getIncomingSize() const { return incomingSize; }
+
+    // Append the wire header and strings that precede the payload, for
+    // callers that write to non-blocking sockets themselves
+    void encodeHead(std::vector<uint8_t>& out) const;
     
     // Display request info
     void print() const;
@@ -1,44 +1,124 @@
 #include "response.h"
 #include "networkUtils.h"
 #include "logger.h"
+#include "bufferPool.h"
+#include "frameFormat.h"
 #include <iostream>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+FileBody::FileBody(FileBody&& other) noexcept
+    : descriptor(other.descriptor), size(other.size) {
+    other.descriptor = -1;
+    other.size = 0;
+}
+
+FileBody& FileBody::operator=(FileBody&& other) noexcept {
+    if (this != &other) {
+        close();
+        descriptor = other.descriptor;
+        size = other.size;
+        other.descriptor = -1;
+        other.size = 0;
+    }
+    return *this;
+}
+
+void FileBody::close() {
+    if (descriptor >= 0) {
+#ifdef _WIN32
+        _close(descriptor);
+#else
+        ::close(descriptor);
+#endif
+    }
+    descriptor = -1;
+    size = 0;
+}
+
+FileBody FileBody::open(const std::string& path) {
+    FileBody body;
+#ifdef _WIN32
+    body.descriptor = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+    struct _stat64 info;
+    const bool found = body.descriptor >= 0 && _fstat64(body.descriptor, &info) == 0;
+#else
+    body.descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    const bool found = body.descriptor >= 0 && fstat(body.descriptor, &info) == 0;
+#endif
+    if (!found || (info.st_mode & S_IFMT) != S_IFREG) {
+        body.close();
+        return body;
+    }
+    body.size = static_cast<uint64_t>(info.st_size);
+    return body;
+}
 
 Response::Response()
-    : status(OperationStatus::SUCCESS), filename(""), message(""), data() {}
+    : status(OperationStatus::SUCCESS), filename(""), message(""), data(),
+      checksumEnabled(true), timingEnabled(false) {}
 
-Response::Response(OperationStatus stat, const std::string& fname,
-                  const std::string& msg, const std::vector<uint8_t>& fileData)
-    : status(stat), filename(fname), message(msg), data(fileData) {}
+Response::Response(OperationStatus stat, std::string fname,
+                  std::string msg, std::vector<uint8_t>&& fileData)
+    : status(stat), filename(std::move(fname)), message(std::move(msg)),
+      data(std::move(fileData)),
+      checksumEnabled(true),
+      timingEnabled(false) {}
 
-bool Response::serialize(SOCKET sock) const {
+void Response::encodeHead(std::vector<uint8_t>& out) const {
     ResponseHeader header{};
     header.status = status;
-    header.dataSize = static_cast<uint32_t>(data.size());
+    header.flags = (isChecksumEnabled() ? PAYLOAD_FLAG_CHECKSUM : 0) |
+                   (timingEnabled ? PAYLOAD_FLAG_TIMING : 0);
+    header.dataSize = static_cast<uint32_t>(getPayloadSize());
     header.fileNameLength = static_cast<uint32_t>(filename.size());
     header.messageLength = static_cast<uint32_t>(message.size());
 
-    if (!NetworkUtils::sendData(sock, &header, sizeof(header))) {
-        Logger::error("Failed to send response header");
-        return false;
-    }
-
-    if (!filename.empty() && !NetworkUtils::sendData(sock, filename.data(), filename.size())) {
-        Logger::error("Failed to send filename");
-        return false;
+    const uint8_t* headerBytes = reinterpret_cast<const uint8_t*>(&header);
+    out.insert(out.end(), headerBytes, headerBytes + sizeof(header));
+    out.insert(out.end(), filename.begin(), filename.end());
+    out.insert(out.end(), message.begin(), message.end());
+    if (timingEnabled) {
+        const uint8_t* timingBytes = reinterpret_cast<const uint8_t*>(&timing);
+        out.insert(out.end(), timingBytes, timingBytes + sizeof(timing));
     }
+}
 
-    if (!message.empty() && !NetworkUtils::sendData(sock, message.data(), message.size())) {
-        Logger::error("Failed to send message");
+bool Response::serialize(SOCKET sock) const {
+    // Header, filename and message go out in one send
+    std::vector<uint8_t> head;
+    encodeHead(head);
+    if (!NetworkUtils::sendData(sock, head.data(), head.size())) {
+        Logger::error("Failed to send response header");
         return false;
     }
 
-    if (!data.empty() && !NetworkUtils::sendData(sock, data.data(), data.size())) {
+    if (file.isOpen()) {
+        if (!NetworkUtils::sendFile(sock, file.getDescriptor(), file.getSize())) {
+            Logger::error("Failed to send file data");
+            return false;
+        }
+    } else if (checksumEnabled) {
+        uint32_t crc = 0;
+        if (!NetworkUtils::sendDataWithChecksum(sock, data.data(), data.size(), crc) ||
+            !NetworkUtils::sendData(sock, &crc, sizeof(crc))) {
+            Logger::error("Failed to send file data");
+            return false;
+        }
+    } else if (!data.empty() && !NetworkUtils::sendData(sock, data.data(), data.size())) {
         Logger::error("Failed to send file data");
         return false;
     }
 
     Logger::info("Response sent: Status=" + operationStatusToString(status) +
-                 ", File=" + filename + ", Size=" + std::to_string(data.size()));
+                 ", File=" + filename + ", Size=" + std::to_string(getPayloadSize()));
     return true;
 }
 
@@ -50,21 +130,34 @@ bool Response::deserialize(SOCKET sock) {
     }
 
     status = header.status;
+    file = FileBody();
 
-    if (header.fileNameLength > 0) {
-        std::vector<char> buf(header.fileNameLength);
-        if (!NetworkUtils::receiveData(sock, buf.data(), header.fileNameLength)) return false;
-        filename.assign(buf.begin(), buf.end());
-    }
+    filename.resize(header.fileNameLength);
+    if (header.fileNameLength > 0 &&
+        !NetworkUtils::receiveData(sock, filename.data(), header.fileNameLength)) return false;
 
-    if (header.messageLength > 0) {
-        std::vector<char> buf(header.messageLength);
-        if (!NetworkUtils::receiveData(sock, buf.data(), header.messageLength)) return false;
-        message.assign(buf.begin(), buf.end());
-    }
+    message.resize(header.messageLength);
+    if (header.messageLength > 0 &&
+        !NetworkUtils::receiveData(sock, message.data(), header.messageLength)) return false;
+
+    timingEnabled = (header.flags & PAYLOAD_FLAG_TIMING) != 0;
+    timing = StageTiming();
+    if (timingEnabled && !NetworkUtils::receiveData(sock, &timing, sizeof(timing))) return false;
 
-    if (header.dataSize > 0) {
-        data.resize(header.dataSize);
+    checksumEnabled = (header.flags & PAYLOAD_FLAG_CHECKSUM) != 0;
+    BufferPool::instance().release(std::move(data));
+    data = BufferPool::instance().acquire(header.dataSize);
+
+    if (checksumEnabled) {
+        uint32_t crc = 0;
+        uint32_t expected = 0;
+        if (!NetworkUtils::receiveDataWithChecksum(sock, data.data(), header.dataSize, crc) ||
+            !NetworkUtils::receiveData(sock, &expected, sizeof(expected))) return false;
+        if (crc != expected) {
+            Logger::error("Response payload checksum mismatch");
+            return false;
+        }
+    } else if (header.dataSize > 0) {
         if (!NetworkUtils::receiveData(sock, data.data(), header.dataSize)) return false;
     }
 
@@ -73,11 +166,46 @@ bool Response::deserialize(SOCKET sock) {
     return true;
 }
 
+bool Response::deserializeStreamed(SOCKET sock) {
+    // Blocks are appended behind room left for the header, which arrives last
+    std::vector<uint8_t> frame;
+    bool chunked = false;
+    while (true) {
+        if (!deserialize(sock)) {
+            BufferPool::instance().release(std::move(frame));
+            return false;
+        }
+        if (status != OperationStatus::IN_PROGRESS) break;
+        if (!chunked) {
+            frame.resize(FrameFormat::HEADER_SIZE);
+            chunked = true;
+        }
+        frame.insert(frame.end(), data.begin(), data.end());
+    }
+
+    // Answered in one piece, or failed part way through
+    if (!chunked || status != OperationStatus::SUCCESS) {
+        BufferPool::instance().release(std::move(frame));
+        return true;
+    }
+
+    if (data.size() < FrameFormat::HEADER_SIZE) {
+        Logger::error("Streamed response ended without a frame header");
+        BufferPool::instance().release(std::move(frame));
+        return false;
+    }
+    std::memcpy(frame.data(), data.data(), FrameFormat::HEADER_SIZE);
+    frame.insert(frame.end(), data.begin() + FrameFormat::HEADER_SIZE, data.end());
+    BufferPool::instance().release(std::move(data));
+    data = std::move(frame);
+    return true;
+}
+
 void Response::print() const {
     std::cout << "=== Response Details ===\n"
               << "Status: " << operationStatusToString(status) << "\n"
               << "Filename: " << filename << "\n"
               << "Message: " << message << "\n"
-              << "Data Size: " << data.size() << " bytes\n"
+              << "Data Size: " << getPayloadSize() << " bytes\n"
               << "========================\n";
 }
@@ -4,7 +4,36 @@
 #include "messageTypes.h"
 #include <vector>
 #include <string>
-#include <winsock2.h> // SOCKET
+#include <utility>
+#include "socketCompat.h" // SOCKET
+#include "memoryBudget.h"
+
+// An open file whose contents are a response payload. It is sent straight
+// from the page cache (sendfile) and never copied into user space; the file
+// is closed with its owner.
+class FileBody {
+private:
+    int descriptor;
+    uint64_t size;
+
+    void close();
+
+public:
+    FileBody() : descriptor(-1), size(0) {}
+    ~FileBody() { close(); }
+
+    FileBody(FileBody&& other) noexcept;
+    FileBody& operator=(FileBody&& other) noexcept;
+    FileBody(const FileBody&) = delete;
+    FileBody& operator=(const FileBody&) = delete;
+
+    // Open path read-only; the result is closed unless it is a regular file
+    static FileBody open(const std::string& path);
+
+    bool isOpen() const { return descriptor >= 0; }
+    int getDescriptor() const { return descriptor; }
+    uint64_t getSize() const { return size; }
+};
 
 class Response {
 private:
@@ -12,28 +41,66 @@ private:
     std::string filename;
     std::string message;
     std::vector<uint8_t> data;
+    FileBody file;        // sent instead of data when open
+    MemoryBudget::Hold hold; // budget for data beyond what the request paid
+    bool checksumEnabled; // send a CRC32C trailer after the data
+    bool timingEnabled;   // timing goes out after the message
+    StageTiming timing;
 
 public:
     Response();
-    Response(OperationStatus stat, const std::string& fname,
-            const std::string& msg, const std::vector<uint8_t>& fileData);
+    Response(OperationStatus stat, std::string fname,
+            std::string msg, std::vector<uint8_t>&& fileData);
+
+    // Responses own their payload, so they move but never copy
+    Response(const Response&) = delete;
+    Response& operator=(const Response&) = delete;
+    Response(Response&&) noexcept = default;
+    Response& operator=(Response&&) noexcept = default;
 
     // Getters
     OperationStatus getStatus() const { return status; }
-    std::string getFilename() const { return filename; }
-    std::string getMessage() const { return message; }
+    const std::string& getFilename() const { return filename; }
+    const std::string& getMessage() const { return message; }
     const std::vector<uint8_t>& getData() const { return data; }
+    const FileBody& getFile() const { return file; }
+    uint64_t getPayloadSize() const { return file.isOpen() ? file.getSize() : data.size(); }
+    bool hasTiming() const { return timingEnabled; }
+    const StageTiming& getTiming() const { return timing; }
+
+    // A file payload is sent without the trailer: its CRC would need the
+    // bytes in user space. Framed outputs carry their own content CRC.
+    bool isChecksumEnabled() const { return checksumEnabled && !file.isOpen(); }
+
+    // Hand the payload to the caller, leaving the response empty
+    std::vector<uint8_t> takeData() { return std::move(data); }
+    FileBody takeFile() { return std::move(file); }
+    MemoryBudget::Hold takeHold() { return std::move(hold); }
 
     // Setters
     void setStatus(OperationStatus stat) { status = stat; }
-    void setFilename(const std::string& fname) { filename = fname; }
-    void setMessage(const std::string& msg) { message = msg; }
-    void setData(const std::vector<uint8_t>& fileData) { data = fileData; }
+    void setFilename(std::string fname) { filename = std::move(fname); }
+    void setMessage(std::string msg) { message = std::move(msg); }
+    void setData(std::vector<uint8_t>&& fileData) { data = std::move(fileData); }
+    void setFile(FileBody&& body) { file = std::move(body); }
+    void addHold(MemoryBudget::Hold&& more) { hold.absorb(std::move(more)); }
+    void setTiming(const StageTiming& stages) { timing = stages; timingEnabled = true; }
+    void setChecksumEnabled(bool enabled) { checksumEnabled = enabled; }
 
     // Serialization
     bool serialize(SOCKET sock) const;
     bool deserialize(SOCKET sock);
 
+    // Read the reply to a streamed compress request: IN_PROGRESS chunks,
+    // one frame block each, then the final response whose data holds the
+    // frame header and trailer. The data ends up as the whole frame. A
+    // server that answered in one piece is read the same way.
+    bool deserializeStreamed(SOCKET sock);
+
+    // Append the wire header and strings that precede the payload, for
+    // callers that write to non-blocking sockets themselves
+    void encodeHead(std::vector<uint8_t>& out) const;
+
     // Display response info
     void print() const;
 };
@@ -0,0 +1,166 @@
+#include "batchFormat.h"
+#include "workerthread.h"
+#include "threadPool.h"
+#include "frameFormat.h"
+#include "logger.h"
+#include "config.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+
+static std::vector<uint8_t> textFile(size_t index) {
+    std::string text;
+    for (size_t line = 0; line < 20 + index % 30; line++) {
+        text += "option_" + std::to_string(line) + " = value " + std::to_string(index) + "\n";
+    }
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+void testManifestRoundTrip() {
+    std::cout << "\n=== Test: Manifest Round Trip ===" << std::endl;
+
+    std::vector<Request> members;
+    members.emplace_back(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "a.conf",
+                         textFile(1));
+    members.emplace_back(MessageType::DECOMPRESS_REQUEST, AlgorithmType::RLE, "b.compressed",
+                         std::vector<uint8_t>{1, 2, 3});
+    members.emplace_back(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "empty",
+                         std::vector<uint8_t>());
+
+    std::vector<uint8_t> payload;
+    BatchFormat::encode(members, payload);
+    std::vector<Request> decoded;
+    assert(BatchFormat::decode(payload.data(), payload.size(), AlgorithmType::HUFFMAN, decoded));
+    assert(decoded.size() == 3);
+    for (size_t i = 0; i < 3; i++) {
+        assert(decoded[i].getMessageType() == members[i].getMessageType());
+        assert(decoded[i].getAlgorithmType() == AlgorithmType::HUFFMAN && "The batch's codec");
+        assert(decoded[i].getFilename() == members[i].getFilename());
+        assert(decoded[i].getData() == members[i].getData());
+    }
+
+    std::vector<Response> results;
+    results.emplace_back(OperationStatus::SUCCESS, "a_RLE.compressed", "done", textFile(2));
+    results.emplace_back(OperationStatus::FAILURE, "", "Invalid input", std::vector<uint8_t>());
+    std::vector<uint8_t> encoded;
+    BatchFormat::encode(results, encoded);
+    assert(encoded.size() == BatchFormat::encodedSize(results));
+    std::vector<Response> back;
+    assert(BatchFormat::decode(encoded.data(), encoded.size(), back));
+    assert(back.size() == 2);
+    assert(back[0].getStatus() == OperationStatus::SUCCESS && back[0].getData() == textFile(2));
+    assert(back[1].getStatus() == OperationStatus::FAILURE &&
+           back[1].getMessage() == "Invalid input");
+
+    std::cout << "✓ Requests and results survive encode/decode" << std::endl;
+}
+
+void testMalformedManifestRejected() {
+    std::cout << "\n=== Test: Malformed Manifest Rejected ===" << std::endl;
+
+    std::vector<Request> members;
+    members.emplace_back(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "a", textFile(3));
+    members.emplace_back(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "b", textFile(4));
+    std::vector<uint8_t> payload;
+    BatchFormat::encode(members, payload);
+
+    std::vector<Request> decoded;
+    for (size_t length = 0; length < payload.size(); length++) {
+        assert(!BatchFormat::decode(payload.data(), length, AlgorithmType::RLE, decoded));
+    }
+    std::vector<uint8_t> trailing = payload;
+    trailing.push_back(0);
+    assert(!BatchFormat::decode(trailing.data(), trailing.size(), AlgorithmType::RLE, decoded));
+
+    // Only compress and decompress requests may be members
+    std::vector<uint8_t> fetch = payload;
+    fetch[4] = static_cast<uint8_t>(MessageType::FETCH_REQUEST);
+    assert(!BatchFormat::decode(fetch.data(), fetch.size(), AlgorithmType::RLE, decoded));
+
+    // A member count past the limit is refused before anything is allocated
+    std::vector<uint8_t> huge = {0xFF, 0xFF, 0xFF, 0xFF};
+    assert(!BatchFormat::decode(huge.data(), huge.size(), AlgorithmType::RLE, decoded));
+
+    std::cout << "✓ Truncated, padded and foreign manifests fail" << std::endl;
+}
+
+void testWorkerProcessesBatch() {
+    std::cout << "\n=== Test: Worker Processes Batch ===" << std::endl;
+
+    // Mostly small config files, one framed file to decompress and one
+    // member that cannot be decompressed
+    const size_t count = 300;
+    std::vector<uint8_t> framed;
+    assert(FrameFormat::compress(AlgorithmType::HUFFMAN, textFile(999), framed));
+
+    std::vector<Request> members;
+    for (size_t i = 0; i < count; i++) {
+        members.emplace_back(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN,
+                             "file" + std::to_string(i) + ".conf", textFile(i));
+    }
+    members.emplace_back(MessageType::DECOMPRESS_REQUEST, AlgorithmType::HUFFMAN,
+                         "framed.compressed", std::vector<uint8_t>(framed));
+    members.emplace_back(MessageType::DECOMPRESS_REQUEST, AlgorithmType::HUFFMAN,
+                         "garbage.compressed", std::vector<uint8_t>{9, 9, 9});
+
+    std::vector<uint8_t> payload;
+    BatchFormat::encode(members, payload);
+    Request batch(MessageType::BATCH_REQUEST, AlgorithmType::HUFFMAN, "batch",
+                  std::move(payload));
+    batch.setSaveOutput(false);
+
+    ThreadPool pool(4);
+    WorkerThread worker(INVALID_SOCKET, &pool);
+    Response response = worker.handleRequest(batch);
+    assert(response.getStatus() == OperationStatus::SUCCESS);
+    assert(response.getMessage() == std::to_string(count + 1) + " of " +
+                                    std::to_string(count + 2) + " members succeeded");
+
+    std::vector<Response> results;
+    assert(BatchFormat::decode(response.getData().data(), response.getData().size(), results));
+    assert(results.size() == count + 2);
+    for (size_t i = 0; i < count; i++) {
+        assert(results[i].getStatus() == OperationStatus::SUCCESS);
+        assert(results[i].getFilename().find("file" + std::to_string(i)) == 0 && "In order");
+        std::vector<uint8_t> original;
+        assert(FrameFormat::decompress(results[i].getData(), original));
+        assert(original == textFile(i));
+    }
+    assert(results[count].getStatus() == OperationStatus::SUCCESS);
+    assert(results[count].getData() == textFile(999));
+    assert(results[count + 1].getStatus() == OperationStatus::FAILURE);
+    assert(pool.getStats().executed > 0 && "Spare workers took members");
+
+    Request broken(MessageType::BATCH_REQUEST, AlgorithmType::HUFFMAN, "broken",
+                   std::vector<uint8_t>{1, 0});
+    assert(worker.handleRequest(broken).getStatus() == OperationStatus::FAILURE);
+
+    std::cout << "✓ " << count + 2 << " members in one request, results in order, "
+              << "one member failed on its own" << std::endl;
+}
+
+int main() {
+    Logger::init("test_batch.log");
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "            Batch Tests                " << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    try {
+        testManifestRoundTrip();
+        testMalformedManifestRejected();
+        testWorkerProcessesBatch();
+
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "  All tests passed successfully! ✓    " << std::endl;
+        std::cout << "========================================" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        Logger::close();
+        return 1;
+    }
+
+    Logger::close();
+    return 0;
+}
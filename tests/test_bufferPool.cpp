@@ -0,0 +1,118 @@
+#include "bufferPool.h"
+#include "logger.h"
+#include <iostream>
+#include <cassert>
+#include <thread>
+
+void testSizeClasses() {
+    std::cout << "\n=== Test: Size Classes ===" << std::endl;
+
+    assert(BufferPool::classIndex(0) == 0);
+    assert(BufferPool::classIndex(1) == 0);
+    assert(BufferPool::classIndex(4096) == 0);
+    assert(BufferPool::classIndex(4097) == 1);
+    assert(BufferPool::classIndex(1024 * 1024) == 8);
+    assert(BufferPool::classIndex(BufferPool::MAX_CLASS_SIZE) == BufferPool::CLASS_COUNT - 1);
+    assert(BufferPool::classIndex(BufferPool::MAX_CLASS_SIZE + 1) == BufferPool::CLASS_COUNT);
+
+    std::cout << "✓ Sizes map to power-of-two classes" << std::endl;
+}
+
+void testRecycling() {
+    std::cout << "\n=== Test: Recycling ===" << std::endl;
+
+    BufferPool& pool = BufferPool::instance();
+    BufferPool::Stats before = pool.getStats();
+
+    std::vector<uint8_t> first = pool.acquire(10000);
+    assert(first.size() == 10000 && first.capacity() >= 16384);
+    const uint8_t* memory = first.data();
+    first[0] = 42;
+    pool.release(std::move(first));
+
+    // Same class again on the same thread comes straight from the thread cache
+    std::vector<uint8_t> second = pool.acquire(12000);
+    assert(second.data() == memory && "Buffer should be recycled");
+    assert(second[0] == 42 && "Recycled bytes are not re-zeroed");
+    pool.release(std::move(second));
+
+    std::vector<uint8_t> output = pool.acquireCapacity(9000);
+    assert(output.empty() && output.data() == memory && "Capacity request reuses the buffer");
+    pool.release(std::move(output));
+
+    BufferPool::Stats after = pool.getStats();
+    assert(after.acquires - before.acquires == 3);
+    assert(after.misses - before.misses == 1);
+    assert(after.threadCacheHits - before.threadCacheHits == 2);
+
+    std::cout << "Hit rate: " << after.hitRate() * 100 << "%" << std::endl;
+    std::cout << "✓ Buffers recycled through the thread cache" << std::endl;
+}
+
+void testSharedAcrossThreads() {
+    std::cout << "\n=== Test: Shared Across Threads ===" << std::endl;
+
+    BufferPool& pool = BufferPool::instance();
+
+    // Large buffers skip the thread cache and land in the shared lists
+    std::vector<uint8_t> large = pool.acquire(4 * 1024 * 1024);
+    const uint8_t* memory = large.data();
+    pool.release(std::move(large));
+
+    BufferPool::Stats before = pool.getStats();
+    const uint8_t* seen = nullptr;
+    std::thread other([&] {
+        std::vector<uint8_t> buffer = pool.acquire(3 * 1024 * 1024);
+        seen = buffer.data();
+        pool.release(std::move(buffer));
+    });
+    other.join();
+
+    BufferPool::Stats after = pool.getStats();
+    assert(seen == memory && "Another thread should reuse the shared buffer");
+    assert(after.sharedHits - before.sharedHits == 1);
+
+    std::cout << "✓ Shared free lists serve other threads" << std::endl;
+}
+
+void testOversizedAndTrim() {
+    std::cout << "\n=== Test: Oversized Buffers and Trim ===" << std::endl;
+
+    BufferPool& pool = BufferPool::instance();
+
+    std::vector<uint8_t> tiny(16);
+    BufferPool::Stats before = pool.getStats();
+    pool.release(std::move(tiny));
+    assert(pool.getStats().discarded - before.discarded == 1 && "Tiny buffers are not pooled");
+
+    pool.trim();
+    assert(pool.getStats().pooledBytes == 0 && "Trim empties the shared lists");
+
+    std::cout << "✓ Oversized buffers dropped and pool trimmed" << std::endl;
+}
+
+int main() {
+    Logger::init("test_bufferPool.log");
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "          Buffer Pool Tests            " << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    try {
+        testSizeClasses();
+        testRecycling();
+        testSharedAcrossThreads();
+        testOversizedAndTrim();
+
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "  All tests passed successfully! ✓    " << std::endl;
+        std::cout << "========================================" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        Logger::close();
+        return 1;
+    }
+
+    Logger::close();
+    return 0;
+}
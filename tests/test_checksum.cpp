@@ -0,0 +1,185 @@
+#include "checksum.h"
+#include "frameFormat.h"
+#include "logger.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <vector>
+
+void testKnownVectors() {
+    std::cout << "\n=== Test: Known CRC32C Vectors ===" << std::endl;
+
+    std::string check = "123456789";
+    assert(Checksum::crc32c(check.data(), check.size()) == 0xE3069283 && "CRC32C check value");
+    assert(Checksum::crc32cPortable(check.data(), check.size()) == 0xE3069283);
+
+    std::vector<uint8_t> zeros(32, 0);
+    assert(Checksum::crc32c(zeros.data(), zeros.size()) == 0x8A9136AA && "RFC 3720 zeros vector");
+
+    assert(Checksum::crc32c(nullptr, 0) == 0 && "Empty input leaves crc unchanged");
+
+    std::cout << "Hardware CRC32C: " << (Checksum::hardwareAccelerated() ? "yes" : "no") << std::endl;
+    std::cout << "✓ Known vectors match" << std::endl;
+}
+
+void testHardwareMatchesPortable() {
+    std::cout << "\n=== Test: Hardware vs Portable ===" << std::endl;
+
+    std::vector<uint8_t> data(4099);
+    uint32_t seed = 12345;
+    for (auto& byte : data) {
+        seed = seed * 1103515245 + 12345;
+        byte = static_cast<uint8_t>(seed >> 16);
+    }
+
+    // Every alignment and tail length through both paths
+    for (size_t start = 0; start < 9; start++) {
+        for (size_t length : {size_t(0), size_t(1), size_t(7), size_t(8), size_t(63), size_t(4090)}) {
+            assert(Checksum::crc32c(data.data() + start, length) ==
+                   Checksum::crc32cPortable(data.data() + start, length));
+        }
+    }
+
+    std::cout << "✓ Both paths agree" << std::endl;
+}
+
+void testChaining() {
+    std::cout << "\n=== Test: Incremental Chaining ===" << std::endl;
+
+    std::string text = "the quick brown fox jumps over the lazy dog";
+    uint32_t whole = Checksum::crc32c(text.data(), text.size());
+
+    uint32_t crc = 0;
+    for (size_t offset = 0; offset < text.size(); offset += 5) {
+        size_t length = std::min<size_t>(5, text.size() - offset);
+        crc = Checksum::crc32c(text.data() + offset, length, crc);
+    }
+    assert(crc == whole && "Chunked CRC should equal one-shot CRC");
+
+    std::cout << "✓ Chunked checksum matches" << std::endl;
+}
+
+void testCombine() {
+    std::cout << "\n=== Test: Combine ===" << std::endl;
+
+    std::vector<uint8_t> data(100000);
+    for (size_t i = 0; i < data.size(); i++) data[i] = static_cast<uint8_t>(i * 31 + 7);
+    uint32_t whole = Checksum::crc32c(data.data(), data.size());
+
+    // Independent CRCs of the pieces, stitched back together in order
+    for (size_t split : {size_t(0), size_t(1), size_t(4096), size_t(99999), data.size()}) {
+        uint32_t first = Checksum::crc32c(data.data(), split);
+        uint32_t second = Checksum::crc32c(data.data() + split, data.size() - split);
+        assert(Checksum::crc32cCombine(first, second, data.size() - split) == whole);
+    }
+
+    std::cout << "✓ Combined piece checksums equal the whole" << std::endl;
+}
+
+void testFrameDetectsCorruption() {
+    std::cout << "\n=== Test: Frame Corruption Detection ===" << std::endl;
+
+    std::string text = "checksums catch the corruption a codec would happily decode";
+    std::vector<uint8_t> input;
+    for (int i = 0; i < 50; i++) {
+        input.insert(input.end(), text.begin(), text.end());
+    }
+
+    std::vector<uint8_t> framed, decoded;
+    assert(FrameFormat::compress(AlgorithmType::HUFFMAN, input, framed));
+
+    FrameHeader header;
+    assert(FrameFormat::readHeader(framed.data(), framed.size(), header));
+    assert(header.flags == FrameFormat::DEFAULT_FLAGS && "Checksums are on by default");
+
+    // Flip a bit in the coded data of the first block
+    std::vector<uint8_t> damaged = framed;
+    damaged[FrameFormat::HEADER_SIZE + FrameFormat::blockHeaderSize(header.flags) + 20] ^= 0x10;
+    assert(!FrameFormat::decompress(damaged, decoded) && "Block checksum should catch damage");
+
+    // Damage the content checksum trailer itself
+    std::vector<uint8_t> badTrailer = framed;
+    badTrailer.back() ^= 0x01;
+    assert(!FrameFormat::decompress(badTrailer, decoded) && "Content checksum should be verified");
+
+    // Checksums can be turned off
+    std::vector<uint8_t> plain;
+    assert(FrameFormat::compress(AlgorithmType::HUFFMAN, input, plain, DEFAULT_FRAME_BLOCK_SIZE, 0));
+    assert(plain.size() + 8 == framed.size() && "One block CRC plus the trailer");
+    assert(FrameFormat::decompress(plain, decoded) && input == decoded);
+
+    std::cout << "✓ Corrupted frames rejected" << std::endl;
+}
+
+void testHash64() {
+    std::cout << "\n=== Test: 64-bit Content Hash ===" << std::endl;
+
+    // Reference xxHash64 values, seed 0
+    assert(Checksum::hash64(nullptr, 0) == 0xEF46DB3751D8E999ull);
+    assert(Checksum::hash64("a", 1) == 0xD24EC4F1A98C6E5Bull);
+    assert(Checksum::hash64("abc", 3) == 0x44BC2CF5AD770999ull);
+
+    // Every tail length, and one flipped bit anywhere changes the hash
+    std::vector<uint8_t> data(100);
+    for (size_t i = 0; i < data.size(); i++) data[i] = static_cast<uint8_t>(i * 31);
+    for (size_t length = 0; length <= data.size(); length++) {
+        uint64_t hash = Checksum::hash64(data.data(), length);
+        assert(hash == Checksum::hash64(data.data(), length) && "Deterministic");
+        if (length == 0) continue;
+        data[length - 1] ^= 0x10;
+        assert(Checksum::hash64(data.data(), length) != hash);
+        data[length - 1] ^= 0x10;
+    }
+    assert(Checksum::hash64(data.data(), data.size(), 1) !=
+           Checksum::hash64(data.data(), data.size(), 2) && "Seed changes the hash");
+
+    std::cout << "✓ Hash matches reference values and sees every byte" << std::endl;
+}
+
+void testThroughput() {
+    std::cout << "\n=== Test: Throughput ===" << std::endl;
+
+    std::vector<uint8_t> data(64 * 1024 * 1024, 0x5A);
+
+    auto start = std::chrono::steady_clock::now();
+    uint32_t crc = Checksum::crc32c(data.data(), data.size());
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "CRC32C over 64 MiB: " << (64.0 / elapsed) << " MiB/s (crc " << crc << ")" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    uint64_t hash = Checksum::hash64(data.data(), data.size());
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "hash64 over 64 MiB: " << (64.0 / elapsed) << " MiB/s (hash " << hash << ")" << std::endl;
+    std::cout << "✓ Throughput measured" << std::endl;
+}
+
+int main() {
+    Logger::init("test_checksum.log");
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "           Checksum Tests              " << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    try {
+        testKnownVectors();
+        testHardwareMatchesPortable();
+        testChaining();
+        testCombine();
+        testFrameDetectsCorruption();
+        testHash64();
+        testThroughput();
+
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "  All tests passed successfully! ✓    " << std::endl;
+        std::cout << "========================================" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        Logger::close();
+        return 1;
+    }
+
+    Logger::close();
+    return 0;
+}
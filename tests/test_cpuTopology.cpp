@@ -0,0 +1,133 @@
+#include "cpuTopology.h"
+#include "threadPool.h"
+#include "logger.h"
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static void writeFile(const fs::path& path, const std::string& text) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << text << "\n";
+}
+
+void testParseCpuList() {
+    std::cout << "\n=== Test: Parse CPU List ===" << std::endl;
+
+    std::vector<size_t> cpus;
+    assert(CpuTopology::parseCpuList("0-3,8,10-11", cpus));
+    assert((cpus == std::vector<size_t>{0, 1, 2, 3, 8, 10, 11}));
+
+    // Sysfs style with a newline, overlaps and out-of-order ranges
+    assert(CpuTopology::parseCpuList("4, 2-4,0\n", cpus));
+    assert((cpus == std::vector<size_t>{0, 2, 3, 4}));
+
+    // Malformed input leaves the list as it was
+    for (const char* bad : {"", "a", "3-1", "1-", "-2", "0-4000000000", "1,,x"}) {
+        assert(!CpuTopology::parseCpuList(bad, cpus));
+    }
+    assert(cpus.size() == 4);
+
+    std::cout << "✓ Ranges, singles and sysfs lists parsed; malformed lists refused" << std::endl;
+}
+
+void testCgroupV2Limit() {
+    std::cout << "\n=== Test: Cgroup V2 Limit ===" << std::endl;
+
+    const fs::path root = fs::temp_directory_path() / "test_cpuTopology_v2";
+    fs::remove_all(root);
+
+    // No files, or no quota: unlimited
+    assert(CpuTopology::cgroupCpuLimit(root.string(), "/app") == 0);
+    writeFile(root / "cpu.max", "max 100000");
+    assert(CpuTopology::cgroupCpuLimit(root.string(), "/") == 0);
+
+    // The group's own quota, or a tighter parent's
+    writeFile(root / "app" / "cpu.max", "250000 100000");
+    assert(std::abs(CpuTopology::cgroupCpuLimit(root.string(), "/app") - 2.5) < 1e-9);
+    writeFile(root / "cpu.max", "150000 100000");
+    writeFile(root / "app" / "worker" / "cpu.max", "max 100000");
+    assert(std::abs(CpuTopology::cgroupCpuLimit(root.string(), "/app/worker") - 1.5) < 1e-9);
+
+    // A path we cannot see (our cgroup mounted as the root) still finds the root's
+    assert(std::abs(CpuTopology::cgroupCpuLimit(root.string(), "/docker/abc") - 1.5) < 1e-9);
+
+    fs::remove_all(root);
+    std::cout << "✓ cpu.max read, tightest limit on the way up wins" << std::endl;
+}
+
+void testCgroupV1Limit() {
+    std::cout << "\n=== Test: Cgroup V1 Limit ===" << std::endl;
+
+    const fs::path root = fs::temp_directory_path() / "test_cpuTopology_v1";
+    fs::remove_all(root);
+
+    writeFile(root / "cpu" / "cpu.cfs_quota_us", "-1");
+    writeFile(root / "cpu" / "cpu.cfs_period_us", "100000");
+    assert(CpuTopology::cgroupCpuLimit(root.string(), "") == 0);
+
+    writeFile(root / "cpu" / "cpu.cfs_quota_us", "50000");
+    assert(std::abs(CpuTopology::cgroupCpuLimit(root.string(), "") - 0.5) < 1e-9);
+
+    fs::remove_all(root);
+    std::cout << "✓ CFS quota and period read; -1 is unlimited" << std::endl;
+}
+
+void testBudgetAndNodes() {
+    std::cout << "\n=== Test: Budget And Nodes ===" << std::endl;
+
+    const std::vector<size_t> cpus = ThreadPool::availableCpus();
+    const double budget = CpuTopology::cpuBudget(cpus);
+    assert(budget > 0 && budget <= static_cast<double>(cpus.size()));
+
+    // Every CPU on a known node, and the grouping keeps each node together
+    const std::vector<size_t> grouped = CpuTopology::groupByNode(cpus);
+    assert(grouped.size() == cpus.size());
+    for (size_t i = 0; i < grouped.size(); i++) {
+        assert(CpuTopology::nodeOf(grouped[i]) < CpuTopology::nodeCount());
+        if (i > 0) assert(CpuTopology::nodeOf(grouped[i - 1]) <= CpuTopology::nodeOf(grouped[i]));
+    }
+    assert(CpuTopology::currentNode() < CpuTopology::nodeCount());
+
+    std::vector<int> touched(1024, 1);
+    assert(CpuTopology::nodeOfAddress(touched.data()) < CpuTopology::nodeCount());
+
+    const uint64_t before = CpuTopology::processCpuMicros();
+    volatile uint64_t spin = 0;
+    for (int i = 0; i < 20000000; i++) spin = spin + i;
+    assert(CpuTopology::processCpuMicros() > before);
+
+    std::cout << "✓ Budget " << budget << " of " << cpus.size() << " CPUs on "
+              << CpuTopology::nodeCount() << " node(s)" << std::endl;
+}
+
+int main() {
+    Logger::init("test_cpuTopology.log");
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "          CPU Topology Tests           " << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    try {
+        testParseCpuList();
+        testCgroupV2Limit();
+        testCgroupV1Limit();
+        testBudgetAndNodes();
+
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "  All tests passed successfully! ✓    " << std::endl;
+        std::cout << "========================================" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        Logger::close();
+        return 1;
+    }
+
+    Logger::close();
+    return 0;
+}
@@ -0,0 +1,793 @@
+#include "eventLoop.h"
+#include "client.h"
+#include "networkUtils.h"
+#include "memoryBudget.h"
+#include "frameFormat.h"
+#include "fileHandler.h"
+#include "logger.h"
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static std::atomic<int> cancelsSeen(0);
+
+// Handler used by these tests: reply with the payload reversed. A filename
+// starting with "sleep<N>" holds the worker for N milliseconds first;
+// "cancel<N>" holds it up to N milliseconds or until the request is
+// cancelled, and counts the cancellation. A fetch is answered with the
+// named file. TestServer's dispatcher throws std::bad_alloc for "throw".
+static Response reverseHandler(Request& request) {
+    const std::string& name = request.getFilename();
+    if (request.getMessageType() == MessageType::FETCH_REQUEST) {
+        FileBody file = FileBody::open(name);
+        Response response(file.isOpen() ? OperationStatus::SUCCESS : OperationStatus::FAILURE,
+                          name, "fetched", {});
+        response.setFile(std::move(file));
+        return response;
+    }
+    if (name.compare(0, 5, "sleep") == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(std::stoi(name.substr(5))));
+    }
+    if (name.compare(0, 6, "cancel") == 0) {
+        const auto deadline = std::chrono::steady_clock::now() +
+                              std::chrono::milliseconds(std::stoi(name.substr(6)));
+        while (!request.isCancelled() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        if (request.isCancelled()) {
+            cancelsSeen++;
+            return Response(OperationStatus::FAILURE, name, "cancelled", {});
+        }
+    }
+    std::vector<uint8_t> data = request.takeData();
+    std::reverse(data.begin(), data.end());
+    Response response(OperationStatus::SUCCESS, request.getFilename() + ".rev", "reversed",
+                      std::move(data));
+    response.setChecksumEnabled(request.isChecksumEnabled());
+    return response;
+}
+
+// Loop on an ephemeral loopback port, with a worker thread per request and
+// per streamed block. With reusePort, other servers may share the port, as
+// the server's shards do; bindPort picks the port to share.
+struct TestServer {
+    SOCKET listenSocket = INVALID_SOCKET;
+    int port = 0;
+    std::unique_ptr<EventLoop> loop;
+    std::thread loopThread;
+    std::vector<std::thread> workers;
+    std::mutex workersMutex;
+
+    explicit TestServer(bool reusePort = false, int bindPort = 0) {
+        listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (reusePort) {
+            int enabled = 1;
+            assert(setsockopt(listenSocket, SOL_SOCKET, SO_REUSEPORT, &enabled,
+                              sizeof(enabled)) == 0);
+        }
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(bindPort);
+        assert(bind(listenSocket, reinterpret_cast<SOCKADDR*>(&addr), sizeof(addr)) == 0);
+        assert(listen(listenSocket, SOMAXCONN) == 0);
+        socklen_t length = sizeof(addr);
+        getsockname(listenSocket, reinterpret_cast<SOCKADDR*>(&addr), &length);
+        port = ntohs(addr.sin_port);
+
+        loop = std::make_unique<EventLoop>(listenSocket,
+            [this](RequestTag tag, Request&& request) {
+                if (request.getFilename() == "throw") throw std::bad_alloc();
+                auto pending = std::make_shared<Request>(std::move(request));
+                std::lock_guard<std::mutex> lock(workersMutex);
+                workers.emplace_back([this, tag, pending] {
+                    loop->complete(tag, reverseHandler(*pending));
+                });
+            },
+            [this](RequestTag tag, Connection::StreamBlock&& block) {
+                auto pending = std::make_shared<Connection::StreamBlock>(std::move(block));
+                std::lock_guard<std::mutex> lock(workersMutex);
+                workers.emplace_back([this, tag, pending] {
+                    bool last = false;
+                    loop->complete(tag, pending->stream->compressBlock(
+                        pending->index, std::move(pending->data), last));
+                    if (last) {
+                        loop->complete({tag.connectionId, pending->stream->getFinalSequence()},
+                                       pending->stream->finish());
+                    }
+                });
+            });
+        assert(loop->initialize());
+        loopThread = std::thread([this] { loop->run(); });
+    }
+
+    ~TestServer() {
+        loop->stop();
+        loopThread.join();
+        for (auto& worker : workers) worker.join();
+        NetworkUtils::closeSocket(listenSocket);
+    }
+
+    SOCKET connectClient() const {
+        SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        assert(connect(sock, reinterpret_cast<SOCKADDR*>(&addr), sizeof(addr)) == 0);
+        return sock;
+    }
+};
+
+static std::vector<uint8_t> pattern(size_t size, uint8_t seed) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++) data[i] = static_cast<uint8_t>(seed + i * 7);
+    return data;
+}
+
+static bool roundTrip(const TestServer& server, std::vector<uint8_t> data, bool checksum) {
+    std::vector<uint8_t> expected(data.rbegin(), data.rend());
+    SOCKET sock = server.connectClient();
+    Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "file.bin",
+                    std::move(data));
+    request.setChecksumEnabled(checksum);
+    Response response;
+    bool ok = request.serialize(sock) && response.deserialize(sock) &&
+              response.getFilename() == "file.bin.rev" && response.getData() == expected;
+    NetworkUtils::closeSocket(sock);
+    return ok;
+}
+
+void testSingleRequest() {
+    std::cout << "\n=== Test: Single Request ===" << std::endl;
+
+    TestServer server;
+    assert(roundTrip(server, pattern(1000, 1), true));
+    assert(roundTrip(server, pattern(1000, 2), false));
+    assert(roundTrip(server, {}, true) && "Empty payloads are valid");
+
+    std::cout << "✓ Requests parsed and answered by the reactor" << std::endl;
+}
+
+void testLargePayload() {
+    std::cout << "\n=== Test: Large Payload ===" << std::endl;
+
+    // Larger than the socket buffers, so both directions go through
+    // partial reads and EPOLLOUT-driven writes
+    TestServer server;
+    assert(roundTrip(server, pattern(16 * 1024 * 1024, 3), true));
+
+    std::cout << "✓ 16 MiB request and response streamed without blocking" << std::endl;
+}
+
+void testSlowClientDoesNotBlock() {
+    std::cout << "\n=== Test: Slow Client Does Not Block ===" << std::endl;
+
+    TestServer server;
+
+    // A client that stalls half way through its header
+    std::vector<uint8_t> slowData = pattern(4096, 4);
+    Request slowRequest(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "slow.bin",
+                        std::vector<uint8_t>(slowData));
+    std::vector<uint8_t> head;
+    slowRequest.encodeHead(head);
+    SOCKET slow = server.connectClient();
+    assert(NetworkUtils::sendData(slow, head.data(), 3));
+
+    // Many other clients complete in the meantime
+    std::vector<std::thread> clients;
+    std::atomic<int> succeeded(0);
+    for (int i = 0; i < 32; i++) {
+        clients.emplace_back([&server, &succeeded, i] {
+            if (roundTrip(server, pattern(2000 + i, static_cast<uint8_t>(i)), true)) succeeded++;
+        });
+    }
+    for (auto& client : clients) client.join();
+    assert(succeeded == 32 && "Stalled client must not hold up others");
+
+    // The slow client finishes and still gets its answer
+    uint32_t crc = 0;
+    assert(NetworkUtils::sendData(slow, head.data() + 3, head.size() - 3));
+    assert(NetworkUtils::sendDataWithChecksum(slow, slowData.data(), slowData.size(), crc));
+    assert(NetworkUtils::sendData(slow, &crc, sizeof(crc)));
+    Response response;
+    assert(response.deserialize(slow));
+    assert(response.getData() == std::vector<uint8_t>(slowData.rbegin(), slowData.rend()));
+    NetworkUtils::closeSocket(slow);
+
+    std::cout << "✓ 32 clients served while one stalled mid-header" << std::endl;
+}
+
+void testChecksumMismatchCloses() {
+    std::cout << "\n=== Test: Checksum Mismatch Closes ===" << std::endl;
+
+    TestServer server;
+    std::vector<uint8_t> data = pattern(512, 5);
+    Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "bad.bin",
+                    std::vector<uint8_t>(data));
+    std::vector<uint8_t> head;
+    request.encodeHead(head);
+
+    SOCKET sock = server.connectClient();
+    uint32_t wrongCrc = 0xDEADBEEF;
+    assert(NetworkUtils::sendData(sock, head.data(), head.size()));
+    assert(NetworkUtils::sendData(sock, data.data(), data.size()));
+    assert(NetworkUtils::sendData(sock, &wrongCrc, sizeof(wrongCrc)));
+
+    Response response;
+    assert(!response.deserialize(sock) && "Corrupt request should drop the connection");
+    NetworkUtils::closeSocket(sock);
+
+    std::cout << "✓ Corrupt payload rejected before reaching a worker" << std::endl;
+}
+
+void testKeepAlive() {
+    std::cout << "\n=== Test: Keep-Alive ===" << std::endl;
+
+    TestServer server;
+    SOCKET sock = server.connectClient();
+    for (int i = 0; i < 10; i++) {
+        std::vector<uint8_t> data = pattern(100 + i * 1000, static_cast<uint8_t>(i));
+        std::vector<uint8_t> expected(data.rbegin(), data.rend());
+        Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "file.bin",
+                        std::move(data));
+        Response response;
+        assert(request.serialize(sock) && response.deserialize(sock));
+        assert(response.getData() == expected);
+    }
+    assert(server.loop->getConnectionCount() == 1 && "All requests share one connection");
+    NetworkUtils::closeSocket(sock);
+
+    std::cout << "✓ 10 sequential requests on one connection" << std::endl;
+}
+
+void testPipelinedResponsesInOrder() {
+    std::cout << "\n=== Test: Pipelined Responses In Order ===" << std::endl;
+
+    TestServer server;
+    SOCKET sock = server.connectClient();
+
+    // Early requests take longest, so workers finish them last; more requests
+    // than the pipeline depth exercise the read pause as well
+    const int count = static_cast<int>(MAX_PIPELINED_REQUESTS) * 2;
+    std::vector<std::vector<uint8_t>> payloads;
+    for (int i = 0; i < count; i++) {
+        payloads.push_back(pattern(500 + i, static_cast<uint8_t>(i)));
+        std::string name = "sleep" + std::to_string((count - i) * 3);
+        Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, name,
+                        std::vector<uint8_t>(payloads.back()));
+        assert(request.serialize(sock));
+    }
+
+    // Half-close: everything already sent must still be answered
+    shutdown(sock, SHUT_WR);
+
+    for (int i = 0; i < count; i++) {
+        Response response;
+        assert(response.deserialize(sock));
+        assert(response.getFilename() == "sleep" + std::to_string((count - i) * 3) + ".rev");
+        assert(response.getData() ==
+               std::vector<uint8_t>(payloads[i].rbegin(), payloads[i].rend()));
+    }
+    uint8_t extra;
+    assert(recv(sock, &extra, 1, 0) == 0 && "Server closes once every response is out");
+    NetworkUtils::closeSocket(sock);
+
+    std::cout << "✓ " << count << " pipelined responses returned in request order" << std::endl;
+}
+
+void testClientPipelining() {
+    std::cout << "\n=== Test: Client Pipelining ===" << std::endl;
+
+    TestServer server;
+    Client client("127.0.0.1", server.port);
+
+    // Large enough that requests and responses are in flight together
+    std::vector<Request> requests;
+    std::vector<std::vector<uint8_t>> payloads;
+    for (int i = 0; i < 8; i++) {
+        payloads.push_back(pattern(2 * 1024 * 1024 + i, static_cast<uint8_t>(i)));
+        requests.emplace_back(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE,
+                              "part" + std::to_string(i), std::vector<uint8_t>(payloads.back()));
+    }
+
+    std::vector<Response> responses;
+    assert(client.sendRequests(requests, responses));
+    assert(responses.size() == requests.size());
+    for (size_t i = 0; i < responses.size(); i++) {
+        assert(responses[i].getFilename() == "part" + std::to_string(i) + ".rev");
+        assert(responses[i].getData() ==
+               std::vector<uint8_t>(payloads[i].rbegin(), payloads[i].rend()));
+    }
+
+    // The next call reuses the same connection
+    Response single;
+    assert(client.sendRequest(requests[0], single));
+    assert(server.loop->getConnectionCount() == 1);
+
+    std::cout << "✓ Client pipelined 16 MiB over one kept-alive connection" << std::endl;
+}
+
+// Raw request on an open socket, answer read back
+static Response exchangeRaw(SOCKET sock, const std::string& name, size_t size) {
+    Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, name, pattern(size, 9));
+    Response response;
+    assert(request.serialize(sock) && response.deserialize(sock));
+    return response;
+}
+
+void testOversizedRequestRefused() {
+    std::cout << "\n=== Test: Oversized Request Refused ===" << std::endl;
+
+    MemoryBudget::instance().setLimit(1024 * 1024);
+    TestServer server;
+    SOCKET sock = server.connectClient();
+
+    // Could never fit the budget: refused from its header, payload skipped
+    Response refused = exchangeRaw(sock, "huge.bin", 600 * 1024);
+    assert(refused.getStatus() == OperationStatus::FAILURE);
+    assert(refused.getData().empty());
+
+    // The connection stays in step for the next request
+    Response next = exchangeRaw(sock, "small.bin", 1000);
+    assert(next.getStatus() == OperationStatus::SUCCESS && next.getData().size() == 1000);
+    NetworkUtils::closeSocket(sock);
+    MemoryBudget::instance().setLimit(SERVER_MEMORY_BUDGET);
+
+    std::cout << "✓ Oversized request answered without allocating it" << std::endl;
+}
+
+void testOverBudgetAnswersBusy() {
+    std::cout << "\n=== Test: Over Budget Answers BUSY ===" << std::endl;
+
+    MemoryBudget::instance().setLimit(1024 * 1024);
+    {
+        TestServer server;
+
+        // Holds most of the budget while its worker sleeps
+        SOCKET holder = server.connectClient();
+        Request big(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "sleep4000",
+                    pattern(400 * 1024, 1));
+        assert(big.serialize(holder));
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        SOCKET sock = server.connectClient();
+        auto start = std::chrono::steady_clock::now();
+        Response busy = exchangeRaw(sock, "waits.bin", 400 * 1024);
+        assert(busy.getStatus() == OperationStatus::BUSY);
+        assert(std::chrono::steady_clock::now() - start >=
+               std::chrono::milliseconds(ADMISSION_WAIT_MS) && "Waited for budget first");
+
+        // A request that fits still goes through on the same connection
+        Response small = exchangeRaw(sock, "small.bin", 1000);
+        assert(small.getStatus() == OperationStatus::SUCCESS);
+
+        Response held;
+        assert(held.deserialize(holder) && held.getStatus() == OperationStatus::SUCCESS);
+        NetworkUtils::closeSocket(holder);
+        NetworkUtils::closeSocket(sock);
+    }
+    assert(MemoryBudget::instance().getInUse() == 0 && "Every charge returned");
+    MemoryBudget::instance().setLimit(SERVER_MEMORY_BUDGET);
+
+    std::cout << "✓ Request answered BUSY after waiting, connection kept" << std::endl;
+}
+
+void testClientRetriesBusy() {
+    std::cout << "\n=== Test: Client Retries BUSY ===" << std::endl;
+
+    MemoryBudget::instance().setLimit(1024 * 1024);
+    {
+        TestServer server;
+        SOCKET holder = server.connectClient();
+        Request big(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "sleep3000",
+                    pattern(400 * 1024, 1));
+        assert(big.serialize(holder));
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        // Answered BUSY at first, then admitted once the holder finishes
+        Client client("127.0.0.1", server.port);
+        Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "retry.bin",
+                        pattern(400 * 1024, 2));
+        Response response;
+        assert(client.sendRequest(request, response));
+        assert(response.getStatus() == OperationStatus::SUCCESS);
+        assert(response.getData().size() == 400 * 1024);
+
+        Response held;
+        assert(held.deserialize(holder));
+        NetworkUtils::closeSocket(holder);
+    }
+    MemoryBudget::instance().setLimit(SERVER_MEMORY_BUDGET);
+
+    std::cout << "✓ Client backed off and succeeded" << std::endl;
+}
+
+void testStreamedCompression() {
+    std::cout << "\n=== Test: Streamed Compression ===" << std::endl;
+
+    TestServer server;
+    SOCKET sock = server.connectClient();
+
+    // Several full blocks and a short last one
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < 3 * DEFAULT_FRAME_BLOCK_SIZE + 12345; i++) {
+        data.push_back(static_cast<uint8_t>((i / 50) % 7));
+    }
+    std::vector<uint8_t> expected;
+    assert(FrameFormat::compress(AlgorithmType::HUFFMAN, data, expected));
+
+    Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN, "stream.bin",
+                    std::vector<uint8_t>(data));
+    request.setStreamed(true);
+    std::vector<uint8_t> head;
+    request.encodeHead(head);
+
+    // The first block comes back before the rest of the upload is sent
+    uint32_t crc = 0;
+    assert(NetworkUtils::sendData(sock, head.data(), head.size()));
+    assert(NetworkUtils::sendDataWithChecksum(sock, data.data(), DEFAULT_FRAME_BLOCK_SIZE, crc));
+    Response first;
+    assert(first.deserialize(sock));
+    assert(first.getStatus() == OperationStatus::IN_PROGRESS);
+    assert(std::equal(first.getData().begin(), first.getData().end(),
+                      expected.begin() + FrameFormat::HEADER_SIZE));
+
+    assert(NetworkUtils::sendDataWithChecksum(sock, data.data() + DEFAULT_FRAME_BLOCK_SIZE,
+                                              data.size() - DEFAULT_FRAME_BLOCK_SIZE, crc));
+    assert(NetworkUtils::sendData(sock, &crc, sizeof(crc)));
+
+    std::vector<uint8_t> blocks = first.getData();
+    int chunks = 1;
+    Response response;
+    while (response.deserialize(sock) && response.getStatus() == OperationStatus::IN_PROGRESS) {
+        blocks.insert(blocks.end(), response.getData().begin(), response.getData().end());
+        chunks++;
+    }
+    assert(chunks == 4 && "One chunk per frame block");
+    assert(response.getStatus() == OperationStatus::SUCCESS);
+    assert(response.getFilename() == "stream_Huffman.compressed");
+
+    // Header from the final response, then the blocks, then the trailer
+    const std::vector<uint8_t>& envelope = response.getData();
+    std::vector<uint8_t> frame(envelope.begin(), envelope.begin() + FrameFormat::HEADER_SIZE);
+    frame.insert(frame.end(), blocks.begin(), blocks.end());
+    frame.insert(frame.end(), envelope.begin() + FrameFormat::HEADER_SIZE, envelope.end());
+    assert(frame == expected && "Streamed frame matches the one-shot frame");
+
+    // The connection carries ordinary requests afterwards
+    Response next = exchangeRaw(sock, "after.bin", 1000);
+    assert(next.getStatus() == OperationStatus::SUCCESS && next.getData().size() == 1000);
+    NetworkUtils::closeSocket(sock);
+
+    std::cout << "✓ 4 blocks streamed back while the upload was in progress" << std::endl;
+}
+
+void testClientStreaming() {
+    std::cout << "\n=== Test: Client Streaming ===" << std::endl;
+
+    TestServer server;
+    Client client("127.0.0.1", server.port);
+    client.setStreamingEnabled(true);
+
+    std::vector<uint8_t> data = pattern(6 * 1024 * 1024 + 7, 11);
+    std::vector<uint8_t> expected;
+    assert(FrameFormat::compress(AlgorithmType::RLE, data, expected));
+
+    Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "big.bin",
+                    std::move(data));
+    request.setStreamed(true);
+    Response response;
+    assert(client.sendRequest(request, response));
+    assert(response.getStatus() == OperationStatus::SUCCESS);
+    assert(response.getData() == expected && "Client reassembles the frame");
+
+    std::cout << "✓ Client rebuilt a 6 MiB streamed frame" << std::endl;
+}
+
+void testFetchSendsFile() {
+    std::cout << "\n=== Test: Fetch Sends File ===" << std::endl;
+
+    // Larger than the socket buffers, so sendfile() resumes on EPOLLOUT
+    const std::string path = "test_eventLoop_fetch.bin";
+    std::vector<uint8_t> contents = pattern(12 * 1024 * 1024 + 5, 13);
+    assert(FileHandler::writeFile(path, contents));
+
+    TestServer server;
+    SOCKET sock = server.connectClient();
+
+    // A fetch pipelined between ordinary requests keeps its place
+    Request fetch(MessageType::FETCH_REQUEST, AlgorithmType::HUFFMAN, path, {});
+    Request reverse(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "after.bin",
+                    pattern(1000, 2));
+    Request missing(MessageType::FETCH_REQUEST, AlgorithmType::HUFFMAN, "missing.bin", {});
+    assert(fetch.serialize(sock) && reverse.serialize(sock) && missing.serialize(sock));
+
+    Response response;
+    assert(response.deserialize(sock));
+    assert(response.getStatus() == OperationStatus::SUCCESS);
+    assert(!response.isChecksumEnabled() && "Sent without a trailer");
+    assert(response.getData() == contents);
+
+    assert(response.deserialize(sock));
+    assert(response.getFilename() == "after.bin.rev");
+    assert(response.deserialize(sock));
+    assert(response.getStatus() == OperationStatus::FAILURE);
+
+    NetworkUtils::closeSocket(sock);
+    std::remove(path.c_str());
+
+    std::cout << "✓ 12 MiB file sent from disk between pipelined responses" << std::endl;
+}
+
+void testReusePortShards() {
+    std::cout << "\n=== Test: SO_REUSEPORT Shards ===" << std::endl;
+
+    TestServer first(true);
+    TestServer second(true, first.port);
+    assert(second.port == first.port);
+
+    // The kernel hashes each connection to one of the two listeners
+    const size_t clients = 64;
+    std::vector<SOCKET> sockets;
+    for (size_t i = 0; i < clients; i++) sockets.push_back(first.connectClient());
+    for (int waited = 0; waited < 5000; waited++) {
+        if (first.loop->getConnectionCount() + second.loop->getConnectionCount() == clients) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const size_t onFirst = first.loop->getConnectionCount();
+    const size_t onSecond = second.loop->getConnectionCount();
+    assert(onFirst + onSecond == clients);
+    assert(onFirst > 0 && onSecond > 0 && "Both shards accept");
+
+    // Every connection is served by whichever loop accepted it
+    for (SOCKET sock : sockets) {
+        std::vector<uint8_t> data = pattern(1000, static_cast<uint8_t>(sock));
+        std::vector<uint8_t> expected(data.rbegin(), data.rend());
+        Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "shard.bin",
+                        std::move(data));
+        Response response;
+        assert(request.serialize(sock) && response.deserialize(sock));
+        assert(response.getData() == expected);
+        NetworkUtils::closeSocket(sock);
+    }
+
+    std::cout << "✓ " << clients << " connections split " << onFirst << "/" << onSecond
+              << " between two loops on port " << first.port << std::endl;
+}
+
+void testThrowClosesOnlyThatConnection() {
+    std::cout << "\n=== Test: Exception Closes Only Its Connection ===" << std::endl;
+
+    TestServer server;
+    SOCKET bystander = server.connectClient();
+    assert(roundTrip(server, pattern(100, 7), false));
+
+    SOCKET sock = server.connectClient();
+    Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "throw",
+                    pattern(100, 8));
+    assert(request.serialize(sock));
+    uint8_t byte;
+    assert(recv(sock, &byte, 1, 0) == 0 && "Its connection is closed");
+    NetworkUtils::closeSocket(sock);
+
+    // The loop carries on for everyone else, including connections it already had
+    std::vector<uint8_t> data = pattern(100, 9);
+    std::vector<uint8_t> expected(data.rbegin(), data.rend());
+    Request after(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "after.bin",
+                  std::move(data));
+    Response response;
+    assert(after.serialize(bystander) && response.deserialize(bystander));
+    assert(response.getData() == expected);
+    NetworkUtils::closeSocket(bystander);
+
+    std::cout << "✓ std::bad_alloc closed its connection; the loop kept serving" << std::endl;
+}
+
+// Resident set size in KiB, from /proc/self/status
+static long residentKiB() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmRSS:") == 0) return std::stol(line.substr(6));
+    }
+    return 0;
+}
+
+void testIdleConnectionsPastBlockingLimit() {
+    std::cout << "\n=== Test: Idle Connections Past The Blocking Limit ===" << std::endl;
+
+    // Both ends live in this process, so each connection costs two descriptors
+    const size_t clients = MAX_CONNECTIONS * 4;
+    if (EventLoop::descriptorConnectionLimit() < clients * 2) {
+        std::cout << "Skipped: only " << EventLoop::descriptorConnectionLimit()
+                  << " descriptors available" << std::endl;
+        return;
+    }
+
+    TestServer server;
+    const long before = residentKiB();
+    std::vector<SOCKET> sockets;
+    for (size_t i = 0; i < clients; i++) sockets.push_back(server.connectClient());
+    for (int waited = 0; waited < 5000; waited++) {
+        if (server.loop->getConnectionCount() == clients) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(server.loop->getConnectionCount() == clients && "All idle connections accepted");
+    const long grown = residentKiB() - before;
+
+    // The newest of them is served like any other
+    std::vector<uint8_t> data = pattern(1000, 6);
+    std::vector<uint8_t> expected(data.rbegin(), data.rend());
+    Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "idle.bin",
+                    std::move(data));
+    Response response;
+    assert(request.serialize(sockets.back()) && response.deserialize(sockets.back()));
+    assert(response.getData() == expected);
+    for (SOCKET sock : sockets) NetworkUtils::closeSocket(sock);
+
+    std::cout << "✓ " << clients << " idle connections held open; RSS grew " << grown
+              << " KiB for both ends" << std::endl;
+}
+
+// Raw bytes of two pipelined requests, the second checksummed
+static std::vector<uint8_t> pipelinedWire() {
+    int pair[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+    Request first(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "first.bin",
+                  pattern(300, 1));
+    Request second(MessageType::DECOMPRESS_REQUEST, AlgorithmType::HUFFMAN, "second.bin",
+                   pattern(50, 2));
+    second.setChecksumEnabled(true);
+    assert(first.serialize(pair[0]) && second.serialize(pair[0]));
+    close(pair[0]);
+
+    std::vector<uint8_t> wire;
+    uint8_t chunk[4096];
+    ssize_t count;
+    while ((count = recv(pair[1], chunk, sizeof(chunk), 0)) > 0) {
+        wire.insert(wire.end(), chunk, chunk + count);
+    }
+    close(pair[1]);
+    return wire;
+}
+
+void testParserResumesAcrossSplits() {
+    std::cout << "\n=== Test: Parser Resumes Across Splits ===" << std::endl;
+
+    const std::vector<uint8_t> wire = pipelinedWire();
+    int pair[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+    assert(NetworkUtils::setNonBlocking(pair[1]));
+
+    // Every byte boundary is a suspension point of the parser
+    std::vector<Request> taken;
+    {
+        Connection connection(pair[1], 2);
+        for (uint8_t byte : wire) {
+            assert(send(pair[0], &byte, 1, 0) == 1);
+            Connection::Status status = connection.readAvailable();
+            while (status == Connection::Status::REQUEST_READY) {
+                uint64_t sequence = 0;
+                taken.push_back(connection.takeRequest(sequence));
+                assert(sequence == taken.size() - 1);
+                status = connection.readAvailable();
+            }
+            assert(status == Connection::Status::PENDING);
+            assert(!connection.hasReadBuffer() && "A drained connection keeps no buffer");
+        }
+    }
+    close(pair[0]);
+
+    assert(taken.size() == 2);
+    assert(taken[0].getFilename() == "first.bin" && taken[0].getData() == pattern(300, 1));
+    assert(taken[1].getMessageType() == MessageType::DECOMPRESS_REQUEST);
+    assert(taken[1].isChecksumEnabled() && taken[1].getData() == pattern(50, 2));
+
+    // Same bytes in one go with the second request's trailer corrupted
+    std::vector<uint8_t> corrupted = wire;
+    corrupted.back() ^= 0xFF;
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+    assert(NetworkUtils::setNonBlocking(pair[1]));
+    assert(send(pair[0], corrupted.data(), corrupted.size(), 0) ==
+           static_cast<ssize_t>(corrupted.size()));
+    {
+        Connection connection(pair[1], 3);
+        assert(connection.readAvailable() == Connection::Status::REQUEST_READY);
+        uint64_t sequence = 0;
+        connection.takeRequest(sequence);
+        assert(connection.readAvailable() == Connection::Status::FAILED);
+        assert(connection.readAvailable() == Connection::Status::FAILED && "Stays failed");
+    }
+    close(pair[0]);
+
+    std::cout << "✓ " << wire.size() << " bytes fed one at a time, 2 requests parsed; "
+              << "bad trailer fails the connection" << std::endl;
+}
+
+void testResetCancelsInFlight() {
+    std::cout << "\n=== Test: Reset Cancels In-Flight Work ===" << std::endl;
+
+    TestServer server;
+    const int before = cancelsSeen;
+
+    // A half-closed client still wants its answer: nothing is cancelled
+    SOCKET sock = server.connectClient();
+    Request waiting(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "cancel200",
+                    pattern(1000, 4));
+    assert(waiting.serialize(sock));
+    shutdown(sock, SHUT_WR);
+    Response response;
+    assert(response.deserialize(sock) && response.getMessage() == "reversed");
+    NetworkUtils::closeSocket(sock);
+    assert(cancelsSeen == before);
+
+    // A client that resets its connection mid-request gets its work dropped
+    sock = server.connectClient();
+    Request abandoned(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "cancel10000",
+                      pattern(1000, 5));
+    assert(abandoned.serialize(sock));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const auto reset = std::chrono::steady_clock::now();
+    NetworkUtils::abortSocket(sock);
+    while (cancelsSeen == before &&
+           std::chrono::steady_clock::now() - reset < std::chrono::seconds(5)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    const auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - reset).count();
+    assert(cancelsSeen == before + 1 && "The worker sees the cancellation");
+    std::cout << "Cancellation seen " << waited << " ms after the reset" << std::endl;
+
+    std::cout << "✓ Reset cancels in-flight work; half-close does not" << std::endl;
+}
+
+int main() {
+    Logger::init("test_eventLoop.log");
+    NetworkUtils::initialize();
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "          Event Loop Tests             " << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    try {
+        testSingleRequest();
+        testLargePayload();
+        testSlowClientDoesNotBlock();
+        testChecksumMismatchCloses();
+        testKeepAlive();
+        testPipelinedResponsesInOrder();
+        testClientPipelining();
+        testOversizedRequestRefused();
+        testOverBudgetAnswersBusy();
+        testClientRetriesBusy();
+        testStreamedCompression();
+        testClientStreaming();
+        testFetchSendsFile();
+        testReusePortShards();
+        testParserResumesAcrossSplits();
+        testResetCancelsInFlight();
+        testThrowClosesOnlyThatConnection();
+        testIdleConnectionsPastBlockingLimit();
+
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "  All tests passed successfully! ✓    " << std::endl;
+        std::cout << "========================================" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        Logger::close();
+        return 1;
+    }
+
+    Logger::close();
+    return 0;
+}
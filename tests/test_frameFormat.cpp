@@ -0,0 +1,280 @@
+#include "frameFormat.h"
+#include "huffman.h"
+#include "RLE.h"
+#include "algorithmFactory.h"
+#include "threadPool.h"
+#include "checksum.h"
+#include "logger.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+void testRoundTrip() {
+    std::cout << "\n=== Test: Frame Round Trip ===" << std::endl;
+
+    std::string testStr = "hello world! this is a test of the frame format.";
+    std::vector<uint8_t> input(testStr.begin(), testStr.end());
+
+    for (AlgorithmType type : {AlgorithmType::HUFFMAN, AlgorithmType::RLE}) {
+        std::vector<uint8_t> framed, decoded;
+        AlgorithmType detected = AlgorithmType::HUFFMAN;
+
+        assert(FrameFormat::compress(type, input, framed) && "Framing should succeed");
+        assert(FrameFormat::isFramed(framed.data(), framed.size()) && "Output should be framed");
+        assert(FrameFormat::decompress(framed, decoded, &detected) && "Decoding should succeed");
+        assert(detected == type && "Codec id should be read from the header");
+        assert(input == decoded && "Decoded data should match original");
+    }
+
+    std::cout << "✓ Both codecs round trip through a frame" << std::endl;
+}
+
+void testMultipleBlocks() {
+    std::cout << "\n=== Test: Multiple Blocks ===" << std::endl;
+
+    std::vector<uint8_t> input;
+    for (int i = 0; i < 10000; i++) {
+        input.push_back(static_cast<uint8_t>((i / 7) % 13));
+    }
+
+    std::vector<uint8_t> framed, decoded;
+    assert(FrameFormat::compress(AlgorithmType::HUFFMAN, input, framed, 1024));
+
+    FrameHeader header;
+    assert(FrameFormat::readHeader(framed.data(), framed.size(), header));
+    assert(header.contentSize == input.size() && "Header should record content size");
+    assert(header.blockCount == 10 && "Input should be split into 1 KiB blocks");
+    assert(FrameFormat::frameLength(header) == framed.size());
+
+    assert(FrameFormat::decompress(framed, decoded));
+    assert(input == decoded && "Multi-block data should match");
+
+    std::cout << "✓ " << header.blockCount << " blocks decoded correctly" << std::endl;
+}
+
+void testStoredBlocks() {
+    std::cout << "\n=== Test: Stored Blocks ===" << std::endl;
+
+    // No runs at all: RLE would double the size, so the block is kept raw
+    std::vector<uint8_t> input;
+    for (int i = 0; i < 256; i++) {
+        input.push_back(static_cast<uint8_t>(i));
+    }
+
+    std::vector<uint8_t> framed, decoded;
+    assert(FrameFormat::compress(AlgorithmType::RLE, input, framed));
+    assert(framed.size() == input.size() + FrameFormat::HEADER_SIZE +
+                            FrameFormat::blockHeaderSize(FrameFormat::DEFAULT_FLAGS) +
+                            FrameFormat::trailerSize(FrameFormat::DEFAULT_FLAGS) &&
+           "Block should be stored");
+
+    assert(FrameFormat::decompress(framed, decoded));
+    assert(input == decoded && "Stored block should match");
+
+    std::cout << "✓ Incompressible block stored verbatim" << std::endl;
+}
+
+void testConcatenatedFrames() {
+    std::cout << "\n=== Test: Concatenated Frames ===" << std::endl;
+
+    std::vector<uint8_t> first(500, 'A');
+    std::vector<uint8_t> second = {'x', 'y', 'z', 'x', 'y', 'z'};
+
+    std::vector<uint8_t> framed, part, decoded;
+    assert(FrameFormat::compress(AlgorithmType::RLE, first, framed));
+    assert(FrameFormat::compress(AlgorithmType::HUFFMAN, second, part));
+    framed.insert(framed.end(), part.begin(), part.end());
+
+    assert(FrameFormat::decompress(framed, decoded));
+
+    std::vector<uint8_t> expected = first;
+    expected.insert(expected.end(), second.begin(), second.end());
+    assert(expected == decoded && "Concatenated frames should decode in order");
+
+    std::cout << "✓ Mixed-codec frames decoded back to back" << std::endl;
+}
+
+void testRejectsCorruptInput() {
+    std::cout << "\n=== Test: Corrupt Input ===" << std::endl;
+
+    std::vector<uint8_t> input(4096, 'B');
+    std::vector<uint8_t> framed, decoded;
+    assert(FrameFormat::compress(AlgorithmType::HUFFMAN, input, framed));
+
+    // Bad magic
+    std::vector<uint8_t> badMagic = framed;
+    badMagic[0] ^= 0xFF;
+    assert(!FrameFormat::decompress(badMagic, decoded) && "Bad magic should be rejected");
+
+    // Truncated payload
+    std::vector<uint8_t> truncated(framed.begin(), framed.end() - 1);
+    assert(!FrameFormat::decompress(truncated, decoded) && "Truncation should be rejected");
+
+    // Absurd content size must fail before any allocation
+    std::vector<uint8_t> hugeSize = framed;
+    hugeSize[15] = 0x7F;
+    assert(!FrameFormat::decompress(hugeSize, decoded) && "Huge content size should be rejected");
+
+    // Unknown codec id
+    std::vector<uint8_t> badCodec = framed;
+    badCodec[5] = 0x7E;
+    assert(!FrameFormat::decompress(badCodec, decoded) && "Unknown codec should be rejected");
+
+    // Content size larger than the caller allows
+    assert(!FrameFormat::decompress(framed.data(), framed.size(), decoded, nullptr, 100) &&
+           "Content over the limit should be rejected");
+
+    std::cout << "✓ Corrupt frames rejected" << std::endl;
+}
+
+void testEmptyContent() {
+    std::cout << "\n=== Test: Empty Content ===" << std::endl;
+
+    std::vector<uint8_t> input, framed, decoded;
+    assert(FrameFormat::compress(AlgorithmType::HUFFMAN, input, framed));
+    assert(framed.size() == FrameFormat::HEADER_SIZE +
+                            FrameFormat::trailerSize(FrameFormat::DEFAULT_FLAGS) &&
+           "Empty frame is header plus trailer");
+    assert(FrameFormat::decompress(framed, decoded));
+    assert(decoded.empty());
+
+    std::cout << "✓ Empty content handled correctly" << std::endl;
+}
+
+void testParallelMatchesSequential() {
+    std::cout << "\n=== Test: Parallel Frames ===" << std::endl;
+
+    // Runs for RLE, a skewed alphabet for Huffman, and some noise
+    std::vector<uint8_t> input(3 * PARALLEL_CHUNK_SIZE + 12345);
+    uint32_t state = 1;
+    for (size_t i = 0; i < input.size(); i++) {
+        state = state * 1103515245u + 12345u;
+        input[i] = (i % 4096 < 1024) ? static_cast<uint8_t>(state >> 24)
+                                      : static_cast<uint8_t>((i / 97) % 5);
+    }
+
+    ThreadPool pool(4);
+    for (AlgorithmType type : {AlgorithmType::HUFFMAN, AlgorithmType::RLE}) {
+        std::vector<uint8_t> sequential, parallel;
+        assert(FrameFormat::compress(type, input, sequential, 256 * 1024));
+        assert(FrameFormat::compressParallel(type, input.data(), input.size(), parallel, pool,
+                                             256 * 1024));
+        assert(parallel == sequential && "Splitting must not change the frame");
+
+        std::vector<uint8_t> decoded;
+        AlgorithmType detected = AlgorithmType::HUFFMAN;
+        assert(FrameFormat::decompressParallel(parallel.data(), parallel.size(), decoded, pool,
+                                               &detected));
+        assert(detected == type);
+        assert(decoded == input && "Parallel decode should match the original");
+    }
+
+    // A damaged byte in the last block is still caught
+    std::vector<uint8_t> framed, decoded;
+    assert(FrameFormat::compressParallel(AlgorithmType::RLE, input.data(), input.size(), framed,
+                                         pool));
+    framed[framed.size() - 10] ^= 0x40;
+    assert(!FrameFormat::decompressParallel(framed.data(), framed.size(), decoded, pool) &&
+           "Corruption should be detected");
+
+    std::cout << "✓ Parallel frames identical to sequential ones and round trip" << std::endl;
+}
+
+void testParallelCancelled() {
+    std::cout << "\n=== Test: Parallel Frames Cancelled ===" << std::endl;
+
+    std::vector<uint8_t> input(2 * PARALLEL_CHUNK_SIZE);
+    for (size_t i = 0; i < input.size(); i++) input[i] = static_cast<uint8_t>((i / 31) % 9);
+
+    ThreadPool pool(2);
+    std::atomic<bool> cancelled(false);
+    std::vector<uint8_t> framed;
+    assert(FrameFormat::compressParallel(AlgorithmType::RLE, input.data(), input.size(), framed,
+                                         pool, DEFAULT_FRAME_BLOCK_SIZE,
+                                         FrameFormat::DEFAULT_FLAGS, nullptr, &cancelled));
+
+    // Raised before the work starts: nothing is produced and the call fails
+    cancelled = true;
+    std::vector<uint8_t> output;
+    assert(!FrameFormat::compressParallel(AlgorithmType::RLE, input.data(), input.size(), output,
+                                          pool, DEFAULT_FRAME_BLOCK_SIZE,
+                                          FrameFormat::DEFAULT_FLAGS, nullptr, &cancelled));
+    assert(output.empty());
+    std::vector<uint8_t> decoded;
+    assert(!FrameFormat::decompressParallel(framed.data(), framed.size(), decoded, pool, nullptr,
+                                            std::numeric_limits<uint64_t>::max(), nullptr,
+                                            &cancelled));
+
+    std::cout << "✓ A raised cancel flag stops parallel compress and decompress" << std::endl;
+}
+
+void testStreamedBlocksMatchCompress() {
+    std::cout << "\n=== Test: Streamed Blocks Match Compress ===" << std::endl;
+
+    std::vector<uint8_t> input;
+    for (int i = 0; i < 10000; i++) {
+        input.push_back(static_cast<uint8_t>((i / 5) % 11));
+    }
+    const uint32_t blockSize = 1024;
+
+    for (AlgorithmType type : {AlgorithmType::HUFFMAN, AlgorithmType::RLE}) {
+        std::vector<uint8_t> expected;
+        assert(FrameFormat::compress(type, input, expected, blockSize));
+
+        // Blocks encoded one at a time, as a streamed upload arrives
+        auto codec = AlgorithmFactory::createAlgorithm(type);
+        std::vector<uint8_t> blocks;
+        uint32_t contentCrc = 0;
+        for (size_t offset = 0; offset < input.size(); offset += blockSize) {
+            const size_t length = std::min<size_t>(blockSize, input.size() - offset);
+            uint32_t blockCrc = 0;
+            assert(FrameFormat::encodeBlock(*codec, input.data() + offset, length, blocks,
+                                            FrameFormat::DEFAULT_FLAGS, blockCrc));
+            contentCrc = Checksum::crc32cCombine(contentCrc, blockCrc, length);
+        }
+
+        std::vector<uint8_t> envelope;
+        FrameFormat::encodeEnvelope(type, input.size(), blocks.size(), blockSize,
+                                    FrameFormat::DEFAULT_FLAGS, contentCrc, envelope);
+        std::vector<uint8_t> frame(envelope.begin(), envelope.begin() + FrameFormat::HEADER_SIZE);
+        frame.insert(frame.end(), blocks.begin(), blocks.end());
+        frame.insert(frame.end(), envelope.begin() + FrameFormat::HEADER_SIZE, envelope.end());
+        assert(frame == expected && "Header + blocks + trailer is the compress() frame");
+    }
+
+    std::cout << "✓ Block-at-a-time encoding rebuilds the same frame" << std::endl;
+}
+
+int main() {
+    Logger::init("test_frameFormat.log");
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "         Frame Format Tests            " << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    try {
+        testRoundTrip();
+        testMultipleBlocks();
+        testStoredBlocks();
+        testConcatenatedFrames();
+        testRejectsCorruptInput();
+        testEmptyContent();
+        testParallelMatchesSequential();
+        testParallelCancelled();
+        testStreamedBlocksMatchCompress();
+
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "  All tests passed successfully! ✓    " << std::endl;
+        std::cout << "========================================" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        Logger::close();
+        return 1;
+    }
+
+    Logger::close();
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <cassert>
 #include <string>
+#include <memory_resource>
 
 void testBasicCompression() {
     std::cout << "\n=== Test: Basic Compression ===" << std::endl;
@@ -105,6 +106,62 @@ void testBinaryData() {
     std::cout << "✓ Binary data handled correctly" << std::endl;
 }
 
+// Counts what the codec asks of its memory resource
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations = 0;
+    size_t deallocations = 0;
+
+private:
+    std::pmr::memory_resource* upstream = std::pmr::new_delete_resource();
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        allocations++;
+        return upstream->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        deallocations++;
+        upstream->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+void testMemoryResource() {
+    std::cout << "\n=== Test: Memory Resource ===" << std::endl;
+    
+    CountingResource counter;
+    std::string testStr = "temporaries should come from the arena, not the global heap";
+    std::vector<uint8_t> input(testStr.begin(), testStr.end());
+    std::vector<uint8_t> compressed, decompressed;
+    
+    {
+        Huffman huffman;
+        huffman.setMemoryResource(&counter);
+        assert(huffman.compress(input, compressed));
+        size_t afterCompress = counter.allocations;
+        assert(afterCompress > 0 && "Tree and codes should use the resource");
+        
+        // The workspace is reused, so a second block allocates nothing new
+        assert(huffman.decompress(compressed, decompressed));
+        assert(counter.allocations == afterCompress);
+        assert(decompressed == input);
+    }
+    assert(counter.deallocations == counter.allocations);
+    
+    // A monotonic arena takes the same codec and frees it all at once
+    std::pmr::monotonic_buffer_resource arena(4096);
+    Huffman arenaHuffman;
+    arenaHuffman.setMemoryResource(&arena);
+    decompressed.clear();
+    assert(arenaHuffman.decompress(compressed, decompressed));
+    assert(decompressed == input);
+    
+    std::cout << "Resource allocations: " << counter.allocations << std::endl;
+    std::cout << "✓ Codec temporaries allocated from the given resource" << std::endl;
+}
+
 int main() {
     Logger::init("test_huffman.log");
     
@@ -118,6 +175,7 @@ int main() {
         testSingleByte();
         testRepeatedBytes();
         testBinaryData();
+        testMemoryResource();
         
         std::cout << "\n========================================" << std::endl;
         std::cout << "  All tests passed successfully! ✓    " << std::endl;
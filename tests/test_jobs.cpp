@@ -0,0 +1,437 @@
+#include "jobManager.h"
+#include "jobFormat.h"
+#include "workerthread.h"
+#include "threadPool.h"
+#include "frameFormat.h"
+#include "memoryBudget.h"
+#include "bufferPool.h"
+#include "logger.h"
+#include "config.h"
+#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::vector<uint8_t> patterned(size_t size) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++) data[i] = static_cast<uint8_t>((i * i >> 9) % 23);
+    return data;
+}
+
+// Collects replies, which may arrive from other threads
+struct Inbox {
+    std::mutex mutex;
+    std::condition_variable arrived;
+    std::deque<Response> replies;
+
+    JobManager::Reply reply() {
+        return [this](Response&& response) {
+            std::lock_guard<std::mutex> lock(mutex);
+            replies.push_back(std::move(response));
+            arrived.notify_all();
+        };
+    }
+
+    Response next() {
+        std::unique_lock<std::mutex> lock(mutex);
+        const bool got = arrived.wait_for(lock, std::chrono::seconds(10),
+                                          [this] { return !replies.empty(); });
+        assert(got && "Every job message is answered");
+        Response response = std::move(replies.front());
+        replies.pop_front();
+        return response;
+    }
+
+    bool empty() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return replies.empty();
+    }
+};
+
+static Request jobMessage(MessageType type, uint64_t id) {
+    return Request(type, AlgorithmType::HUFFMAN, "", JobFormat::encodeId(id));
+}
+
+static uint64_t submitJob(ThreadPool& pool, Inbox& inbox, std::vector<uint8_t> data,
+                          JobFormat::Status& status) {
+    Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN, "job.bin",
+                    std::move(data));
+    request.setSaveOutput(false);
+    request.setSubmitted(true);
+    assert(JobManager::isJobMessage(request));
+    JobManager::instance().handle(std::move(request), &pool, 1, inbox.reply());
+
+    Response ack = inbox.next();
+    assert(ack.getStatus() == OperationStatus::IN_PROGRESS);
+    assert(JobFormat::decodeStatus(ack.getData(), status));
+    assert(status.id != 0);
+    return status.id;
+}
+
+// Holds the only worker of a pool until released
+struct Gate {
+    std::atomic<bool> open{false};
+    std::atomic<bool> closed{false};
+
+    void block(ThreadPool& pool) {
+        pool.submit([this] {
+            closed = true;
+            while (!open) std::this_thread::yield();
+        });
+        while (!closed) std::this_thread::yield();
+    }
+};
+
+void testStatusRoundTrip() {
+    std::cout << "\n=== Test: Status Round Trip ===" << std::endl;
+
+    JobFormat::Status status;
+    status.id = 0x0123456789abcdefull;
+    status.done = 5;
+    status.total = 1ull << 40;
+    JobFormat::Status decoded;
+    assert(JobFormat::decodeStatus(JobFormat::encodeStatus(status), decoded));
+    assert(decoded.id == status.id && decoded.done == 5 && decoded.total == status.total);
+
+    uint64_t id = 0;
+    assert(JobFormat::decodeId(JobFormat::encodeId(42), id) && id == 42);
+    assert(!JobFormat::decodeId(std::vector<uint8_t>(7), id) && "Exactly 8 bytes");
+    assert(!JobFormat::decodeStatus(JobFormat::encodeId(42), decoded));
+
+    Request plain(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "x", {});
+    assert(!JobManager::isJobMessage(plain) && "Only submitted requests are jobs");
+
+    std::cout << "✓ IDs and statuses survive encoding; wrong sizes are refused" << std::endl;
+}
+
+void testWorkerReportsProgress() {
+    std::cout << "\n=== Test: Worker Reports Progress ===" << std::endl;
+
+    // Large enough to be split over the pool, so progress comes piece by piece
+    const std::vector<uint8_t> data = patterned(PARALLEL_MIN_REQUEST_SIZE + 12345);
+    ThreadPool pool(4);
+    std::atomic<uint64_t> progress(0);
+    WorkerThread worker(INVALID_SOCKET, &pool);
+    worker.setProgress(&progress);
+
+    Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN, "progress.bin",
+                    std::vector<uint8_t>(data));
+    request.setSaveOutput(false);
+    Response response = worker.handleRequest(request);
+    assert(response.getStatus() == OperationStatus::SUCCESS);
+    assert(progress == data.size() && "Every piece counted once");
+
+    std::cout << "✓ " << progress << " of " << data.size() << " bytes reported" << std::endl;
+}
+
+void testSubmitThenWait() {
+    std::cout << "\n=== Test: Submit Then Wait ===" << std::endl;
+
+    const std::vector<uint8_t> data = patterned(3 * 1024 * 1024);
+    ThreadPool pool(2);
+    Inbox inbox;
+    const JobManager::Stats before = JobManager::instance().getStats();
+
+    JobFormat::Status status;
+    const uint64_t id = submitJob(pool, inbox, data, status);
+    assert(status.total == data.size());
+
+    JobManager::instance().handle(jobMessage(MessageType::WAIT_REQUEST, id), &pool, 1,
+                                  inbox.reply());
+    Response result = inbox.next();
+    assert(result.getStatus() == OperationStatus::SUCCESS);
+    std::vector<uint8_t> restored;
+    assert(FrameFormat::decompress(result.getData(), restored));
+    assert(restored == data);
+
+    // A result is handed out once
+    JobManager::instance().handle(jobMessage(MessageType::POLL_REQUEST, id), &pool, 1,
+                                  inbox.reply());
+    Response again = inbox.next();
+    assert(again.getStatus() == OperationStatus::FAILURE);
+
+    const JobManager::Stats after = JobManager::instance().getStats();
+    assert(after.submitted == before.submitted + 1);
+    assert(after.completed == before.completed + 1);
+
+    std::cout << "✓ Job " << id << " acknowledged, then its result collected once" << std::endl;
+}
+
+void testPollWhileQueued() {
+    std::cout << "\n=== Test: Poll While Queued ===" << std::endl;
+
+    Gate gate;      // outlives the pool, whose worker it holds
+    ThreadPool pool(1);
+    gate.block(pool);
+    Inbox inbox;
+
+    JobFormat::Status status;
+    const uint64_t id = submitJob(pool, inbox, patterned(4096), status);
+
+    JobManager::instance().handle(jobMessage(MessageType::POLL_REQUEST, id), &pool, 1,
+                                  inbox.reply());
+    Response polled = inbox.next();
+    assert(polled.getStatus() == OperationStatus::IN_PROGRESS);
+    assert(JobFormat::decodeStatus(polled.getData(), status));
+    assert(status.id == id && status.done == 0 && status.total == 4096);
+    assert(polled.getMessage().find("queued") != std::string::npos);
+    assert(JobManager::instance().getStats().queued >= 1);
+
+    // The WAIT holds no worker: the only one is still blocked
+    JobManager::instance().handle(jobMessage(MessageType::WAIT_REQUEST, id), &pool, 1,
+                                  inbox.reply());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    assert(inbox.empty());
+
+    gate.open = true;
+    assert(inbox.next().getStatus() == OperationStatus::SUCCESS);
+
+    std::cout << "✓ Polled as queued; the waiting request was answered when it ran" << std::endl;
+}
+
+void testCancelQueuedJob() {
+    std::cout << "\n=== Test: Cancel Queued Job ===" << std::endl;
+
+    Gate gate;
+    ThreadPool pool(1);
+    gate.block(pool);
+    Inbox inbox;
+    const size_t budgetBefore = MemoryBudget::instance().getInUse();
+
+    JobFormat::Status status;
+    const uint64_t id = submitJob(pool, inbox, patterned(64 * 1024), status);
+    assert(MemoryBudget::instance().getInUse() > budgetBefore && "The payload is charged");
+
+    JobManager::instance().handle(jobMessage(MessageType::WAIT_REQUEST, id), &pool, 1,
+                                  inbox.reply());
+    JobManager::instance().handle(jobMessage(MessageType::CANCEL_REQUEST, id), &pool, 1,
+                                  inbox.reply());
+    Response waited = inbox.next();
+    Response cancelled = inbox.next();
+    assert(waited.getStatus() == OperationStatus::FAILURE && "The waiter hears of it");
+    assert(cancelled.getStatus() == OperationStatus::SUCCESS);
+    assert(MemoryBudget::instance().getInUse() == budgetBefore);
+
+    JobManager::instance().handle(jobMessage(MessageType::CANCEL_REQUEST, id), &pool, 1,
+                                  inbox.reply());
+    assert(inbox.next().getStatus() == OperationStatus::FAILURE && "Already gone");
+
+    const uint64_t completedBefore = JobManager::instance().getStats().completed;
+    gate.open = true;
+    pool.shutdown();
+    assert(JobManager::instance().getStats().completed == completedBefore && "Never ran");
+
+    std::cout << "✓ Cancelled before it started; budget returned" << std::endl;
+}
+
+void testWaitTimesOut() {
+    std::cout << "\n=== Test: Wait Times Out ===" << std::endl;
+
+    JobManager::instance().setWaitTimeout(std::chrono::milliseconds(50));
+    Gate gate;
+    ThreadPool pool(1);
+    gate.block(pool);
+    Inbox inbox;
+
+    JobFormat::Status status;
+    const uint64_t id = submitJob(pool, inbox, patterned(4096), status);
+
+    const auto started = std::chrono::steady_clock::now();
+    JobManager::instance().handle(jobMessage(MessageType::WAIT_REQUEST, id), &pool, 1,
+                                  inbox.reply());
+    Response waited = inbox.next();
+    const auto waitedFor = std::chrono::steady_clock::now() - started;
+    assert(waited.getStatus() == OperationStatus::IN_PROGRESS);
+    assert(JobFormat::decodeStatus(waited.getData(), status) && status.id == id);
+    assert(waitedFor >= std::chrono::milliseconds(50));
+
+    gate.open = true;
+    JobManager::instance().setWaitTimeout(std::chrono::milliseconds(JOB_WAIT_MS));
+    JobManager::instance().handle(jobMessage(MessageType::WAIT_REQUEST, id), &pool, 1,
+                                  inbox.reply());
+    assert(inbox.next().getStatus() == OperationStatus::SUCCESS);
+
+    std::cout << "✓ WAIT answered IN_PROGRESS after "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(waitedFor).count()
+              << " ms, then with the result" << std::endl;
+}
+
+void testUncollectedResultExpires() {
+    std::cout << "\n=== Test: Uncollected Result Expires ===" << std::endl;
+
+    JobManager::instance().setResultTtl(std::chrono::milliseconds(50));
+    ThreadPool pool(1);
+    Inbox inbox;
+    const uint64_t expiredBefore = JobManager::instance().getStats().expired;
+
+    JobFormat::Status status;
+    const uint64_t id = submitJob(pool, inbox, patterned(4096), status);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (JobManager::instance().getStats().expired == expiredBefore &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(JobManager::instance().getStats().expired == expiredBefore + 1);
+
+    JobManager::instance().handle(jobMessage(MessageType::POLL_REQUEST, id), &pool, 1,
+                                  inbox.reply());
+    assert(inbox.next().getStatus() == OperationStatus::FAILURE);
+
+    Request malformed(MessageType::POLL_REQUEST, AlgorithmType::HUFFMAN, "",
+                      std::vector<uint8_t>{1, 2, 3});
+    JobManager::instance().handle(std::move(malformed), &pool, 1, inbox.reply());
+    assert(inbox.next().getStatus() == OperationStatus::FAILURE);
+    JobManager::instance().setResultTtl(std::chrono::seconds(JOB_RESULT_TTL_SECONDS));
+
+    std::cout << "✓ Result dropped after its time to live" << std::endl;
+}
+
+void testUncollectedResultsStayCharged() {
+    std::cout << "\n=== Test: Uncollected Results Stay Charged ===" << std::endl;
+
+    JobManager::instance().setResultTtl(std::chrono::milliseconds(300));
+    MemoryBudget& budget = MemoryBudget::instance();
+    const size_t limitBefore = budget.getLimit();
+    const size_t budgetBefore = budget.getInUse();
+    const uint64_t expiredBefore = JobManager::instance().getStats().expired;
+    ThreadPool pool(1);
+    Inbox inbox;
+
+    // Submitted and never collected
+    JobFormat::Status status;
+    submitJob(pool, inbox, patterned(64 * 1024), status);
+    while (JobManager::instance().getStats().finished == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const size_t held = budget.getInUse() - budgetBefore;
+    assert(held > 0 && "The waiting result is charged");
+    assert(held < MemoryBudget::chargeFor(64 * 1024) && "Only the result, not the payload");
+
+    // With the budget taken up by results, further submits are turned away
+    budget.setLimit(budget.getInUse() + MemoryBudget::chargeFor(4096) - 1);
+    Request refused(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN, "busy.bin",
+                    patterned(4096));
+    refused.setSubmitted(true);
+    JobManager::instance().handle(std::move(refused), &pool, 1, inbox.reply());
+    assert(inbox.next().getStatus() == OperationStatus::BUSY);
+    budget.setLimit(limitBefore);
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (JobManager::instance().getStats().expired == expiredBefore &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(JobManager::instance().getStats().expired == expiredBefore + 1);
+    assert(budget.getInUse() == budgetBefore && "Expiry returns the charge");
+    JobManager::instance().setResultTtl(std::chrono::seconds(JOB_RESULT_TTL_SECONDS));
+
+    std::cout << "✓ " << held << " bytes held until expiry; submits refused meanwhile"
+              << std::endl;
+}
+
+void testLargeSubmitChargedOnce() {
+    std::cout << "\n=== Test: Large Submit Charged Once ===" << std::endl;
+
+    // Room for the payload's charge once but not twice, on an idle server
+    MemoryBudget& budget = MemoryBudget::instance();
+    const size_t limitBefore = budget.getLimit();
+    const size_t budgetBefore = budget.getInUse();
+    const size_t size = 256 * 1024;
+    budget.setLimit(budgetBefore + 3 * size);
+    ThreadPool pool(1);
+    Inbox inbox;
+
+    // Admitted the way a connection does, then handed to the job
+    const size_t charge = MemoryBudget::chargeFor(size);
+    assert(budget.tryReserve(charge));
+    Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN, "large.bin",
+                    patterned(size));
+    request.setSaveOutput(false);
+    request.setSubmitted(true);
+    request.setAdmission(MemoryBudget::Hold(charge));
+    JobManager::instance().handle(std::move(request), &pool, 1, inbox.reply());
+    Response ack = inbox.next();
+    assert(ack.getStatus() == OperationStatus::IN_PROGRESS && "Not BUSY");
+    JobFormat::Status status;
+    assert(JobFormat::decodeStatus(ack.getData(), status));
+
+    {
+        Response result;
+        do {
+            JobManager::instance().handle(jobMessage(MessageType::WAIT_REQUEST, status.id),
+                                          &pool, 1, inbox.reply());
+            result = inbox.next();
+        } while (result.getStatus() == OperationStatus::IN_PROGRESS);
+        assert(result.getStatus() == OperationStatus::SUCCESS);
+        BufferPool::instance().release(result.takeData());
+    }
+    assert(budget.getInUse() == budgetBefore && "The charge went with the result");
+    budget.setLimit(limitBefore);
+
+    std::cout << "✓ " << size << "-byte job accepted under a " << 3 * size
+              << "-byte budget" << std::endl;
+}
+
+void testShutdownRefuses() {
+    std::cout << "\n=== Test: Shutdown Refuses ===" << std::endl;
+
+    Gate gate;
+    ThreadPool pool(1);
+    gate.block(pool);
+    Inbox inbox;
+
+    JobFormat::Status status;
+    const uint64_t id = submitJob(pool, inbox, patterned(4096), status);
+    JobManager::instance().handle(jobMessage(MessageType::WAIT_REQUEST, id), &pool, 1,
+                                  inbox.reply());
+
+    JobManager::instance().shutdown();
+    assert(inbox.next().getStatus() == OperationStatus::FAILURE && "Waiters are answered");
+    gate.open = true;
+    pool.shutdown();
+
+    Request late(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "late", patterned(100));
+    late.setSubmitted(true);
+    JobManager::instance().handle(std::move(late), &pool, 1, inbox.reply());
+    assert(inbox.next().getStatus() == OperationStatus::FAILURE);
+
+    std::cout << "✓ Queued job cancelled, waiter answered, later submits refused" << std::endl;
+}
+
+int main() {
+    Logger::init("test_jobs.log");
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "         Background Job Tests          " << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    try {
+        testStatusRoundTrip();
+        testWorkerReportsProgress();
+        testSubmitThenWait();
+        testPollWhileQueued();
+        testCancelQueuedJob();
+        testWaitTimesOut();
+        testUncollectedResultExpires();
+        testUncollectedResultsStayCharged();
+        testLargeSubmitChargedOnce();
+        testShutdownRefuses();
+
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "  All tests passed successfully! ✓    " << std::endl;
+        std::cout << "========================================" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        Logger::close();
+        return 1;
+    }
+
+    Logger::close();
+    return 0;
+}
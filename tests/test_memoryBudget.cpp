@@ -0,0 +1,161 @@
+#include "memoryBudget.h"
+#include "workerthread.h"
+#include "frameFormat.h"
+#include "config.h"
+#include "logger.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+void testReserveAndRelease() {
+    std::cout << "\n=== Test: Reserve And Release ===" << std::endl;
+
+    MemoryBudget& budget = MemoryBudget::instance();
+    budget.setLimit(1000);
+
+    assert(budget.tryReserve(600));
+    assert(budget.tryReserve(400) && "Exactly the limit fits");
+    assert(!budget.tryReserve(1) && "Nothing more fits");
+    assert(budget.getInUse() == 1000);
+
+    budget.release(400);
+    assert(budget.tryReserve(300));
+    budget.release(300);
+    budget.release(600);
+    assert(budget.getInUse() == 0);
+
+    MemoryBudget::Stats stats = budget.getStats();
+    assert(stats.peak == 1000);
+    assert(stats.deferred >= 1);
+
+    std::cout << "✓ Reservations bounded by the limit" << std::endl;
+}
+
+void testOversizedNeverFits() {
+    std::cout << "\n=== Test: Oversized Request ===" << std::endl;
+
+    MemoryBudget& budget = MemoryBudget::instance();
+    budget.setLimit(1000);
+
+    assert(budget.exceedsLimit(1001));
+    assert(!budget.tryReserve(1001));
+    auto start = std::chrono::steady_clock::now();
+    assert(!budget.reserve(1001, std::chrono::milliseconds(5000)));
+    assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(1) &&
+           "No point waiting for more than the whole budget");
+    assert(MemoryBudget::chargeFor(600) > 1000 && "Charge covers the response too");
+
+    std::cout << "✓ Requests larger than the budget refused immediately" << std::endl;
+}
+
+void testBlockingReserve() {
+    std::cout << "\n=== Test: Blocking Reserve ===" << std::endl;
+
+    MemoryBudget& budget = MemoryBudget::instance();
+    budget.setLimit(1000);
+    assert(budget.tryReserve(800));
+
+    // Times out while the budget stays full
+    auto start = std::chrono::steady_clock::now();
+    assert(!budget.reserve(500, std::chrono::milliseconds(50)));
+    assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(50));
+
+    // Succeeds as soon as another thread gives bytes back
+    std::thread releaser([&budget] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        budget.release(800);
+    });
+    assert(budget.reserve(500, std::chrono::seconds(5)));
+    releaser.join();
+    budget.release(500);
+    assert(budget.getInUse() == 0);
+
+    std::cout << "✓ Waiters wake when budget is released" << std::endl;
+}
+
+void testHoldReturnsOnDestruction() {
+    std::cout << "\n=== Test: Hold Returns On Destruction ===" << std::endl;
+
+    MemoryBudget& budget = MemoryBudget::instance();
+    budget.setLimit(1000);
+    assert(budget.tryReserve(300) && budget.tryReserve(200));
+    {
+        MemoryBudget::Hold hold(300);
+        MemoryBudget::Hold moved(std::move(hold));
+        moved.absorb(MemoryBudget::Hold(200));
+        assert(hold.getBytes() == 0 && moved.getBytes() == 500);
+        assert(budget.getInUse() == 500 && "Moving gives nothing back");
+    }
+    assert(budget.getInUse() == 0);
+
+    std::cout << "✓ Held bytes returned once, by the last owner" << std::endl;
+}
+
+void testDecompressionOutputCharged() {
+    std::cout << "\n=== Test: Decompression Output Charged ===" << std::endl;
+
+    // 1 MiB of one byte: RLE shrinks it about a hundredfold
+    const std::vector<uint8_t> content(1024 * 1024, 'z');
+    std::vector<uint8_t> frame;
+    assert(FrameFormat::compress(AlgorithmType::RLE, content, frame));
+    auto decompress = [&frame] {
+        Request request(MessageType::DECOMPRESS_REQUEST, AlgorithmType::RLE, "z.bin",
+                        std::vector<uint8_t>(frame));
+        request.setSaveOutput(false);
+        WorkerThread worker(INVALID_SOCKET, nullptr);
+        return worker.handleRequest(request);
+    };
+
+    // Output that could never fit, and output that does not fit right now
+    MemoryBudget& budget = MemoryBudget::instance();
+    budget.setLimit(256 * 1024);
+    assert(decompress().getStatus() == OperationStatus::FAILURE);
+    budget.setLimit(4 * 1024 * 1024);
+    assert(budget.tryReserve(3 * 1024 * 1024 + 512 * 1024));
+    assert(decompress().getStatus() == OperationStatus::BUSY);
+    budget.release(3 * 1024 * 1024 + 512 * 1024);
+    assert(budget.getInUse() == 0 && "Refused output holds nothing");
+
+    // Held with the response beyond what the payload pays for, until it goes
+    {
+        Response response = decompress();
+        assert(response.getStatus() == OperationStatus::SUCCESS);
+        assert(response.getData() == content);
+        assert(budget.getInUse() == content.size() - frame.size());
+    }
+    assert(budget.getInUse() == 0);
+
+    std::cout << "✓ " << frame.size() << "-byte frame charged for its "
+              << content.size() << "-byte output before decoding" << std::endl;
+}
+
+int main() {
+    Logger::init("test_memoryBudget.log");
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "         Memory Budget Tests           " << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    try {
+        testReserveAndRelease();
+        testOversizedNeverFits();
+        testBlockingReserve();
+        testHoldReturnsOnDestruction();
+        testDecompressionOutputCharged();
+
+        MemoryBudget::instance().setLimit(SERVER_MEMORY_BUDGET);
+
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "  All tests passed successfully! ✓    " << std::endl;
+        std::cout << "========================================" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        Logger::close();
+        return 1;
+    }
+
+    Logger::close();
+    return 0;
+}
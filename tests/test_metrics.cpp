@@ -0,0 +1,202 @@
+#include "metrics.h"
+#include "workerthread.h"
+#include "logger.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::chrono::microseconds;
+
+static const Metrics::Cell& cellFor(const Metrics::Snapshot& snapshot, MessageType type,
+                                    AlgorithmType algorithm) {
+    return snapshot.cells[static_cast<size_t>(type) - 1][static_cast<size_t>(algorithm) - 1];
+}
+
+void testHistogramBuckets() {
+    std::cout << "\n=== Test: Histogram Buckets ===" << std::endl;
+
+    size_t previous = 0;
+    for (uint64_t value = 0; value < 1000000; value += 1 + value / 50) {
+        const size_t bucket = Metrics::Histogram::bucketFor(value);
+        const uint64_t bound = Metrics::Histogram::upperBound(bucket);
+        assert(bucket >= previous && "Buckets follow the values");
+        assert(bound >= value && "A value is never above its bucket's bound");
+        assert(bound - value <= value / Metrics::SUB_BUCKETS && "Within 1/8 of the value");
+        previous = bucket;
+    }
+    for (size_t bucket = 0; bucket + 1 < Metrics::HISTOGRAM_BUCKETS; bucket++) {
+        const uint64_t bound = Metrics::Histogram::upperBound(bucket);
+        assert(Metrics::Histogram::bucketFor(bound) == bucket);
+        assert(Metrics::Histogram::bucketFor(bound + 1) == bucket + 1 && "No gaps");
+    }
+    assert(Metrics::Histogram::bucketFor(UINT64_MAX) < Metrics::HISTOGRAM_BUCKETS);
+
+    std::cout << "✓ " << Metrics::HISTOGRAM_BUCKETS << " buckets, each within 12.5%" << std::endl;
+}
+
+void testPercentiles() {
+    std::cout << "\n=== Test: Percentiles ===" << std::endl;
+
+    Metrics& metrics = Metrics::instance();
+    metrics.reset();
+    for (int i = 1; i <= 1000; i++) {
+        metrics.recordRequest(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN,
+                              100, 40, i % 100 != 0, microseconds(i));
+    }
+
+    const Metrics::Snapshot snapshot = metrics.snapshot();
+    const Metrics::Cell& cell =
+        cellFor(snapshot, MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN);
+    assert(cell.requests == 1000 && cell.failures == 10);
+    assert(cell.bytesIn == 100000 && cell.bytesOut == 40000);
+    assert(cell.latency.count == 1000 && cell.latency.max == 1000);
+    assert(cell.latency.sum == 500500);
+
+    const uint64_t p50 = cell.latency.percentile(0.5);
+    const uint64_t p99 = cell.latency.percentile(0.99);
+    assert(p50 >= 500 && p50 <= 500 + 500 / 8);
+    assert(p99 >= 990 && p99 <= 1000 && "Clamped to the largest value seen");
+    assert(cellFor(snapshot, MessageType::COMPRESS_REQUEST, AlgorithmType::RLE).requests == 0);
+
+    std::cout << "✓ p50=" << p50 << "us p99=" << p99 << "us" << std::endl;
+}
+
+void testConcurrentRecording() {
+    std::cout << "\n=== Test: Concurrent Recording ===" << std::endl;
+
+    Metrics& metrics = Metrics::instance();
+    metrics.reset();
+
+    // Two rounds: the second round's threads take over the first's shards
+    const int threadCount = 8;
+    const int perThread = 20000;
+    for (int round = 0; round < 2; round++) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; t++) {
+            threads.emplace_back([&metrics, t] {
+                for (int i = 0; i < perThread; i++) {
+                    metrics.recordRequest(MessageType::DECOMPRESS_REQUEST, AlgorithmType::RLE,
+                                          1, 2, true, microseconds(t * 10 + i % 7));
+                }
+                metrics.connectionOpened();
+            });
+        }
+        for (auto& thread : threads) thread.join();
+    }
+
+    const Metrics::Snapshot snapshot = metrics.snapshot();
+    const Metrics::Cell& cell =
+        cellFor(snapshot, MessageType::DECOMPRESS_REQUEST, AlgorithmType::RLE);
+    assert(cell.requests == 2ull * threadCount * perThread && "No update lost");
+    assert(cell.latency.count == cell.requests);
+    assert(cell.bytesOut == 2 * cell.bytesIn);
+    assert(snapshot.connectionsOpened == 2 * threadCount);
+
+    std::cout << "✓ " << cell.requests << " requests from " << 2 * threadCount
+              << " threads counted exactly" << std::endl;
+}
+
+void testWorkerReportsRequests() {
+    std::cout << "\n=== Test: Worker Reports Requests ===" << std::endl;
+
+    Metrics& metrics = Metrics::instance();
+    metrics.reset();
+    metrics.connectionOpened();
+
+    WorkerThread worker;
+    std::vector<uint8_t> data(64 * 1024, 'a');
+    Request compress(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "metrics.txt",
+                     std::move(data));
+    compress.setSaveOutput(false);
+    Response compressed = worker.handleRequest(compress);
+    assert(compressed.getStatus() == OperationStatus::SUCCESS);
+
+    Request stats(MessageType::STATS_REQUEST, AlgorithmType::HUFFMAN, "", {});
+    Response response = worker.handleRequest(stats);
+    assert(response.getStatus() == OperationStatus::SUCCESS);
+    const std::string report(response.getData().begin(), response.getData().end());
+
+    const std::string labels = "{type=\"COMPRESS_REQUEST\",algorithm=\"RLE\"}";
+    assert(report.find("requests_total" + labels + " 1\n") != std::string::npos);
+    assert(report.find("request_bytes_in_total" + labels + " 65536\n") != std::string::npos);
+    assert(report.find("request_bytes_out_total" + labels + " " +
+                       std::to_string(compressed.getData().size()) + "\n") != std::string::npos);
+    assert(report.find("request_latency_us{type=\"COMPRESS_REQUEST\",algorithm=\"RLE\","
+                       "quantile=\"0.99\"}") != std::string::npos);
+    assert(report.find("connections_active 1\n") != std::string::npos);
+    assert(report.find("result_cache_hits_total") != std::string::npos);
+    assert(report.find("write_behind_failed_total") != std::string::npos);
+
+    std::cout << "✓ Report covers the request and the other subsystems:\n" << report;
+}
+
+void testWorkerStageTiming() {
+    std::cout << "\n=== Test: Worker Stage Timing ===" << std::endl;
+
+    WorkerThread worker;
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<uint8_t> data(256 * 1024);
+    for (size_t i = 0; i < data.size(); i++) data[i] = static_cast<uint8_t>(i * i >> 7);
+
+    // As if the payload took 2 ms to arrive and then waited 3 ms for a worker
+    Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN, "timed.bin",
+                    std::vector<uint8_t>(data));
+    request.setSaveOutput(false);
+    request.setTimingRequested(true);
+    request.setReceiveTimes(now - std::chrono::milliseconds(5), now - std::chrono::milliseconds(3));
+    Response response = worker.handleRequest(request);
+    assert(response.getStatus() == OperationStatus::SUCCESS && response.hasTiming());
+
+    const StageTiming& timing = response.getTiming();
+    assert(timing.receiveMicros >= 2000 && timing.receiveMicros < 2100);
+    assert(timing.queueMicros >= 3000);
+    assert(timing.codecMicros > 0 && timing.cpuMicros > 0);
+    assert(timing.totalMicros >= timing.receiveMicros + timing.queueMicros + timing.codecMicros);
+    std::cout << "✓ receive " << timing.receiveMicros << "us, queue " << timing.queueMicros
+              << "us, codec " << timing.codecMicros << "us, cpu " << timing.cpuMicros << "us"
+              << std::endl;
+
+    // The same payload again is a cache hit: lookup, no codec
+    Request repeat(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN, "timed.bin",
+                   std::move(data));
+    repeat.setSaveOutput(false);
+    repeat.setTimingRequested(true);
+    Response cached = worker.handleRequest(repeat);
+    assert(cached.hasTiming() && cached.getTiming().receiveMicros == 0);
+    assert(cached.getTiming().codecMicros < timing.codecMicros);
+
+    Request untimed(MessageType::STATS_REQUEST, AlgorithmType::HUFFMAN, "", {});
+    assert(!worker.handleRequest(untimed).hasTiming() && "Timing only when asked for");
+
+    std::cout << "✓ Cached repeat: lookup " << cached.getTiming().lookupMicros << "us, codec "
+              << cached.getTiming().codecMicros << "us" << std::endl;
+}
+
+int main() {
+    Logger::init("test_metrics.log");
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "            Metrics Tests              " << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    try {
+        testHistogramBuckets();
+        testPercentiles();
+        testConcurrentRecording();
+        testWorkerReportsRequests();
+        testWorkerStageTiming();
+
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "  All tests passed successfully! ✓    " << std::endl;
+        std::cout << "========================================" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        Logger::close();
+        return 1;
+    }
+
+    Logger::close();
+    return 0;
+}
@@ -0,0 +1,202 @@
+#include "objectStore.h"
+#include "logger.h"
+#include <iostream>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static const std::string STORE_PATH = "./test_store/";
+
+static std::vector<uint8_t> bytes(size_t size, uint8_t seed) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++) data[i] = static_cast<uint8_t>(seed * 31 + i);
+    return data;
+}
+
+static ResultCache::Key keyOf(uint8_t seed) {
+    return ResultCache::keyFor(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN,
+                               bytes(100, seed));
+}
+
+void testStoreAndFetch() {
+    std::cout << "\n=== Test: Store And Fetch ===" << std::endl;
+
+    fs::remove_all(STORE_PATH);
+    ObjectStore& store = ObjectStore::instance();
+    assert(store.open(STORE_PATH, 1024 * 1024, 64));
+
+    std::vector<uint8_t> data;
+    std::string name, message;
+    assert(!store.fetch(keyOf(1), data, name, message));
+
+    assert(store.store(keyOf(1), bytes(5000, 1), "Huffman", "Compression successful"));
+    assert(store.store(keyOf(1), bytes(5000, 1), "Huffman", "again") && "Storing twice is a no-op");
+    assert(store.fetch(keyOf(1), data, name, message));
+    assert(data == bytes(5000, 1));
+    assert(name == "Huffman" && message == "Compression successful");
+
+    // The codec is part of the address
+    ResultCache::Key rle = ResultCache::keyFor(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE,
+                                               bytes(100, 1));
+    assert(!store.fetch(rle, data, name, message));
+
+    ObjectStore::Stats stats = store.getStats();
+    assert(stats.objects == 1 && stats.bytes == 5000 && stats.stores == 1);
+    std::cout << "✓ Stored objects read back intact" << std::endl;
+}
+
+void testSurvivesRestart() {
+    std::cout << "\n=== Test: Survives Restart ===" << std::endl;
+
+    ObjectStore& store = ObjectStore::instance();
+    assert(store.store(keyOf(2), bytes(3000, 2), "Huffman", "second"));
+    store.close();
+    assert(!store.isOpen());
+
+    // Reopening maps the same index; nothing has to be recomputed
+    assert(store.open(STORE_PATH, 1024 * 1024, 64));
+    assert(store.getStats().objects == 2);
+
+    std::vector<uint8_t> data;
+    std::string name, message;
+    assert(store.fetch(keyOf(1), data, name, message) && data == bytes(5000, 1));
+    assert(store.fetch(keyOf(2), data, name, message) && message == "second");
+
+    // An index of a different shape is rebuilt empty
+    store.close();
+    assert(store.open(STORE_PATH, 1024 * 1024, 128));
+    assert(store.getStats().objects == 0);
+    assert(!store.fetch(keyOf(1), data, name, message));
+
+    std::cout << "✓ Index reopened warm after close" << std::endl;
+}
+
+void testEvictsLeastRecentlyUsed() {
+    std::cout << "\n=== Test: Evicts Least Recently Used ===" << std::endl;
+
+    fs::remove_all(STORE_PATH);
+    ObjectStore& store = ObjectStore::instance();
+    assert(store.open(STORE_PATH, 10000, 64));
+
+    assert(store.store(keyOf(1), bytes(4000, 1), "Huffman", ""));
+    assert(store.store(keyOf(2), bytes(4000, 2), "Huffman", ""));
+
+    std::vector<uint8_t> data;
+    std::string name, message;
+    assert(store.fetch(keyOf(1), data, name, message)); // 2 is now the oldest
+
+    assert(store.store(keyOf(3), bytes(4000, 3), "Huffman", ""));
+    assert(store.fetch(keyOf(1), data, name, message));
+    assert(!store.fetch(keyOf(2), data, name, message) && "Oldest object evicted");
+    assert(store.fetch(keyOf(3), data, name, message));
+
+    ObjectStore::Stats stats = store.getStats();
+    assert(stats.bytes <= 10000 && stats.evictions == 1);
+    assert(!store.store(keyOf(4), bytes(20000, 4), "Huffman", "") && "Larger than the store");
+
+    // Recency outlives a restart
+    store.close();
+    assert(store.open(STORE_PATH, 10000, 64));
+    assert(store.fetch(keyOf(1), data, name, message)); // 3 is now the oldest
+    assert(store.store(keyOf(5), bytes(4000, 5), "Huffman", ""));
+    assert(!store.fetch(keyOf(3), data, name, message));
+    assert(store.fetch(keyOf(1), data, name, message));
+
+    // Many small objects: the index never fills up
+    for (uint8_t seed = 10; seed < 200; seed++) {
+        assert(store.store(keyOf(seed), bytes(10, seed), "Huffman", ""));
+    }
+    assert(store.getStats().objects <= 48);
+    assert(store.fetch(keyOf(199), data, name, message) && data == bytes(10, 199));
+
+    std::cout << "✓ Disk use bounded by evicting least recently used" << std::endl;
+}
+
+void testStrayFilesRemoved() {
+    std::cout << "\n=== Test: Stray Files Removed ===" << std::endl;
+
+    ObjectStore& store = ObjectStore::instance();
+    store.close();
+
+    // A write cut short, and an object whose slot never made it to the index
+    const fs::path objects = fs::path(STORE_PATH) / "objects";
+    std::ofstream(objects / "00000000000000aa-64-11.tmp3") << "partial";
+    std::ofstream(objects / "00000000000000bb-64-11") << "orphan";
+
+    assert(store.open(STORE_PATH, 10000, 64));
+    assert(!fs::exists(objects / "00000000000000aa-64-11.tmp3"));
+    assert(!fs::exists(objects / "00000000000000bb-64-11"));
+
+    size_t files = 0;
+    for (const auto& entry : fs::directory_iterator(objects)) {
+        (void)entry;
+        files++;
+    }
+    assert(files == store.getStats().objects && "Indexed objects kept");
+
+    std::vector<uint8_t> data;
+    std::string name, message;
+    assert(store.fetch(keyOf(199), data, name, message) && data == bytes(10, 199));
+
+    std::cout << "✓ Temporary and unindexed files deleted on open" << std::endl;
+}
+
+void testDamagedObjectDropped() {
+    std::cout << "\n=== Test: Damaged Object Dropped ===" << std::endl;
+
+    ObjectStore& store = ObjectStore::instance();
+    size_t before = store.getStats().objects;
+    std::vector<uint8_t> data;
+    std::string name, message;
+
+    // Truncate the object file behind the store's back
+    size_t truncated = 0;
+    for (const auto& entry : fs::directory_iterator(fs::path(STORE_PATH) / "objects")) {
+        std::ofstream(entry.path(), std::ios::binary | std::ios::trunc) << "xx";
+        truncated++;
+        break;
+    }
+    assert(truncated == 1);
+
+    size_t found = 0;
+    for (uint8_t seed = 1; seed < 200; seed++) {
+        if (store.fetch(keyOf(seed), data, name, message)) found++;
+    }
+    assert(found == before - 1 && "Unreadable object is a miss");
+    assert(store.getStats().objects == before - 1 && "and is dropped from the index");
+
+    store.close();
+    fs::remove_all(STORE_PATH);
+    std::cout << "✓ Damaged object treated as a miss" << std::endl;
+}
+
+int main() {
+    Logger::init("test_objectStore.log");
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "          Object Store Tests           " << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    try {
+        testStoreAndFetch();
+        testSurvivesRestart();
+        testEvictsLeastRecentlyUsed();
+        testStrayFilesRemoved();
+        testDamagedObjectDropped();
+
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "  All tests passed successfully! ✓    " << std::endl;
+        std::cout << "========================================" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        Logger::close();
+        return 1;
+    }
+
+    Logger::close();
+    return 0;
+}
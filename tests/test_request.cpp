@@ -0,0 +1,209 @@
+#include "request.h"
+#include "response.h"
+#include "fileHandler.h"
+#include "networkUtils.h"
+#include "logger.h"
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+#include <type_traits>
+#ifndef _WIN32
+#include <sys/socket.h>
+#endif
+
+// Count heap allocations so payload copies show up as extra large blocks
+static size_t allocationCount = 0;
+static size_t largeAllocationCount = 0;
+static constexpr size_t LARGE_ALLOCATION = 64 * 1024;
+
+void* operator new(size_t size) {
+    allocationCount++;
+    if (size >= LARGE_ALLOCATION) largeAllocationCount++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+struct AllocationScope {
+    size_t startCount = allocationCount;
+    size_t startLarge = largeAllocationCount;
+    size_t allocations() const { return allocationCount - startCount; }
+    size_t largeAllocations() const { return largeAllocationCount - startLarge; }
+};
+
+static_assert(!std::is_copy_constructible<Request>::value, "Request must not be copyable");
+static_assert(std::is_nothrow_move_constructible<Request>::value, "Request must move cheaply");
+static_assert(!std::is_copy_constructible<Response>::value, "Response must not be copyable");
+static_assert(std::is_nothrow_move_constructible<Response>::value, "Response must move cheaply");
+static_assert(!std::is_copy_constructible<FileBody>::value, "FileBody owns its descriptor");
+
+void testRequestTakesOwnership() {
+    std::cout << "\n=== Test: Request Takes Ownership ===" << std::endl;
+
+    std::vector<uint8_t> fileData(1024 * 1024, 'x');
+    const uint8_t* payload = fileData.data();
+
+    AllocationScope scope;
+    Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN,
+                    "payload.bin", std::move(fileData));
+    assert(scope.largeAllocations() == 0 && "Constructor must not copy the payload");
+    assert(request.getData().data() == payload && "Payload buffer should be reused");
+
+    Request moved(std::move(request));
+    assert(scope.largeAllocations() == 0 && "Moving a request must not copy the payload");
+    assert(moved.getData().data() == payload);
+
+    std::vector<uint8_t> taken = moved.takeData();
+    assert(taken.data() == payload && "takeData should hand over the same buffer");
+    assert(moved.getData().empty());
+
+    std::cout << "Allocations for construct + move + take: " << scope.allocations() << std::endl;
+    std::cout << "✓ Payload moved end to end without copies" << std::endl;
+}
+
+void testResponseTakesOwnership() {
+    std::cout << "\n=== Test: Response Takes Ownership ===" << std::endl;
+
+    std::vector<uint8_t> output(512 * 1024, 'y');
+    const uint8_t* payload = output.data();
+
+    AllocationScope scope;
+    Response response;
+    response.setData(std::move(output));
+    response.setStatus(OperationStatus::SUCCESS);
+    assert(scope.largeAllocations() == 0 && "setData must not copy the payload");
+    assert(response.getData().data() == payload);
+
+    Response error(OperationStatus::FAILURE, "", "failed", {});
+    response = std::move(error);
+    assert(response.getStatus() == OperationStatus::FAILURE);
+    assert(scope.largeAllocations() == 0);
+
+    std::cout << "✓ Response payload moved without copies" << std::endl;
+}
+
+void testGettersDoNotCopy() {
+    std::cout << "\n=== Test: Getters Do Not Copy ===" << std::endl;
+
+    Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE,
+                    "a_rather_long_filename_that_would_not_fit_inline.txt", {});
+    Response response(OperationStatus::SUCCESS, "another_long_output_filename.compressed",
+                      "a message that is long enough to live on the heap", {});
+
+    AllocationScope scope;
+    size_t total = request.getFilename().size() + response.getFilename().size() +
+                   response.getMessage().size() + request.getData().size();
+    assert(total > 0);
+    assert(&request.getFilename() == &request.getFilename() && "Filename is returned by reference");
+    assert(scope.allocations() == 0 && "Getters must not allocate");
+
+    std::cout << "✓ Getters return references" << std::endl;
+}
+
+#ifndef _WIN32
+void testResponseSendsFile() {
+    std::cout << "\n=== Test: Response Sends File ===" << std::endl;
+
+    const std::string path = "test_request_body.bin";
+    std::vector<uint8_t> contents(100 * 1024);
+    for (size_t i = 0; i < contents.size(); i++) contents[i] = static_cast<uint8_t>(i * 13);
+    assert(FileHandler::writeFile(path, contents));
+
+    assert(!FileBody::open("no_such_file.bin").isOpen());
+    assert(!FileBody::open(".").isOpen() && "Directories are not file bodies");
+
+    FileBody body = FileBody::open(path);
+    assert(body.isOpen() && body.getSize() == contents.size());
+    Response response(OperationStatus::SUCCESS, "body.bin", "stored", {});
+    response.setFile(std::move(body));
+    assert(!body.isOpen() && "Moving hands the descriptor over");
+    assert(!response.isChecksumEnabled() && "File payloads carry no trailer");
+    assert(response.getPayloadSize() == contents.size());
+
+    // Small enough for the socket buffer, so one thread can do both ends
+    int sockets[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+    {
+        AllocationScope scope;
+        assert(response.serialize(sockets[0]));
+#ifdef __linux__
+        assert(scope.largeAllocations() == 0 && "The file is never read into memory");
+#endif
+    }
+    Response received;
+    assert(received.deserialize(sockets[1]));
+    assert(received.getData() == contents);
+    assert(received.getFilename() == "body.bin");
+
+    NetworkUtils::closeSocket(sockets[0]);
+    NetworkUtils::closeSocket(sockets[1]);
+    std::remove(path.c_str());
+
+    std::cout << "✓ " << contents.size() << " byte file sent without a user-space copy" << std::endl;
+}
+
+void testResponseCarriesTiming() {
+    std::cout << "\n=== Test: Response Carries Timing ===" << std::endl;
+
+    StageTiming timing;
+    timing.receiveMicros = 11;
+    timing.codecMicros = 2200;
+    timing.totalMicros = 2500;
+    Response response(OperationStatus::SUCCESS, "out.bin", "done", std::vector<uint8_t>(300, 'z'));
+    response.setTiming(timing);
+
+    int sockets[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+    Response plain(OperationStatus::SUCCESS, "plain.bin", "", std::vector<uint8_t>(10, 'p'));
+    assert(response.serialize(sockets[0]) && plain.serialize(sockets[0]));
+
+    Response received;
+    assert(received.deserialize(sockets[1]));
+    assert(received.hasTiming());
+    assert(received.getTiming().receiveMicros == 11 && received.getTiming().codecMicros == 2200);
+    assert(received.getTiming().totalMicros == 2500 && received.getMessage() == "done");
+    assert(received.getData() == std::vector<uint8_t>(300, 'z'));
+
+    // Without the flag nothing extra is on the wire
+    assert(received.deserialize(sockets[1]));
+    assert(!received.hasTiming() && received.getFilename() == "plain.bin");
+
+    NetworkUtils::closeSocket(sockets[0]);
+    NetworkUtils::closeSocket(sockets[1]);
+
+    std::cout << "✓ Stage timing travels between message and payload" << std::endl;
+}
+#endif
+
+int main() {
+    Logger::init("test_request.log");
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "     Request/Response Ownership Tests  " << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    try {
+        testRequestTakesOwnership();
+        testResponseTakesOwnership();
+        testGettersDoNotCopy();
+#ifndef _WIN32
+        testResponseSendsFile();
+        testResponseCarriesTiming();
+#endif
+
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "  All tests passed successfully! ✓    " << std::endl;
+        std::cout << "========================================" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        Logger::close();
+        return 1;
+    }
+
+    Logger::close();
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include "resultCache.h"
+#include "workerthread.h"
+#include "request.h"
+#include "response.h"
+#include "logger.h"
+#include "config.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+
+static std::vector<uint8_t> bytes(size_t size, uint8_t seed) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++) data[i] = static_cast<uint8_t>(seed + (i / 7) % 5);
+    return data;
+}
+
+static ResultCache::Key keyOf(const std::vector<uint8_t>& payload) {
+    return ResultCache::keyFor(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, payload);
+}
+
+void testKeys() {
+    std::cout << "\n=== Test: Cache Keys ===" << std::endl;
+
+    std::vector<uint8_t> payload = bytes(1000, 1);
+    ResultCache::Key key = keyOf(payload);
+    assert(key == keyOf(bytes(1000, 1)) && "Same bytes, same key");
+    assert(!(key == keyOf(bytes(1000, 2))));
+    assert(!(key == ResultCache::keyFor(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN,
+                                        payload)) && "Codec is part of the key");
+    assert(!(key == ResultCache::keyFor(MessageType::DECOMPRESS_REQUEST, AlgorithmType::RLE,
+                                        payload)) && "Operation is part of the key");
+
+    std::cout << "✓ Keys cover payload, operation and codec" << std::endl;
+}
+
+void testHitsAndMisses() {
+    std::cout << "\n=== Test: Hits And Misses ===" << std::endl;
+
+    ResultCache& cache = ResultCache::instance();
+    cache.clear();
+    ResultCache::Stats before = cache.getStats();
+
+    ResultCache::Key key = keyOf(bytes(1000, 3));
+    ResultCache::Result result;
+    assert(!cache.lookup(key, result));
+
+    cache.insert(key, bytes(400, 9), "RLE", "done");
+    assert(cache.lookup(key, result));
+    assert(*result.data == bytes(400, 9));
+    assert(result.algorithmName == "RLE" && result.message == "done");
+
+    ResultCache::Stats after = cache.getStats();
+    assert(after.hits - before.hits == 1);
+    assert(after.misses - before.misses == 1);
+    assert(after.entries == 1 && after.bytes == 400);
+
+    std::cout << "✓ Stored results returned with counters updated" << std::endl;
+}
+
+void testLruEviction() {
+    std::cout << "\n=== Test: LRU Eviction ===" << std::endl;
+
+    ResultCache& cache = ResultCache::instance();
+    cache.clear();
+    cache.setLimit(3000);
+    ResultCache::Stats before = cache.getStats();
+
+    ResultCache::Key a = keyOf(bytes(10, 1));
+    ResultCache::Key b = keyOf(bytes(10, 2));
+    ResultCache::Key c = keyOf(bytes(10, 3));
+    cache.insert(a, bytes(1000, 0), "RLE", "");
+    cache.insert(b, bytes(1000, 0), "RLE", "");
+
+    // Touch a so b becomes the oldest
+    ResultCache::Result result;
+    assert(cache.lookup(a, result));
+    cache.insert(c, bytes(1500, 0), "RLE", "");
+
+    assert(cache.lookup(a, result) && "Recently used entry kept");
+    assert(!cache.lookup(b, result) && "Least recently used entry evicted");
+    assert(cache.lookup(c, result));
+    assert(cache.getStats().bytes == 2500);
+    assert(cache.getStats().evictions - before.evictions == 1);
+
+    // Results bigger than the whole cache are not stored
+    ResultCache::Key big = keyOf(bytes(10, 4));
+    cache.insert(big, bytes(4000, 0), "RLE", "");
+    assert(!cache.lookup(big, result));
+    assert(cache.lookup(a, result) && "Oversized insert evicts nothing");
+
+    // Shrinking evicts at once; zero disables the cache
+    cache.setLimit(0);
+    assert(cache.getStats().entries == 0 && cache.getStats().bytes == 0);
+    cache.insert(a, bytes(10, 0), "RLE", "");
+    assert(!cache.lookup(a, result));
+    cache.setLimit(RESULT_CACHE_MAX_BYTES);
+
+    std::cout << "✓ Least recently used results evicted first" << std::endl;
+}
+
+void testWorkerServesRepeatsFromCache() {
+    std::cout << "\n=== Test: Worker Serves Repeats From Cache ===" << std::endl;
+
+    ResultCache& cache = ResultCache::instance();
+    cache.clear();
+    WorkerThread worker;
+
+    Request first(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN, "cached.txt",
+                  bytes(64 * 1024, 7));
+    Response computed = worker.handleRequest(first);
+    assert(computed.getStatus() == OperationStatus::SUCCESS);
+    assert(computed.getMessage().find("(cached)") == std::string::npos);
+
+    ResultCache::Stats before = cache.getStats();
+    Request again(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN, "renamed.txt",
+                  bytes(64 * 1024, 7));
+    Response repeated = worker.handleRequest(again);
+    assert(repeated.getStatus() == OperationStatus::SUCCESS);
+    assert(repeated.getMessage().find("(cached)") != std::string::npos);
+    assert(repeated.getData() == computed.getData() && "Identical output");
+    assert(repeated.getFilename() != computed.getFilename() && "Named after this upload");
+    assert(cache.getStats().hits - before.hits == 1);
+
+    // Another codec is a different result
+    Request rle(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE, "cached.txt",
+                bytes(64 * 1024, 7));
+    Response rleResponse = worker.handleRequest(rle);
+    assert(rleResponse.getMessage().find("(cached)") == std::string::npos);
+
+    // Decompressing the same frame twice hits too
+    Request unpack(MessageType::DECOMPRESS_REQUEST, AlgorithmType::HUFFMAN, "cached.huf",
+                   std::vector<uint8_t>(computed.getData()));
+    Response unpacked = worker.handleRequest(unpack);
+    Request unpackAgain(MessageType::DECOMPRESS_REQUEST, AlgorithmType::HUFFMAN, "cached.huf",
+                        std::vector<uint8_t>(computed.getData()));
+    Response unpackedAgain = worker.handleRequest(unpackAgain);
+    assert(unpacked.getData() == bytes(64 * 1024, 7));
+    assert(unpackedAgain.getData() == unpacked.getData());
+    assert(unpackedAgain.getMessage().find("(cached)") != std::string::npos);
+
+    std::cout << "✓ Repeated uploads skip the codec" << std::endl;
+}
+
+int main() {
+    Logger::init("test_resultCache.log");
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "          Result Cache Tests           " << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    try {
+        testKeys();
+        testHitsAndMisses();
+        testLruEviction();
+        testWorkerServesRepeatsFromCache();
+
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "  All tests passed successfully! ✓    " << std::endl;
+        std::cout << "========================================" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        Logger::close();
+        return 1;
+    }
+
+    Logger::close();
+    return 0;
+}
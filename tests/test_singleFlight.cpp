@@ -0,0 +1,246 @@
+#include "singleFlight.h"
+#include "workerthread.h"
+#include "metrics.h"
+#include "threadPool.h"
+#include "logger.h"
+#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::vector<uint8_t> bytes(size_t size, uint8_t seed) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++) data[i] = static_cast<uint8_t>(seed + (i / 13) % 7);
+    return data;
+}
+
+void testFollowersShareLeaderOutcome() {
+    std::cout << "\n=== Test: Followers Share Leader Outcome ===" << std::endl;
+
+    SingleFlight& flights = SingleFlight::instance();
+    SingleFlight::Stats before = flights.getStats();
+    ResultCache::Key key = ResultCache::keyFor(MessageType::COMPRESS_REQUEST,
+                                               AlgorithmType::RLE, bytes(1000, 1));
+
+    SingleFlight::Outcome outcome;
+    assert(flights.join(key, outcome) && "First request leads");
+
+    const int followerCount = 4;
+    std::vector<SingleFlight::Outcome> outcomes(followerCount);
+    std::vector<bool> led(followerCount, true);
+    std::vector<std::thread> followers;
+    for (int i = 0; i < followerCount; i++) {
+        followers.emplace_back([&, i] { led[i] = flights.join(key, outcomes[i]); });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    assert(flights.getStats().inFlight == before.inFlight + 1);
+
+    // Without shared bytes the leader's buffer is copied for the followers
+    SingleFlight::Outcome result;
+    result.status = OperationStatus::SUCCESS;
+    result.result.algorithmName = "RLE";
+    result.result.message = "done";
+    flights.finish(key, result, bytes(300, 9));
+    for (auto& follower : followers) follower.join();
+
+    for (int i = 0; i < followerCount; i++) {
+        assert(!led[i]);
+        assert(outcomes[i].status == OperationStatus::SUCCESS);
+        assert(outcomes[i].result.data && *outcomes[i].result.data == bytes(300, 9));
+        assert(outcomes[i].result.message == "done");
+    }
+
+    SingleFlight::Stats after = flights.getStats();
+    assert(after.leaders - before.leaders == 1);
+    assert(after.coalesced - before.coalesced == followerCount);
+    assert(after.bytesSaved - before.bytesSaved == followerCount * 1000);
+    assert(after.inFlight == before.inFlight);
+
+    // Once finished, the next request with the key leads again
+    assert(flights.join(key, outcome));
+    flights.finish(key, SingleFlight::Outcome(), {});
+
+    std::cout << "✓ Followers received the leader's result" << std::endl;
+}
+
+void testConcurrentIdenticalRequests() {
+    std::cout << "\n=== Test: Concurrent Identical Requests ===" << std::endl;
+
+    ResultCache::instance().clear();
+    SingleFlight::Stats flightsBefore = SingleFlight::instance().getStats();
+    ResultCache::Stats cacheBefore = ResultCache::instance().getStats();
+
+    const int clients = 8;
+    std::vector<Response> responses(clients);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clients; i++) {
+        threads.emplace_back([&responses, i] {
+            Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN,
+                            "herd" + std::to_string(i) + ".bin", bytes(4 * 1024 * 1024, 3));
+            WorkerThread worker;
+            responses[i] = worker.handleRequest(request);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    for (const Response& response : responses) {
+        assert(response.getStatus() == OperationStatus::SUCCESS);
+        assert(response.getData() == responses[0].getData());
+    }
+
+    // Everyone but one was answered from that one's computation, either
+    // while it ran or from the cache afterwards
+    SingleFlight::Stats flightsAfter = SingleFlight::instance().getStats();
+    ResultCache::Stats cacheAfter = ResultCache::instance().getStats();
+    const uint64_t coalesced = flightsAfter.coalesced - flightsBefore.coalesced;
+    const uint64_t cached = cacheAfter.hits - cacheBefore.hits;
+    std::cout << "Coalesced: " << coalesced << ", from cache: " << cached << std::endl;
+    assert(coalesced + cached == clients - 1 && "Payload compressed once");
+
+    std::cout << "✓ Identical burst compressed once" << std::endl;
+}
+
+void testFollowersGiveBackWorkers() {
+    std::cout << "\n=== Test: Followers Give Back Workers ===" << std::endl;
+
+    // One worker: a follower that waited on it would starve everything else
+    ThreadPool pool(1);
+    SingleFlight& flights = SingleFlight::instance();
+    const std::vector<uint8_t> payload = bytes(3000, 7);
+    ResultCache::Key key = ResultCache::keyFor(MessageType::COMPRESS_REQUEST,
+                                               AlgorithmType::RLE, payload);
+    SingleFlight::Outcome outcome;
+    assert(flights.join(key, outcome) && "The test leads");
+
+    const int followerCount = 4;
+    std::mutex mutex;
+    std::vector<Response> responses;
+    for (int i = 0; i < followerCount; i++) {
+        auto request = std::make_shared<Request>(MessageType::COMPRESS_REQUEST, AlgorithmType::RLE,
+                                                 "follower.bin", bytes(3000, 7));
+        request->setSaveOutput(false);
+        pool.submit([&pool, &mutex, &responses, request] {
+            WorkerThread worker(INVALID_SOCKET, &pool);
+            worker.handleRequest(request, [&mutex, &responses](Response&& response) {
+                std::lock_guard<std::mutex> lock(mutex);
+                responses.push_back(std::move(response));
+            });
+        });
+    }
+
+    std::atomic<bool> ran{false};
+    pool.submit([&ran] { ran = true; });
+    for (int i = 0; i < 200 && !ran; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(ran && "The worker is free while the followers wait");
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        assert(responses.empty());
+    }
+
+    SingleFlight::Outcome result;
+    result.status = OperationStatus::SUCCESS;
+    result.result.algorithmName = "RLE";
+    result.result.message = "done";
+    flights.finish(key, result, bytes(500, 8));
+    auto answered = [&mutex, &responses] {
+        std::lock_guard<std::mutex> lock(mutex);
+        return responses.size();
+    };
+    for (int i = 0; i < 200 && answered() < followerCount; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    assert(responses.size() == followerCount);
+    for (const Response& response : responses) {
+        assert(response.getStatus() == OperationStatus::SUCCESS);
+        assert(response.getData() == bytes(500, 8));
+    }
+
+    std::cout << "✓ " << followerCount << " followers answered after the leader, "
+              << "without holding the only worker" << std::endl;
+}
+
+void testAbandonedLeaderHandsOver() {
+    std::cout << "\n=== Test: Abandoned Leader Hands Over ===" << std::endl;
+
+    SingleFlight& flights = SingleFlight::instance();
+    ResultCache::Key key = ResultCache::keyFor(MessageType::COMPRESS_REQUEST,
+                                               AlgorithmType::RLE, bytes(2000, 5));
+    SingleFlight::Outcome outcome;
+    assert(flights.join(key, outcome));
+
+    SingleFlight::Outcome followed;
+    bool led = true;
+    std::thread follower([&] { led = flights.join(key, followed); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    SingleFlight::Outcome gaveUp;
+    gaveUp.abandoned = true;
+    flights.finish(key, gaveUp, {});
+    follower.join();
+    assert(!led && followed.abandoned && "The follower hears the leader gave up");
+    assert(flights.join(key, outcome) && "Joining again leads the next attempt");
+    flights.finish(key, SingleFlight::Outcome(), {});
+
+    // A request whose client has gone is neither computed nor counted as
+    // a failure, and leaves nothing behind in the cache
+    ResultCache::instance().clear();
+    const Metrics::Snapshot before = Metrics::instance().snapshot();
+    auto gone = std::make_shared<std::atomic<bool>>(true);
+    Request request(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN, "gone.bin",
+                    bytes(64 * 1024, 6));
+    request.setCancelFlag(gone);
+    WorkerThread worker;
+    Response response = worker.handleRequest(request);
+    assert(response.getStatus() == OperationStatus::FAILURE);
+    assert(response.getMessage().find("Cancelled") == 0);
+
+    const Metrics::Snapshot after = Metrics::instance().snapshot();
+    assert(after.requestsCancelled - before.requestsCancelled == 1);
+    assert(after.cancelledBytes - before.cancelledBytes == 64 * 1024);
+    const size_t compress = static_cast<size_t>(MessageType::COMPRESS_REQUEST) - 1;
+    const size_t huffman = static_cast<size_t>(AlgorithmType::HUFFMAN) - 1;
+    assert(after.cells[compress][huffman].requests == before.cells[compress][huffman].requests);
+
+    ResultCache::Result cached;
+    assert(!ResultCache::instance().lookup(
+        ResultCache::keyFor(MessageType::COMPRESS_REQUEST, AlgorithmType::HUFFMAN,
+                            bytes(64 * 1024, 6)), cached));
+
+    std::cout << "✓ Abandoned flight handed on; cancelled request dropped and counted"
+              << std::endl;
+}
+
+int main() {
+    Logger::init("test_singleFlight.log");
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "         Single-Flight Tests           " << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    try {
+        testFollowersShareLeaderOutcome();
+        testConcurrentIdenticalRequests();
+        testFollowersGiveBackWorkers();
+        testAbandonedLeaderHandsOver();
+
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "  All tests passed successfully! ✓    " << std::endl;
+        std::cout << "========================================" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        Logger::close();
+        return 1;
+    }
+
+    Logger::close();
+    return 0;
+}
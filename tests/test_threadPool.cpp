@@ -0,0 +1,414 @@
+#include "threadPool.h"
+#include "logger.h"
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+void testRunsEveryTask() {
+    std::cout << "\n=== Test: Runs Every Task ===" << std::endl;
+
+    std::atomic<int> counter(0);
+    {
+        ThreadPool pool(4);
+        for (int i = 0; i < 10000; i++) {
+            pool.submit([&counter] { counter++; });
+        }
+        // Destruction drains the queues before joining
+    }
+    assert(counter == 10000);
+
+    std::cout << "✓ 10000 tasks executed" << std::endl;
+}
+
+void testNestedSubmitsAreStolen() {
+    std::cout << "\n=== Test: Nested Submits Are Stolen ===" << std::endl;
+
+    ThreadPool pool(4);
+    std::atomic<int> counter(0);
+    std::atomic<bool> ranElsewhere(false);
+
+    // One task fans out onto its own deque; the other workers must steal
+    pool.submit([&] {
+        const int owner = pool.currentWorkerIndex();
+        assert(owner >= 0);
+        for (int i = 0; i < 1000; i++) {
+            pool.submit([&, owner] {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+                if (pool.currentWorkerIndex() != owner) ranElsewhere = true;
+                counter++;
+            });
+        }
+    });
+
+    while (counter < 1000) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ThreadPool::Stats stats = pool.getStats();
+    assert(ranElsewhere && "Idle workers should steal from a busy one");
+    assert(stats.steals > 0);
+    assert(stats.submitted == 1001);
+    assert(stats.maxQueueDepth > 1);
+
+    std::cout << "Steals: " << stats.steals << ", max queue depth: " << stats.maxQueueDepth
+              << std::endl;
+    std::cout << "✓ Work spread across workers by stealing" << std::endl;
+}
+
+void testHelpingWhileWaiting() {
+    std::cout << "\n=== Test: Helping While Waiting ===" << std::endl;
+
+    // A single worker that waits on its own subtasks would deadlock unless
+    // the wait runs queued tasks itself
+    ThreadPool pool(1);
+    std::atomic<bool> done(false);
+    pool.submit([&] {
+        std::atomic<int> children(0);
+        for (int i = 0; i < 8; i++) {
+            pool.submit([&children] { children++; });
+        }
+        while (children < 8) {
+            if (!pool.runPendingTask()) std::this_thread::yield();
+        }
+        done = true;
+    });
+
+    while (!done) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::cout << "✓ Waiting task ran its own subtasks" << std::endl;
+}
+
+void testParallelFor() {
+    std::cout << "\n=== Test: Parallel For ===" << std::endl;
+
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> hits(1000);
+    pool.parallelFor(hits.size(), [&hits](size_t i) { hits[i]++; });
+    for (auto& hit : hits) assert(hit == 1 && "Every index runs exactly once");
+
+    // From inside a worker, as the codecs use it
+    std::atomic<bool> done(false);
+    std::atomic<int> sum(0);
+    pool.submit([&] {
+        pool.parallelFor(100, [&sum](size_t i) { sum += static_cast<int>(i); });
+        done = true;
+    });
+    while (!done) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    assert(sum == 4950);
+
+    pool.parallelFor(0, [](size_t) { assert(false); });
+
+    // With no workers left the caller does it all
+    pool.shutdown();
+    int count = 0;
+    pool.parallelFor(10, [&count](size_t) { count++; });
+    assert(count == 10);
+
+    std::cout << "✓ Indices spread over the caller and spare workers" << std::endl;
+}
+
+void testIdleWorkersPark() {
+    std::cout << "\n=== Test: Idle Workers Park ===" << std::endl;
+
+    ThreadPool pool(4);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ThreadPool::Stats idle = pool.getStats();
+    assert(idle.parks >= 4 && "Workers should sleep when there is no work");
+
+    // A parked pool still wakes for new work
+    std::atomic<int> counter(0);
+    for (int i = 0; i < 100; i++) {
+        pool.submit([&counter] { counter++; });
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    pool.shutdown();
+    assert(counter == 100);
+
+    // After shutdown, submit runs on the caller
+    pool.submit([&counter] { counter++; });
+    assert(counter == 101);
+
+    std::cout << "✓ Workers park when idle and wake on submit" << std::endl;
+}
+
+void testPinnedWorkers() {
+    std::cout << "\n=== Test: Pinned Workers ===" << std::endl;
+
+    const std::vector<size_t> cpus = ThreadPool::availableCpus();
+    assert(!cpus.empty());
+    assert(std::is_sorted(cpus.begin(), cpus.end()));
+
+#ifdef __linux__
+    // Everything lands on the last CPU we are allowed to use
+    const std::vector<size_t> target{cpus.back()};
+    ThreadPool pool(3);
+    assert(pool.pinWorkers(target));
+    std::atomic<int> elsewhere(0);
+    for (int i = 0; i < 200; i++) {
+        pool.submit([&elsewhere, &target] {
+            if (sched_getcpu() != static_cast<int>(target[0])) elsewhere++;
+        });
+    }
+    pool.shutdown();
+    assert(elsewhere == 0);
+    assert(!pool.pinWorkers(target) && "No workers left to pin");
+    assert(!ThreadPool::pinCurrentThread({}) && "An empty set is refused");
+
+    std::cout << "✓ " << cpus.size() << " CPUs available, workers kept on CPU " << target[0]
+              << std::endl;
+#else
+    std::cout << "✓ " << cpus.size() << " CPUs available (pinning is Linux only)" << std::endl;
+#endif
+}
+
+void testLargeLaneTakesTurns() {
+    std::cout << "\n=== Test: Large Lane Takes Turns ===" << std::endl;
+
+    std::vector<std::string> order;
+    std::atomic<bool> release(false);
+    ThreadPool pool(1);
+
+    // The only worker is held up while the queues fill
+    std::atomic<bool> started(false);
+    pool.submitLarge(1, [&] {
+        started = true;
+        while (!release) std::this_thread::yield();
+    });
+    while (!started) std::this_thread::yield();
+
+    for (const char* name : {"a1", "a2", "a3"}) {
+        pool.submitLarge(1, [&order, name] { order.push_back(name); });
+    }
+    pool.submitLarge(2, [&order] { order.push_back("b1"); });
+    pool.submit([&order] { order.push_back("small"); });
+    assert(pool.getStats().largeQueueDepth == 4);
+
+    release = true;
+    pool.shutdown();
+    const std::vector<std::string> expected{"small", "a1", "b1", "a2", "a3"};
+    assert(order == expected && "Small first, then owners in turn");
+
+    std::cout << "✓ Small task first, then a1 b1 a2 a3" << std::endl;
+}
+
+void testReservedWorkerServesSmall() {
+    std::cout << "\n=== Test: Reserved Worker Serves Small ===" << std::endl;
+
+    assert(ThreadPool(1, 4).getReservedWorkers() == 0 && "One worker is kept for large jobs");
+
+    ThreadPool pool(2, 1);
+    assert(pool.getReservedWorkers() == 1);
+
+    // Two large jobs, but only the unreserved worker may start one
+    std::atomic<bool> release(false);
+    std::atomic<int> largeRunning(0);
+    for (int i = 0; i < 2; i++) {
+        pool.submitLarge(static_cast<uint64_t>(i), [&] {
+            largeRunning++;
+            while (!release) std::this_thread::yield();
+        });
+    }
+
+    std::atomic<bool> smallDone(false);
+    pool.submit([&smallDone] { smallDone = true; });
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!smallDone && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(smallDone && "The reserved worker is free for small tasks");
+    assert(largeRunning == 1 && pool.getStats().largeQueueDepth == 1);
+
+    release = true;
+    pool.shutdown();
+    assert(largeRunning == 2);
+
+    std::cout << "✓ Small task ran while both large jobs held the other worker" << std::endl;
+}
+
+// Submit-to-start delays of small tasks trickling in while bigJob runs
+static std::vector<long long> smallLatencies(ThreadPool& pool, std::atomic<bool>& bigDone) {
+    std::vector<long long> latencies;
+    std::mutex mutex;
+    while (!bigDone) {
+        const auto submitted = std::chrono::steady_clock::now();
+        pool.submit([&latencies, &mutex, submitted] {
+            std::lock_guard<std::mutex> lock(mutex);
+            latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - submitted).count());
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    pool.shutdown();
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+void testSmallTailWhileLargeRuns() {
+    std::cout << "\n=== Test: Small Tail While Large Runs ===" << std::endl;
+
+    // A 40-block job of 5 ms blocks on the only worker
+    auto bigJob = [](ThreadPool& pool, std::atomic<bool>& done) {
+        return [&pool, &done] {
+            pool.parallelFor(40, [](size_t) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            });
+            done = true;
+        };
+    };
+    auto p99 = [](const std::vector<long long>& values) {
+        return values[std::min(values.size() - 1, values.size() * 99 / 100)];
+    };
+
+    // Same job as an ordinary task: small ones wait until it finishes
+    ThreadPool fifo(1);
+    std::atomic<bool> fifoDone(false);
+    fifo.submit(bigJob(fifo, fifoDone));
+    const std::vector<long long> unsliced = smallLatencies(fifo, fifoDone);
+
+    ThreadPool lanes(1);
+    std::atomic<bool> lanesDone(false);
+    lanes.submitLarge(1, bigJob(lanes, lanesDone));
+    const std::vector<long long> sliced = smallLatencies(lanes, lanesDone);
+
+    assert(!sliced.empty() && lanes.getStats().yields > 0);
+    assert(p99(sliced) < 50000 && "Small tasks wait for one block, not the whole job");
+
+    std::cout << "✓ Small-task p99 " << p99(sliced) / 1000 << " ms with lanes, "
+              << p99(unsliced) / 1000 << " ms behind the same job as one task" << std::endl;
+}
+
+void testNextActiveCount() {
+    std::cout << "\n=== Test: Next Active Count ===" << std::endl;
+
+    using std::chrono::microseconds;
+    const ThreadPool::Sizing sizing{2, 4.0, microseconds(2000), std::chrono::milliseconds(100)};
+
+    // Tasks wait while the CPUs idle: workers are blocked, add one
+    assert(ThreadPool::nextActiveCount(2, 8, sizing, microseconds(5000), 1.0, false) == 3);
+    // The budget is used up: another worker would only share it out thinner
+    assert(ThreadPool::nextActiveCount(2, 8, sizing, microseconds(5000), 3.8, false) == 2);
+    // Never past the workers the pool has
+    assert(ThreadPool::nextActiveCount(8, 8, sizing, microseconds(5000), 0.0, false) == 8);
+    // Quiet again: retire one, but not below the floor
+    assert(ThreadPool::nextActiveCount(5, 8, sizing, microseconds(100), 0.2, true) == 4);
+    assert(ThreadPool::nextActiveCount(2, 8, sizing, microseconds(100), 0.2, true) == 2);
+    // Short waits without an idle worker leave it alone
+    assert(ThreadPool::nextActiveCount(5, 8, sizing, microseconds(100), 0.2, false) == 5);
+
+    std::cout << "✓ Grows only while tasks wait with CPU to spare, shrinks to the floor" << std::endl;
+}
+
+void testStandbyWorkersTakeNoTasks() {
+    std::cout << "\n=== Test: Standby Workers Take No Tasks ===" << std::endl;
+
+    ThreadPool pool(4);
+    pool.setActiveCount(1);
+    assert(pool.getActiveCount() == 1 && pool.getStats().resizes == 1);
+
+    std::atomic<int> counter(0);
+    std::atomic<bool> standbyRan(false);
+    for (int i = 0; i < 1000; i++) {
+        pool.submit([&] {
+            if (pool.currentWorkerIndex() != 0) standbyRan = true;
+            counter++;
+        });
+    }
+    while (counter < 1000) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(!standbyRan && "Only the active worker runs tasks");
+
+    // Grown back, the others join in
+    pool.setActiveCount(4);
+    std::atomic<int> blocked(0);
+    for (int i = 0; i < 4; i++) {
+        pool.submit([&blocked] {
+            blocked++;
+            while (blocked < 4) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+    }
+    pool.shutdown();
+    assert(blocked == 4);
+
+    std::cout << "✓ One active worker ran everything; all four ran together once grown" << std::endl;
+}
+
+void testGrowsWhileWorkersBlock() {
+    std::cout << "\n=== Test: Grows While Workers Block ===" << std::endl;
+
+    ThreadPool pool(4);
+    pool.startAutoSizing({1, 4.0, std::chrono::microseconds(1000), std::chrono::milliseconds(10)});
+    assert(pool.getActiveCount() == 1);
+
+    // Sleeping tasks queue up without using any CPU
+    std::atomic<int> counter(0);
+    for (int i = 0; i < 60; i++) {
+        pool.submit([&counter] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            counter++;
+        });
+    }
+    size_t peak = 1;
+    while (counter < 60) {
+        peak = std::max(peak, pool.getActiveCount());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(peak > 1 && "Queued tasks with idle CPUs add workers");
+
+    // Nothing to do: back down to the floor
+    for (int i = 0; i < 500 && pool.getActiveCount() > 1; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(pool.getActiveCount() == 1);
+
+    const ThreadPool::Stats stats = pool.getStats();
+    assert(stats.resizes >= 2 && stats.queueWaitMicros > 0);
+    pool.shutdown();
+
+    std::cout << "✓ Grew to " << peak << " workers while tasks slept, then shrank to 1" << std::endl;
+}
+
+int main() {
+    Logger::init("test_threadPool.log");
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "          Thread Pool Tests            " << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    try {
+        testRunsEveryTask();
+        testNestedSubmitsAreStolen();
+        testHelpingWhileWaiting();
+        testParallelFor();
+        testIdleWorkersPark();
+        testPinnedWorkers();
+        testLargeLaneTakesTurns();
+        testReservedWorkerServesSmall();
+        testSmallTailWhileLargeRuns();
+        testNextActiveCount();
+        testStandbyWorkersTakeNoTasks();
+        testGrowsWhileWorkersBlock();
+
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "  All tests passed successfully! ✓    " << std::endl;
+        std::cout << "========================================" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        Logger::close();
+        return 1;
+    }
+
+    Logger::close();
+    return 0;
+}
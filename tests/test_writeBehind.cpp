@@ -0,0 +1,224 @@
+#include "writeBehind.h"
+#include "fileHandler.h"
+#include "memoryBudget.h"
+#include "logger.h"
+#include <iostream>
+#include <cassert>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static const std::string TEST_DIR = "./write_behind_test/";
+
+static std::vector<uint8_t> pattern(size_t size, uint8_t seed) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++) data[i] = static_cast<uint8_t>(seed + i * 3);
+    return data;
+}
+
+void testWritesLandOnDisk() {
+    std::cout << "\n=== Test: Writes Land On Disk ===" << std::endl;
+
+    WriteBehind& writer = WriteBehind::instance();
+    const WriteBehind::Stats before = writer.getStats();
+
+    // The directory is created by the I/O thread
+    for (int i = 0; i < 20; i++) {
+        assert(writer.write(TEST_DIR + "out" + std::to_string(i) + ".bin",
+                            pattern(1000 + i, static_cast<uint8_t>(i))));
+    }
+    writer.flush();
+
+    for (int i = 0; i < 20; i++) {
+        std::vector<uint8_t> data;
+        assert(FileHandler::readFile(TEST_DIR + "out" + std::to_string(i) + ".bin", data));
+        assert(data == pattern(1000 + i, static_cast<uint8_t>(i)));
+    }
+    for (const auto& entry : fs::directory_iterator(TEST_DIR)) {
+        assert(entry.path().string().find(".tmp") == std::string::npos &&
+               "Temporary names are renamed away");
+    }
+
+    const WriteBehind::Stats after = writer.getStats();
+    assert(after.written - before.written == 20);
+    assert(after.batches - before.batches <= 20 && "Queued files share batches");
+    assert(after.pendingFiles == 0 && after.pendingBytes == 0);
+
+    std::cout << "✓ 20 files written in " << (after.batches - before.batches)
+              << " batches" << std::endl;
+}
+
+void testKeepExisting() {
+    std::cout << "\n=== Test: Keep Existing ===" << std::endl;
+
+    WriteBehind& writer = WriteBehind::instance();
+    const uint64_t skippedBefore = writer.getStats().skipped;
+
+    assert(writer.write(TEST_DIR + "kept.bin", pattern(100, 1)));
+    writer.flush();
+    assert(writer.write(TEST_DIR + "kept.bin", pattern(200, 2), true));
+    writer.flush();
+
+    std::vector<uint8_t> data;
+    assert(FileHandler::readFile(TEST_DIR + "kept.bin", data));
+    assert(data == pattern(100, 1) && "Existing file left alone");
+    assert(writer.getStats().skipped == skippedBefore + 1);
+
+    std::cout << "✓ keepExisting skips a file already on disk" << std::endl;
+}
+
+void testFailedWritesCounted() {
+    std::cout << "\n=== Test: Failed Writes Counted ===" << std::endl;
+
+    WriteBehind& writer = WriteBehind::instance();
+    const uint64_t failedBefore = writer.getStats().failed;
+
+    // A regular file where a directory should be
+    assert(writer.write(TEST_DIR + "blocker", pattern(10, 0)));
+    writer.flush();
+    assert(writer.write(TEST_DIR + "blocker/child.bin", pattern(10, 0)) &&
+           "Queued; the failure only shows up later");
+    writer.flush();
+
+    assert(writer.getStats().failed == failedBefore + 1);
+    assert(!FileHandler::fileExists(TEST_DIR + "blocker/child.bin"));
+
+    std::cout << "✓ Failed write reported in the stats" << std::endl;
+}
+
+void testBoundedQueue() {
+    std::cout << "\n=== Test: Bounded Queue ===" << std::endl;
+
+    WriteBehind& writer = WriteBehind::instance();
+    const size_t limit = 64 * 1024;
+    writer.setLimit(limit);
+
+    for (int i = 0; i < 50; i++) {
+        assert(writer.write(TEST_DIR + "bounded" + std::to_string(i) + ".bin",
+                            pattern(16 * 1024, static_cast<uint8_t>(i))));
+        assert(writer.getStats().pendingBytes <= limit && "Writers wait for room");
+    }
+
+    // Larger than the whole queue: still written, once on its own
+    assert(writer.write(TEST_DIR + "oversized.bin", pattern(limit * 2, 7)));
+    writer.flush();
+    assert(FileHandler::getFileSize(TEST_DIR + "oversized.bin") == limit * 2);
+    writer.setLimit(WRITE_BEHIND_MAX_BYTES);
+
+    std::cout << "✓ Queued bytes stayed within " << limit << std::endl;
+}
+
+void testPendingReadable() {
+    std::cout << "\n=== Test: Pending Readable ===" << std::endl;
+
+    WriteBehind& writer = WriteBehind::instance();
+    size_t size = 0;
+    std::vector<uint8_t> data;
+    assert(!writer.pendingSize(TEST_DIR + "never-written.bin", size));
+    assert(!writer.readPending(TEST_DIR + "never-written.bin", data));
+
+    // Read straight back: from the queue while it is there, the disk after
+    int fromQueue = 0;
+    for (int i = 0; i < 20; i++) {
+        const std::string path = TEST_DIR + "pending" + std::to_string(i) + ".bin";
+        assert(writer.write(path, pattern(4096 + i, static_cast<uint8_t>(i))));
+        if (writer.pendingSize(path, size)) {
+            assert(size == 4096u + i);
+            if (writer.readPending(path, data)) {
+                assert(data == pattern(4096 + i, static_cast<uint8_t>(i)));
+                fromQueue++;
+                continue;
+            }
+        }
+        assert(FileHandler::readFile(path, data));
+        assert(data == pattern(4096 + i, static_cast<uint8_t>(i)));
+    }
+
+    writer.flush();
+    for (int i = 0; i < 20; i++) {
+        assert(!writer.pendingSize(TEST_DIR + "pending" + std::to_string(i) + ".bin", size) &&
+               "Forgotten once on disk");
+    }
+
+    std::cout << "✓ " << fromQueue << " of 20 files read back from the queue" << std::endl;
+}
+
+void testChargeHeldUntilWritten() {
+    std::cout << "\n=== Test: Charge Held Until Written ===" << std::endl;
+
+    WriteBehind& writer = WriteBehind::instance();
+    MemoryBudget& budget = MemoryBudget::instance();
+    const size_t before = budget.getInUse();
+
+    // The charge and the pending entry are dropped together, so a file
+    // still pending after the budget was read was charged at that point
+    int seenCharged = 0;
+    for (int i = 0; i < 20; i++) {
+        const std::string path = TEST_DIR + "charged" + std::to_string(i) + ".bin";
+        assert(budget.tryReserve(8192));
+        assert(writer.write(path, pattern(8192, static_cast<uint8_t>(i)), false,
+                            MemoryBudget::Hold(8192)));
+        const size_t inUse = budget.getInUse();
+        size_t size = 0;
+        if (writer.pendingSize(path, size)) {
+            assert(inUse >= before + 8192 && "Queued data stays charged");
+            seenCharged++;
+        }
+    }
+
+    writer.flush();
+    assert(budget.getInUse() == before && "Every charge returned once written");
+
+    std::cout << "✓ " << seenCharged << " of 20 files seen charged while queued; "
+              << "all returned after the flush" << std::endl;
+}
+
+void testInlineAfterShutdown() {
+    std::cout << "\n=== Test: Inline After Shutdown ===" << std::endl;
+
+    WriteBehind& writer = WriteBehind::instance();
+    assert(writer.write(TEST_DIR + "last-queued.bin", pattern(5000, 3)));
+    writer.shutdown();
+    assert(FileHandler::fileExists(TEST_DIR + "last-queued.bin") && "Shutdown drains the queue");
+
+    // No thread left: writes happen on the caller and report failure directly
+    assert(writer.write(TEST_DIR + "inline.bin", pattern(10, 4)));
+    assert(FileHandler::fileExists(TEST_DIR + "inline.bin"));
+    assert(!writer.write(TEST_DIR + "blocker/inline.bin", pattern(10, 4)));
+
+    std::cout << "✓ Queue drained on shutdown, later writes inline" << std::endl;
+}
+
+int main() {
+    Logger::init("test_writeBehind.log");
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "         Write-Behind Tests            " << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    fs::remove_all(TEST_DIR);
+
+    try {
+        testWritesLandOnDisk();
+        testKeepExisting();
+        testFailedWritesCounted();
+        testBoundedQueue();
+        testPendingReadable();
+        testChargeHeldUntilWritten();
+        testInlineAfterShutdown();
+
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "  All tests passed successfully! ✓    " << std::endl;
+        std::cout << "========================================" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        Logger::close();
+        return 1;
+    }
+
+    fs::remove_all(TEST_DIR);
+    Logger::close();
+    return 0;
+}
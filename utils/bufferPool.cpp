@@ -0,0 +1,177 @@
+#include "bufferPool.h"
+#include "cpuTopology.h"
+#include "config.h"
+
+struct BufferPool::ThreadCache {
+    std::vector<std::vector<uint8_t>> slots[CLASS_COUNT];
+
+    // Hand cached buffers back to the shared lists when the thread exits
+    ~ThreadCache() {
+        for (size_t i = 0; i < CLASS_COUNT; i++) {
+            for (auto& buffer : slots[i]) {
+                BufferPool::instance().putShared(i, std::move(buffer));
+            }
+        }
+    }
+};
+
+BufferPool::BufferPool()
+    : nodes(CpuTopology::nodeCount()),
+      classes(std::make_unique<SharedClass[]>(nodes * CLASS_COUNT)),
+      maxPooledBytes(BUFFER_POOL_MAX_BYTES),
+      acquires(0),
+      threadCacheHits(0),
+      sharedHits(0),
+      misses(0),
+      releases(0),
+      discarded(0),
+      pooledBytes(0) {}
+
+BufferPool& BufferPool::instance() {
+    static BufferPool pool;
+    return pool;
+}
+
+BufferPool::ThreadCache& BufferPool::threadCache() {
+    thread_local ThreadCache cache;
+    return cache;
+}
+
+size_t BufferPool::classIndex(size_t size) {
+    if (size > MAX_CLASS_SIZE) return CLASS_COUNT;
+
+    size_t index = 0;
+    while (classSize(index) < size) {
+        index++;
+    }
+    return index;
+}
+
+std::vector<uint8_t> BufferPool::take(size_t index) {
+    acquires.fetch_add(1, std::memory_order_relaxed);
+
+    if (classSize(index) <= THREAD_CACHE_MAX_SIZE) {
+        auto& slot = threadCache().slots[index];
+        if (!slot.empty()) {
+            std::vector<uint8_t> buffer = std::move(slot.back());
+            slot.pop_back();
+            threadCacheHits.fetch_add(1, std::memory_order_relaxed);
+            return buffer;
+        }
+    }
+
+    {
+        SharedClass& local = shared(nodes > 1 ? CpuTopology::currentNode() : 0, index);
+        std::lock_guard<std::mutex> lock(local.mutex);
+        if (!local.buffers.empty()) {
+            std::vector<uint8_t> buffer = std::move(local.buffers.back());
+            local.buffers.pop_back();
+            pooledBytes.fetch_sub(buffer.capacity(), std::memory_order_relaxed);
+            sharedHits.fetch_add(1, std::memory_order_relaxed);
+            return buffer;
+        }
+    }
+
+    misses.fetch_add(1, std::memory_order_relaxed);
+    std::vector<uint8_t> buffer;
+    buffer.reserve(classSize(index));
+    return buffer;
+}
+
+std::vector<uint8_t> BufferPool::acquire(size_t size) {
+    size_t index = classIndex(size);
+    if (index == CLASS_COUNT) {
+        acquires.fetch_add(1, std::memory_order_relaxed);
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return std::vector<uint8_t>(size);
+    }
+
+    // Shrinking never touches the bytes; only growth past what this buffer
+    // held before is zero-filled
+    std::vector<uint8_t> buffer = take(index);
+    buffer.resize(size);
+    return buffer;
+}
+
+std::vector<uint8_t> BufferPool::acquireCapacity(size_t capacity) {
+    size_t index = classIndex(capacity);
+    if (index == CLASS_COUNT) {
+        acquires.fetch_add(1, std::memory_order_relaxed);
+        misses.fetch_add(1, std::memory_order_relaxed);
+        std::vector<uint8_t> buffer;
+        buffer.reserve(capacity);
+        return buffer;
+    }
+
+    std::vector<uint8_t> buffer = take(index);
+    buffer.clear();
+    return buffer;
+}
+
+void BufferPool::release(std::vector<uint8_t>&& buffer) {
+    const size_t capacity = buffer.capacity();
+    if (capacity < MIN_CLASS_SIZE || capacity >= 2 * MAX_CLASS_SIZE) {
+        if (capacity > 0) discarded.fetch_add(1, std::memory_order_relaxed);
+        std::vector<uint8_t>().swap(buffer);
+        return;
+    }
+
+    releases.fetch_add(1, std::memory_order_relaxed);
+
+    // File under the largest class this capacity can fully serve
+    size_t index = 0;
+    while (index + 1 < CLASS_COUNT && classSize(index + 1) <= capacity) {
+        index++;
+    }
+
+    if (classSize(index) <= THREAD_CACHE_MAX_SIZE) {
+        auto& slot = threadCache().slots[index];
+        if (slot.size() < THREAD_CACHE_DEPTH) {
+            slot.push_back(std::move(buffer));
+            return;
+        }
+    }
+
+    putShared(index, std::move(buffer));
+}
+
+void BufferPool::putShared(size_t index, std::vector<uint8_t>&& buffer) {
+    const size_t capacity = buffer.capacity();
+    if (pooledBytes.load(std::memory_order_relaxed) + capacity > maxPooledBytes) {
+        discarded.fetch_add(1, std::memory_order_relaxed);
+        std::vector<uint8_t>().swap(buffer);
+        return;
+    }
+
+    // Filed where the memory is, not where the releasing thread runs
+    const size_t node = nodes > 1 ? CpuTopology::nodeOfAddress(buffer.data()) : 0;
+    SharedClass& home = shared(node, index);
+    std::lock_guard<std::mutex> lock(home.mutex);
+    home.buffers.push_back(std::move(buffer));
+    pooledBytes.fetch_add(capacity, std::memory_order_relaxed);
+}
+
+BufferPool::Stats BufferPool::getStats() const {
+    Stats stats;
+    stats.acquires = acquires.load(std::memory_order_relaxed);
+    stats.threadCacheHits = threadCacheHits.load(std::memory_order_relaxed);
+    stats.sharedHits = sharedHits.load(std::memory_order_relaxed);
+    stats.misses = misses.load(std::memory_order_relaxed);
+    stats.releases = releases.load(std::memory_order_relaxed);
+    stats.discarded = discarded.load(std::memory_order_relaxed);
+    stats.pooledBytes = pooledBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void BufferPool::trim() {
+    for (size_t i = 0; i < nodes * CLASS_COUNT; i++) {
+        std::deque<std::vector<uint8_t>> freed;
+        {
+            std::lock_guard<std::mutex> lock(classes[i].mutex);
+            freed.swap(classes[i].buffers);
+        }
+        for (const auto& buffer : freed) {
+            pooledBytes.fetch_sub(buffer.capacity(), std::memory_order_relaxed);
+        }
+    }
+}
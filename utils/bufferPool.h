@@ -0,0 +1,96 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+// Server-wide pool of payload buffers, bucketed into power-of-two size
+// classes. Each thread keeps a small cache of small buffers in front of the
+// shared free lists, so steady-state traffic recycles warm memory instead of
+// going through the allocator and faulting in fresh pages.
+//
+// On NUMA machines the shared free lists are kept per node: a buffer is
+// filed under the node its memory is on and only handed to threads running
+// on that node. A miss allocates afresh, and first touch by the requesting
+// thread places the new pages locally.
+//
+// Recycled buffers are not re-zeroed: acquire(n) on a buffer that has held
+// n bytes before hands them back as-is, ready to be overwritten by recv.
+class BufferPool {
+public:
+    struct Stats {
+        uint64_t acquires;
+        uint64_t threadCacheHits;
+        uint64_t sharedHits;
+        uint64_t misses;
+        uint64_t releases;
+        uint64_t discarded;   // dropped because the pool was full or oversized
+        uint64_t pooledBytes; // capacity currently held in shared free lists
+
+        double hitRate() const {
+            return acquires ? static_cast<double>(threadCacheHits + sharedHits) / acquires : 0.0;
+        }
+    };
+
+    static constexpr size_t MIN_CLASS_SIZE = 4 * 1024;            // 4 KiB
+    static constexpr size_t MAX_CLASS_SIZE = 256 * 1024 * 1024;   // 256 MiB
+    static constexpr size_t CLASS_COUNT = 17;                     // 4 KiB .. 256 MiB
+
+    // Per-thread cache limits: only small classes, a few buffers each
+    static constexpr size_t THREAD_CACHE_MAX_SIZE = 1024 * 1024;
+    static constexpr size_t THREAD_CACHE_DEPTH = 4;
+
+    static BufferPool& instance();
+
+    // Buffer of exactly size bytes with unspecified contents
+    std::vector<uint8_t> acquire(size_t size);
+
+    // Empty buffer with at least capacity bytes reserved (codec output)
+    std::vector<uint8_t> acquireCapacity(size_t capacity);
+
+    // Return a buffer for reuse; anything that does not fit a class is freed
+    void release(std::vector<uint8_t>&& buffer);
+
+    Stats getStats() const;
+
+    // Free everything in the shared lists
+    void trim();
+
+    // Size class index for a request, or CLASS_COUNT if too large to pool
+    static size_t classIndex(size_t size);
+    static size_t classSize(size_t index) { return MIN_CLASS_SIZE << index; }
+
+private:
+    BufferPool();
+
+    struct SharedClass {
+        std::mutex mutex;
+        std::deque<std::vector<uint8_t>> buffers;
+    };
+
+    struct ThreadCache;
+    static ThreadCache& threadCache();
+
+    std::vector<uint8_t> take(size_t index);
+    void putShared(size_t index, std::vector<uint8_t>&& buffer);
+    SharedClass& shared(size_t node, size_t index) { return classes[node * CLASS_COUNT + index]; }
+
+    size_t nodes;
+    std::unique_ptr<SharedClass[]> classes;     // CLASS_COUNT per node
+    size_t maxPooledBytes;
+
+    std::atomic<uint64_t> acquires;
+    std::atomic<uint64_t> threadCacheHits;
+    std::atomic<uint64_t> sharedHits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> releases;
+    std::atomic<uint64_t> discarded;
+    std::atomic<uint64_t> pooledBytes;
+};
+
+#endif // BUFFER_POOL_H
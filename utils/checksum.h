@@ -0,0 +1,31 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstdint>
+#include <cstddef>
+
+// CRC32C (Castagnoli) used for frame blocks, frame content and wire payloads.
+// Uses the SSE4.2 crc32 instruction when the CPU has it, otherwise a
+// slicing-by-8 table. Results are identical either way.
+class Checksum {
+public:
+    // Extend crc with size bytes of data. Chaining is transparent:
+    // crc32c(b, crc32c(a)) == crc32c(a followed by b)
+    static uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+    // CRC of a followed by b, given crcA = crc32c(a), crcB = crc32c(b) and
+    // b's length. Lets pieces of one stream be checksummed independently.
+    static uint32_t crc32cCombine(uint32_t crcA, uint32_t crcB, uint64_t lengthB);
+
+    // 64-bit non-cryptographic content hash (xxHash64) for cache keys; much
+    // stronger against accidental collisions than a 32-bit CRC
+    static uint64_t hash64(const void* data, size_t size, uint64_t seed = 0);
+
+    // Table-driven path only, so tests can cross-check the hardware path
+    static uint32_t crc32cPortable(const void* data, size_t size, uint32_t crc = 0);
+
+    // True if crc32c() runs on the hardware instruction
+    static bool hardwareAccelerated();
+};
+
+#endif // CHECKSUM_H
@@ -2,20 +2,96 @@
 #define CONFIG_H
 
 #include <string>
+#include <cstdint>
+#include <cstddef>
 
 // Network configuration
 constexpr int DEFAULT_PORT = 8080;
 constexpr int MAX_BUFFER_SIZE = 8192;
-constexpr int MAX_CONNECTIONS = 10;
+constexpr size_t MAX_CONNECTIONS = 1000;         // blocking path: open client connections; more
+                                                 // wait in the backlog (see EVENT_LOOP_* for epoll)
+constexpr int CONNECTION_YIELD_IDLE_MS = 200;   // blocking path: idle this long while clients wait
+                                                // for a worker, a connection gives its worker up
 constexpr const char* DEFAULT_SERVER_IP = "127.0.0.1";
 
+// Event loop configuration (Linux, see server/eventLoop.h)
+constexpr int CONNECTION_IDLE_TIMEOUT_SECONDS = 60;    // no bytes moved, no request in flight
+constexpr size_t EVENT_LOOP_RESERVED_DESCRIPTORS = 256; // of RLIMIT_NOFILE, kept for files and pools;
+                                                       // the rest are shared by the loops' connections
+constexpr size_t CONNECTION_READ_BUFFER_SIZE = 64 * 1024;
+constexpr size_t CONNECTION_READ_BUDGET = 1024 * 1024; // per wakeup, for fairness
+constexpr size_t MAX_PIPELINED_REQUESTS = 16;          // per connection, client and server
+constexpr size_t DEFAULT_SERVER_SHARDS = 1;            // event loops, each with its own listener
+constexpr size_t MAX_SERVER_SHARDS = 64;
+
+// Admission control (see utils/memoryBudget.h)
+constexpr size_t SERVER_MEMORY_BUDGET = 2048ull * 1024 * 1024;  // payload bytes in flight
+constexpr uint32_t MAX_REQUEST_SIZE = 1024u * 1024 * 1024;      // larger payloads are refused
+constexpr uint32_t MAX_FILENAME_LENGTH = 4096;
+constexpr int ADMISSION_WAIT_MS = 2000;      // wait for budget before answering BUSY
+constexpr int CLIENT_MAX_RETRIES = 5;        // BUSY answers retried with back-off
+constexpr int CLIENT_RETRY_BASE_MS = 100;    // doubled after each BUSY
+
 // File paths
 const std::string COMPRESSED_DIR = "./compressed/";
 const std::string DECOMPRESSED_DIR = "./decompressed/";
 const std::string TEMP_DIR = "./temp/";
 
+// Batch requests (see src/batchFormat.h)
+constexpr uint32_t MAX_BATCH_MEMBERS = 65536;
+constexpr size_t CLIENT_BATCH_BYTES = 16 * 1024 * 1024; // member data per batch the client sends
+
+// Background jobs (see server/jobManager.h)
+constexpr size_t MAX_JOBS = 16384;             // queued, running and not yet collected
+constexpr int JOB_WAIT_MS = 10000;             // a WAIT answers IN_PROGRESS after this
+constexpr int JOB_RESULT_TTL_SECONDS = 600;    // results nobody collects are dropped
+
+// Frame format configuration (see algorithms/frameFormat.h)
+constexpr uint32_t DEFAULT_FRAME_BLOCK_SIZE = 1024 * 1024;      // 1 MiB
+constexpr uint32_t MAX_FRAME_BLOCK_SIZE = 64 * 1024 * 1024;     // 64 MiB
+
+// Buffer pool configuration (see utils/bufferPool.h)
+constexpr size_t BUFFER_POOL_MAX_BYTES = 512 * 1024 * 1024;    // shared free lists cap
+
+// Result cache configuration (see utils/resultCache.h)
+constexpr size_t RESULT_CACHE_MAX_BYTES = 256 * 1024 * 1024;     // cached output bytes
+constexpr size_t RESULT_CACHE_MAX_ENTRY_SIZE = 32 * 1024 * 1024; // larger results are not kept
+
+// Object store configuration (see utils/objectStore.h)
+const std::string STORE_DIR = "./store/";
+constexpr uint64_t STORE_MAX_BYTES = 4ull * 1024 * 1024 * 1024;  // objects on disk
+constexpr uint32_t STORE_INDEX_SLOTS = 64 * 1024;                 // index entries (power of two)
+constexpr size_t STORE_MAX_OBJECT_SIZE = 256 * 1024 * 1024;       // larger results are not stored
+
+// Write-behind for output files (see utils/writeBehind.h)
+constexpr size_t WRITE_BEHIND_MAX_BYTES = 256 * 1024 * 1024;    // queued file data
+constexpr bool WRITE_BEHIND_SYNC = true;                         // fsync every batch
+
+// Initial size of the per-request arena for codec temporaries; it grows
+// from the heap if a request needs more and is freed when the request ends
+constexpr size_t REQUEST_ARENA_INITIAL_SIZE = 64 * 1024;
+
 // Threading configuration
-constexpr int MAX_WORKER_THREADS = 5;
+// Payloads at least this large are split across spare pool workers; smaller
+// ones stay on one worker. Each task takes whole blocks, about this much.
+constexpr size_t PARALLEL_MIN_REQUEST_SIZE = 8 * 1024 * 1024;
+constexpr size_t PARALLEL_CHUNK_SIZE = 4 * 1024 * 1024;
+
+// Worker pool sizing (see utils/threadPool.h and utils/cpuTopology.h). A
+// shard keeps one worker per CPU of its share of the budget (cgroup quota
+// included) and adds up to POOL_THREADS_PER_CPU times that while tasks queue
+// for longer than POOL_GROW_WAIT_US with CPU to spare, i.e. while workers
+// block. No pool ever has more than MAX_WORKER_THREADS workers.
+constexpr size_t MAX_WORKER_THREADS = 256;
+constexpr size_t POOL_THREADS_PER_CPU = 2;
+constexpr int POOL_GROW_WAIT_US = 2000;
+constexpr int POOL_RESIZE_INTERVAL_MS = 100;
+
+// Size-aware scheduling (see utils/threadPool.h). Larger payloads, and every
+// streamed block, go to the pool's large lane; one worker in
+// SMALL_LANE_WORKER_SHARE only ever runs small requests.
+constexpr size_t SMALL_REQUEST_MAX_SIZE = 1024 * 1024;
+constexpr size_t SMALL_LANE_WORKER_SHARE = 4;
 
 // Logging configuration
 enum class LogLevel {
@@ -0,0 +1,206 @@
+#include "cpuTopology.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// get_mempolicy flags (linux/mempolicy.h): report the node of the page at addr
+constexpr unsigned long MEMPOLICY_NODE = 1 << 0;
+constexpr unsigned long MEMPOLICY_ADDRESS = 1 << 1;
+
+// cgroup v2 cpu.max: "<quota> <period>", or "max <period>" when unlimited
+double readCpuMax(const std::string& file) {
+    std::ifstream in(file);
+    std::string quota;
+    double period = 0;
+    if (!(in >> quota >> period) || quota == "max" || period <= 0) return 0;
+    try {
+        return std::stod(quota) / period;
+    } catch (...) {
+        return 0;
+    }
+}
+
+// Node of every CPU, from /sys/devices/system/node/node<N>/cpulist
+struct NodeTable {
+    std::vector<size_t> nodeOfCpu;
+    size_t nodes = 1;
+
+    NodeTable() {
+        std::error_code error;
+        for (const auto& entry : fs::directory_iterator("/sys/devices/system/node", error)) {
+            const std::string name = entry.path().filename().string();
+            if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+                !std::all_of(name.begin() + 4, name.end(), ::isdigit)) continue;
+            const size_t node = std::stoul(name.substr(4));
+
+            std::ifstream in(entry.path() / "cpulist");
+            std::string text;
+            std::vector<size_t> cpus;
+            if (!std::getline(in, text) || !CpuTopology::parseCpuList(text, cpus)) continue;
+            for (size_t cpu : cpus) {
+                if (cpu >= nodeOfCpu.size()) nodeOfCpu.resize(cpu + 1, 0);
+                nodeOfCpu[cpu] = node;
+            }
+            nodes = std::max(nodes, node + 1);
+        }
+    }
+};
+
+const NodeTable& nodeTable() {
+    static const NodeTable table;
+    return table;
+}
+
+} // namespace
+
+double CpuTopology::cgroupCpuLimit() {
+#ifdef __linux__
+    // The cgroup v2 entry is "0::<path>"; inside a cgroup namespace it is "/"
+    std::ifstream in("/proc/self/cgroup");
+    std::string line;
+    std::string path;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 3, "0::") == 0) path = line.substr(3);
+    }
+    return cgroupCpuLimit("/sys/fs/cgroup", path);
+#else
+    return 0;
+#endif
+}
+
+double CpuTopology::cgroupCpuLimit(const std::string& cgroupRoot, const std::string& path) {
+    // A parent's limit applies to everything below it, so walk up to the
+    // root; the path may also not exist under our mount when the container
+    // sees its own cgroup as the root
+    double limit = 0;
+    std::string group = path == "/" ? "" : path;
+    while (true) {
+        const double here = readCpuMax(cgroupRoot + group + "/cpu.max");
+        if (here > 0 && (limit == 0 || here < limit)) limit = here;
+        if (group.empty()) break;
+        group = group.substr(0, group.find_last_of('/'));
+    }
+    if (limit > 0) return limit;
+
+    // cgroup v1: a quota of -1 means unlimited
+    std::ifstream quotaFile(cgroupRoot + "/cpu/cpu.cfs_quota_us");
+    std::ifstream periodFile(cgroupRoot + "/cpu/cpu.cfs_period_us");
+    long long quota = -1;
+    long long period = 0;
+    if (quotaFile >> quota && periodFile >> period && quota > 0 && period > 0) {
+        return static_cast<double>(quota) / static_cast<double>(period);
+    }
+    return 0;
+}
+
+double CpuTopology::cpuBudget(const std::vector<size_t>& cpus) {
+    const double count = static_cast<double>(std::max<size_t>(1, cpus.size()));
+    const double limit = cgroupCpuLimit();
+    return limit > 0 ? std::min(count, limit) : count;
+}
+
+bool CpuTopology::parseCpuList(const std::string& text, std::vector<size_t>& cpus) {
+    std::vector<size_t> parsed;
+    std::stringstream in(text);
+    std::string range;
+    while (std::getline(in, range, ',')) {
+        range.erase(std::remove_if(range.begin(), range.end(), ::isspace), range.end());
+        if (range.empty()) continue;
+        const size_t dash = range.find('-');
+        const std::string first = range.substr(0, dash);
+        const std::string last = dash == std::string::npos ? first : range.substr(dash + 1);
+        if (first.empty() || last.empty() ||
+            !std::all_of(first.begin(), first.end(), ::isdigit) ||
+            !std::all_of(last.begin(), last.end(), ::isdigit)) return false;
+
+        size_t low = 0;
+        size_t high = 0;
+        try {
+            low = std::stoul(first);
+            high = std::stoul(last);
+        } catch (...) {
+            return false;
+        }
+        // Nobody has this many CPUs; guards against "0-4000000000"
+        if (low > high || high >= 65536) return false;
+        for (size_t cpu = low; cpu <= high; cpu++) parsed.push_back(cpu);
+    }
+    if (parsed.empty()) return false;
+
+    std::sort(parsed.begin(), parsed.end());
+    parsed.erase(std::unique(parsed.begin(), parsed.end()), parsed.end());
+    cpus = std::move(parsed);
+    return true;
+}
+
+size_t CpuTopology::nodeOf(size_t cpu) {
+    const NodeTable& table = nodeTable();
+    return cpu < table.nodeOfCpu.size() ? table.nodeOfCpu[cpu] : 0;
+}
+
+size_t CpuTopology::nodeCount() {
+    return nodeTable().nodes;
+}
+
+size_t CpuTopology::currentNode() {
+#ifdef __linux__
+    if (nodeCount() == 1) return 0;
+    const int cpu = sched_getcpu();
+    return cpu >= 0 ? nodeOf(static_cast<size_t>(cpu)) : 0;
+#else
+    return 0;
+#endif
+}
+
+size_t CpuTopology::nodeOfAddress(const void* address) {
+#if defined(__linux__) && defined(SYS_get_mempolicy)
+    if (nodeCount() == 1 || !address) return 0;
+    int node = 0;
+    if (syscall(SYS_get_mempolicy, &node, nullptr, 0UL, const_cast<void*>(address),
+                MEMPOLICY_NODE | MEMPOLICY_ADDRESS) != 0 || node < 0) return 0;
+    return std::min(static_cast<size_t>(node), nodeCount() - 1);
+#else
+    (void)address;
+    return 0;
+#endif
+}
+
+std::vector<size_t> CpuTopology::groupByNode(std::vector<size_t> cpus) {
+    std::sort(cpus.begin(), cpus.end(), [](size_t a, size_t b) {
+        const size_t nodeA = nodeOf(a);
+        const size_t nodeB = nodeOf(b);
+        return nodeA != nodeB ? nodeA < nodeB : a < b;
+    });
+    return cpus;
+}
+
+uint64_t CpuTopology::processCpuMicros() {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) return 0;
+    auto ticks = [](const FILETIME& time) {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return (ticks(kernel) + ticks(user)) / 10;
+#else
+    timespec now{};
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now) != 0) return 0;
+    return static_cast<uint64_t>(now.tv_sec) * 1000000 + static_cast<uint64_t>(now.tv_nsec) / 1000;
+#endif
+}
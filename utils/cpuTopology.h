@@ -0,0 +1,51 @@
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// What the process may actually run on, as opposed to what the host has.
+//
+// A container usually gets a CFS quota (cgroup cpu.max) well below the
+// host's core count, and hardware_concurrency() only ever reports the host.
+// Pools are sized from cpuBudget() instead, so a 4-CPU quota on a 64-core
+// host gets 4 workers rather than 64 taking turns on 4 CPUs' worth of time.
+//
+// NUMA nodes come from sysfs. Without NUMA information every CPU and every
+// address is on node 0.
+class CpuTopology {
+public:
+    // CPUs' worth of time the process's cgroup allows (quota / period), or 0
+    // when unlimited or unknown. The tightest cgroup v2 cpu.max on the way up
+    // to the root wins; cgroup v1 (cpu/cpu.cfs_quota_us) is the fallback.
+    static double cgroupCpuLimit();
+
+    // The same below cgroupRoot for the cgroup at path ("" or "/a/b")
+    static double cgroupCpuLimit(const std::string& cgroupRoot, const std::string& path);
+
+    // CPUs' worth of time usable on cpus: their count, capped by the quota
+    static double cpuBudget(const std::vector<size_t>& cpus);
+
+    // "0-3,8,10-11" into ascending CPU numbers; false on malformed input
+    static bool parseCpuList(const std::string& text, std::vector<size_t>& cpus);
+
+    // NUMA node of a CPU, and how many nodes there are
+    static size_t nodeOf(size_t cpu);
+    static size_t nodeCount();
+
+    // Node of the CPU the calling thread is running on
+    static size_t currentNode();
+
+    // Node holding the page at address; 0 when it cannot be told
+    static size_t nodeOfAddress(const void* address);
+
+    // cpus ordered by node, then number, so contiguous slices stay on a node
+    static std::vector<size_t> groupByNode(std::vector<size_t> cpus);
+
+    // CPU time used so far by every thread of the process
+    static uint64_t processCpuMicros();
+};
+
+#endif // CPU_TOPOLOGY_H
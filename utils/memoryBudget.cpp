@@ -0,0 +1,88 @@
+#include "memoryBudget.h"
+#include "config.h"
+
+MemoryBudget::MemoryBudget()
+    : limit(SERVER_MEMORY_BUDGET),
+      inUse(0),
+      peak(0),
+      admitted(0),
+      deferred(0),
+      refused(0),
+      waiters(0) {}
+
+MemoryBudget& MemoryBudget::instance() {
+    static MemoryBudget budget;
+    return budget;
+}
+
+bool MemoryBudget::tryReserve(size_t bytes) {
+    if (exceedsLimit(bytes)) {
+        refused.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    size_t current = inUse.load();
+    do {
+        if (current + bytes > limit.load()) {
+            deferred.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    } while (!inUse.compare_exchange_weak(current, current + bytes));
+
+    admitted.fetch_add(1, std::memory_order_relaxed);
+    size_t seen = peak.load(std::memory_order_relaxed);
+    while (current + bytes > seen &&
+           !peak.compare_exchange_weak(seen, current + bytes, std::memory_order_relaxed)) {}
+    return true;
+}
+
+bool MemoryBudget::reserve(size_t bytes, std::chrono::milliseconds timeout) {
+    if (tryReserve(bytes)) return true;
+    if (exceedsLimit(bytes)) return false;
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(waitMutex);
+    waiters.fetch_add(1);
+    bool reserved = false;
+    while (!(reserved = tryReserve(bytes))) {
+        if (waitCondition.wait_until(lock, deadline) == std::cv_status::timeout) {
+            reserved = tryReserve(bytes);
+            break;
+        }
+    }
+    waiters.fetch_sub(1);
+    return reserved;
+}
+
+void MemoryBudget::release(size_t bytes) {
+    if (bytes == 0) return;
+    inUse.fetch_sub(bytes);
+
+    if (waiters.load() > 0) {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        waitCondition.notify_all();
+    }
+}
+
+MemoryBudget::Hold& MemoryBudget::Hold::operator=(Hold&& other) noexcept {
+    if (this != &other) {
+        reset();
+        bytes = std::exchange(other.bytes, 0);
+    }
+    return *this;
+}
+
+void MemoryBudget::Hold::reset() {
+    MemoryBudget::instance().release(std::exchange(bytes, 0));
+}
+
+MemoryBudget::Stats MemoryBudget::getStats() const {
+    Stats stats{};
+    stats.limit = limit.load();
+    stats.inUse = inUse.load();
+    stats.peak = peak.load(std::memory_order_relaxed);
+    stats.admitted = admitted.load(std::memory_order_relaxed);
+    stats.deferred = deferred.load(std::memory_order_relaxed);
+    stats.refused = refused.load(std::memory_order_relaxed);
+    return stats;
+}
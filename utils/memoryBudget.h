@@ -0,0 +1,100 @@
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+// Server-wide cap on the payload bytes held by requests in flight. A request
+// reserves its charge before its payload is allocated and gives it back once
+// its response has been written, so concurrent uploads can only use as much
+// memory as the budget allows instead of whatever their headers ask for.
+//
+// Memory that outlives its request (a decompressed result larger than the
+// upload, a job result waiting to be collected) is charged to a Hold that
+// travels with the response and gives the bytes back when it is destroyed.
+class MemoryBudget {
+public:
+    // Bytes already reserved, returned to the budget on destruction. Moves
+    // but never copies, like the response that carries it.
+    class Hold {
+    public:
+        Hold() : bytes(0) {}
+        explicit Hold(size_t reserved) : bytes(reserved) {}
+        ~Hold() { reset(); }
+
+        Hold(Hold&& other) noexcept : bytes(std::exchange(other.bytes, 0)) {}
+        Hold& operator=(Hold&& other) noexcept;
+        Hold(const Hold&) = delete;
+        Hold& operator=(const Hold&) = delete;
+
+        // Take over other's bytes as well
+        void absorb(Hold&& other) { bytes += std::exchange(other.bytes, 0); }
+
+        // Give the bytes back now
+        void reset();
+
+        // Stop tracking the bytes without returning them; the caller now
+        // releases them itself
+        size_t detach() { return std::exchange(bytes, 0); }
+
+        size_t getBytes() const { return bytes; }
+
+    private:
+        size_t bytes;
+    };
+
+    struct Stats {
+        size_t limit;
+        size_t inUse;
+        size_t peak;
+        uint64_t admitted;
+        uint64_t deferred;    // tryReserve() calls that found no room
+        uint64_t refused;     // requests larger than the whole budget
+    };
+
+    static MemoryBudget& instance();
+
+    // What a request with this much payload is charged: the payload itself
+    // plus a response of about the same size
+    static size_t chargeFor(uint64_t payloadSize) {
+        return static_cast<size_t>(payloadSize) * 2;
+    }
+
+    // Take bytes from the budget if they fit right now
+    bool tryReserve(size_t bytes);
+
+    // Wait up to timeout for bytes to fit (blocking server path)
+    bool reserve(size_t bytes, std::chrono::milliseconds timeout);
+
+    void release(size_t bytes);
+
+    // A charge this large can never be admitted
+    bool exceedsLimit(size_t bytes) const { return bytes > limit.load(); }
+
+    void setLimit(size_t bytes) { limit = bytes; }
+    size_t getLimit() const { return limit.load(); }
+    size_t getInUse() const { return inUse.load(); }
+    Stats getStats() const;
+
+private:
+    MemoryBudget();
+
+    std::atomic<size_t> limit;
+    std::atomic<size_t> inUse;
+    std::atomic<size_t> peak;
+    std::atomic<uint64_t> admitted;
+    std::atomic<uint64_t> deferred;
+    std::atomic<uint64_t> refused;
+
+    // Only used by reserve(); release() signals when anyone waits
+    std::mutex waitMutex;
+    std::condition_variable waitCondition;
+    std::atomic<size_t> waiters;
+};
+
+#endif // MEMORY_BUDGET_H
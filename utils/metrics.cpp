@@ -0,0 +1,285 @@
+#include "metrics.h"
+#include "threadPool.h"
+#include "bufferPool.h"
+#include "memoryBudget.h"
+#include "resultCache.h"
+#include "objectStore.h"
+#include "singleFlight.h"
+#include "writeBehind.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+size_t Metrics::Histogram::bucketFor(uint64_t micros) {
+    micros = std::min<uint64_t>(micros, (uint64_t(2) << MAX_EXPONENT) - 1);
+    if (micros < SUB_BUCKETS) return static_cast<size_t>(micros);
+
+    size_t exponent = 63;
+    while (!(micros >> exponent)) exponent--;
+    const size_t sub = static_cast<size_t>(micros >> (exponent - SUB_BUCKET_BITS)) - SUB_BUCKETS;
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t Metrics::Histogram::upperBound(size_t bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+
+    const size_t shift = bucket / SUB_BUCKETS - 1;
+    const uint64_t lower = static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return lower + (uint64_t(1) << shift) - 1;
+}
+
+uint64_t Metrics::Histogram::percentile(double q) const {
+    if (count == 0) return 0;
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * count + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank) return std::min(upperBound(i), max);
+    }
+    return max;
+}
+
+// Returns the shard to the free list when its thread exits
+struct Metrics::ShardHandle {
+    Shard* shard = nullptr;
+    ~ShardHandle() {
+        if (shard) Metrics::instance().retire(shard);
+    }
+};
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Metrics() : started(std::chrono::steady_clock::now()) {}
+
+Metrics::Shard& Metrics::localShard() {
+    thread_local ShardHandle handle;
+    if (!handle.shard) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!freeShards.empty()) {
+            handle.shard = freeShards.back();
+            freeShards.pop_back();
+        } else {
+            shards.push_back(std::make_unique<Shard>());
+            handle.shard = shards.back().get();
+        }
+    }
+    return *handle.shard;
+}
+
+void Metrics::retire(Shard* shard) {
+    // Its counts stay in the totals; the next thread keeps adding to them
+    std::lock_guard<std::mutex> lock(mutex);
+    freeShards.push_back(shard);
+}
+
+void Metrics::recordRequest(MessageType type, AlgorithmType algorithm, uint64_t bytesIn,
+                            uint64_t bytesOut, bool succeeded,
+                            std::chrono::microseconds latency) {
+    const size_t typeIndex = static_cast<size_t>(type) - 1;
+    const size_t algorithmIndex = static_cast<size_t>(algorithm) - 1;
+    if (typeIndex >= MESSAGE_SLOTS || algorithmIndex >= ALGORITHM_SLOTS) return;
+
+    ShardCell& cell = localShard().cells[typeIndex][algorithmIndex];
+    const uint64_t micros = static_cast<uint64_t>(std::max<int64_t>(0, latency.count()));
+    cell.requests.add(1);
+    if (!succeeded) cell.failures.add(1);
+    cell.bytesIn.add(bytesIn);
+    cell.bytesOut.add(bytesOut);
+    cell.latencySum.add(micros);
+    if (micros > cell.latencyMax.get()) {
+        cell.latencyMax.value.store(micros, std::memory_order_relaxed);
+    }
+    cell.buckets[Histogram::bucketFor(micros)].add(1);
+}
+
+void Metrics::connectionOpened() {
+    localShard().connectionsOpened.add(1);
+}
+
+void Metrics::connectionClosed() {
+    localShard().connectionsClosed.add(1);
+}
+
+void Metrics::requestCancelled(uint64_t bytes) {
+    Shard& shard = localShard();
+    shard.requestsCancelled.add(1);
+    shard.cancelledBytes.add(bytes);
+}
+
+void Metrics::addThreadPool(const ThreadPool* threadPool) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pools.push_back(threadPool);
+}
+
+void Metrics::removeThreadPool(const ThreadPool* threadPool) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pools.erase(std::remove(pools.begin(), pools.end(), threadPool), pools.end());
+}
+
+Metrics::Snapshot Metrics::snapshot() const {
+    Snapshot result{};
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& shard : shards) {
+        for (size_t t = 0; t < MESSAGE_SLOTS; t++) {
+            for (size_t a = 0; a < ALGORITHM_SLOTS; a++) {
+                const ShardCell& from = shard->cells[t][a];
+                Cell& to = result.cells[t][a];
+                to.requests += from.requests.get();
+                to.failures += from.failures.get();
+                to.bytesIn += from.bytesIn.get();
+                to.bytesOut += from.bytesOut.get();
+                to.latency.sum += from.latencySum.get();
+                to.latency.max = std::max(to.latency.max, from.latencyMax.get());
+                for (size_t b = 0; b < HISTOGRAM_BUCKETS; b++) {
+                    const uint64_t count = from.buckets[b].get();
+                    to.latency.counts[b] += count;
+                    to.latency.count += count;
+                }
+            }
+        }
+        result.connectionsOpened += shard->connectionsOpened.get();
+        result.connectionsClosed += shard->connectionsClosed.get();
+        result.requestsCancelled += shard->requestsCancelled.get();
+        result.cancelledBytes += shard->cancelledBytes.get();
+    }
+    result.uptimeSeconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - started).count();
+    return result;
+}
+
+void Metrics::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& shard : shards) {
+        for (auto& row : shard->cells) {
+            for (ShardCell& cell : row) {
+                for (Counter* counter : {&cell.requests, &cell.failures, &cell.bytesIn,
+                                         &cell.bytesOut, &cell.latencySum, &cell.latencyMax}) {
+                    counter->value.store(0, std::memory_order_relaxed);
+                }
+                for (Counter& bucket : cell.buckets) {
+                    bucket.value.store(0, std::memory_order_relaxed);
+                }
+            }
+        }
+        shard->connectionsOpened.value.store(0, std::memory_order_relaxed);
+        shard->connectionsClosed.value.store(0, std::memory_order_relaxed);
+        shard->requestsCancelled.value.store(0, std::memory_order_relaxed);
+        shard->cancelledBytes.value.store(0, std::memory_order_relaxed);
+    }
+    started = std::chrono::steady_clock::now();
+}
+
+std::string Metrics::report() const {
+    const Snapshot stats = snapshot();
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+
+    out << "uptime_seconds " << stats.uptimeSeconds << "\n";
+    out << "connections_active " << (stats.connectionsOpened - stats.connectionsClosed) << "\n";
+    out << "connections_total " << stats.connectionsOpened << "\n";
+    out << "requests_cancelled_total " << stats.requestsCancelled << "\n";
+    out << "requests_cancelled_bytes_total " << stats.cancelledBytes << "\n";
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!pools.empty()) {
+            // Depths add up across server shards; the high-water mark is the worst pool's
+            ThreadPool::Stats workers{};
+            for (const ThreadPool* threadPool : pools) {
+                const ThreadPool::Stats one = threadPool->getStats();
+                workers.threads += one.threads;
+                workers.activeThreads += one.activeThreads;
+                workers.resizes += one.resizes;
+                workers.queueWaitMicros += one.queueWaitMicros;
+                workers.queueDepth += one.queueDepth;
+                workers.largeQueueDepth += one.largeQueueDepth;
+                workers.yields += one.yields;
+                workers.maxQueueDepth = std::max(workers.maxQueueDepth, one.maxQueueDepth);
+                workers.executed += one.executed;
+                workers.steals += one.steals;
+            }
+            out << "pool_count " << pools.size() << "\n";
+            out << "pool_threads " << workers.threads << "\n";
+            out << "pool_active_threads " << workers.activeThreads << "\n";
+            out << "pool_resizes_total " << workers.resizes << "\n";
+            out << "pool_queue_wait_us_total " << workers.queueWaitMicros << "\n";
+            out << "pool_queue_depth " << workers.queueDepth << "\n";
+            out << "pool_queue_depth_max " << workers.maxQueueDepth << "\n";
+            out << "pool_large_queue_depth " << workers.largeQueueDepth << "\n";
+            out << "pool_large_yields_total " << workers.yields << "\n";
+            out << "pool_tasks_total " << workers.executed << "\n";
+            out << "pool_steals_total " << workers.steals << "\n";
+        }
+    }
+
+    for (size_t t = 0; t < MESSAGE_SLOTS; t++) {
+        for (size_t a = 0; a < ALGORITHM_SLOTS; a++) {
+            const Cell& cell = stats.cells[t][a];
+            if (cell.requests == 0) continue;
+
+            const std::string labels =
+                "{type=\"" + messageTypeToString(static_cast<MessageType>(t + 1)) +
+                "\",algorithm=\"" + algorithmTypeToString(static_cast<AlgorithmType>(a + 1)) +
+                "\"";
+            out << "requests_total" << labels << "} " << cell.requests << "\n";
+            out << "request_failures_total" << labels << "} " << cell.failures << "\n";
+            out << "request_bytes_in_total" << labels << "} " << cell.bytesIn << "\n";
+            out << "request_bytes_out_total" << labels << "} " << cell.bytesOut << "\n";
+            for (const char* q : {"0.5", "0.9", "0.99", "0.999"}) {
+                out << "request_latency_us" << labels << ",quantile=\"" << q << "\"} "
+                    << cell.latency.percentile(std::stod(q)) << "\n";
+            }
+            out << "request_latency_us_max" << labels << "} " << cell.latency.max << "\n";
+            out << "request_latency_us_mean" << labels << "} "
+                << static_cast<double>(cell.latency.sum) / cell.latency.count << "\n";
+
+            // Bytes per microsecond of processing is MB/s
+            if (cell.latency.sum > 0) {
+                out << "request_throughput_mb_per_s" << labels << "} "
+                    << static_cast<double>(cell.bytesIn) / cell.latency.sum << "\n";
+            }
+        }
+    }
+
+    BufferPool::Stats buffers = BufferPool::instance().getStats();
+    out << "buffer_pool_acquires_total " << buffers.acquires << "\n";
+    out << "buffer_pool_hit_rate " << buffers.hitRate() << "\n";
+    out << "buffer_pool_discarded_total " << buffers.discarded << "\n";
+    out << "buffer_pool_bytes " << buffers.pooledBytes << "\n";
+
+    MemoryBudget::Stats budget = MemoryBudget::instance().getStats();
+    out << "memory_budget_in_use_bytes " << budget.inUse << "\n";
+    out << "memory_budget_peak_bytes " << budget.peak << "\n";
+    out << "memory_budget_limit_bytes " << budget.limit << "\n";
+    out << "memory_budget_deferred_total " << budget.deferred << "\n";
+    out << "memory_budget_refused_total " << budget.refused << "\n";
+
+    ResultCache::Stats cache = ResultCache::instance().getStats();
+    out << "result_cache_hits_total " << cache.hits << "\n";
+    out << "result_cache_misses_total " << cache.misses << "\n";
+    out << "result_cache_evictions_total " << cache.evictions << "\n";
+    out << "result_cache_entries " << cache.entries << "\n";
+    out << "result_cache_bytes " << cache.bytes << "\n";
+
+    ObjectStore::Stats store = ObjectStore::instance().getStats();
+    out << "object_store_hits_total " << store.hits << "\n";
+    out << "object_store_misses_total " << store.misses << "\n";
+    out << "object_store_objects " << store.objects << "\n";
+    out << "object_store_bytes " << store.bytes << "\n";
+
+    SingleFlight::Stats flights = SingleFlight::instance().getStats();
+    out << "single_flight_coalesced_total " << flights.coalesced << "\n";
+    out << "single_flight_in_flight " << flights.inFlight << "\n";
+
+    WriteBehind::Stats writes = WriteBehind::instance().getStats();
+    out << "write_behind_written_total " << writes.written << "\n";
+    out << "write_behind_failed_total " << writes.failed << "\n";
+    out << "write_behind_pending_files " << writes.pendingFiles << "\n";
+    out << "write_behind_pending_bytes " << writes.pendingBytes << "\n";
+
+    return out.str();
+}
@@ -0,0 +1,132 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "messageTypes.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class ThreadPool;
+
+// Live server metrics, answered to STATS requests as text.
+//
+// Every request is counted per MessageType x AlgorithmType: requests,
+// failures, bytes in and out, and a latency histogram. Recording never takes
+// a lock: each thread owns a shard of counters that only it writes, and a
+// snapshot adds the shards up. A thread's shard is handed to the next new
+// thread when it exits, so short-lived threads do not pile up shards.
+//
+// The report also carries the gauges and counters of the other subsystems
+// (connections, pool queue depth, buffer pool, memory budget, result cache,
+// object store, single-flight and write-behind).
+class Metrics {
+public:
+    // Log-linear latency histogram in microseconds, in the style of HDR
+    // histograms: values below SUB_BUCKETS get a bucket each, and every
+    // power of two above that is split into SUB_BUCKETS equal buckets, so a
+    // bucket's bound is within 1/SUB_BUCKETS of any value in it.
+    static constexpr size_t SUB_BUCKET_BITS = 3;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    static constexpr size_t MAX_EXPONENT = 40;                 // ~12 days
+    static constexpr size_t HISTOGRAM_BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    struct Histogram {
+        std::array<uint64_t, HISTOGRAM_BUCKETS> counts{};
+        uint64_t count = 0;
+        uint64_t sum = 0;   // microseconds
+        uint64_t max = 0;
+
+        static size_t bucketFor(uint64_t micros);
+        static uint64_t upperBound(size_t bucket); // largest value in bucket
+
+        // Smallest bucket bound with at least fraction q of the values at
+        // or below it (clamped to max); 0 when empty
+        uint64_t percentile(double q) const;
+    };
+
+    struct Cell {
+        uint64_t requests = 0;
+        uint64_t failures = 0;
+        uint64_t bytesIn = 0;
+        uint64_t bytesOut = 0;
+        Histogram latency;
+    };
+
+    // Message types 1..MESSAGE_SLOTS and algorithms 1..ALGORITHM_SLOTS
+    static constexpr size_t MESSAGE_SLOTS = 8;
+    static constexpr size_t ALGORITHM_SLOTS = 2;
+
+    struct Snapshot {
+        std::array<std::array<Cell, ALGORITHM_SLOTS>, MESSAGE_SLOTS> cells;
+        uint64_t connectionsOpened;
+        uint64_t connectionsClosed;
+        uint64_t requestsCancelled;
+        uint64_t cancelledBytes;    // payload bytes left unprocessed
+        double uptimeSeconds;
+    };
+
+    static Metrics& instance();
+
+    // Count one finished request; types or algorithms out of range are dropped
+    void recordRequest(MessageType type, AlgorithmType algorithm, uint64_t bytesIn,
+                       uint64_t bytesOut, bool succeeded, std::chrono::microseconds latency);
+
+    void connectionOpened();
+    void connectionClosed();
+
+    // A request dropped because its client went away, with its payload
+    // size. Cancelled requests are not also counted by recordRequest.
+    void requestCancelled(uint64_t bytes);
+
+    // Queue depth and thread count are read from these pools, summed over
+    // the server's event-loop shards
+    void addThreadPool(const ThreadPool* pool);
+    void removeThreadPool(const ThreadPool* pool);
+
+    Snapshot snapshot() const;
+
+    // One "name{labels} value" line per metric
+    std::string report() const;
+
+    // Forget everything recorded so far (tests)
+    void reset();
+
+private:
+    // Written only by the owning thread; read by snapshots
+    struct Counter {
+        std::atomic<uint64_t> value{0};
+        void add(uint64_t n) { value.store(value.load(std::memory_order_relaxed) + n,
+                                           std::memory_order_relaxed); }
+        uint64_t get() const { return value.load(std::memory_order_relaxed); }
+    };
+    struct ShardCell {
+        Counter requests, failures, bytesIn, bytesOut, latencySum, latencyMax;
+        std::array<Counter, HISTOGRAM_BUCKETS> buckets;
+    };
+    struct Shard {
+        std::array<std::array<ShardCell, ALGORITHM_SLOTS>, MESSAGE_SLOTS> cells;
+        Counter connectionsOpened;
+        Counter connectionsClosed;
+        Counter requestsCancelled;
+        Counter cancelledBytes;
+    };
+    struct ShardHandle;
+
+    Metrics();
+    Shard& localShard();
+    void retire(Shard* shard);
+
+    mutable std::mutex mutex;                    // guards the shard and pool lists
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<Shard*> freeShards;              // left behind by exited threads
+    std::vector<const ThreadPool*> pools;
+    std::chrono::steady_clock::time_point started;
+};
+
+#endif // METRICS_H
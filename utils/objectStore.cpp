@@ -0,0 +1,479 @@
+#include "objectStore.h"
+#include "bufferPool.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <unordered_set>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char INDEX_MAGIC[8] = {'C', 'Z', 'S', 'T', 'O', 'R', 'E', '1'};
+constexpr uint32_t INDEX_VERSION = 1;
+constexpr char OBJECT_MAGIC[4] = {'C', 'Z', 'O', 'B'};
+constexpr uint32_t MAX_OBJECT_TEXT = 4096; // algorithm name and message
+
+// Precedes the output bytes in every object file
+struct ObjectHeader {
+    char magic[4];
+    uint32_t nameLength;
+    uint32_t messageLength;
+    uint32_t reserved;
+    uint64_t dataSize;
+};
+
+uint32_t roundUpToPowerOfTwo(uint32_t value) {
+    uint32_t result = 16;
+    while (result < value && result < (1u << 30)) result <<= 1;
+    return result;
+}
+
+// Write parts to path and sync them, so a rename never publishes an object
+// whose bytes are only in the page cache
+bool writeSynced(const std::string& path, const std::vector<std::pair<const void*, size_t>>& parts) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool ok = true;
+    for (const auto& part : parts) {
+        const char* bytes = static_cast<const char*>(part.first);
+        size_t offset = 0;
+        while (ok && offset < part.second) {
+            const ssize_t count = ::write(fd, bytes + offset, part.second - offset);
+            if (count < 0 && errno == EINTR) continue;
+            ok = count > 0;
+            if (ok) offset += static_cast<size_t>(count);
+        }
+    }
+    ok = ok && ::fsync(fd) == 0;
+    return ::close(fd) == 0 && ok;
+#else
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    for (const auto& part : parts) {
+        file.write(static_cast<const char*>(part.first), part.second);
+    }
+    file.close();
+    return static_cast<bool>(file);
+#endif
+}
+
+} // namespace
+
+// index.bin is this header followed by slotCount slots, in host byte order
+struct ObjectStore::IndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t slotCount;
+    uint64_t count;     // used slots
+    uint64_t bytes;     // sum of objectSize over used slots
+    uint64_t clock;     // logical time for recency
+};
+
+// Open addressing with linear probing; removal shifts later entries back,
+// so there are no tombstones
+struct ObjectStore::Slot {
+    uint64_t hash;
+    uint64_t size;
+    uint64_t objectSize;
+    uint64_t lastUsed;
+    uint8_t type;
+    uint8_t algorithm;
+    uint8_t used;
+    uint8_t reserved[5];
+};
+
+ObjectStore::ObjectStore()
+    : index(nullptr),
+      mappedSize(0),
+      indexFd(-1),
+      maxBytes(STORE_MAX_BYTES),
+      tempCounter(0),
+      hits(0),
+      misses(0),
+      stores(0),
+      evictions(0) {}
+
+ObjectStore::~ObjectStore() {
+    close();
+}
+
+ObjectStore& ObjectStore::instance() {
+    static ObjectStore store;
+    return store;
+}
+
+#ifdef _WIN32
+
+bool ObjectStore::open(const std::string& dir, uint64_t, uint32_t) {
+    Logger::warning("Object store not supported on this platform: " + dir);
+    return false;
+}
+
+void ObjectStore::close() {}
+
+#else
+
+bool ObjectStore::open(const std::string& dir, uint64_t limit, uint32_t slotCount) {
+    close();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::error_code error;
+    fs::create_directories(fs::path(dir) / "objects", error);
+    if (error) {
+        Logger::error("Failed to create object store in " + dir + ": " + error.message());
+        return false;
+    }
+
+    slotCount = roundUpToPowerOfTwo(slotCount);
+    const size_t size = sizeof(IndexHeader) + static_cast<size_t>(slotCount) * sizeof(Slot);
+    const std::string indexPath = (fs::path(dir) / "index.bin").string();
+
+    int fd = ::open(indexPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        Logger::error("Failed to open object store index " + indexPath + ": " +
+                      std::to_string(errno));
+        return false;
+    }
+
+    struct stat info;
+    const bool sized = (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) == size);
+    if (!sized && (ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(size)) != 0)) {
+        Logger::error("Failed to size object store index: " + std::to_string(errno));
+        ::close(fd);
+        return false;
+    }
+
+    void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        Logger::error("Failed to map object store index: " + std::to_string(errno));
+        ::close(fd);
+        return false;
+    }
+
+    IndexHeader* header = static_cast<IndexHeader*>(mapped);
+    const bool valid = sized && std::memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+                       header->version == INDEX_VERSION && header->slotCount == slotCount;
+    if (!valid) {
+        // Objects of an index we cannot read are unreachable
+        fs::remove_all(fs::path(dir) / "objects", error);
+        fs::create_directories(fs::path(dir) / "objects", error);
+        std::memset(mapped, 0, size);
+        std::memcpy(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        header->version = INDEX_VERSION;
+        header->slotCount = slotCount;
+        Logger::info("Created object store index in " + dir);
+    } else {
+        Logger::info("Opened object store in " + dir + " with " +
+                     std::to_string(header->count) + " objects (" +
+                     std::to_string(header->bytes) + " bytes)");
+    }
+
+    directory = dir;
+    index = header;
+    mappedSize = size;
+    indexFd = fd;
+    maxBytes = limit;
+
+    // Recency order from the clock values stored in the index
+    std::vector<const Slot*> used;
+    used.reserve(static_cast<size_t>(index->count));
+    for (uint32_t i = 0; i < slotCount; i++) {
+        if (slots()[i].used) used.push_back(&slots()[i]);
+    }
+    std::sort(used.begin(), used.end(),
+              [](const Slot* a, const Slot* b) { return a->lastUsed > b->lastUsed; });
+    for (const Slot* slot : used) {
+        recency.push_back(keyOf(*slot));
+        recencyOf[recency.back()] = std::prev(recency.end());
+    }
+    if (valid) removeStrayObjects();
+
+    while (!recency.empty() && index->bytes > maxBytes) {
+        evictOldest();
+    }
+    return true;
+}
+
+void ObjectStore::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!index) return;
+
+    msync(index, mappedSize, MS_ASYNC);
+    munmap(index, mappedSize);
+    ::close(indexFd);
+    index = nullptr;
+    mappedSize = 0;
+    indexFd = -1;
+    recency.clear();
+    recencyOf.clear();
+}
+
+#endif // _WIN32
+
+bool ObjectStore::isOpen() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return index != nullptr;
+}
+
+ObjectStore::Slot* ObjectStore::slots() const {
+    return reinterpret_cast<Slot*>(index + 1);
+}
+
+ObjectStore::Slot* ObjectStore::find(const ResultCache::Key& key) const {
+    const uint64_t mask = index->slotCount - 1;
+    Slot* table = slots();
+    for (uint64_t i = key.hash & mask; table[i].used; i = (i + 1) & mask) {
+        const Slot& slot = table[i];
+        if (slot.hash == key.hash && slot.size == key.size &&
+            slot.type == static_cast<uint8_t>(key.type) &&
+            slot.algorithm == static_cast<uint8_t>(key.algorithm)) {
+            return &table[i];
+        }
+    }
+    return nullptr;
+}
+
+ResultCache::Key ObjectStore::keyOf(const Slot& slot) {
+    ResultCache::Key key;
+    key.hash = slot.hash;
+    key.size = slot.size;
+    key.type = static_cast<MessageType>(slot.type);
+    key.algorithm = static_cast<AlgorithmType>(slot.algorithm);
+    return key;
+}
+
+void ObjectStore::touch(const ResultCache::Key& key) {
+    auto found = recencyOf.find(key);
+    if (found != recencyOf.end()) {
+        recency.splice(recency.begin(), recency, found->second);
+    } else {
+        recency.push_front(key);
+        recencyOf[key] = recency.begin();
+    }
+}
+
+void ObjectStore::remove(Slot* slot) {
+    const uint64_t mask = index->slotCount - 1;
+    Slot* table = slots();
+    auto found = recencyOf.find(keyOf(*slot));
+    if (found != recencyOf.end()) {
+        recency.erase(found->second);
+        recencyOf.erase(found);
+    }
+    index->count--;
+    index->bytes -= slot->objectSize;
+
+    // Backward-shift: pull later entries of the probe run into the hole
+    // unless their home slot lies between the hole and where they are
+    uint64_t hole = static_cast<uint64_t>(slot - table);
+    table[hole].used = 0;
+    for (uint64_t next = (hole + 1) & mask; table[next].used; next = (next + 1) & mask) {
+        const uint64_t home = table[next].hash & mask;
+        const bool reachable = (hole <= next) ? (hole < home && home <= next)
+                                              : (hole < home || home <= next);
+        if (reachable) continue;
+        table[hole] = table[next];
+        table[next].used = 0;
+        hole = next;
+    }
+}
+
+void ObjectStore::evictOldest() {
+    if (recency.empty()) return;
+    const ResultCache::Key key = recency.back();
+    Slot* oldest = find(key);
+    if (!oldest) {
+        // Not in the index any more; nothing to delete
+        recencyOf.erase(key);
+        recency.pop_back();
+        return;
+    }
+
+    std::error_code error;
+    fs::remove(objectPath(key), error);
+    remove(oldest);
+    evictions++;
+}
+
+void ObjectStore::removeStrayObjects() {
+    // Temporary files of writes cut short, and objects whose slot was lost
+    // (evicted or dropped before a crash): nothing can reach them
+    std::unordered_set<std::string> indexed;
+    indexed.reserve(recency.size());
+    for (const ResultCache::Key& key : recency) {
+        indexed.insert(fs::path(objectPath(key)).filename().string());
+    }
+
+    size_t removed = 0;
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(fs::path(directory) / "objects", error)) {
+        if (indexed.count(entry.path().filename().string())) continue;
+        std::error_code removeError;
+        if (fs::remove(entry.path(), removeError)) removed++;
+    }
+    if (removed > 0) {
+        Logger::info("Removed " + std::to_string(removed) + " stray files from the object store");
+    }
+}
+
+std::string ObjectStore::objectPath(const ResultCache::Key& key) const {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx-%llx-%u%u",
+                  static_cast<unsigned long long>(key.hash),
+                  static_cast<unsigned long long>(key.size),
+                  static_cast<unsigned>(key.type), static_cast<unsigned>(key.algorithm));
+    return (fs::path(directory) / "objects" / name).string();
+}
+
+bool ObjectStore::fetch(const ResultCache::Key& key, std::vector<uint8_t>& data,
+                        std::string& algorithmName, std::string& message) {
+    std::string path;
+    uint64_t expectedSize = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!index) return false;
+        Slot* slot = find(key);
+        if (!slot) {
+            misses++;
+            return false;
+        }
+        slot->lastUsed = ++index->clock;
+        touch(key);
+        expectedSize = slot->objectSize;
+        path = objectPath(key);
+    }
+
+    // The file is read without the lock; an eviction meanwhile only unlinks it
+    std::ifstream file(path, std::ios::binary);
+    ObjectHeader header;
+    bool valid = file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+                 std::memcmp(header.magic, OBJECT_MAGIC, sizeof(OBJECT_MAGIC)) == 0 &&
+                 header.dataSize == expectedSize &&
+                 header.nameLength <= MAX_OBJECT_TEXT && header.messageLength <= MAX_OBJECT_TEXT;
+    if (valid) {
+        algorithmName.resize(header.nameLength);
+        message.resize(header.messageLength);
+        data = BufferPool::instance().acquire(static_cast<size_t>(header.dataSize));
+        valid = file.read(&algorithmName[0], header.nameLength) &&
+                file.read(&message[0], header.messageLength) &&
+                file.read(reinterpret_cast<char*>(data.data()), data.size());
+    }
+
+    if (!valid) {
+        Logger::warning("Dropping unreadable object " + path);
+        BufferPool::instance().release(std::move(data));
+        data.clear();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (index) {
+            Slot* slot = find(key);
+            if (slot) remove(slot);
+            std::error_code error;
+            fs::remove(path, error);
+        }
+        misses++;
+        return false;
+    }
+
+    hits++;
+    return true;
+}
+
+bool ObjectStore::store(const ResultCache::Key& key, const std::vector<uint8_t>& data,
+                        const std::string& algorithmName, const std::string& message) {
+    if (data.size() > STORE_MAX_OBJECT_SIZE || algorithmName.size() > MAX_OBJECT_TEXT ||
+        message.size() > MAX_OBJECT_TEXT) {
+        return false;
+    }
+
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!index || data.size() > maxBytes) return false;
+        if (find(key)) return true;
+        path = objectPath(key);
+    }
+
+    // Written and synced under a private name, then renamed into place below
+    const std::string tempPath = path + ".tmp" + std::to_string(tempCounter++);
+    ObjectHeader header{};
+    std::memcpy(header.magic, OBJECT_MAGIC, sizeof(OBJECT_MAGIC));
+    header.nameLength = static_cast<uint32_t>(algorithmName.size());
+    header.messageLength = static_cast<uint32_t>(message.size());
+    header.dataSize = data.size();
+    if (!writeSynced(tempPath, {{&header, sizeof(header)},
+                                {algorithmName.data(), algorithmName.size()},
+                                {message.data(), message.size()},
+                                {data.data(), data.size()}})) {
+        Logger::error("Failed to write object " + tempPath);
+        std::error_code error;
+        fs::remove(tempPath, error);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::error_code error;
+    if (!index || find(key)) {
+        fs::remove(tempPath, error);
+        return index != nullptr;
+    }
+
+    // Keep the table at most three quarters full so probe runs stay short
+    while (!recency.empty() && (index->count + 1 > index->slotCount / 4 * 3 ||
+                                index->bytes + data.size() > maxBytes)) {
+        evictOldest();
+    }
+
+    fs::rename(tempPath, path, error);
+    if (error) {
+        Logger::error("Failed to store object " + path + ": " + error.message());
+        fs::remove(tempPath, error);
+        return false;
+    }
+
+    const uint64_t mask = index->slotCount - 1;
+    Slot* table = slots();
+    uint64_t i = key.hash & mask;
+    while (table[i].used) i = (i + 1) & mask;
+
+    Slot& slot = table[i];
+    slot.hash = key.hash;
+    slot.size = key.size;
+    slot.objectSize = data.size();
+    slot.lastUsed = ++index->clock;
+    slot.type = static_cast<uint8_t>(key.type);
+    slot.algorithm = static_cast<uint8_t>(key.algorithm);
+    slot.used = 1;
+    index->count++;
+    index->bytes += data.size();
+    touch(key);
+    stores++;
+    return true;
+}
+
+ObjectStore::Stats ObjectStore::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats{};
+    stats.objects = index ? static_cast<size_t>(index->count) : 0;
+    stats.bytes = index ? index->bytes : 0;
+    stats.maxBytes = maxBytes;
+    stats.hits = hits.load();
+    stats.misses = misses.load();
+    stats.stores = stores.load();
+    stats.evictions = evictions.load();
+    return stats;
+}
@@ -0,0 +1,98 @@
+#ifndef OBJECT_STORE_H
+#define OBJECT_STORE_H
+
+#include "resultCache.h"
+#include "config.h"
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Content-addressed store of finished results on disk, behind the in-memory
+// ResultCache. Each result is one file under objects/, named after its key,
+// so results from different clients never collide. A fixed-size hash table
+// in index.bin, memory-mapped, maps keys to objects; a restarted server
+// maps it again and serves stored results straight away, without scanning.
+//
+// Disk use is bounded: past maxBytes (or a full index) the least recently
+// used objects are deleted. Recency is a logical clock kept in the index,
+// so it survives restarts; in memory the keys are also kept in recency
+// order, so finding the oldest does not scan the index.
+//
+// Objects are synced before they are renamed into place. open() deletes
+// leftover temporary files and objects the index does not know about.
+//
+// Memory mapping is POSIX-only; elsewhere open() fails and the server runs
+// without the store.
+class ObjectStore {
+public:
+    struct Stats {
+        size_t objects;
+        uint64_t bytes;
+        uint64_t maxBytes;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t stores;
+        uint64_t evictions;
+    };
+
+    static ObjectStore& instance();
+
+    // Map (or create) the index under directory. slots is rounded up to a
+    // power of two; an index created with another slot count is rebuilt.
+    bool open(const std::string& directory, uint64_t maxBytes = STORE_MAX_BYTES,
+              uint32_t slots = STORE_INDEX_SLOTS);
+    void close();
+    bool isOpen() const;
+
+    // Read a stored result into a pooled buffer and mark it recently used
+    bool fetch(const ResultCache::Key& key, std::vector<uint8_t>& data,
+               std::string& algorithmName, std::string& message);
+
+    // Write a result; objects are renamed into place, so readers never see
+    // a partial file
+    bool store(const ResultCache::Key& key, const std::vector<uint8_t>& data,
+               const std::string& algorithmName, const std::string& message);
+
+    Stats getStats() const;
+
+    ~ObjectStore();
+
+private:
+    struct IndexHeader;
+    struct Slot;
+
+    ObjectStore();
+
+    Slot* slots() const;
+    Slot* find(const ResultCache::Key& key) const;
+    void remove(Slot* slot);
+    void touch(const ResultCache::Key& key); // make key the most recently used
+    void evictOldest();
+    void removeStrayObjects();
+    static ResultCache::Key keyOf(const Slot& slot);
+    std::string objectPath(const ResultCache::Key& key) const;
+
+    mutable std::mutex mutex;
+    std::string directory;
+    IndexHeader* index;       // mapped index.bin, null while closed
+    size_t mappedSize;
+    int indexFd;
+    uint64_t maxBytes;
+    std::atomic<uint64_t> tempCounter;
+
+    using RecencyList = std::list<ResultCache::Key>;
+    RecencyList recency;      // most recently used first, rebuilt on open
+    std::unordered_map<ResultCache::Key, RecencyList::iterator, ResultCache::KeyHash> recencyOf;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> stores;
+    std::atomic<uint64_t> evictions;
+};
+
+#endif // OBJECT_STORE_H
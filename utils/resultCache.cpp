@@ -0,0 +1,109 @@
+#include "resultCache.h"
+#include "checksum.h"
+#include "config.h"
+
+ResultCache::ResultCache()
+    : bytes(0),
+      limit(RESULT_CACHE_MAX_BYTES),
+      hits(0),
+      misses(0),
+      insertions(0),
+      evictions(0) {}
+
+ResultCache& ResultCache::instance() {
+    static ResultCache cache;
+    return cache;
+}
+
+ResultCache::Key ResultCache::keyFor(MessageType type, AlgorithmType algorithm,
+                                     const std::vector<uint8_t>& payload) {
+    Key key;
+    key.hash = Checksum::hash64(payload.data(), payload.size());
+    key.size = payload.size();
+    key.type = type;
+    key.algorithm = algorithm;
+    return key;
+}
+
+bool ResultCache::lookup(const Key& key, Result& result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end()) {
+        misses++;
+        return false;
+    }
+
+    entries.splice(entries.begin(), entries, it->second);
+    result = it->second->result;
+    hits++;
+    return true;
+}
+
+void ResultCache::insert(const Key& key, const std::vector<uint8_t>& data,
+                         const std::string& algorithmName, const std::string& message) {
+    if (data.size() > RESULT_CACHE_MAX_ENTRY_SIZE) return;
+
+    // Copy outside the lock; concurrent hits only wait for the list update
+    Result result;
+    result.data = std::make_shared<const std::vector<uint8_t>>(data);
+    result.algorithmName = algorithmName;
+    result.message = message;
+    insert(key, result);
+}
+
+void ResultCache::insert(const Key& key, const Result& result) {
+    if (!result.data) return;
+    const size_t size = result.data->size();
+    if (size > RESULT_CACHE_MAX_ENTRY_SIZE) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (size > limit) return;
+    if (index.count(key)) return; // another worker stored it first
+
+    evictToFit(size);
+    entries.push_front(Entry{key, result});
+    index.emplace(key, entries.begin());
+    bytes += size;
+    insertions++;
+}
+
+void ResultCache::evictToFit(size_t incoming) {
+    while (!entries.empty() && bytes + incoming > limit) {
+        Entry& oldest = entries.back();
+        bytes -= oldest.result.data->size();
+        index.erase(oldest.key);
+        entries.pop_back();
+        evictions++;
+    }
+}
+
+void ResultCache::setLimit(size_t newLimit) {
+    std::lock_guard<std::mutex> lock(mutex);
+    limit = newLimit;
+    evictToFit(0);
+}
+
+size_t ResultCache::getLimit() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return limit;
+}
+
+void ResultCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    index.clear();
+    entries.clear();
+    bytes = 0;
+}
+
+ResultCache::Stats ResultCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats{};
+    stats.entries = entries.size();
+    stats.bytes = bytes;
+    stats.limit = limit;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.insertions = insertions;
+    stats.evictions = evictions;
+    return stats;
+}
@@ -0,0 +1,104 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include "messageTypes.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Server-wide LRU cache of finished results, keyed by a hash of the request
+// payload together with the operation and codec. Clients that upload the
+// same file again get the stored output back for the cost of hashing it;
+// the codec is not run. Holds at most getLimit() bytes of output and evicts
+// the least recently used results to stay under it.
+class ResultCache {
+public:
+    struct Key {
+        uint64_t hash;        // Checksum::hash64 of the payload
+        uint64_t size;        // payload length, a second guard against collisions
+        MessageType type;
+        AlgorithmType algorithm;
+
+        bool operator==(const Key& other) const {
+            return hash == other.hash && size == other.size &&
+                   type == other.type && algorithm == other.algorithm;
+        }
+    };
+
+    // A cached output. The bytes are shared and immutable, so a hit copies
+    // them out without holding the cache lock.
+    struct Result {
+        std::shared_ptr<const std::vector<uint8_t>> data;
+        std::string algorithmName; // names the output file
+        std::string message;
+    };
+
+    struct Stats {
+        size_t entries;
+        size_t bytes;
+        size_t limit;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t insertions;
+        uint64_t evictions;
+
+        double hitRate() const {
+            return hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.0;
+        }
+    };
+
+    static ResultCache& instance();
+
+    static Key keyFor(MessageType type, AlgorithmType algorithm,
+                      const std::vector<uint8_t>& payload);
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return static_cast<size_t>(key.hash); }
+    };
+
+    // Fill result and mark it most recently used
+    bool lookup(const Key& key, Result& result);
+
+    // Store a result, sharing its bytes; results larger than the entry
+    // limit are skipped
+    void insert(const Key& key, const Result& result);
+
+    // Store a copy of data
+    void insert(const Key& key, const std::vector<uint8_t>& data,
+                const std::string& algorithmName, const std::string& message);
+
+    // 0 disables the cache; shrinking evicts at once
+    void setLimit(size_t bytes);
+    size_t getLimit() const;
+
+    void clear();
+    Stats getStats() const;
+
+private:
+    ResultCache();
+
+    struct Entry {
+        Key key;
+        Result result;
+    };
+
+    void evictToFit(size_t bytes);
+
+    mutable std::mutex mutex;
+    std::list<Entry> entries;   // most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+    size_t bytes;
+    size_t limit;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;
+};
+
+#endif // RESULT_CACHE_H
@@ -0,0 +1,80 @@
+#include "singleFlight.h"
+
+SingleFlight::SingleFlight() : leaders(0), coalesced(0), bytesSaved(0) {}
+
+SingleFlight& SingleFlight::instance() {
+    static SingleFlight singleFlight;
+    return singleFlight;
+}
+
+bool SingleFlight::join(const ResultCache::Key& key, Outcome& outcome) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = flights.find(key);
+    if (it == flights.end()) {
+        flights.emplace(key, std::make_shared<Flight>());
+        leaders++;
+        return true;
+    }
+
+    // Hold the flight itself: the leader drops it from the map when done
+    std::shared_ptr<Flight> flight = it->second;
+    flight->followers++;
+    flight->finished.wait(lock, [&flight] { return flight->done; });
+    outcome = flight->outcome;
+    if (!outcome.abandoned) {
+        coalesced++;
+        bytesSaved += key.size;
+    }
+    return false;
+}
+
+bool SingleFlight::join(const ResultCache::Key& key, Callback onFinish) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = flights.find(key);
+    if (it == flights.end()) {
+        flights.emplace(key, std::make_shared<Flight>());
+        leaders++;
+        return true;
+    }
+    it->second->callbacks.push_back(std::move(onFinish));
+    return false;
+}
+
+void SingleFlight::finish(const ResultCache::Key& key, const Outcome& outcome,
+                          const std::vector<uint8_t>& data) {
+    std::shared_ptr<Flight> flight;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = flights.find(key);
+        if (it == flights.end()) return;
+        flight = std::move(it->second);
+        flights.erase(it);
+
+        // Nobody can join once the flight leaves the map, so an uncontended
+        // request never pays for the copy
+        flight->done = true;
+        flight->outcome = outcome;
+        const bool followed = flight->followers > 0 || !flight->callbacks.empty();
+        if (followed && outcome.status == OperationStatus::SUCCESS && !outcome.result.data) {
+            flight->outcome.result.data = std::make_shared<const std::vector<uint8_t>>(data);
+        }
+        if (!outcome.abandoned) {
+            coalesced += flight->callbacks.size();
+            bytesSaved += flight->callbacks.size() * key.size;
+        }
+        flight->finished.notify_all();
+    }
+
+    // Outside the lock: a callback may join again straight away
+    for (const Callback& callback : flight->callbacks) callback(flight->outcome);
+}
+
+SingleFlight::Stats SingleFlight::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats{};
+    stats.leaders = leaders;
+    stats.coalesced = coalesced;
+    stats.bytesSaved = bytesSaved;
+    stats.inFlight = flights.size();
+    return stats;
+}
@@ -0,0 +1,76 @@
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+#include "resultCache.h"
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Merges concurrent requests for the same result onto one computation.
+// The first request for a key leads: it checks the caches and otherwise
+// runs the codec. Requests with the same key that arrive before it finishes
+// are handed its outcome: on the blocking path they wait for it, on the pool
+// they leave a callback and give their worker back. The ResultCache covers
+// repeats after a result exists; this covers the burst before it does.
+class SingleFlight {
+public:
+    struct Outcome {
+        OperationStatus status = OperationStatus::FAILURE;
+        ResultCache::Result result; // data is empty unless status is SUCCESS
+        bool abandoned = false;     // the leader's client went away; join again
+    };
+
+    struct Stats {
+        uint64_t leaders;       // requests that looked the result up themselves
+        uint64_t coalesced;     // requests answered from another's computation
+        uint64_t bytesSaved;    // their payload bytes, not processed again
+        size_t inFlight;
+    };
+
+    // Called once with the leader's outcome, from the thread calling finish()
+    using Callback = std::function<void(const Outcome&)>;
+
+    static SingleFlight& instance();
+
+    // True: the caller leads for key and must call finish() once.
+    // False: the key was already in flight; outcome holds the leader's result.
+    // An abandoned outcome holds nothing, and whoever joins again first
+    // leads the next attempt.
+    bool join(const ResultCache::Key& key, Outcome& outcome);
+
+    // As above without waiting: when the key is in flight, onFinish gets the
+    // leader's outcome later. It runs on the leader's thread, so it should
+    // only hand the work on. An abandoned outcome means join again.
+    bool join(const ResultCache::Key& key, Callback onFinish);
+
+    // Hand the leader's outcome to everyone waiting on key. Without shared
+    // bytes in outcome, data is copied, but only if anyone is waiting.
+    void finish(const ResultCache::Key& key, const Outcome& outcome,
+                const std::vector<uint8_t>& data);
+
+    Stats getStats() const;
+
+private:
+    SingleFlight();
+
+    struct Flight {
+        bool done = false;
+        size_t followers = 0;           // waiting in join()
+        std::vector<Callback> callbacks; // followers that did not wait
+        Outcome outcome;
+        std::condition_variable finished;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<ResultCache::Key, std::shared_ptr<Flight>, ResultCache::KeyHash> flights;
+    uint64_t leaders;
+    uint64_t coalesced;
+    uint64_t bytesSaved;
+};
+
+#endif // SINGLE_FLIGHT_H
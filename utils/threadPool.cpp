@@ -0,0 +1,548 @@
+#include "threadPool.h"
+#include "cpuTopology.h"
+#include "logger.h"
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+// Pool and deque index of the calling thread, if it is a worker
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentIndex = 0;
+thread_local bool currentLarge = false;     // inside a large-lane task
+
+// Rounds of looking for work before an idle worker parks
+constexpr int SPIN_ROUNDS = 64;
+
+#ifdef __linux__
+bool pinThread(pthread_t thread, const std::vector<size_t>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t cpu : cpus) {
+        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    if (CPU_COUNT(&set) == 0) return false;
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+#endif
+}
+
+ThreadPool::ThreadPool(size_t threadCount, size_t reservedWorkers)
+    : reserved(0),
+      largePending(0),
+      yields(0),
+      pending(0),
+      active(0),
+      maxPending(0),
+      submitted(0),
+      nextQueue(0),
+      stopping(false),
+      stopped(false),
+      parked(0),
+      helped(0),
+      activeCount(0),
+      resizes(0),
+      queueWait(0),
+      dequeued(0) {
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+        if (threadCount == 0) threadCount = 1;
+    }
+    reserved = std::min(reservedWorkers, threadCount - 1);
+    activeCount = threadCount;
+
+    for (size_t i = 0; i < threadCount; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threadCount; i++) {
+        workers[i]->thread = std::thread(&ThreadPool::workerLoop, this, i);
+    }
+
+    Logger::info("Thread pool started with " + std::to_string(threadCount) + " workers, " +
+                 std::to_string(reserved) + " reserved for small requests");
+}
+
+ThreadPool::~ThreadPool() {
+    shutdown();
+}
+
+int ThreadPool::currentWorkerIndex() const {
+    return currentPool == this ? static_cast<int>(currentIndex) : -1;
+}
+
+void ThreadPool::noteDepth(size_t depth) {
+    size_t seen = maxPending.load(std::memory_order_relaxed);
+    while (depth > seen &&
+           !maxPending.compare_exchange_weak(seen, depth, std::memory_order_relaxed)) {}
+}
+
+void ThreadPool::push(size_t index, Task&& task) {
+    // Counted before it is visible, so a thief never takes pending below zero
+    noteDepth(pending.fetch_add(1) + 1 + largePending.load(std::memory_order_relaxed));
+    submitted.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mutex);
+        workers[index]->tasks.push_back({std::move(task), std::chrono::steady_clock::now()});
+    }
+    notifyParked(false);
+}
+
+void ThreadPool::notifyParked(bool everyone) {
+    // Pairs with the parked increment in workerLoop: either the sleeper sees
+    // the new task or we see the sleeper
+    if (parked.load() > 0) {
+        std::lock_guard<std::mutex> lock(parkMutex);
+        // A reserved worker would go back to sleep on a large task, taking
+        // the wakeup with it
+        if (everyone) {
+            parkCondition.notify_all();
+        } else {
+            parkCondition.notify_one();
+        }
+    }
+}
+
+void ThreadPool::submit(Task task) {
+    if (stopped.load()) {
+        // Nobody is left to run it; do it here rather than lose it
+        task();
+        return;
+    }
+
+    int self = currentWorkerIndex();
+    size_t index = self >= 0
+        ? static_cast<size_t>(self)
+        : nextQueue.fetch_add(1, std::memory_order_relaxed) % getActiveCount();
+    push(index, std::move(task));
+}
+
+void ThreadPool::submitLarge(uint64_t owner, Task task) {
+    if (stopped.load()) {
+        task();
+        return;
+    }
+
+    submitted.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(largeMutex);
+        std::deque<Queued>& queue = largeTasks[owner];
+        if (queue.empty()) largeTurns.push_back(owner);
+        queue.push_back({std::move(task), std::chrono::steady_clock::now()});
+        noteDepth(largePending.fetch_add(1) + 1 + pending.load(std::memory_order_relaxed));
+    }
+    notifyParked(true);
+}
+
+bool ThreadPool::popLarge(Task& task) {
+    if (largePending.load(std::memory_order_relaxed) == 0) return false;
+
+    std::lock_guard<std::mutex> lock(largeMutex);
+    if (largeTurns.empty()) return false;
+
+    // The owner goes to the back of the line once it has had its turn
+    const uint64_t owner = largeTurns.front();
+    largeTurns.pop_front();
+    auto queue = largeTasks.find(owner);
+    noteWait(queue->second.front());
+    task = std::move(queue->second.front().task);
+    queue->second.pop_front();
+    if (queue->second.empty()) {
+        largeTasks.erase(queue);
+    } else {
+        largeTurns.push_back(owner);
+    }
+    largePending.fetch_sub(1);
+    return true;
+}
+
+bool ThreadPool::popLocal(size_t index, Task& task) {
+    Worker& worker = *workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) return false;
+    noteWait(worker.tasks.back());
+    task = std::move(worker.tasks.back().task);
+    worker.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t thief, Task& task) {
+    const size_t count = workers.size();
+    for (size_t offset = 1; offset <= count; offset++) {
+        Worker& victim = *workers[(thief + offset) % count];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.tasks.empty()) continue;
+
+        // Oldest task: likely the largest remaining piece of work
+        noteWait(victim.tasks.front());
+        task = std::move(victim.tasks.front().task);
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+bool ThreadPool::findTask(int index, Task& task) {
+    if (pending.load(std::memory_order_relaxed) == 0) return false;
+
+    bool found = false;
+    if (index >= 0) {
+        found = popLocal(static_cast<size_t>(index), task);
+        if (!found && steal(static_cast<size_t>(index), task)) {
+            workers[index]->steals.fetch_add(1, std::memory_order_relaxed);
+            found = true;
+        }
+    } else {
+        found = steal(nextQueue.load(std::memory_order_relaxed) % getActiveCount(), task);
+    }
+
+    if (found) pending.fetch_sub(1);
+    return found;
+}
+
+void ThreadPool::noteWait(const Queued& queued) {
+    const auto waited = std::chrono::steady_clock::now() - queued.since;
+    queueWait.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(waited).count(),
+                        std::memory_order_relaxed);
+    dequeued.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool ThreadPool::hasWork(size_t index) const {
+    return pending.load(std::memory_order_relaxed) > 0 ||
+           (index >= reserved && largePending.load(std::memory_order_relaxed) > 0);
+}
+
+void ThreadPool::run(int index, Task& task, bool large) {
+    // Saved for small tasks run from inside a large one by yieldToSmall
+    const bool outer = currentLarge;
+    currentLarge = large;
+    if (index >= 0) {
+        active.fetch_add(1, std::memory_order_relaxed);
+        task();
+        active.fetch_sub(1, std::memory_order_relaxed);
+        workers[index]->executed.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        task();
+        helped.fetch_add(1, std::memory_order_relaxed);
+    }
+    currentLarge = outer;
+}
+
+bool ThreadPool::runPendingTask() {
+    int index = currentWorkerIndex();
+    Task task;
+    if (!findTask(index, task)) return false;
+    run(index, task);
+    return true;
+}
+
+bool ThreadPool::inLargeTask() const {
+    return currentPool == this && currentLarge;
+}
+
+bool ThreadPool::yieldToSmall() {
+    if (!inLargeTask()) return false;
+
+    // Only what is queued now: a steady trickle of small tasks must not
+    // stall the large job for good
+    const int index = currentWorkerIndex();
+    size_t budget = pending.load(std::memory_order_relaxed);
+    bool ran = false;
+    Task task;
+    while (budget > 0 && findTask(index, task)) {
+        run(index, task);
+        budget--;
+        ran = true;
+    }
+    if (ran) yields.fetch_add(1, std::memory_order_relaxed);
+    return ran;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentIndex = index;
+    Worker& self = *workers[index];
+
+    while (true) {
+        if (index >= getActiveCount()) {
+            // Standing by until the pool grows again; tasks left on our
+            // deque are stolen by the active workers
+            std::unique_lock<std::mutex> lock(parkMutex);
+            standbyCondition.wait(lock, [this, index] {
+                return index < getActiveCount() || stopping.load();
+            });
+            if (index >= getActiveCount()) return;
+            continue;
+        }
+
+        Task task;
+        bool found = false;
+        bool large = false;
+        for (int round = 0; round < SPIN_ROUNDS && !found; round++) {
+            // Retired mid-spin: stand by instead
+            if (index >= getActiveCount()) break;
+            // Small tasks first; reserved workers never start a large one
+            found = findTask(static_cast<int>(index), task);
+            if (!found && index >= reserved) {
+                found = large = popLarge(task);
+            }
+            if (!found && !hasWork(index)) {
+                if (stopping.load()) return;
+                std::this_thread::yield();
+            }
+        }
+
+        if (found) {
+            run(static_cast<int>(index), task, large);
+            continue;
+        }
+        if (index >= getActiveCount()) continue;
+
+        std::unique_lock<std::mutex> lock(parkMutex);
+        parked.fetch_add(1);
+        self.parks.fetch_add(1, std::memory_order_relaxed);
+        parkCondition.wait(lock, [this, index] {
+            return hasWork(index) || stopping.load() || index >= getActiveCount();
+        });
+        parked.fetch_sub(1);
+    }
+}
+
+size_t ThreadPool::spareWorkers() const {
+    const size_t busy = active.load(std::memory_order_relaxed) +
+                        pending.load(std::memory_order_relaxed) +
+                        largePending.load(std::memory_order_relaxed);
+    const size_t workerCount = getActiveCount();
+    return busy < workerCount ? workerCount - busy : 0;
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) return;
+
+    // Shared with the helpers, which may still sit in a queue after the
+    // caller has returned; they only touch body while indices remain, and
+    // the caller cannot return before every index has finished
+    struct Job {
+        const std::function<void(size_t)>* body;
+        size_t count;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> finished{0};
+        std::atomic<size_t> waiting{0};     // helpers queued but not started
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto job = std::make_shared<Job>();
+    job->body = &body;
+    job->count = count;
+
+    // Claim and run one index; false once none are left
+    auto step = [](Job& shared) {
+        size_t index = shared.next.fetch_add(1);
+        if (index >= shared.count) return false;
+        (*shared.body)(index);
+        if (shared.finished.fetch_add(1) + 1 == shared.count) {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            shared.done.notify_all();
+        }
+        return true;
+    };
+
+    if (!stopped.load()) {
+        const size_t helpers = std::min(spareWorkers(), count - 1);
+        job->waiting = helpers;
+        for (size_t i = 0; i < helpers; i++) {
+            submit([this, job, step] {
+                job->waiting.fetch_sub(1);
+                // Other work queued up (beyond our own helpers): give way
+                while (step(*job) &&
+                       pending.load(std::memory_order_relaxed) <= job->waiting.load()) {}
+            });
+        }
+    }
+
+    // Each index is a block boundary for a large job: small tasks queued in
+    // the meantime (other than our own helpers) run before the next one
+    const bool sliced = inLargeTask();
+    while (step(*job)) {
+        if (sliced && pending.load(std::memory_order_relaxed) > job->waiting.load()) {
+            yieldToSmall();
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->done.wait(lock, [&job] { return job->finished.load() == job->count; });
+}
+
+void ThreadPool::shutdown() {
+    if (stopped.load()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(parkMutex);
+        stopping = true;
+    }
+    parkCondition.notify_all();
+    standbyCondition.notify_all();
+    sizerWake.notify_all();
+    if (sizer.joinable()) sizer.join();
+
+    // Workers exit only once both lanes are empty, so queued work still runs
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+
+    Stats stats = getStats();
+    Logger::info("Thread pool stopped: " + std::to_string(stats.executed) + " tasks, " +
+                 std::to_string(stats.steals) + " steals, " +
+                 std::to_string(stats.parks) + " parks, max queue depth " +
+                 std::to_string(stats.maxQueueDepth));
+    stopped = true;
+}
+
+void ThreadPool::setActiveCount(size_t count) {
+    count = std::clamp(count, std::min(reserved + 1, workers.size()), workers.size());
+    size_t previous;
+    {
+        std::lock_guard<std::mutex> lock(parkMutex);
+        previous = activeCount.exchange(count);
+    }
+    if (count == previous) return;
+    resizes.fetch_add(1, std::memory_order_relaxed);
+    if (count > previous) {
+        standbyCondition.notify_all();
+    } else {
+        // Parked workers now past the count move over to standing by, so a
+        // later notify_one always reaches a worker that will take the task
+        parkCondition.notify_all();
+    }
+}
+
+size_t ThreadPool::nextActiveCount(size_t active, size_t maxThreads, const Sizing& sizing,
+                                   std::chrono::microseconds queueWait, double cpusUsed,
+                                   bool idleWorker) {
+    const size_t floor = std::min(std::max<size_t>(1, sizing.minThreads), maxThreads);
+    active = std::clamp(active, floor, maxThreads);
+    // Busy CPUs would only be shared out more thinly by another worker
+    if (queueWait > sizing.growWait && cpusUsed < sizing.cpuBudget - 0.5 &&
+        active < maxThreads) {
+        return active + 1;
+    }
+    if (idleWorker && queueWait * 2 <= sizing.growWait && active > floor) {
+        return active - 1;
+    }
+    return active;
+}
+
+void ThreadPool::startAutoSizing(const Sizing& sizing) {
+    if (stopped.load() || stopping.load() || sizer.joinable()) return;
+    setActiveCount(sizing.minThreads);
+    sizer = std::thread(&ThreadPool::sizeLoop, this, sizing);
+}
+
+void ThreadPool::sizeLoop(Sizing sizing) {
+    auto parks = [this] {
+        uint64_t total = 0;
+        for (const auto& worker : workers) total += worker->parks.load(std::memory_order_relaxed);
+        return total;
+    };
+    auto lastTime = std::chrono::steady_clock::now();
+    uint64_t lastCpu = CpuTopology::processCpuMicros();
+    uint64_t lastWait = queueWait.load();
+    uint64_t lastDequeued = dequeued.load();
+    uint64_t lastParks = parks();
+
+    std::unique_lock<std::mutex> lock(parkMutex);
+    while (!sizerWake.wait_for(lock, sizing.interval, [this] { return stopping.load(); })) {
+        lock.unlock();
+        const auto now = std::chrono::steady_clock::now();
+        const uint64_t cpu = CpuTopology::processCpuMicros();
+        const uint64_t waited = queueWait.load();
+        const uint64_t started = dequeued.load();
+        const uint64_t parksNow = parks();
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - lastTime);
+        const double cpusUsed = elapsed.count() > 0
+            ? static_cast<double>(cpu - lastCpu) / static_cast<double>(elapsed.count()) : 0;
+        // Nothing started although tasks are queued: they waited all along
+        std::chrono::microseconds wait(0);
+        if (started > lastDequeued) {
+            wait = std::chrono::microseconds((waited - lastWait) / (started - lastDequeued));
+        } else if (pending.load() + largePending.load() > 0) {
+            wait = elapsed;
+        }
+
+        const size_t current = getActiveCount();
+        // Idle: a worker parked during the interval, or is still parked
+        const bool idle = parksNow > lastParks || parked.load() > 0;
+        const size_t next = nextActiveCount(current, workers.size(), sizing, wait, cpusUsed, idle);
+        if (next != current) setActiveCount(next);
+
+        lastTime = now;
+        lastCpu = cpu;
+        lastWait = waited;
+        lastDequeued = started;
+        lastParks = parksNow;
+        lock.lock();
+    }
+}
+
+bool ThreadPool::pinWorkers(const std::vector<size_t>& cpus) {
+#ifdef __linux__
+    if (stopped.load()) return false;
+    bool pinned = true;
+    for (auto& worker : workers) {
+        pinned = pinThread(worker->thread.native_handle(), cpus) && pinned;
+    }
+    return pinned;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+bool ThreadPool::pinCurrentThread(const std::vector<size_t>& cpus) {
+#ifdef __linux__
+    return pinThread(pthread_self(), cpus);
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+std::vector<size_t> ThreadPool::availableCpus() {
+    std::vector<size_t> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (size_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        const size_t count = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t cpu = 0; cpu < count; cpu++) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+ThreadPool::Stats ThreadPool::getStats() const {
+    Stats stats{};
+    stats.threads = workers.size();
+    stats.submitted = submitted.load(std::memory_order_relaxed);
+    stats.largeQueueDepth = largePending.load(std::memory_order_relaxed);
+    stats.queueDepth = pending.load(std::memory_order_relaxed) + stats.largeQueueDepth;
+    stats.yields = yields.load(std::memory_order_relaxed);
+    stats.maxQueueDepth = maxPending.load(std::memory_order_relaxed);
+    stats.activeThreads = getActiveCount();
+    stats.resizes = resizes.load(std::memory_order_relaxed);
+    stats.queueWaitMicros = queueWait.load(std::memory_order_relaxed);
+    stats.executed = helped.load(std::memory_order_relaxed);
+    for (const auto& worker : workers) {
+        stats.executed += worker->executed.load(std::memory_order_relaxed);
+        stats.steals += worker->steals.load(std::memory_order_relaxed);
+        stats.parks += worker->parks.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
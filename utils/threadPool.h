@@ -0,0 +1,204 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+// Work-stealing task scheduler. Every worker owns a deque: it pushes and pops
+// its own tasks at the back (newest first, still warm in cache) while idle
+// workers steal from the front of the others. Tasks submitted from outside
+// the pool are spread round-robin over the deques, so there is no single
+// queue lock for everyone to fight over.
+//
+// Idle workers spin briefly and then park on a condition variable; a submit
+// only touches the parking lock when someone is actually parked.
+//
+// Size-aware lanes: submit() is the small lane and always goes first.
+// Large jobs go through submitLarge() into a FIFO per owner (a client
+// connection), and the owners take turns, so one client's burst of uploads
+// does not queue everyone else's behind it. Reserved workers never start a
+// large job, and a large job gives way to queued small tasks at every
+// parallelFor index (its block boundaries), so small requests wait for at
+// most one slice of a large one.
+//
+// Adaptive sizing: only the first getActiveCount() workers take tasks; the
+// rest stand by, parked. startAutoSizing() moves that count with measured
+// queue wait, adding a worker while tasks wait and the process has CPU to
+// spare (workers are blocked, not busy) and retiring one once idle again.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    struct Stats {
+        size_t threads;
+        uint64_t submitted;
+        uint64_t executed;
+        uint64_t steals;        // tasks taken from another worker's deque
+        uint64_t parks;         // times a worker went to sleep
+        size_t queueDepth;      // tasks waiting right now, both lanes
+        size_t maxQueueDepth;   // high-water mark of queueDepth
+        size_t largeQueueDepth; // of which in the large lane
+        uint64_t yields;        // times a large job ran small tasks mid-way
+        size_t activeThreads;   // workers taking tasks; the rest stand by
+        uint64_t resizes;       // changes to activeThreads
+        uint64_t queueWaitMicros; // time tasks spent queued, summed
+    };
+
+    struct Sizing {
+        size_t minThreads;                  // never fewer active
+        double cpuBudget;                   // CPUs' worth of time the process may use
+        std::chrono::microseconds growWait; // average queue wait that calls for a worker
+        std::chrono::milliseconds interval; // between adjustments
+    };
+
+    // threadCount 0 means one worker per hardware thread. The first
+    // reservedWorkers workers only run small-lane tasks; at least one worker
+    // is always left for the large lane.
+    explicit ThreadPool(size_t threadCount = 0, size_t reservedWorkers = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a small-lane task. From a worker it goes on that worker's own deque.
+    void submit(Task task);
+
+    // Queue a large-lane task behind the owner's earlier ones. Started only
+    // when no small task is waiting.
+    void submitLarge(uint64_t owner, Task task);
+
+    // Run one queued small-lane task on the calling thread, if there is one.
+    // Lets a thread that waits on other tasks help instead of blocking a worker.
+    bool runPendingTask();
+
+    // Called by a large job at a block boundary: runs the small tasks queued
+    // right now on this thread. False, and nothing run, outside a large job.
+    bool yieldToSmall();
+
+    // Whether the calling thread is running a large-lane task of this pool
+    bool inLargeTask() const;
+
+    // Call body(0) .. body(count - 1) and return once all calls are done.
+    // The caller works through the indices itself and is joined by at most
+    // one helper per spare worker. Helpers take one index at a time and hand
+    // their worker back as soon as other tasks are queued, so one large job
+    // never holds up short requests for longer than a single index. A caller
+    // inside a large job yields to small tasks between its own indices.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    // Workers that are neither running a task nor about to pick one up
+    size_t spareWorkers() const;
+
+    // Run everything still queued, then stop and join the workers. Tasks
+    // submitted afterwards run on the caller.
+    void shutdown();
+
+    // Start at sizing.minThreads active workers and adjust every
+    // sizing.interval (see nextActiveCount) until shutdown
+    void startAutoSizing(const Sizing& sizing);
+
+    // One adjustment: a worker more while tasks waited longer than growWait
+    // on average and the process left over half a CPU of its budget unused;
+    // a worker less, down to minThreads, once tasks barely wait and an
+    // active worker ran out of work
+    static size_t nextActiveCount(size_t active, size_t maxThreads, const Sizing& sizing,
+                                  std::chrono::microseconds queueWait, double cpusUsed,
+                                  bool idleWorker);
+
+    // Let the first count workers take tasks; at least one beyond the
+    // reserved ones, at most getThreadCount()
+    void setActiveCount(size_t count);
+    size_t getActiveCount() const { return activeCount.load(std::memory_order_relaxed); }
+
+    // Restrict every worker to the given CPUs (Linux only; false elsewhere
+    // or when the kernel refuses the set)
+    bool pinWorkers(const std::vector<size_t>& cpus);
+
+    // The same for the calling thread
+    static bool pinCurrentThread(const std::vector<size_t>& cpus);
+
+    // CPUs this process may run on, in ascending order; 0 .. hardware
+    // threads - 1 where the affinity mask cannot be read
+    static std::vector<size_t> availableCpus();
+
+    size_t getThreadCount() const { return workers.size(); }
+    size_t getReservedWorkers() const { return reserved; }
+    Stats getStats() const;
+
+    // Index of the calling worker in the current pool, or -1 outside it
+    int currentWorkerIndex() const;
+
+private:
+    struct Queued {
+        Task task;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Queued> tasks;
+        std::thread thread;
+
+        // Written by the owning worker only; read for stats
+        std::atomic<uint64_t> executed{0};
+        std::atomic<uint64_t> steals{0};
+        std::atomic<uint64_t> parks{0};
+    };
+
+    void workerLoop(size_t index);
+    void run(int index, Task& task, bool large = false);
+    void push(size_t index, Task&& task);
+    bool popLocal(size_t index, Task& task);
+    bool steal(size_t thief, Task& task);
+    bool popLarge(Task& task);
+    bool findTask(int index, Task& task);
+    bool hasWork(size_t index) const;
+    void notifyParked(bool everyone);
+    void noteDepth(size_t depth);
+    void noteWait(const Queued& queued);
+    void sizeLoop(Sizing sizing);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    size_t reserved;                    // workers 0 .. reserved - 1 skip the large lane
+
+    // Large lane: a FIFO per owner, owners served round-robin
+    std::mutex largeMutex;
+    std::unordered_map<uint64_t, std::deque<Queued>> largeTasks;
+    std::deque<uint64_t> largeTurns;    // owners with queued tasks, next first
+    std::atomic<size_t> largePending;
+    std::atomic<uint64_t> yields;
+
+    std::atomic<size_t> pending;        // small lane: queued, not yet started
+    std::atomic<size_t> active;         // workers inside a task
+    std::atomic<size_t> maxPending;
+    std::atomic<uint64_t> submitted;
+    std::atomic<size_t> nextQueue;      // round-robin target for outside submits
+    std::atomic<bool> stopping;
+    std::atomic<bool> stopped;          // workers joined; submit runs inline
+
+    std::mutex parkMutex;
+    std::condition_variable parkCondition;
+    std::atomic<size_t> parked;
+    std::atomic<uint64_t> helped;       // tasks run by outside threads
+
+    // Adaptive sizing; workers at activeCount and above stand by
+    std::atomic<size_t> activeCount;
+    std::atomic<uint64_t> resizes;
+    std::atomic<uint64_t> queueWait;    // microseconds, summed over dequeued tasks
+    std::atomic<uint64_t> dequeued;
+    std::condition_variable standbyCondition;   // with parkMutex
+    std::condition_variable sizerWake;
+    std::thread sizer;
+};
+
+#endif // THREAD_POOL_H
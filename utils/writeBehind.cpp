@@ -0,0 +1,278 @@
+#include "writeBehind.h"
+#include "bufferPool.h"
+#include "logger.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <system_error>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// A written but not yet synced file. Windows has no descriptor to keep:
+// the stream is closed after writing and syncs are skipped.
+struct TempFile {
+    int fd = -1;
+
+    bool write(const std::string& path, const std::vector<uint8_t>& data) {
+#ifndef _WIN32
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) return false;
+        size_t offset = 0;
+        while (offset < data.size()) {
+            ssize_t count = ::write(fd, data.data() + offset, data.size() - offset);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                close();
+                return false;
+            }
+            offset += static_cast<size_t>(count);
+        }
+        return true;
+#else
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        file.close();
+        return static_cast<bool>(file);
+#endif
+    }
+
+    bool sync() {
+#ifndef _WIN32
+        return fd < 0 || ::fsync(fd) == 0;
+#else
+        return true;
+#endif
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (fd >= 0) ::close(fd);
+#endif
+        fd = -1;
+    }
+};
+
+// Make renames into directory durable
+void syncDirectory(const std::string& directory) {
+#ifndef _WIN32
+    int fd = ::open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+#else
+    (void)directory;
+#endif
+}
+
+} // namespace
+
+WriteBehind& WriteBehind::instance() {
+    static WriteBehind writer;
+    return writer;
+}
+
+WriteBehind::WriteBehind()
+    : queuedBytes(0),
+      batchBytes(0),
+      writing(false),
+      stopped(false),
+      maxBytes(WRITE_BEHIND_MAX_BYTES),
+      sync(WRITE_BEHIND_SYNC),
+      tempCounter(0),
+      queued(0),
+      written(0),
+      failed(0),
+      skipped(0),
+      batches(0),
+      bytesWritten(0) {}
+
+WriteBehind::~WriteBehind() {
+    shutdown();
+}
+
+bool WriteBehind::write(std::string path, std::vector<uint8_t>&& data, bool keepExisting,
+                        MemoryBudget::Hold charge) {
+    // Bounded: wait for the I/O thread to catch up. An oversized file still
+    // goes through once the queue is empty.
+    std::unique_lock<std::mutex> lock(mutex);
+    const size_t size = data.size();
+    spaceReady.wait(lock, [&] {
+        return stopped || queuedBytes + batchBytes == 0 ||
+               queuedBytes + batchBytes + size <= maxBytes.load();
+    });
+
+    if (stopped) {
+        // No thread any more: write on the caller's thread, as before
+        lock.unlock();
+        std::list<Entry> batch;
+        batch.push_back(Entry{std::move(path), std::move(data), keepExisting, std::move(charge)});
+        const bool ok = writeBatch(batch) == 0;
+        BufferPool::instance().release(std::move(batch.front().data));
+        batch.front().charge.reset();
+        return ok;
+    }
+
+    if (!thread.joinable()) {
+        thread = std::thread([this] { run(); });
+    }
+    queue.push_back(Entry{std::move(path), std::move(data), keepExisting, std::move(charge)});
+    pending[queue.back().path] = &queue.back();
+    queuedBytes += size;
+    queued++;
+    workReady.notify_one();
+    return true;
+}
+
+void WriteBehind::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        workReady.wait(lock, [this] { return stopped || !queue.empty(); });
+        if (queue.empty()) break; // stopped with nothing left to write
+
+        // Everything queued so far is one batch and shares its syncs. The
+        // entries keep their addresses, so pending still finds them.
+        std::list<Entry> batch;
+        batch.splice(batch.end(), queue);
+        batchBytes = queuedBytes;
+        queuedBytes = 0;
+        writing = true;
+
+        lock.unlock();
+        writeBatch(batch);
+        lock.lock();
+
+        // On disk (or failed) now: readers go to the file from here on
+        for (Entry& entry : batch) {
+            auto found = pending.find(entry.path);
+            if (found != pending.end() && found->second == &entry) pending.erase(found);
+            BufferPool::instance().release(std::move(entry.data));
+            entry.charge.reset();
+        }
+        batchBytes = 0;
+        writing = false;
+        spaceReady.notify_all();
+    }
+}
+
+size_t WriteBehind::writeBatch(std::list<Entry>& batch) {
+    struct Staged {
+        Entry* entry;
+        std::string tempPath;
+        TempFile file;
+    };
+    std::vector<Staged> staged;
+    std::set<std::string> directories;
+    std::error_code error;
+    size_t failures = 0;
+
+    for (Entry& entry : batch) {
+        if (entry.keepExisting && fs::exists(entry.path, error)) {
+            skipped++;
+            continue;
+        }
+
+        const fs::path parent = fs::path(entry.path).parent_path();
+        if (!parent.empty() && directories.insert(parent.string()).second) {
+            fs::create_directories(parent, error);
+        }
+
+        // Written under a private name, renamed into place once synced
+        Staged file{&entry, entry.path + ".tmp" + std::to_string(tempCounter++), {}};
+        if (!file.file.write(file.tempPath, entry.data)) {
+            Logger::error("Failed to write file: " + entry.path);
+            fs::remove(file.tempPath, error);
+            failures++;
+            continue;
+        }
+        staged.push_back(std::move(file));
+    }
+
+    const bool syncing = sync.load();
+    for (Staged& file : staged) {
+        bool ok = !syncing || file.file.sync();
+        file.file.close();
+        if (ok) {
+            fs::rename(file.tempPath, file.entry->path, error);
+            ok = !error;
+        }
+        if (!ok) {
+            Logger::error("Failed to write file: " + file.entry->path);
+            fs::remove(file.tempPath, error);
+            failures++;
+            continue;
+        }
+        written++;
+        bytesWritten += file.entry->data.size();
+        Logger::info("Successfully wrote file: " + file.entry->path + " (" +
+                     std::to_string(file.entry->data.size()) + " bytes)");
+    }
+
+    if (syncing && !staged.empty()) {
+        for (const std::string& directory : directories) syncDirectory(directory);
+    }
+    batches++;
+    failed += failures;
+    return failures;
+}
+
+bool WriteBehind::pendingSize(const std::string& path, size_t& size) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = pending.find(path);
+    if (found == pending.end()) return false;
+    size = found->second->data.size();
+    return true;
+}
+
+bool WriteBehind::readPending(const std::string& path, std::vector<uint8_t>& data) const {
+    // The I/O thread only reads an entry's data until it takes the lock to
+    // drop it from pending, so copying under the lock is safe
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = pending.find(path);
+    if (found == pending.end()) return false;
+    const std::vector<uint8_t>& queuedData = found->second->data;
+    data = BufferPool::instance().acquire(queuedData.size());
+    if (!queuedData.empty()) std::memcpy(data.data(), queuedData.data(), queuedData.size());
+    return true;
+}
+
+void WriteBehind::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    spaceReady.wait(lock, [this] { return queue.empty() && !writing; });
+}
+
+void WriteBehind::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopped) return;
+        stopped = true;
+    }
+    // The thread drains the queue before it sees stopped with nothing left
+    workReady.notify_all();
+    spaceReady.notify_all();
+    if (thread.joinable()) thread.join();
+}
+
+WriteBehind::Stats WriteBehind::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats;
+    stats.queued = queued.load();
+    stats.written = written.load();
+    stats.failed = failed.load();
+    stats.skipped = skipped.load();
+    stats.batches = batches.load();
+    stats.bytesWritten = bytesWritten.load();
+    stats.pendingFiles = queue.size();
+    stats.pendingBytes = queuedBytes + batchBytes;
+    return stats;
+}
@@ -0,0 +1,111 @@
+#ifndef WRITE_BEHIND_H
+#define WRITE_BEHIND_H
+
+#include "config.h"
+#include "memoryBudget.h"
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Writes server output files on a dedicated I/O thread, so responses go out
+// as soon as their data is in memory instead of after the disk write.
+//
+// write() queues a file and returns. The thread takes whatever has queued
+// up as one batch: every file is written under a temporary name, then the
+// batch is synced together (one fsync per file, one per directory) and each
+// file renamed into place, so a reader never sees a partial file.
+//
+// The queue is bounded by maxBytes of file data; write() waits for room
+// rather than let a slow disk pile up memory. Failed writes are logged and
+// counted in the stats; the response has already gone out by then.
+//
+// Until a file is renamed into place its bytes can be read back by path
+// (pendingSize/readPending), so a fetch never has to wait on the disk.
+// A MemoryBudget charge queued with the data is held until then too.
+class WriteBehind {
+public:
+    struct Stats {
+        uint64_t queued;
+        uint64_t written;
+        uint64_t failed;
+        uint64_t skipped;       // keepExisting files that were already there
+        uint64_t batches;
+        uint64_t bytesWritten;
+        size_t pendingFiles;
+        size_t pendingBytes;
+    };
+
+    static WriteBehind& instance();
+
+    // Queue data (a pooled buffer, returned to the pool once written) for
+    // path; with keepExisting a file already at path is left alone. charge
+    // is given back at the same time. After shutdown() the write happens on
+    // the calling thread and its result is returned.
+    bool write(std::string path, std::vector<uint8_t>&& data, bool keepExisting = false,
+               MemoryBudget::Hold charge = MemoryBudget::Hold());
+
+    // Size of the newest data queued for path that is not on disk yet;
+    // false when nothing is pending for it
+    bool pendingSize(const std::string& path, size_t& size) const;
+
+    // A pooled copy of that data; false once it has been written
+    bool readPending(const std::string& path, std::vector<uint8_t>& data) const;
+
+    // Wait until everything queued so far is on disk
+    void flush();
+
+    // Flush, then stop the I/O thread
+    void shutdown();
+
+    // fsync each batch (WRITE_BEHIND_SYNC by default)
+    void setSync(bool enabled) { sync = enabled; }
+
+    void setLimit(size_t bytes) { maxBytes = bytes; }
+    Stats getStats() const;
+
+    ~WriteBehind();
+
+private:
+    struct Entry {
+        std::string path;
+        std::vector<uint8_t> data;
+        bool keepExisting;
+        MemoryBudget::Hold charge;
+    };
+
+    WriteBehind();
+
+    void run();
+    size_t writeBatch(std::list<Entry>& batch); // returns the number that failed
+
+    mutable std::mutex mutex;
+    std::condition_variable workReady;    // signalled to the I/O thread
+    std::condition_variable spaceReady;   // signalled to writers and flush()
+    std::list<Entry> queue;               // spliced whole into a batch
+    std::unordered_map<std::string, const Entry*> pending; // newest unwritten entry per path
+    size_t queuedBytes;
+    size_t batchBytes;                    // being written by the I/O thread
+    bool writing;
+    bool stopped;
+    std::thread thread;
+
+    std::atomic<size_t> maxBytes;
+    std::atomic<bool> sync;
+    std::atomic<uint64_t> tempCounter;
+
+    std::atomic<uint64_t> queued;
+    std::atomic<uint64_t> written;
+    std::atomic<uint64_t> failed;
+    std::atomic<uint64_t> skipped;
+    std::atomic<uint64_t> batches;
+    std::atomic<uint64_t> bytesWritten;
+};
+
+#endif // WRITE_BEHIND_H